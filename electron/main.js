@@ -35,11 +35,27 @@ try {
 /* ── State ─────────────────────────────────────────────────────────────────── */
 let mainWindow = null;
 
+/** Where flight-recorder dumps (automatic and on demand) are written. */
+function flightRecorderDir() {
+  return path.join(app.getPath('userData'), 'flight');
+}
+
 /* ── App Lifecycle ─────────────────────────────────────────────────────────── */
 
 app.whenReady().then(() => {
+  /* Persist per-device latency calibration across runs. */
+  if (typeof addon.setLatencyCacheFile === 'function') {
+    addon.setLatencyCacheFile(path.join(app.getPath('userData'), 'latency-cache.tsv'));
+  }
+  /* Keep the last ~30 s of audio when the device glitches (flight recorder). */
+  if (typeof addon.setFlightRecorderDir === 'function') {
+    const flightDir = flightRecorderDir();
+    fs.mkdirSync(flightDir, { recursive: true });
+    addon.setFlightRecorderDir(flightDir);
+  }
   createMainWindow();
   createTray(mainWindow);
+  watchDevices();
 });
 
 /* Prevent app from quitting when all windows are closed (tray app behavior). */
@@ -96,6 +112,27 @@ function createMainWindow() {
   });
 }
 
+/* ── Device Hotplug ────────────────────────────────────────────────────────── */
+
+/**
+ * Forward native device-list changes to the renderer.
+ * The addon keeps a cached device list, re-scanned on the OS's hotplug
+ * notifications, so the renderer can re-populate its selects without a
+ * slow re-enumeration. Showing the window also asks for a re-scan, which
+ * covers platforms without notifications.
+ */
+function watchDevices() {
+  if (typeof addon.onDevicesChanged !== 'function') return;
+  addon.onDevicesChanged((devices) => {
+    if (mainWindow && !mainWindow.isDestroyed()) {
+      mainWindow.webContents.send('audio:devices-changed', devices);
+    }
+  });
+  if (typeof addon.refreshDevices === 'function' && mainWindow) {
+    mainWindow.on('show', () => addon.refreshDevices());
+  }
+}
+
 /* ── IPC Handlers ──────────────────────────────────────────────────────────── */
 
 /**
@@ -111,14 +148,14 @@ ipcMain.handle('audio:get-devices', () => {
 
 /**
  * audio:start -> { success: boolean, error?: string }
- * @param {number} inputIdx  - Input device index (-1 for default)
- * @param {number} outputIdx - Output device index (-1 for default)
+ * @param {string|number} input  - Input device id, or -1 for default
+ * @param {string|number} output - Output device id, or -1 default / -2 none
  */
-ipcMain.handle('audio:start', (_event, inputIdx, outputIdx) => {
+ipcMain.handle('audio:start', (_event, input, output) => {
   try {
     const errMsg = addon.start(
-      inputIdx !== undefined ? inputIdx : -1,
-      outputIdx !== undefined ? outputIdx : -1
+      input !== undefined ? input : -1,
+      output !== undefined ? output : -1
     );
     if (errMsg && errMsg.length > 0) {
       return { success: false, error: errMsg };
@@ -169,14 +206,19 @@ ipcMain.handle('audio:get-status', () => {
 });
 
 /**
- * audio:get-metrics -> { inputRms, outputRms, vadProbability, gateGain, framesProcessed }
+ * audio:get-metrics -> { inputRms, outputRms, vadProbability, gateGain, framesProcessed,
+ *                        restarts, lastRecoveryMs, outputLatencyMs, ... }
  * Polled from the renderer at ~100ms intervals for the level meter and logs.
  */
 ipcMain.handle('audio:get-metrics', () => {
   try {
     return addon.getMetrics();
   } catch (err) {
-    return { inputRms: 0, outputRms: 0, vadProbability: 0, gateGain: 0, framesProcessed: 0 };
+    return {
+      inputRms: 0, outputRms: 0, vadProbability: 0, gateGain: 0, framesProcessed: 0,
+      restarts: 0, failedRestarts: 0, lastRecoveryMs: 0,
+      processLatencyMs: 0, outputLatencyMs: 0, maxOutputLatencyMs: 0,
+    };
   }
 });
 
@@ -193,6 +235,91 @@ ipcMain.handle('audio:set-vad-threshold', (_event, threshold) => {
   }
 });
 
+/**
+ * audio:set-post-chain -> { success: boolean, stages?: string[], error?: string }
+ * @param {string[]} stages - Enabled post-RNNoise stages in processing order
+ */
+ipcMain.handle('audio:set-post-chain', (_event, stages) => {
+  try {
+    if (!addon.setPostChain(stages)) {
+      return { success: false, error: 'Unsupported stage list or order' };
+    }
+    return { success: true, stages: addon.getPostChain() };
+  } catch (err) {
+    return { success: false, error: err.message };
+  }
+});
+
+/**
+ * audio:dump-flight -> { success: boolean, path?: string, error?: string }
+ * Save the last ~30 s of input/output audio and metrics (.wav + .csv).
+ */
+ipcMain.handle('audio:dump-flight', () => {
+  try {
+    const dir = flightRecorderDir();
+    fs.mkdirSync(dir, { recursive: true });
+    const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+    const base = path.join(dir, `flight-manual-${stamp}`);
+    const error = addon.dumpFlightRecorder(base);
+    if (error) return { success: false, error };
+    return { success: true, path: base };
+  } catch (err) {
+    return { success: false, error: err.message };
+  }
+});
+
+/**
+ * audio:start-trace -> { success: boolean, error?: string }
+ * Record engine timing (callbacks, ring fill, frame stages, restarts) until audio:stop-trace.
+ */
+ipcMain.handle('audio:start-trace', () => {
+  try {
+    const error = addon.startTrace();
+    if (error) return { success: false, error };
+    return { success: true };
+  } catch (err) {
+    return { success: false, error: err.message };
+  }
+});
+
+/**
+ * audio:stop-trace -> { success: boolean, path?: string, error?: string }
+ * Stop tracing and save a Chrome trace JSON (open in ui.perfetto.dev).
+ */
+ipcMain.handle('audio:stop-trace', () => {
+  try {
+    addon.stopTrace();
+    const dir = path.join(app.getPath('userData'), 'traces');
+    fs.mkdirSync(dir, { recursive: true });
+    const stamp = new Date().toISOString().replace(/[:.]/g, '-');
+    const file = path.join(dir, `trace-${stamp}.json`);
+    const error = addon.exportTrace(file, 'chrome');
+    if (error) return { success: false, error };
+    return { success: true, path: file };
+  } catch (err) {
+    return { success: false, error: err.message };
+  }
+});
+
+/**
+ * audio:calibrate -> { success: boolean, input?, output?, error?: string }
+ * Probes the selected devices for the lowest stable buffer size / latency.
+ * Takes several seconds; the engine must be stopped.
+ * @param {string|number} input  - Input device id, or -1 for default
+ * @param {string|number} output - Output device id, or -1 default / -2 none
+ */
+ipcMain.handle('audio:calibrate', async (_event, input, output) => {
+  try {
+    const result = await addon.calibrateLatency(
+      input !== undefined ? input : -1,
+      output !== undefined ? output : -1
+    );
+    return { success: true, ...result };
+  } catch (err) {
+    return { success: false, error: err.message };
+  }
+});
+
 /**
  * app:open-external -> void
  * Open a URL in the system's default browser (used for VB-Cable download link).
@@ -12,9 +12,14 @@ contextBridge.exposeInMainWorld('noiseGuard', {
   /** Get available audio devices. */
   getDevices: () => ipcRenderer.invoke('audio:get-devices'),
 
-  /** Start noise cancellation with selected devices. */
-  start: (inputIdx, outputIdx) =>
-    ipcRenderer.invoke('audio:start', inputIdx, outputIdx),
+  /** Subscribe to device hotplug changes. Callback receives { inputs, outputs }. */
+  onDevicesChanged: (callback) => {
+    ipcRenderer.on('audio:devices-changed', (_event, devices) => callback(devices));
+  },
+
+  /** Start noise cancellation with selected devices (id, or -1 default / -2 mute). */
+  start: (input, output) =>
+    ipcRenderer.invoke('audio:start', input, output),
 
   /** Stop noise cancellation. */
   stop: () => ipcRenderer.invoke('audio:stop'),
@@ -32,6 +37,22 @@ contextBridge.exposeInMainWorld('noiseGuard', {
   setVadThreshold: (threshold) =>
     ipcRenderer.invoke('audio:set-vad-threshold', threshold),
 
+  /** Select / reorder post-RNNoise stages, e.g. ['hpf', 'lpf', 'gate']. */
+  setPostChain: (stages) => ipcRenderer.invoke('audio:set-post-chain', stages),
+
+  /** Save the last ~30 s of audio + metrics for a bug report. Resolves { success, path }. */
+  dumpFlightRecorder: () => ipcRenderer.invoke('audio:dump-flight'),
+
+  /** Start recording an engine timing trace. */
+  startTrace: () => ipcRenderer.invoke('audio:start-trace'),
+
+  /** Stop the trace and save it as Chrome trace JSON. Resolves { success, path }. */
+  stopTrace: () => ipcRenderer.invoke('audio:stop-trace'),
+
+  /** Find the lowest stable latency for the given devices (engine must be stopped). */
+  calibrateLatency: (input, output) =>
+    ipcRenderer.invoke('audio:calibrate', input, output),
+
   /** Open a URL in the system's default browser. */
   openExternal: (url) => ipcRenderer.invoke('app:open-external', url),
 });
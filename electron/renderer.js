@@ -24,6 +24,7 @@ const vadThreshSlider = document.getElementById('vadThreshSlider');
 const vadThreshValue = document.getElementById('vadThreshValue');
 const statusText = document.getElementById('statusText');
 const latencyText = document.getElementById('latencyText');
+const tuneLink = document.getElementById('tuneLink');
 const framesText = document.getElementById('framesText');
 const gateText = document.getElementById('gateText');
 const errorBar = document.getElementById('errorBar');
@@ -61,6 +62,11 @@ async function init() {
   await loadDevices();
   await syncStatus();
 
+  /* Re-populate device lists when devices are plugged in or removed. */
+  if (window.noiseGuard.onDevicesChanged) {
+    window.noiseGuard.onDevicesChanged(onDevicesChanged);
+  }
+
   /* Poll status every 2 seconds for external state changes. */
   setInterval(syncStatus, 2000);
 }
@@ -87,6 +93,35 @@ async function loadDevices() {
   }
 }
 
+/** Apply a hotplug device-list update, keeping the current selection if possible. */
+function onDevicesChanged(devices) {
+  const prevInput = inputSelect.value;
+  const prevOutput = outputSelect.value;
+
+  populateSelect(inputSelect, devices.inputs, 'input');
+  populateSelect(outputSelect, devices.outputs, 'output');
+
+  if ([...inputSelect.options].some(o => o.value === prevInput)) {
+    inputSelect.value = prevInput;
+  }
+  if ([...outputSelect.options].some(o => o.value === prevOutput)) {
+    outputSelect.value = prevOutput;
+  }
+
+  addLog('Audio devices changed (' + devices.inputs.length + ' in / ' +
+         devices.outputs.length + ' out)', 'warn');
+}
+
+/**
+ * The engine argument for a device <select>: the device id, or the numeric
+ * -1 (system default) / -2 (no output) for the special entries.
+ */
+function selectedDevice(select) {
+  return (select.value === '-1' || select.value === '-2')
+    ? parseInt(select.value, 10)
+    : select.value;
+}
+
 /** Populate a <select> with device options. */
 function populateSelect(select, devices, type) {
   select.innerHTML = '<option value="-1">System Default</option>';
@@ -95,9 +130,10 @@ function populateSelect(select, devices, type) {
     select.innerHTML += '<option value="-2">No Output (Mute)</option>';
   }
 
+  /* Devices are keyed by id (host API + name): indices shift on hotplug. */
   for (const d of devices) {
     const opt = document.createElement('option');
-    opt.value = d.index;
+    opt.value = d.id;
     opt.textContent = d.name;
 
     if (d.name.toLowerCase().includes('cable')) {
@@ -133,12 +169,10 @@ toggleBtn.addEventListener('click', async () => {
         showError(result.error || 'Failed to stop');
       }
     } else {
-      const inputIdx = parseInt(inputSelect.value, 10);
-      const outputIdx = parseInt(outputSelect.value, 10);
-
       statusText.textContent = 'Starting...';
       addLog('Starting engine...', 'ok');
-      const result = await window.noiseGuard.start(inputIdx, outputIdx);
+      const result = await window.noiseGuard.start(
+        selectedDevice(inputSelect), selectedDevice(outputSelect));
 
       if (result.success) {
         updateUI(true);
@@ -195,12 +229,11 @@ async function restartIfRunning() {
   if (!isRunning) return;
 
   await window.noiseGuard.stop();
-  const inputIdx = parseInt(inputSelect.value, 10);
-  const outputIdx = parseInt(outputSelect.value, 10);
 
   statusText.textContent = 'Restarting...';
   addLog('Restarting with new devices...', 'ok');
-  const result = await window.noiseGuard.start(inputIdx, outputIdx);
+  const result = await window.noiseGuard.start(
+    selectedDevice(inputSelect), selectedDevice(outputSelect));
 
   if (result.success) {
     updateUI(true);
@@ -213,6 +246,46 @@ async function restartIfRunning() {
   }
 }
 
+/* ── Latency Calibration ─────────────────────────────────────────────────── */
+
+tuneLink.addEventListener('click', async (e) => {
+  e.preventDefault();
+  if (isRunning) {
+    showError('Stop noise cancellation before tuning latency.');
+    return;
+  }
+
+  tuneLink.classList.add('disabled');
+  toggleBtn.disabled = true;
+  statusText.textContent = 'Tuning...';
+  addLog('Probing buffer sizes for the selected devices...', 'ok');
+
+  try {
+    const result = await window.noiseGuard.calibrateLatency(
+      selectedDevice(inputSelect), selectedDevice(outputSelect));
+    if (!result.success) {
+      showError(result.error || 'Calibration failed');
+      addLog('Calibration failed: ' + (result.error || 'unknown'), 'warn');
+      return;
+    }
+    for (const dir of ['input', 'output']) {
+      const r = result[dir];
+      if (!r) continue;
+      if (r.error) {
+        addLog('Tune ' + dir + ': ' + r.error, 'warn');
+      } else {
+        addLog('Tune ' + dir + ': ' + r.framesPerBuffer + ' frames, ' +
+               r.latencyMs.toFixed(1) + ' ms suggested', 'ok');
+      }
+    }
+    hideError();
+  } finally {
+    tuneLink.classList.remove('disabled');
+    toggleBtn.disabled = false;
+    statusText.textContent = isRunning ? 'Active' : 'Idle';
+  }
+});
+
 /* ── Metrics Polling ─────────────────────────────────────────────────────── */
 
 function startMetricsPolling() {
@@ -341,7 +414,7 @@ function updateUI(running, level) {
 
   if (!running) {
     latencyText.textContent = '-- ms';
-  } else if (parseInt(outputSelect.value, 10) === -2) {
+  } else if (outputSelect.value === '-2') {
     latencyText.textContent = 'Muted';
   } else {
     latencyText.textContent = '~12 ms';
@@ -388,7 +461,7 @@ function detectVBCable(outputDevices) {
 
   if (cableDevice) {
     /* Auto-select VB-Cable as the output device. */
-    outputSelect.value = String(cableDevice.index);
+    outputSelect.value = cableDevice.id;
     vbCableFound.classList.remove('hidden');
     vbCableMissing.classList.add('hidden');
     addLog('VB-Cable detected (device #' + cableDevice.index + '). Auto-selected as output.', 'ok');
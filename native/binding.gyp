@@ -4,7 +4,22 @@
       "target_name": "noiseguard",
       "cflags!": ["-fno-exceptions"],
       "cflags_cc!": ["-fno-exceptions"],
-      "sources": ["src/addon.cc", "src/audio.cpp", "src/rnnoise_wrapper.cpp"],
+      "sources": [
+        "src/addon.cc",
+        "src/audio.cpp",
+        "src/audio_tap.cpp",
+        "src/denoise_session.cpp",
+        "src/flight_recorder.cpp",
+        "src/frame_capture.cpp",
+        "src/host_session.cpp",
+        "src/latency_tuner.cpp",
+        "src/processing_pool.cpp",
+        "src/rnnoise_wrapper.cpp",
+        "src/session_arena.cpp",
+        "src/signal_gen.cpp",
+        "src/stream_session.cpp",
+        "src/trace.cpp"
+      ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
         "src",
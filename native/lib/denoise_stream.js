@@ -0,0 +1,109 @@
+/**
+ * DenoiseStream -- Node.js Transform stream backed by the native StreamSession.
+ *
+ * Pipes raw mono 48 kHz PCM (s16le by default, or f32le) through the
+ * production RNNoise chain without an audio device:
+ *
+ *   const { DenoiseStream } = require('./native/lib/denoise_stream');
+ *   fs.createReadStream('in.raw')
+ *     .pipe(new DenoiseStream({ format: 's16le' }))
+ *     .pipe(fs.createWriteStream('out.raw'));
+ *
+ * - Chunks may have any size; split samples and partial 480-sample frames
+ *   are carried natively.
+ * - Processing runs on a libuv worker, never on the event loop.
+ * - Backpressure: input is copied into a bounded native queue
+ *   (maxQueuedBytes). While it is full the write callback is withheld, so
+ *   upstream pauses through the normal stream machinery. Readable-side
+ *   backpressure is handled by Transform itself.
+ * - Output lags input by 480 samples; the tail is emitted on end().
+ * - A native failure (e.g. out of memory in a worker pass) destroys the
+ *   stream with that error.
+ *
+ * Options (besides the usual Transform options):
+ *   format          's16le' | 'f32le'
+ *   maxQueuedBytes  native queue cap (default 256 KiB)
+ *   noiseLevel, vadThreshold, postChain  -- as on the engine
+ *   addon           an already loaded noiseguard.node (optional)
+ */
+
+'use strict';
+
+const path = require('path');
+const { Transform } = require('stream');
+
+function loadAddon() {
+  return require(path.join(__dirname, '..', '..', 'build', 'Release', 'noiseguard.node'));
+}
+
+class DenoiseStream extends Transform {
+  constructor(options = {}) {
+    const {
+      addon,
+      format = 's16le',
+      maxQueuedBytes,
+      noiseLevel,
+      vadThreshold,
+      postChain,
+      ...streamOptions
+    } = options;
+    super(streamOptions);
+
+    const native = addon || loadAddon();
+    this._pendingCallback = null;  /* Write callback withheld while the queue is full */
+    this._flushCallback = null;
+    this._session = new native.StreamSession(
+      { format, maxQueuedBytes, noiseLevel, vadThreshold, postChain },
+      (chunk, writable, ended, err) => this._onOutput(chunk, writable, ended, err)
+    );
+  }
+
+  _transform(chunk, _encoding, callback) {
+    let writable;
+    try {
+      writable = this._session.push(chunk);
+    } catch (err) {
+      callback(err);
+      return;
+    }
+    if (writable) {
+      callback();
+    } else {
+      this._pendingCallback = callback;
+    }
+  }
+
+  _flush(callback) {
+    this._flushCallback = callback;
+    this._session.end();
+  }
+
+  _destroy(err, callback) {
+    this._session.close();
+    callback(err);
+  }
+
+  /** Called by the native session after each worker pass (JS thread). */
+  _onOutput(chunk, writable, ended, err) {
+    if (err) {
+      this.destroy(err);
+      return;
+    }
+    if (chunk) this.push(chunk);
+
+    if (writable && this._pendingCallback) {
+      const cb = this._pendingCallback;
+      this._pendingCallback = null;
+      cb();
+    }
+
+    if (ended && this._flushCallback) {
+      const cb = this._flushCallback;
+      this._flushCallback = null;
+      this._session.close();
+      cb();
+    }
+  }
+}
+
+module.exports = { DenoiseStream };
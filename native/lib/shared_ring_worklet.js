@@ -0,0 +1,147 @@
+/**
+ * NoiseGuard - JS side of the engine's shared-memory output ring
+ *
+ * Reader for the SharedArrayBuffer ring an engine writes processed frames
+ * into (engine.attachSharedOutput(new Int32Array(sab)); layout:
+ * native/src/shared_ring.h). One file for both kinds of consumer:
+ *
+ *   - AudioWorklet: context.audioWorklet.addModule(<this file>) registers
+ *     'noiseguard-shared-ring', a processor that plays the ring. Only
+ *     useful where the engine runs in the same process as the AudioContext
+ *     (the addon loaded in that renderer); a SharedArrayBuffer cannot
+ *     cross processes.
+ *   - Node (main thread or a worker_threads Worker):
+ *       const { createSharedRing, SharedRingReader } = require(<this file>);
+ *
+ * The worklet scope has no require(), so everything lives here and the
+ * file exports / registers whatever its scope supports.
+ */
+
+'use strict';
+
+/* Int32 header slots -- keep in sync with SharedRingWriter. */
+const WRITE_INDEX = 0;
+const CAPACITY = 1;
+const DROPPED = 2;
+const READ_INDEX = 16;
+const HEADER_INTS = 32;
+const HEADER_BYTES = HEADER_INTS * 4;
+
+/**
+ * Allocate a ring for engine.attachSharedOutput(new Int32Array(sab)).
+ * capacity (samples) must be a power of 2; 8192 ~= 170ms at 48 kHz.
+ */
+function createSharedRing(capacity = 8192) {
+  const sab = new SharedArrayBuffer(HEADER_BYTES + capacity * 4);
+  Atomics.store(new Int32Array(sab), CAPACITY, capacity);
+  return sab;
+}
+
+/**
+ * Consumer side of the ring. Never blocks; waitForData() is the only call
+ * that waits, and only with a timeout (a native store cannot wake
+ * Atomics.wait(), see shared_ring.h).
+ */
+class SharedRingReader {
+  constructor(sab) {
+    this.header = new Int32Array(sab, 0, HEADER_INTS);
+    const capacity = Atomics.load(this.header, CAPACITY);
+    this.data = new Float32Array(sab, HEADER_BYTES, capacity);
+    this.mask = capacity - 1;
+  }
+
+  /** Samples written but not yet read (indices are free-running uint32). */
+  available() {
+    return (Atomics.load(this.header, WRITE_INDEX) - Atomics.load(this.header, READ_INDEX)) | 0;
+  }
+
+  /** Samples the engine dropped because the reader fell behind. */
+  dropped() {
+    return Atomics.load(this.header, DROPPED) >>> 0;
+  }
+
+  /** Copy up to out.length samples into out. Returns the count copied. */
+  read(out, available = this.available()) {
+    const r = Atomics.load(this.header, READ_INDEX);
+    const n = Math.min(available, out.length);
+    for (let i = 0; i < n; i++) {
+      out[i] = this.data[(r + i) & this.mask];
+    }
+    Atomics.store(this.header, READ_INDEX, (r + n) | 0);
+    return n;
+  }
+
+  /** Discard count samples (e.g. a backlog beyond the latency budget). */
+  skip(count) {
+    Atomics.store(this.header, READ_INDEX, (Atomics.load(this.header, READ_INDEX) + count) | 0);
+  }
+
+  /**
+   * Worker threads only (the main thread and worklets may not wait):
+   * return once the write index moves or after timeoutMs.
+   */
+  waitForData(timeoutMs) {
+    const w = Atomics.load(this.header, WRITE_INDEX);
+    if (w !== Atomics.load(this.header, READ_INDEX)) return;
+    Atomics.wait(this.header, WRITE_INDEX, w, timeoutMs);
+  }
+}
+
+/*
+ * Plays the ring on the audio rendering thread, so it never waits: each
+ * 128-sample quantum loads the write index, copies what is there and
+ * publishes the new read index. No IPC, no messages per block.
+ *
+ * The engine writes at the capture device's clock and we read at the
+ * AudioContext's, so the fill level drifts:
+ *   - underrun  -> output silence and re-prime before playing again
+ *   - overgrown -> skip ahead to the prime level to bound latency
+ */
+if (typeof registerProcessor === 'function') {
+  class SharedRingProcessor extends AudioWorkletProcessor {
+    constructor(options) {
+      super();
+      const {
+        buffer,
+        primeSamples = 960,          /* 20ms cushion before (re)starting */
+        maxBufferedSamples = 4800,   /* 100ms: beyond this, drop the backlog */
+      } = options.processorOptions;
+
+      this.reader = new SharedRingReader(buffer);
+      this.primeSamples = Math.min(primeSamples, this.reader.mask);
+      this.maxBufferedSamples =
+          Math.min(Math.max(maxBufferedSamples, this.primeSamples), this.reader.mask);
+      this.primed = false;
+    }
+
+    process(_inputs, outputs) {
+      const channels = outputs[0];
+      const out = channels[0];
+      let available = this.reader.available();
+
+      if (!this.primed && available < this.primeSamples) {
+        out.fill(0);
+      } else {
+        this.primed = true;
+        if (available > this.maxBufferedSamples) {
+          this.reader.skip(available - this.primeSamples);
+          available = this.primeSamples;
+        }
+        const n = this.reader.read(out, available);
+        if (n < out.length) {
+          out.fill(0, n);
+          this.primed = false;
+        }
+      }
+
+      for (let c = 1; c < channels.length; c++) channels[c].set(out);
+      return true;
+    }
+  }
+
+  registerProcessor('noiseguard-shared-ring', SharedRingProcessor);
+}
+
+if (typeof module !== 'undefined' && module.exports) {
+  module.exports = { createSharedRing, SharedRingReader, HEADER_BYTES };
+}
@@ -3,33 +3,107 @@
  *
  * Exposes the C++ AudioEngine to JavaScript via Node-API (N-API).
  * All heavy audio work stays in C++. JavaScript only calls:
- *   - getDevices()                -> list audio devices
- *   - start(inputIdx, outputIdx)  -> start noise cancellation
+ *   - getDevices()                -> list audio devices (cached, near-instant)
+ *   - refreshDevices()            -> request a background re-scan (hotplug is automatic)
+ *   - onDevicesChanged(cb)        -> cb({ inputs, outputs }) on hotplug
+ *   - start(input, output[, options]) -> start noise cancellation (device id or index)
  *   - stop()                      -> stop noise cancellation
  *   - setNoiseLevel(level)        -> adjust suppression [0.0, 1.0]
  *   - getNoiseLevel()             -> read current suppression level
  *   - setVadThreshold(threshold)  -> adjust VAD gate threshold [0.0, 1.0]
  *   - getVadThreshold()           -> read current VAD threshold
+ *   - setPostChain(stages)        -> select / reorder post-RNNoise stages
+ *   - getPostChain()              -> current post-RNNoise stage list
  *   - isRunning()                 -> check engine state
  *   - getMetrics()                -> real-time audio metrics
+ *   - attachSharedOutput(int32View) -> also publish frames to a SharedArrayBuffer ring
+ *   - detachSharedOutput()        -> stop publishing to it
+ *   - startRecording(opts)        -> QA taps { pre?, post?, final?: path, format? } to files
+ *   - stopRecording()             -> flush and close the tap files
+ *   - getRecordingStats()         -> per-tap samples written / dropped
+ *   - startCapture(path)          -> record the next run for bit-exact replay (tools/ng_replay)
+ *   - stopCapture()               -> finish it early (stop() also finishes it)
+ *   - getCaptureStats()           -> { frames, truncated }
+ *   - dumpFlightRecorder(base)    -> write the last ~30 s to base.wav / base.csv
+ *   - setFlightRecorderDir(dir)   -> auto-dump there after xrun bursts ("" = off)
+ *   - startTrace([eventsPerThread]) -> record engine timing of every thread (all engines)
+ *   - stopTrace()                 -> stop recording; the trace stays for export
+ *   - exportTrace(path[, format]) -> write it as 'chrome' JSON or 'perfetto' protobuf
+ *   - getTraceStats()             -> { enabled, events, overwritten, threads, untraced }
+ *   - calibrateLatency(in, out)   -> Promise: tune per-device buffer size / latency
+ *   - setLatencyCacheFile(path)   -> persist calibration results across runs
+ *   - generateSignal(spec, secs)  -> deterministic synthetic test audio (Float32Array)
+ *   - new NoiseGuardEngine()      -> additional independent engine (same API)
+ *   - new DenoiseSession(opts)    -> device-less denoising of Float32Arrays
+ *   - new StreamSession(opts, cb) -> PCM byte-stream denoising (see lib/denoise_stream.js)
+ *
+ * The module-level functions drive a default engine; NoiseGuardEngine
+ * instances run alongside it on other devices.
  */
 
 #include <napi.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <set>
+
 #include "audio.h"
+#include "denoise_session.h"
+#include "latency_tuner.h"
+#include "signal_gen.h"
+#include "stream_session.h"
+#include "trace.h"
 
 namespace {
 
-/* Single global engine instance. One engine per process is sufficient. */
+/*
+ * Default engine behind the module-level start()/stop()/... functions.
+ * Further independent engines are created from JS as NoiseGuardEngine.
+ */
 static noiseguard::AudioEngine g_engine;
 
-/**
- * getDevices() -> { inputs: [...], outputs: [...] }
+/*
+ * Every live engine (g_engine + NoiseGuardEngine instances), so calibration
+ * can check that no device is in use and env teardown can stop them all.
  */
-Napi::Value GetDevices(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+static std::mutex g_enginesMutex;
+static std::set<noiseguard::AudioEngine*> g_engines;
+
+bool AnyEngineRunning() {
+  std::lock_guard<std::mutex> lock(g_enginesMutex);
+  for (auto* e : g_engines) {
+    if (e->isRunning()) return true;
+  }
+  return false;
+}
 
-  auto devices = noiseguard::AudioEngine::enumerateDevices();
+/*
+ * Keeps the default engine's shared ring (SharedArrayBuffer view) alive
+ * while the engine writes into it.
+ */
+static Napi::ObjectReference g_sharedOutputRef;
+
+/*
+ * Claimed (exchange(true)) by a latency calibration for its whole run and
+ * by start() for the duration of the call, so a calibration never probes
+ * devices an engine is opening, and only one calibration runs at a time.
+ */
+static std::atomic<bool> g_calibrating{false};
 
+/*
+ * JS listener for device-change notifications. The HostSession callback is
+ * registered once and forwards through whichever TSFN is current, so
+ * replacing the listener never races with an in-flight notification.
+ */
+static std::mutex g_deviceTsfnMutex;
+static Napi::ThreadSafeFunction g_deviceTsfn;
+static bool g_deviceTsfnActive = false;
+
+/** Convert a device list to { inputs: [...], outputs: [...] }. */
+Napi::Object DevicesToJs(Napi::Env env,
+                         const std::vector<noiseguard::DeviceInfo>& devices) {
   Napi::Array inputs = Napi::Array::New(env);
   Napi::Array outputs = Napi::Array::New(env);
   uint32_t inIdx = 0, outIdx = 0;
@@ -38,7 +112,9 @@ Napi::Value GetDevices(const Napi::CallbackInfo& info) {
     if (d.maxInputChannels > 0) {
       Napi::Object obj = Napi::Object::New(env);
       obj.Set("index", Napi::Number::New(env, d.index));
+      obj.Set("id", Napi::String::New(env, d.id));
       obj.Set("name", Napi::String::New(env, d.name));
+      obj.Set("hostApi", Napi::String::New(env, d.hostApi));
       obj.Set("maxChannels", Napi::Number::New(env, d.maxInputChannels));
       obj.Set("defaultSampleRate", Napi::Number::New(env, d.defaultSampleRate));
       inputs.Set(inIdx++, obj);
@@ -46,7 +122,9 @@ Napi::Value GetDevices(const Napi::CallbackInfo& info) {
     if (d.maxOutputChannels > 0) {
       Napi::Object obj = Napi::Object::New(env);
       obj.Set("index", Napi::Number::New(env, d.index));
+      obj.Set("id", Napi::String::New(env, d.id));
       obj.Set("name", Napi::String::New(env, d.name));
+      obj.Set("hostApi", Napi::String::New(env, d.hostApi));
       obj.Set("maxChannels", Napi::Number::New(env, d.maxOutputChannels));
       obj.Set("defaultSampleRate", Napi::Number::New(env, d.defaultSampleRate));
       outputs.Set(outIdx++, obj);
@@ -59,33 +137,127 @@ Napi::Value GetDevices(const Napi::CallbackInfo& info) {
   return result;
 }
 
+/** Forward a device-list change from the watcher thread to JS. */
+void NotifyDevicesChanged(const std::vector<noiseguard::DeviceInfo>& devices) {
+  std::lock_guard<std::mutex> lock(g_deviceTsfnMutex);
+  if (!g_deviceTsfnActive) return;
+
+  auto* copy = new std::vector<noiseguard::DeviceInfo>(devices);
+  auto status = g_deviceTsfn.NonBlockingCall(
+      copy, [](Napi::Env env, Napi::Function cb,
+               std::vector<noiseguard::DeviceInfo>* data) {
+        cb.Call({DevicesToJs(env, *data)});
+        delete data;
+      });
+  if (status != napi_ok) delete copy;
+}
+
 /**
- * start(inputDeviceIndex, outputDeviceIndex) -> string
+ * getDevices() -> { inputs: [...], outputs: [...] }
  */
-Napi::Value Start(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+Napi::Value GetDevices(const Napi::CallbackInfo& info) {
+  return DevicesToJs(info.Env(), noiseguard::AudioEngine::enumerateDevices());
+}
 
-  int inputIdx = -1;
-  int outputIdx = -1;
+/**
+ * refreshDevices() -> void
+ * Asks the background watcher to re-scan. Platform hotplug notifications do
+ * this on their own; changes arrive via onDevicesChanged.
+ */
+void RefreshDevices(const Napi::CallbackInfo& /*info*/) {
+  noiseguard::HostSession::instance().refresh();
+}
 
-  if (info.Length() >= 1 && info[0].IsNumber()) {
-    inputIdx = info[0].As<Napi::Number>().Int32Value();
+/**
+ * onDevicesChanged(callback | null) -> void
+ * callback({ inputs, outputs }) runs on the JS thread after a hotplug change.
+ */
+void OnDevicesChanged(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::lock_guard<std::mutex> lock(g_deviceTsfnMutex);
+  if (g_deviceTsfnActive) {
+    g_deviceTsfn.Release();
+    g_deviceTsfnActive = false;
   }
-  if (info.Length() >= 2 && info[1].IsNumber()) {
-    outputIdx = info[1].As<Napi::Number>().Int32Value();
+
+  if (info.Length() < 1 || !info[0].IsFunction()) return;
+
+  g_deviceTsfn = Napi::ThreadSafeFunction::New(
+      env, info[0].As<Napi::Function>(), "noiseguard:devicesChanged", 0, 1);
+  g_deviceTsfn.Unref(env);  /* Don't keep the event loop alive for this. */
+  g_deviceTsfnActive = true;
+}
+
+/**
+ * A device argument: a device's id (string, stable across hotplug and
+ * re-scans) or a PortAudio index (number; -1 default, -2 no output).
+ * Anything else leaves index / id untouched.
+ */
+void ParseDeviceArg(const Napi::Value& value, int& index, std::string& id) {
+  if (value.IsString()) {
+    id = value.As<Napi::String>().Utf8Value();
+  } else if (value.IsNumber()) {
+    index = value.As<Napi::Number>().Int32Value();
   }
+}
+
+/**
+ * start(input, output[, options]) -> string
+ * input / output: device id or index, see ParseDeviceArg().
+ *
+ * options.captureFormat: 'float32' (default) | 'int16' | 'int24'
+ *   Integer formats capture in the device's integer format and skip the
+ *   float normalize/denormalize round trip around RNNoise.
+ *
+ * Shared by the module-level start() and NoiseGuardEngine#start().
+ */
+Napi::Value StartEngine(noiseguard::AudioEngine& engine,
+                        const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
 
   noiseguard::AudioConfig config;
-  config.inputDeviceIndex = inputIdx;
-  config.outputDeviceIndex = outputIdx;
+  if (info.Length() >= 1) {
+    ParseDeviceArg(info[0], config.inputDeviceIndex, config.inputDeviceId);
+  }
+  if (info.Length() >= 2) {
+    ParseDeviceArg(info[1], config.outputDeviceIndex, config.outputDeviceId);
+  }
   config.sampleRate = 48000.0;
   config.framesPerBuffer = noiseguard::kRNNoiseFrameSize;
   config.tryExclusiveMode = true;
+  config.useCalibratedLatency = true;
+
+  if (info.Length() >= 3 && info[2].IsObject()) {
+    /* Nothing = the getter threw; leave that exception pending for JS. */
+    Napi::Value fmt;
+    if (!info[2].As<Napi::Object>().Get("captureFormat").UnwrapTo(&fmt)) {
+      return env.Undefined();
+    }
+    if (fmt.IsString()) {
+      std::string f = fmt.As<Napi::String>().Utf8Value();
+      if (f == "int16") {
+        config.captureFormat = noiseguard::CaptureFormat::kInt16;
+      } else if (f == "int24") {
+        config.captureFormat = noiseguard::CaptureFormat::kInt24;
+      } else if (f != "float32") {
+        return Napi::String::New(env, "Unknown captureFormat: " + f);
+      }
+    }
+  }
 
-  std::string err = g_engine.start(config);
+  if (g_calibrating.exchange(true, std::memory_order_acq_rel)) {
+    return Napi::String::New(env, "Latency calibration in progress");
+  }
+  std::string err = engine.start(config);
+  g_calibrating.store(false, std::memory_order_release);
   return Napi::String::New(env, err);
 }
 
+Napi::Value Start(const Napi::CallbackInfo& info) {
+  return StartEngine(g_engine, info);
+}
+
 /**
  * stop() -> void
  */
@@ -123,6 +295,67 @@ Napi::Value GetVadThreshold(const Napi::CallbackInfo& info) {
   return Napi::Number::New(info.Env(), g_engine.getVadThreshold());
 }
 
+/* JS names for PostStage values, indexed by enum value. */
+static const char* const kPostStageNames[noiseguard::kPostStageCount] = {
+    "blend", "hpf", "lpf", "gate", "clamp", "softSilence", "limiter"};
+
+/**
+ * Parse a JS array of stage names. Returns false on anything unknown, or
+ * with the exception pending if reading an element threw.
+ */
+bool ParsePostChain(const Napi::Value& value,
+                    std::vector<noiseguard::PostStage>& stages) {
+  if (!value.IsArray()) return false;
+  Napi::Array arr = value.As<Napi::Array>();
+  for (uint32_t i = 0; i < arr.Length(); i++) {
+    Napi::Value v;
+    if (!arr.Get(i).UnwrapTo(&v) || !v.IsString()) return false;
+    std::string name = v.As<Napi::String>().Utf8Value();
+    size_t s = 0;
+    while (s < noiseguard::kPostStageCount && name != kPostStageNames[s]) s++;
+    if (s == noiseguard::kPostStageCount) return false;
+    stages.push_back(static_cast<noiseguard::PostStage>(s));
+  }
+  return true;
+}
+
+Napi::Value SetPostChainOn(noiseguard::AudioEngine& engine,
+                          const Napi::CallbackInfo& info) {
+  std::vector<noiseguard::PostStage> stages;
+  bool ok = info.Length() >= 1 && ParsePostChain(info[0], stages) &&
+            engine.setPostChain(stages);
+  return Napi::Boolean::New(info.Env(), ok);
+}
+
+/**
+ * setPostChain(stages: string[]) -> boolean
+ *
+ * Enabled post-RNNoise stages in processing order, e.g.
+ * ['hpf', 'lpf', 'gate', 'limiter']. Returns false (chain unchanged) for
+ * unknown names or an order that has no pre-built kernel.
+ */
+Napi::Value SetPostChain(const Napi::CallbackInfo& info) {
+  return SetPostChainOn(g_engine, info);
+}
+
+/** Current post-RNNoise stages as their JS names. */
+Napi::Array PostChainToJs(Napi::Env env,
+                          const std::vector<noiseguard::PostStage>& stages) {
+  Napi::Array result = Napi::Array::New(env, stages.size());
+  for (uint32_t i = 0; i < stages.size(); i++) {
+    result.Set(i, Napi::String::New(env,
+        kPostStageNames[static_cast<size_t>(stages[i])]));
+  }
+  return result;
+}
+
+/**
+ * getPostChain() -> string[]
+ */
+Napi::Value GetPostChain(const Napi::CallbackInfo& info) {
+  return PostChainToJs(info.Env(), g_engine.postChain());
+}
+
 /**
  * isRunning() -> boolean
  */
@@ -131,16 +364,44 @@ Napi::Value IsRunning(const Napi::CallbackInfo& info) {
 }
 
 /**
- * getMetrics() -> { inputRms, outputRms, vadProbability, gateGain, framesProcessed }
- *
- * Returns a snapshot of real-time audio metrics. Lock-free atomic reads.
- * Call this from a polling interval (e.g. every 100ms) to animate the UI meter.
+ * Point engine at the ring in info[0], an Int32Array over the whole
+ * SharedArrayBuffer (layout in shared_ring.h). On success ref holds the view
+ * so the memory outlives the engine's use of it. Returns an error string
+ * ("" on success).
  */
-Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
-  Napi::Env env = info.Env();
+std::string AttachSharedOutputOn(noiseguard::AudioEngine& engine,
+                                 const Napi::CallbackInfo& info,
+                                 Napi::ObjectReference& ref) {
+  if (info.Length() < 1 || !info[0].IsTypedArray() ||
+      info[0].As<Napi::TypedArray>().TypedArrayType() != napi_int32_array) {
+    return "Expected an Int32Array over the shared ring";
+  }
+  Napi::Int32Array view = info[0].As<Napi::Int32Array>();
+  std::string err = engine.attachSharedOutput(
+      view.Data(), view.ElementLength() * sizeof(int32_t));
+  if (!err.empty()) return err;
+  ref = Napi::Persistent(info[0].As<Napi::Object>());
+  return "";
+}
+
+/**
+ * attachSharedOutput(view: Int32Array) -> string ("" on success)
+ */
+Napi::Value AttachSharedOutput(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(),
+                           AttachSharedOutputOn(g_engine, info, g_sharedOutputRef));
+}
 
-  const auto& m = g_engine.metrics();
+/**
+ * detachSharedOutput() -> void
+ */
+void DetachSharedOutput(const Napi::CallbackInfo& /*info*/) {
+  g_engine.detachSharedOutput();
+  g_sharedOutputRef.Reset();
+}
 
+/** RNNoiseWrapper metrics (levels, VAD, gate) as a plain JS object. */
+Napi::Object ChainMetricsToJs(Napi::Env env, const noiseguard::AudioMetrics& m) {
   Napi::Object result = Napi::Object::New(env);
   result.Set("inputRms", Napi::Number::New(env,
       static_cast<double>(m.inputRms.load(std::memory_order_relaxed))));
@@ -154,23 +415,1172 @@ Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
       static_cast<double>(m.framesProcessed.load(std::memory_order_relaxed))));
   result.Set("noiseFloor", Napi::Number::New(env,
       static_cast<double>(m.noiseFloor.load(std::memory_order_relaxed))));
+  return result;
+}
+
+/**
+ * getMetrics() -> { inputRms, outputRms, vadProbability, gateGain, framesProcessed,
+ *                   noiseFloor, restarts, failedRestarts, lastRecoveryMs }
+ *
+ * Returns a snapshot of real-time audio metrics. Lock-free atomic reads.
+ * Call this from a polling interval (e.g. every 100ms) to animate the UI meter.
+ */
+Napi::Object MetricsToJs(Napi::Env env, const noiseguard::AudioEngine& engine) {
+  Napi::Object result = ChainMetricsToJs(env, engine.metrics());
+
+  const auto& em = engine.engineMetrics();
+  result.Set("restarts", Napi::Number::New(env,
+      static_cast<double>(em.restarts.load(std::memory_order_relaxed))));
+  result.Set("xruns", Napi::Number::New(env,
+      static_cast<double>(em.xruns.load(std::memory_order_relaxed))));
+  result.Set("failedRestarts", Napi::Number::New(env,
+      static_cast<double>(em.failedRestarts.load(std::memory_order_relaxed))));
+  result.Set("lastRecoveryMs", Napi::Number::New(env,
+      em.lastRecoveryMs.load(std::memory_order_relaxed)));
+  result.Set("processLatencyMs", Napi::Number::New(env,
+      em.processLatencyMs.load(std::memory_order_relaxed)));
+  result.Set("outputLatencyMs", Napi::Number::New(env,
+      em.outputLatencyMs.load(std::memory_order_relaxed)));
+  result.Set("maxOutputLatencyMs", Napi::Number::New(env,
+      em.maxOutputLatencyMs.load(std::memory_order_relaxed)));
+
+  return result;
+}
+
+Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
+  return MetricsToJs(info.Env(), g_engine);
+}
+
+/* JS option names of the tap points, indexed by TapPoint. */
+static const char* const kTapPointNames[noiseguard::kTapPointCount] = {
+    "pre", "post", "final"};
 
+/**
+ * Start recording from { pre?, post?, final?: path, format?: 'wav' | 'raw' }.
+ * Returns an error string ("" on success); if reading an option threw,
+ * that exception is left pending and nothing is started.
+ */
+std::string StartRecordingOn(noiseguard::AudioEngine& engine,
+                             const Napi::CallbackInfo& info) {
+  if (info.Length() < 1 || !info[0].IsObject()) return "Expected a tap options object";
+  Napi::Object opts = info[0].As<Napi::Object>();
+
+  noiseguard::TapConfig config;
+  bool any = false;
+  for (size_t i = 0; i < noiseguard::kTapPointCount; i++) {
+    Napi::Value path;
+    if (!opts.Get(kTapPointNames[i]).UnwrapTo(&path)) return "Could not read tap options";
+    if (path.IsString()) {
+      config.paths[i] = path.As<Napi::String>().Utf8Value();
+      any = any || !config.paths[i].empty();
+    }
+  }
+  if (!any) return "No tap path given (pre, post or final)";
+
+  Napi::Value format;
+  if (!opts.Get("format").UnwrapTo(&format)) return "Could not read tap options";
+  if (format.IsString()) {
+    std::string f = format.As<Napi::String>().Utf8Value();
+    if (f == "raw") {
+      config.format = noiseguard::TapFileFormat::kRaw;
+    } else if (f != "wav") {
+      return "Unsupported tap format: " + f;
+    }
+  }
+  return engine.startRecording(config);
+}
+
+/** { pre: { samplesWritten, samplesDropped }, ... } for the enabled taps. */
+Napi::Object RecordingStatsToJs(Napi::Env env, const noiseguard::AudioEngine& engine) {
+  Napi::Object result = Napi::Object::New(env);
+  for (size_t i = 0; i < noiseguard::kTapPointCount; i++) {
+    noiseguard::TapStats st =
+        engine.recordingStats(static_cast<noiseguard::TapPoint>(i));
+    if (!st.enabled) continue;
+    Napi::Object tap = Napi::Object::New(env);
+    tap.Set("samplesWritten",
+            Napi::Number::New(env, static_cast<double>(st.samplesWritten)));
+    tap.Set("samplesDropped",
+            Napi::Number::New(env, static_cast<double>(st.samplesDropped)));
+    result.Set(kTapPointNames[i], tap);
+  }
+  return result;
+}
+
+/**
+ * startRecording(opts) -> string ("" on success)
+ */
+Napi::Value StartRecording(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(), StartRecordingOn(g_engine, info));
+}
+
+/**
+ * stopRecording() -> void
+ */
+void StopRecording(const Napi::CallbackInfo& /*info*/) { g_engine.stopRecording(); }
+
+/**
+ * getRecordingStats() -> { pre?, post?, final? }
+ */
+Napi::Value GetRecordingStats(const Napi::CallbackInfo& info) {
+  return RecordingStatsToJs(info.Env(), g_engine);
+}
+
+/** Start a frame capture to info[0] (a path). Returns an error string ("" on success). */
+std::string StartCaptureOn(noiseguard::AudioEngine& engine,
+                           const Napi::CallbackInfo& info) {
+  if (info.Length() < 1 || !info[0].IsString()) return "Expected a capture path";
+  return engine.startCapture(info[0].As<Napi::String>().Utf8Value());
+}
+
+/** { frames, truncated } of the current or last capture. */
+Napi::Object CaptureStatsToJs(Napi::Env env, const noiseguard::AudioEngine& engine) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("frames", Napi::Number::New(env,
+      static_cast<double>(engine.capturedFrames())));
+  result.Set("truncated", Napi::Boolean::New(env, engine.captureTruncated()));
+  return result;
+}
+
+/**
+ * startCapture(path) -> string ("" on success)
+ */
+Napi::Value StartCapture(const Napi::CallbackInfo& info) {
+  return Napi::String::New(info.Env(), StartCaptureOn(g_engine, info));
+}
+
+/**
+ * stopCapture() -> void
+ */
+void StopCapture(const Napi::CallbackInfo& /*info*/) { g_engine.stopCapture(); }
+
+/**
+ * getCaptureStats() -> { frames, truncated }
+ */
+Napi::Value GetCaptureStats(const Napi::CallbackInfo& info) {
+  return CaptureStatsToJs(info.Env(), g_engine);
+}
+
+/**
+ * dumpFlightRecorder(basePath) -> string ("" on success)
+ */
+Napi::Value DumpFlightRecorder(const Napi::CallbackInfo& info) {
+  if (info.Length() < 1 || !info[0].IsString()) {
+    return Napi::String::New(info.Env(), "Expected a base path");
+  }
+  return Napi::String::New(info.Env(), g_engine.dumpFlightRecorder(
+      info[0].As<Napi::String>().Utf8Value()));
+}
+
+/**
+ * setFlightRecorderDir(dir) -> void
+ */
+void SetFlightRecorderDir(const Napi::CallbackInfo& info) {
+  if (info.Length() < 1 || !info[0].IsString()) return;
+  g_engine.setFlightDumpDir(info[0].As<Napi::String>().Utf8Value());
+}
+
+/**
+ * startTrace([eventsPerThread]) -> string ("" on success)
+ */
+Napi::Value StartTrace(const Napi::CallbackInfo& info) {
+  size_t events = noiseguard::kDefaultTraceEvents;
+  if (info.Length() >= 1 && info[0].IsNumber()) {
+    double n = info[0].As<Napi::Number>().DoubleValue();
+    if (!(n >= 2.0 && n <= 1048576.0)) {
+      return Napi::String::New(info.Env(), "eventsPerThread must be within [2, 1048576]");
+    }
+    events = static_cast<size_t>(n);
+  }
+  return Napi::String::New(info.Env(), noiseguard::Tracer::instance().start(events));
+}
+
+/**
+ * stopTrace() -> void
+ */
+void StopTrace(const Napi::CallbackInfo& /*info*/) {
+  noiseguard::Tracer::instance().stop();
+}
+
+/**
+ * exportTrace(path[, format = 'chrome' | 'perfetto']) -> string ("" on success)
+ */
+Napi::Value ExportTrace(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    return Napi::String::New(env, "Expected a trace path");
+  }
+  std::string path = info[0].As<Napi::String>().Utf8Value();
+  std::string format = "chrome";
+  if (info.Length() >= 2 && info[1].IsString()) {
+    format = info[1].As<Napi::String>().Utf8Value();
+  }
+
+  auto& tracer = noiseguard::Tracer::instance();
+  if (format == "chrome") return Napi::String::New(env, tracer.exportChromeJson(path));
+  if (format == "perfetto") return Napi::String::New(env, tracer.exportPerfetto(path));
+  return Napi::String::New(env, "Unknown trace format: " + format);
+}
+
+/**
+ * getTraceStats() -> { enabled, events, overwritten, threads, untraced }
+ */
+Napi::Value GetTraceStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  noiseguard::TraceStats st = noiseguard::Tracer::instance().stats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("enabled", Napi::Boolean::New(env, st.enabled));
+  result.Set("events", Napi::Number::New(env, static_cast<double>(st.events)));
+  result.Set("overwritten", Napi::Number::New(env, static_cast<double>(st.overwritten)));
+  result.Set("threads", Napi::Number::New(env, st.threads));
+  result.Set("untraced", Napi::Number::New(env, st.untraced));
   return result;
 }
 
+/** Convert a calibration report to a plain JS object (latencies in ms). */
+Napi::Object CalibrationToJs(Napi::Env env,
+                             const noiseguard::CalibrationReport& r) {
+  Napi::Object obj = Napi::Object::New(env);
+  obj.Set("device", Napi::String::New(env, r.deviceKey));
+  if (!r.error.empty()) obj.Set("error", Napi::String::New(env, r.error));
+  obj.Set("framesPerBuffer",
+          Napi::Number::New(env, static_cast<double>(r.best.framesPerBuffer)));
+  obj.Set("latencyMs", Napi::Number::New(env, r.best.suggestedLatency * 1000.0));
+  obj.Set("streamLatencyMs", Napi::Number::New(env, r.best.streamLatency * 1000.0));
+
+  Napi::Array probes = Napi::Array::New(env, r.probes.size());
+  for (uint32_t i = 0; i < r.probes.size(); i++) {
+    const auto& p = r.probes[i];
+    Napi::Object po = Napi::Object::New(env);
+    po.Set("framesPerBuffer", Napi::Number::New(env, static_cast<double>(p.framesPerBuffer)));
+    po.Set("latencyMs", Napi::Number::New(env, p.suggestedLatency * 1000.0));
+    po.Set("streamLatencyMs", Napi::Number::New(env, p.streamLatency * 1000.0));
+    po.Set("callbacks", Napi::Number::New(env, p.callbacks));
+    po.Set("xruns", Napi::Number::New(env, p.xruns));
+    po.Set("p99IntervalMs", Napi::Number::New(env, p.p99IntervalMs));
+    po.Set("stable", Napi::Boolean::New(env, p.stable));
+    probes.Set(i, po);
+  }
+  obj.Set("probes", probes);
+  return obj;
+}
+
+/**
+ * Runs LatencyTuner::calibrate() for the input and (optionally) output
+ * device on a libuv worker thread -- probing takes several seconds.
+ */
+class CalibrateWorker : public Napi::AsyncWorker {
+ public:
+  CalibrateWorker(Napi::Env env, int inputIdx, std::string inputId,
+                  int outputIdx, std::string outputId)
+      : Napi::AsyncWorker(env),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        inputIdx_(inputIdx),
+        outputIdx_(outputIdx),
+        inputId_(std::move(inputId)),
+        outputId_(std::move(outputId)) {}
+
+  Napi::Promise Promise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override {
+    input_ = noiseguard::LatencyTuner::calibrate(inputIdx_, true, 48000.0, true,
+                                                 inputId_);
+    if (outputIdx_ != -2) {
+      output_ = noiseguard::LatencyTuner::calibrate(outputIdx_, false, 48000.0, true,
+                                                    outputId_);
+    }
+  }
+
+  void OnOK() override {
+    g_calibrating.store(false, std::memory_order_release);
+    Napi::Env env = Env();
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("input", CalibrationToJs(env, input_));
+    if (outputIdx_ != -2) result.Set("output", CalibrationToJs(env, output_));
+    deferred_.Resolve(result);
+  }
+
+  void OnError(const Napi::Error& e) override {
+    g_calibrating.store(false, std::memory_order_release);
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  Napi::Promise::Deferred deferred_;
+  int inputIdx_;
+  int outputIdx_;
+  std::string inputId_;
+  std::string outputId_;
+  noiseguard::CalibrationReport input_;
+  noiseguard::CalibrationReport output_;
+};
+
+/**
+ * calibrateLatency(input, output) -> Promise<{ input, output }>
+ * input / output: device id or index, see ParseDeviceArg().
+ *
+ * Probes decreasing buffer sizes / latencies on the given devices and caches
+ * the lowest stable setting; start() picks it up automatically. Every engine
+ * must be stopped (the probes need the devices).
+ */
+Napi::Value CalibrateLatency(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  int inputIdx = -1;
+  int outputIdx = -1;
+  std::string inputId;
+  std::string outputId;
+  if (info.Length() >= 1) ParseDeviceArg(info[0], inputIdx, inputId);
+  if (info.Length() >= 2) ParseDeviceArg(info[1], outputIdx, outputId);
+
+  auto deferred = Napi::Promise::Deferred::New(env);
+  /* Claim first: no start() can slip in between the check and the probes. */
+  if (g_calibrating.exchange(true, std::memory_order_acq_rel)) {
+    deferred.Reject(Napi::Error::New(env, "Calibration already in progress").Value());
+    return deferred.Promise();
+  }
+  if (AnyEngineRunning()) {
+    g_calibrating.store(false, std::memory_order_release);
+    deferred.Reject(Napi::Error::New(env, "Stop all engines before calibrating").Value());
+    return deferred.Promise();
+  }
+
+  auto* worker = new CalibrateWorker(env, inputIdx, std::move(inputId),
+                                     outputIdx, std::move(outputId));
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+/**
+ * setLatencyCacheFile(path) -> string (empty on success)
+ */
+Napi::Value SetLatencyCacheFile(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 1 || !info[0].IsString()) {
+    return Napi::String::New(env, "Expected a file path");
+  }
+  std::string err = noiseguard::LatencyTuner::setCacheFile(
+      info[0].As<Napi::String>().Utf8Value());
+  return Napi::String::New(env, err);
+}
+
+/* generateSignal() refuses longer signals (10 min of float is ~115 MB). */
+static constexpr double kMaxSignalSeconds = 600.0;
+
+/**
+ * Parse one { kind, level?, seed?, humHz? } component. Returns an error or
+ * ""; if reading a field threw, that exception is pending as well.
+ */
+std::string ParseSignalSpec(const Napi::Value& value, noiseguard::SignalSpec& spec) {
+  if (!value.IsObject()) return "Expected { kind, level?, seed?, humHz? }";
+  Napi::Object o = value.As<Napi::Object>();
+  Napi::Value kind, level, seed, hum;
+  if (!o.Get("kind").UnwrapTo(&kind) || !o.Get("level").UnwrapTo(&level) ||
+      !o.Get("seed").UnwrapTo(&seed) || !o.Get("humHz").UnwrapTo(&hum)) {
+    return "Could not read signal component";
+  }
+  if (!kind.IsString() ||
+      !noiseguard::parseSignalKind(kind.As<Napi::String>().Utf8Value(), spec.kind)) {
+    return "Unknown signal kind";
+  }
+  if (level.IsNumber()) spec.levelDb = level.As<Napi::Number>().FloatValue();
+  if (seed.IsNumber()) spec.seed = seed.As<Napi::Number>().Uint32Value();
+  if (hum.IsNumber()) spec.humHz = hum.As<Napi::Number>().FloatValue();
+  return "";
+}
+
+/**
+ * generateSignal(components, seconds) -> Float32Array
+ *
+ * Synthetic 48 kHz mono test audio, e.g. to drive a DenoiseSession in load
+ * tests. components is one { kind, level?, seed?, humHz? } or an array of
+ * them, summed. kind: 'speech' | 'keyboard' | 'fan' | 'hum' | 'white' |
+ * 'silence'; level: RMS dBFS (default typical for the kind). The same
+ * arguments always give the same samples. Throws a TypeError on bad input.
+ */
+Napi::Value GenerateSignal(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() < 2 || !info[1].IsNumber()) {
+    Napi::TypeError::New(env, "Expected (components, seconds)").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+  double seconds = info[1].As<Napi::Number>().DoubleValue();
+  if (!(seconds >= 0.0 && seconds <= kMaxSignalSeconds)) {
+    Napi::TypeError::New(env, "seconds must be within [0, 600]").ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  noiseguard::SignalMix mix;
+  std::string err;
+  if (info[0].IsArray()) {
+    Napi::Array arr = info[0].As<Napi::Array>();
+    for (uint32_t i = 0; i < arr.Length() && err.empty(); i++) {
+      Napi::Value item;
+      if (!arr.Get(i).UnwrapTo(&item)) return env.Undefined();
+      noiseguard::SignalSpec spec;
+      err = ParseSignalSpec(item, spec);
+      if (err.empty()) mix.add(spec);
+    }
+  } else {
+    noiseguard::SignalSpec spec;
+    err = ParseSignalSpec(info[0], spec);
+    if (err.empty()) mix.add(spec);
+  }
+  if (!err.empty()) {
+    /* A getter's exception may already be pending; napi_throw on top aborts. */
+    if (!env.IsExceptionPending()) Napi::TypeError::New(env, err).ThrowAsJavaScriptException();
+    return env.Undefined();
+  }
+
+  Napi::Float32Array out =
+      Napi::Float32Array::New(env, static_cast<size_t>(seconds * 48000.0));
+  mix.render(out.Data(), out.ElementLength());
+  return out;
+}
+
+/**
+ * new NoiseGuardEngine() -- an independent pipeline with its own devices,
+ * settings, RNNoise state and metrics. Methods mirror the module-level API:
+ *   start(input, output[, options]) -> string, stop(), close(),
+ *   setNoiseLevel / getNoiseLevel, setVadThreshold / getVadThreshold,
+ *   setPostChain / getPostChain, isRunning(), getMetrics()
+ *
+ * All engines share the process-wide PortAudio session (HostSession) and
+ * processing threads (ProcessingPool).
+ *
+ * Lifetime: close() stops the engine and frees its native state right away
+ * (later calls are no-ops; start() returns an error). Without close(), the
+ * same happens when the object is garbage-collected, or at env teardown.
+ */
+class NoiseGuardEngine : public Napi::ObjectWrap<NoiseGuardEngine> {
+ public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "NoiseGuardEngine", {
+        InstanceMethod("start", &NoiseGuardEngine::Start),
+        InstanceMethod("stop", &NoiseGuardEngine::Stop),
+        InstanceMethod("close", &NoiseGuardEngine::Close),
+        InstanceMethod("setNoiseLevel", &NoiseGuardEngine::SetNoiseLevel),
+        InstanceMethod("getNoiseLevel", &NoiseGuardEngine::GetNoiseLevel),
+        InstanceMethod("setVadThreshold", &NoiseGuardEngine::SetVadThreshold),
+        InstanceMethod("getVadThreshold", &NoiseGuardEngine::GetVadThreshold),
+        InstanceMethod("setPostChain", &NoiseGuardEngine::SetPostChain),
+        InstanceMethod("getPostChain", &NoiseGuardEngine::GetPostChain),
+        InstanceMethod("isRunning", &NoiseGuardEngine::IsRunning),
+        InstanceMethod("getMetrics", &NoiseGuardEngine::GetMetrics),
+        InstanceMethod("attachSharedOutput", &NoiseGuardEngine::AttachSharedOutput),
+        InstanceMethod("detachSharedOutput", &NoiseGuardEngine::DetachSharedOutput),
+        InstanceMethod("startRecording", &NoiseGuardEngine::StartRecording),
+        InstanceMethod("stopRecording", &NoiseGuardEngine::StopRecording),
+        InstanceMethod("getRecordingStats", &NoiseGuardEngine::GetRecordingStats),
+        InstanceMethod("startCapture", &NoiseGuardEngine::StartCapture),
+        InstanceMethod("stopCapture", &NoiseGuardEngine::StopCapture),
+        InstanceMethod("getCaptureStats", &NoiseGuardEngine::GetCaptureStats),
+        InstanceMethod("dumpFlightRecorder", &NoiseGuardEngine::DumpFlightRecorder),
+        InstanceMethod("setFlightRecorderDir", &NoiseGuardEngine::SetFlightRecorderDir),
+    });
+  }
+
+  explicit NoiseGuardEngine(const Napi::CallbackInfo& info)
+      : Napi::ObjectWrap<NoiseGuardEngine>(info),
+        engine_(std::make_unique<noiseguard::AudioEngine>()) {
+    std::lock_guard<std::mutex> lock(g_enginesMutex);
+    g_engines.insert(engine_.get());
+  }
+
+  /* Runs from the GC finalizer when close() was never called. */
+  ~NoiseGuardEngine() override { Release(); }
+
+ private:
+  /** Stop and free the native engine. Idempotent. */
+  void Release() {
+    if (!engine_) return;
+    {
+      std::lock_guard<std::mutex> lock(g_enginesMutex);
+      g_engines.erase(engine_.get());
+    }
+    engine_->stop();
+    engine_->detachSharedOutput();
+    engine_.reset();
+    sharedOutputRef_.Reset();
+  }
+
+  Napi::Value Start(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::String::New(info.Env(), "Engine is closed");
+    return StartEngine(*engine_, info);
+  }
+
+  void Stop(const Napi::CallbackInfo& /*info*/) {
+    if (engine_) engine_->stop();
+  }
+
+  void Close(const Napi::CallbackInfo& /*info*/) { Release(); }
+
+  void SetNoiseLevel(const Napi::CallbackInfo& info) {
+    if (!engine_ || info.Length() < 1 || !info[0].IsNumber()) return;
+    engine_->setSuppressionLevel(info[0].As<Napi::Number>().FloatValue());
+  }
+
+  Napi::Value GetNoiseLevel(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return Napi::Number::New(info.Env(), engine_->getSuppressionLevel());
+  }
+
+  void SetVadThreshold(const Napi::CallbackInfo& info) {
+    if (!engine_ || info.Length() < 1 || !info[0].IsNumber()) return;
+    engine_->setVadThreshold(info[0].As<Napi::Number>().FloatValue());
+  }
+
+  Napi::Value GetVadThreshold(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return Napi::Number::New(info.Env(), engine_->getVadThreshold());
+  }
+
+  Napi::Value SetPostChain(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::Boolean::New(info.Env(), false);
+    return SetPostChainOn(*engine_, info);
+  }
+
+  Napi::Value GetPostChain(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return PostChainToJs(info.Env(), engine_->postChain());
+  }
+
+  Napi::Value IsRunning(const Napi::CallbackInfo& info) {
+    return Napi::Boolean::New(info.Env(), engine_ && engine_->isRunning());
+  }
+
+  Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return MetricsToJs(info.Env(), *engine_);
+  }
+
+  Napi::Value AttachSharedOutput(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::String::New(info.Env(), "Engine is closed");
+    return Napi::String::New(info.Env(),
+                             AttachSharedOutputOn(*engine_, info, sharedOutputRef_));
+  }
+
+  void DetachSharedOutput(const Napi::CallbackInfo& /*info*/) {
+    if (engine_) engine_->detachSharedOutput();
+    sharedOutputRef_.Reset();
+  }
+
+  Napi::Value StartRecording(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::String::New(info.Env(), "Engine is closed");
+    return Napi::String::New(info.Env(), StartRecordingOn(*engine_, info));
+  }
+
+  void StopRecording(const Napi::CallbackInfo& /*info*/) {
+    if (engine_) engine_->stopRecording();
+  }
+
+  Napi::Value GetRecordingStats(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return RecordingStatsToJs(info.Env(), *engine_);
+  }
+
+  Napi::Value StartCapture(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::String::New(info.Env(), "Engine is closed");
+    return Napi::String::New(info.Env(), StartCaptureOn(*engine_, info));
+  }
+
+  void StopCapture(const Napi::CallbackInfo& /*info*/) {
+    if (engine_) engine_->stopCapture();
+  }
+
+  Napi::Value GetCaptureStats(const Napi::CallbackInfo& info) {
+    if (!engine_) return info.Env().Undefined();
+    return CaptureStatsToJs(info.Env(), *engine_);
+  }
+
+  Napi::Value DumpFlightRecorder(const Napi::CallbackInfo& info) {
+    if (!engine_) return Napi::String::New(info.Env(), "Engine is closed");
+    if (info.Length() < 1 || !info[0].IsString()) {
+      return Napi::String::New(info.Env(), "Expected a base path");
+    }
+    return Napi::String::New(info.Env(), engine_->dumpFlightRecorder(
+        info[0].As<Napi::String>().Utf8Value()));
+  }
+
+  void SetFlightRecorderDir(const Napi::CallbackInfo& info) {
+    if (!engine_ || info.Length() < 1 || !info[0].IsString()) return;
+    engine_->setFlightDumpDir(info[0].As<Napi::String>().Utf8Value());
+  }
+
+  std::unique_ptr<noiseguard::AudioEngine> engine_;
+  Napi::ObjectReference sharedOutputRef_;  /* Keeps the shared ring alive */
+};
+
+/*
+ * DenoiseSession.process() runs chunks up to this many samples (100ms at
+ * 48 kHz, ~10 RNNoise frames, well under a millisecond of CPU) on the
+ * calling thread; larger ones go to a libuv worker.
+ */
+static constexpr size_t kSyncMaxSamples = 4800;
+
+/**
+ * View a Float32Array or ArrayBuffer (read as float32) as a sample pointer.
+ * No copy: the pointer aliases the JS backing store.
+ */
+bool FloatView(const Napi::Value& value, float*& data, size_t& count) {
+  if (value.IsTypedArray()) {
+    Napi::TypedArray ta = value.As<Napi::TypedArray>();
+    if (ta.TypedArrayType() != napi_float32_array) return false;
+    Napi::Float32Array f32 = value.As<Napi::Float32Array>();
+    data = f32.Data();
+    count = f32.ElementLength();
+    return true;
+  }
+  if (value.IsArrayBuffer()) {
+    Napi::ArrayBuffer ab = value.As<Napi::ArrayBuffer>();
+    if (ab.ByteLength() % sizeof(float) != 0) return false;
+    data = static_cast<float*>(ab.Data());
+    count = ab.ByteLength() / sizeof(float);
+    return true;
+  }
+  return false;
+}
+
+/**
+ * Apply { noiseLevel?, vadThreshold?, postChain? } to a chain.
+ * Throws a TypeError (and returns false) for an unsupported postChain;
+ * returns false with the exception pending if reading an option threw.
+ */
+bool ApplyChainOptions(Napi::Env env, const Napi::Object& opts,
+                       noiseguard::RNNoiseWrapper& chain) {
+  Napi::Value level, vad, post;
+  if (!opts.Get("noiseLevel").UnwrapTo(&level) ||
+      !opts.Get("vadThreshold").UnwrapTo(&vad) ||
+      !opts.Get("postChain").UnwrapTo(&post)) {
+    return false;
+  }
+  if (level.IsNumber()) chain.setSuppressionLevel(level.As<Napi::Number>().FloatValue());
+  if (vad.IsNumber()) chain.setVadThreshold(vad.As<Napi::Number>().FloatValue());
+  std::vector<noiseguard::PostStage> stages;
+  if (!post.IsUndefined() &&
+      !(ParsePostChain(post, stages) && chain.setPostChain(stages))) {
+    /* napi_throw on top of a pending exception is fatal. */
+    if (!env.IsExceptionPending()) {
+      Napi::TypeError::New(env, "Unsupported postChain").ThrowAsJavaScriptException();
+    }
+    return false;
+  }
+  return true;
+}
+
+class DenoiseWorker;
+
+/**
+ * new DenoiseSession([options]) -- denoise caller-provided audio with the
+ * production RNNoiseWrapper chain, no audio device involved.
+ *
+ * options: { noiseLevel?: number, vadThreshold?: number, postChain?: string[] }
+ *
+ *   process(buf)     -> Promise<buf>  in place; small chunks run inline,
+ *                                     large ones on a libuv worker
+ *   processSync(buf) -> buf           in place, always on the calling thread
+ *   flush()          -> Float32Array  the last `latency` samples of the stream
+ *   reset()          -> void          start an unrelated stream
+ *   close()          -> void          free native state (also done by GC)
+ *   latency          -> number        output delay in samples (480)
+ *   setNoiseLevel / setVadThreshold / setPostChain / getMetrics
+ *
+ * buf is a Float32Array or ArrayBuffer of normalized 48 kHz mono samples.
+ * It is modified in place (never copied) and must not be detached or
+ * reused while a process() promise is pending. Output lags input by
+ * `latency` samples across calls, so chunk boundaries are free.
+ * One call at a time per session; calls made while busy throw.
+ */
+class DenoiseSessionWrap : public Napi::ObjectWrap<DenoiseSessionWrap> {
+ public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "DenoiseSession", {
+        InstanceMethod("process", &DenoiseSessionWrap::Process),
+        InstanceMethod("processSync", &DenoiseSessionWrap::ProcessSync),
+        InstanceMethod("flush", &DenoiseSessionWrap::Flush),
+        InstanceMethod("reset", &DenoiseSessionWrap::Reset),
+        InstanceMethod("close", &DenoiseSessionWrap::Close),
+        InstanceMethod("setNoiseLevel", &DenoiseSessionWrap::SetNoiseLevel),
+        InstanceMethod("setVadThreshold", &DenoiseSessionWrap::SetVadThreshold),
+        InstanceMethod("setPostChain", &DenoiseSessionWrap::SetPostChain),
+        InstanceMethod("getMetrics", &DenoiseSessionWrap::GetMetrics),
+        InstanceAccessor("latency", &DenoiseSessionWrap::Latency, nullptr),
+    });
+  }
+
+  explicit DenoiseSessionWrap(const Napi::CallbackInfo& info)
+      : Napi::ObjectWrap<DenoiseSessionWrap>(info),
+        session_(std::make_unique<noiseguard::DenoiseSession>()) {
+    Napi::Env env = info.Env();
+    std::string err = session_->init();
+    if (!err.empty()) {
+      session_.reset();
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+      return;
+    }
+
+    if (info.Length() >= 1 && info[0].IsObject()) {
+      ApplyChainOptions(env, info[0].As<Napi::Object>(), session_->chain());
+    }
+  }
+
+ private:
+  friend class DenoiseWorker;
+
+  /** Throws and returns false unless the session can take a call now. */
+  bool Usable(Napi::Env env) {
+    if (!session_) {
+      Napi::Error::New(env, "Session is closed").ThrowAsJavaScriptException();
+      return false;
+    }
+    if (busy_) {
+      Napi::Error::New(env, "Session is busy").ThrowAsJavaScriptException();
+      return false;
+    }
+    return true;
+  }
+
+  /** Validate info[0] as an audio buffer. Throws on failure. */
+  static bool Buffer(const Napi::CallbackInfo& info, float*& data, size_t& count) {
+    if (info.Length() >= 1 && FloatView(info[0], data, count)) return true;
+    Napi::TypeError::New(info.Env(), "Expected a Float32Array or ArrayBuffer")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  Napi::Value Process(const Napi::CallbackInfo& info);
+
+  Napi::Value ProcessSync(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    float* data = nullptr;
+    size_t count = 0;
+    if (!Usable(env) || !Buffer(info, data, count)) return env.Undefined();
+    session_->process(data, count);
+    return info[0];
+  }
+
+  Napi::Value Flush(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!Usable(env)) return env.Undefined();
+    Napi::Float32Array out =
+        Napi::Float32Array::New(env, noiseguard::DenoiseSession::kLatency);
+    session_->flush(out.Data());
+    return out;
+  }
+
+  void Reset(const Napi::CallbackInfo& info) {
+    if (!Usable(info.Env())) return;
+    std::string err = session_->reset();
+    if (!err.empty()) Napi::Error::New(info.Env(), err).ThrowAsJavaScriptException();
+  }
+
+  /* A pending worker keeps this object alive and frees the session when done. */
+  void Close(const Napi::CallbackInfo& /*info*/) {
+    if (busy_) {
+      closePending_ = true;
+    } else {
+      session_.reset();
+    }
+  }
+
+  void SetNoiseLevel(const Napi::CallbackInfo& info) {
+    if (!session_ || info.Length() < 1 || !info[0].IsNumber()) return;
+    session_->chain().setSuppressionLevel(info[0].As<Napi::Number>().FloatValue());
+  }
+
+  void SetVadThreshold(const Napi::CallbackInfo& info) {
+    if (!session_ || info.Length() < 1 || !info[0].IsNumber()) return;
+    session_->chain().setVadThreshold(info[0].As<Napi::Number>().FloatValue());
+  }
+
+  Napi::Value SetPostChain(const Napi::CallbackInfo& info) {
+    std::vector<noiseguard::PostStage> stages;
+    bool ok = session_ && info.Length() >= 1 && ParsePostChain(info[0], stages) &&
+              session_->chain().setPostChain(stages);
+    return Napi::Boolean::New(info.Env(), ok);
+  }
+
+  Napi::Value GetMetrics(const Napi::CallbackInfo& info) {
+    if (!session_) return info.Env().Undefined();
+    return ChainMetricsToJs(info.Env(), session_->chain().metrics());
+  }
+
+  Napi::Value Latency(const Napi::CallbackInfo& info) {
+    return Napi::Number::New(info.Env(),
+        static_cast<double>(noiseguard::DenoiseSession::kLatency));
+  }
+
+  std::unique_ptr<noiseguard::DenoiseSession> session_;
+  bool busy_ = false;          /* A DenoiseWorker owns session_ right now. */
+  bool closePending_ = false;  /* close() arrived while busy. */
+};
+
+/**
+ * Runs DenoiseSession::process() on a libuv worker for large chunks.
+ * Holds references to the session object and the buffer so neither can be
+ * collected while the worker runs.
+ */
+class DenoiseWorker : public Napi::AsyncWorker {
+ public:
+  DenoiseWorker(Napi::Env env, DenoiseSessionWrap* owner, Napi::Value buffer,
+                float* data, size_t count)
+      : Napi::AsyncWorker(env, "noiseguard:denoise"),
+        deferred_(Napi::Promise::Deferred::New(env)),
+        owner_(owner),
+        session_(owner->session_.get()),
+        data_(data),
+        count_(count) {
+    ownerRef_ = Napi::Persistent(owner->Value());
+    bufferRef_ = Napi::Persistent(buffer.As<Napi::Object>());
+  }
+
+  Napi::Promise Promise() const { return deferred_.Promise(); }
+
+ protected:
+  void Execute() override { session_->process(data_, count_); }
+
+  void OnOK() override {
+    Finish();
+    deferred_.Resolve(bufferRef_.Value());
+  }
+
+  void OnError(const Napi::Error& e) override {
+    Finish();
+    deferred_.Reject(e.Value());
+  }
+
+ private:
+  void Finish() {
+    owner_->busy_ = false;
+    if (owner_->closePending_) owner_->session_.reset();
+  }
+
+  Napi::Promise::Deferred deferred_;
+  DenoiseSessionWrap* owner_;
+  noiseguard::DenoiseSession* session_;
+  float* data_;
+  size_t count_;
+  Napi::ObjectReference ownerRef_;
+  Napi::ObjectReference bufferRef_;
+};
+
+Napi::Value DenoiseSessionWrap::Process(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  float* data = nullptr;
+  size_t count = 0;
+  if (!Usable(env) || !Buffer(info, data, count)) return env.Undefined();
+
+  if (count <= kSyncMaxSamples) {
+    session_->process(data, count);
+    auto deferred = Napi::Promise::Deferred::New(env);
+    deferred.Resolve(info[0]);
+    return deferred.Promise();
+  }
+
+  busy_ = true;
+  auto* worker = new DenoiseWorker(env, this, info[0], data, count);
+  Napi::Promise promise = worker->Promise();
+  worker->Queue();
+  return promise;
+}
+
+/* Default cap on queued-but-unprocessed input (~2.7 s of s16le audio). */
+static constexpr size_t kDefaultStreamQueueBytes = 256 * 1024;
+
+class StreamWorker;
+
+/**
+ * new StreamSession(options, onOutput) -- native half of DenoiseStream
+ * (native/lib/denoise_stream.js): PCM bytes in, denoised PCM bytes out.
+ *
+ * options: { format?: 's16le' | 'f32le', maxQueuedBytes?: number,
+ *            noiseLevel?, vadThreshold?, postChain? }
+ *
+ *   push(chunk)  -> boolean  copy a Buffer / TypedArray into the bounded
+ *                            queue; false = queue full, wait for an
+ *                            onOutput call with writable === true
+ *   end()        -> void     no more input; the tail follows with ended
+ *   close()      -> void     free native state (also done by GC)
+ *   queuedBytes  -> number   input not yet processed
+ *
+ * onOutput(chunk: Buffer | null, writable: boolean, ended: boolean,
+ *          error?: Error) runs on the JS thread after each pass of the
+ * libuv worker that drains the queue. One worker per session at a time,
+ * so output stays in order. A failed pass (e.g. out of memory) reports
+ * error with ended === true; the session takes no more input.
+ */
+class StreamSessionWrap : public Napi::ObjectWrap<StreamSessionWrap> {
+ public:
+  static Napi::Function Define(Napi::Env env) {
+    return DefineClass(env, "StreamSession", {
+        InstanceMethod("push", &StreamSessionWrap::Push),
+        InstanceMethod("end", &StreamSessionWrap::End),
+        InstanceMethod("close", &StreamSessionWrap::Close),
+        InstanceAccessor("queuedBytes", &StreamSessionWrap::QueuedBytes, nullptr),
+    });
+  }
+
+  explicit StreamSessionWrap(const Napi::CallbackInfo& info)
+      : Napi::ObjectWrap<StreamSessionWrap>(info) {
+    Napi::Env env = info.Env();
+    if (info.Length() < 2 || !info[0].IsObject() || !info[1].IsFunction()) {
+      Napi::TypeError::New(env, "Expected (options, onOutput)")
+          .ThrowAsJavaScriptException();
+      return;
+    }
+    Napi::Object opts = info[0].As<Napi::Object>();
+
+    /* Nothing = an option getter threw; leave that exception pending for JS. */
+    Napi::Value fmt, cap;
+    if (!opts.Get("format").UnwrapTo(&fmt) ||
+        !opts.Get("maxQueuedBytes").UnwrapTo(&cap)) {
+      return;
+    }
+
+    noiseguard::PcmFormat format = noiseguard::PcmFormat::kS16LE;
+    if (fmt.IsString()) {
+      std::string f = fmt.As<Napi::String>().Utf8Value();
+      if (f == "f32le") {
+        format = noiseguard::PcmFormat::kF32LE;
+      } else if (f != "s16le") {
+        Napi::TypeError::New(env, "Unknown format: " + f).ThrowAsJavaScriptException();
+        return;
+      }
+    }
+
+    size_t maxQueued = kDefaultStreamQueueBytes;
+    if (cap.IsNumber() && cap.As<Napi::Number>().Int64Value() > 0) {
+      maxQueued = static_cast<size_t>(cap.As<Napi::Number>().Int64Value());
+    }
+
+    session_ = std::make_unique<noiseguard::StreamSession>(format, maxQueued);
+    std::string err = session_->init();
+    if (!err.empty()) {
+      session_.reset();
+      Napi::Error::New(env, err).ThrowAsJavaScriptException();
+      return;
+    }
+    if (!ApplyChainOptions(env, opts, session_->session().chain())) return;
+    onOutput_ = Napi::Persistent(info[1].As<Napi::Function>());
+  }
+
+ private:
+  friend class StreamWorker;
+
+  Napi::Value Push(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    if (!session_ || ending_) {
+      Napi::Error::New(env, session_ ? "Stream has ended" : "Session is closed")
+          .ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+    if (info.Length() < 1 || !info[0].IsTypedArray()) {
+      Napi::TypeError::New(env, "Expected a Buffer or TypedArray")
+          .ThrowAsJavaScriptException();
+      return env.Undefined();
+    }
+
+    Napi::TypedArray ta = info[0].As<Napi::TypedArray>();
+    const auto* data = static_cast<const uint8_t*>(ta.ArrayBuffer().Data()) +
+                       ta.ByteOffset();
+    bool writable = session_->push(data, ta.ByteLength());
+    Schedule(env);
+    return Napi::Boolean::New(env, writable);
+  }
+
+  void End(const Napi::CallbackInfo& info) {
+    if (!session_ || ending_) return;
+    ending_ = true;
+    Schedule(info.Env());
+  }
+
+  void Close(const Napi::CallbackInfo& /*info*/) {
+    ending_ = true;
+    if (running_) {
+      closePending_ = true;
+    } else {
+      session_.reset();
+      onOutput_.Reset();
+    }
+  }
+
+  Napi::Value QueuedBytes(const Napi::CallbackInfo& info) {
+    size_t queued = session_ ? session_->queuedBytes() : 0;
+    return Napi::Number::New(info.Env(), static_cast<double>(queued));
+  }
+
+  /** Start a worker pass if there is work and none is running. */
+  void Schedule(Napi::Env env);
+
+  /** Worker pass finished (JS thread): deliver output, maybe go again. */
+  void PassDone(Napi::Env env, std::vector<uint8_t>& out, bool finished) {
+    running_ = false;
+    if (closePending_) {
+      session_.reset();
+      onOutput_.Reset();
+      return;
+    }
+    if (finished) ended_ = true;
+
+    Napi::Value chunk = out.empty()
+        ? env.Null()
+        : Napi::Value(Napi::Buffer<uint8_t>::Copy(env, out.data(), out.size()));
+    bool writable = session_->writable();
+    onOutput_.Value().Call({chunk, Napi::Boolean::New(env, writable),
+                            Napi::Boolean::New(env, ended_)});
+    Schedule(env);
+  }
+
+  /** Worker pass threw (JS thread): end the stream and report the error. */
+  void PassFailed(Napi::Env env, const Napi::Error& error) {
+    running_ = false;
+    if (closePending_) {
+      session_.reset();
+      onOutput_.Reset();
+      return;
+    }
+    ending_ = true;
+    ended_ = true;
+    onOutput_.Value().Call({env.Null(), Napi::Boolean::New(env, false),
+                            Napi::Boolean::New(env, true), error.Value()});
+  }
+
+  std::unique_ptr<noiseguard::StreamSession> session_;
+  Napi::FunctionReference onOutput_;
+  bool running_ = false;       /* A StreamWorker is draining the queue. */
+  bool ending_ = false;        /* end() called (or closed). */
+  bool ended_ = false;         /* Tail delivered. */
+  bool closePending_ = false;  /* close() arrived while running. */
+};
+
+/**
+ * One drain pass of a StreamSession on a libuv worker. Holds a reference to
+ * the session object so it cannot be collected mid-pass.
+ */
+class StreamWorker : public Napi::AsyncWorker {
+ public:
+  StreamWorker(Napi::Env env, StreamSessionWrap* owner, bool finish)
+      : Napi::AsyncWorker(env, "noiseguard:stream"),
+        owner_(owner),
+        session_(owner->session_.get()),
+        finish_(finish) {
+    ownerRef_ = Napi::Persistent(owner->Value());
+  }
+
+ protected:
+  /* node-addon-api only catches for us with NAPI_CPP_EXCEPTIONS. */
+  void Execute() override {
+    try {
+      if (finish_) {
+        session_->finish(out_);
+      } else {
+        session_->drain(out_);
+      }
+    } catch (const std::exception& e) {
+      SetError(e.what());
+    }
+  }
+
+  void OnOK() override { owner_->PassDone(Env(), out_, finish_); }
+
+  void OnError(const Napi::Error& e) override { owner_->PassFailed(Env(), e); }
+
+ private:
+  StreamSessionWrap* owner_;
+  noiseguard::StreamSession* session_;
+  bool finish_;
+  std::vector<uint8_t> out_;
+  Napi::ObjectReference ownerRef_;
+};
+
+void StreamSessionWrap::Schedule(Napi::Env env) {
+  if (running_ || !session_ || ended_) return;
+  bool finish = ending_;
+  if (!finish && session_->queuedBytes() == 0) return;
+
+  running_ = true;
+  (new StreamWorker(env, this, finish))->Queue();
+}
+
 /**
  * Module initialization.
  */
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
+  /*
+   * Hold a PortAudio session for the lifetime of the addon so device
+   * enumeration is cached and start()/stop() never re-initialize PortAudio.
+   * If no audio host is available, getDevices() falls back to a one-shot scan.
+   */
+  auto& session = noiseguard::HostSession::instance();
+  bool sessionHeld = session.acquire().empty();
+  session.setDeviceChangeCallback(NotifyDevicesChanged);
+
+  {
+    std::lock_guard<std::mutex> lock(g_enginesMutex);
+    g_engines.insert(&g_engine);
+  }
+
+  env.AddCleanupHook([sessionHeld]() {
+    auto& s = noiseguard::HostSession::instance();
+    s.setDeviceChangeCallback(nullptr);
+    {
+      std::lock_guard<std::mutex> lock(g_deviceTsfnMutex);
+      if (g_deviceTsfnActive) g_deviceTsfn.Release();
+      g_deviceTsfnActive = false;
+    }
+    /* Stop every engine before the session goes; finalizers that run
+     * afterwards find them stopped. */
+    std::vector<noiseguard::AudioEngine*> engines;
+    {
+      std::lock_guard<std::mutex> lock(g_enginesMutex);
+      engines.assign(g_engines.begin(), g_engines.end());
+    }
+    for (auto* e : engines) {
+      e->stop();
+      e->detachSharedOutput();
+      e->stopRecording();
+      e->stopCapture();
+    }
+    noiseguard::Tracer::instance().stop();
+    g_sharedOutputRef.Reset();
+    if (sessionHeld) s.release();
+  });
+
   exports.Set("getDevices", Napi::Function::New(env, GetDevices));
+  exports.Set("refreshDevices", Napi::Function::New(env, RefreshDevices));
+  exports.Set("onDevicesChanged", Napi::Function::New(env, OnDevicesChanged));
   exports.Set("start", Napi::Function::New(env, Start));
   exports.Set("stop", Napi::Function::New(env, Stop));
   exports.Set("setNoiseLevel", Napi::Function::New(env, SetNoiseLevel));
   exports.Set("getNoiseLevel", Napi::Function::New(env, GetNoiseLevel));
   exports.Set("setVadThreshold", Napi::Function::New(env, SetVadThreshold));
   exports.Set("getVadThreshold", Napi::Function::New(env, GetVadThreshold));
+  exports.Set("setPostChain", Napi::Function::New(env, SetPostChain));
+  exports.Set("getPostChain", Napi::Function::New(env, GetPostChain));
   exports.Set("isRunning", Napi::Function::New(env, IsRunning));
   exports.Set("getMetrics", Napi::Function::New(env, GetMetrics));
+  exports.Set("attachSharedOutput", Napi::Function::New(env, AttachSharedOutput));
+  exports.Set("detachSharedOutput", Napi::Function::New(env, DetachSharedOutput));
+  exports.Set("startRecording", Napi::Function::New(env, StartRecording));
+  exports.Set("stopRecording", Napi::Function::New(env, StopRecording));
+  exports.Set("getRecordingStats", Napi::Function::New(env, GetRecordingStats));
+  exports.Set("startCapture", Napi::Function::New(env, StartCapture));
+  exports.Set("stopCapture", Napi::Function::New(env, StopCapture));
+  exports.Set("getCaptureStats", Napi::Function::New(env, GetCaptureStats));
+  exports.Set("dumpFlightRecorder", Napi::Function::New(env, DumpFlightRecorder));
+  exports.Set("setFlightRecorderDir", Napi::Function::New(env, SetFlightRecorderDir));
+  exports.Set("startTrace", Napi::Function::New(env, StartTrace));
+  exports.Set("stopTrace", Napi::Function::New(env, StopTrace));
+  exports.Set("exportTrace", Napi::Function::New(env, ExportTrace));
+  exports.Set("getTraceStats", Napi::Function::New(env, GetTraceStats));
+  exports.Set("calibrateLatency", Napi::Function::New(env, CalibrateLatency));
+  exports.Set("setLatencyCacheFile", Napi::Function::New(env, SetLatencyCacheFile));
+  exports.Set("generateSignal", Napi::Function::New(env, GenerateSignal));
+  exports.Set("NoiseGuardEngine", NoiseGuardEngine::Define(env));
+  exports.Set("DenoiseSession", DenoiseSessionWrap::Define(env));
+  exports.Set("StreamSession", StreamSessionWrap::Define(env));
   return exports;
 }
 
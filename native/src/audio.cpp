@@ -2,70 +2,120 @@
  * AudioEngine implementation.
  *
  * Data flow:
- *   Mic -> captureCallback() -> captureRing_ -> processingLoop() -> RNNoise
- *       -> outputRing_ -> outputCallback() -> Speaker/VB-Cable
+ *   Mic -> captureCallback() -> captureRing_ -> processPending() -> RNNoise
+ *       -> outputFrames_ (broadcast) -> outputCallback() -> Speaker/VB-Cable
+ *                                    -> kFinal tap writer, outputFrames() readers
+ *       -> shared ring (optional) -> AudioWorklet / other in-process reader
  *
  * Threading model:
  *   - Capture callback:    PortAudio's audio thread (real-time priority).
  *   - Output callback:     PortAudio's audio thread (real-time priority).
- *   - Processing loop:     Our own std::thread (elevated priority recommended).
+ *   - processPending():    A ProcessingPool worker, shared with other engines.
+ *   - Supervisor loop:     Our own std::thread (normal priority). Owns the
+ *                          PortAudio streams while running; performs device
+ *                          recovery with backoff so nothing else ever waits.
  *   - start()/stop():      Called from Node.js main thread via N-API.
  */
 
 #include "audio.h"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstring>
+#include <ctime>
+#include <new>
 
-#include "portaudio.h"
-
-#ifdef _WIN32
-#include "pa_win_wasapi.h"
-#endif
+#include "latency_tuner.h"
+#include "pa_util.h"
+#include "rt_check.h"
+#include "sample_convert.h"
+#include "trace.h"
 
 namespace noiseguard {
 
 /*
- * Ring buffer capacity in samples.
- * 4096 samples @ 48kHz ~= 85ms -- enough to absorb scheduling jitter
- * without adding perceptible latency. Must be >> framesPerBuffer.
+ * Frames processed per pool call before yielding to the worker's other
+ * engines. A backlog larger than this is drained over the next sweeps.
+ */
+static constexpr int kMaxFramesPerPass = 4;
+
+/*
+ * Minimum spacing of automatic flight-recorder dumps. A flapping device
+ * recovers over and over; one window per minute is plenty to diagnose it.
+ */
+static constexpr auto kAutoDumpCooldown = std::chrono::seconds(60);
+
+/*
+ * What counts as an xrun burst worth a flight dump: kXrunBurstCount xruns
+ * within kXrunBurstWindow. A lone glitch still gets its recovery, but its
+ * window would show nothing worth diagnosing.
  */
-static constexpr size_t kRingCapacity = 4096;
+static constexpr uint64_t kXrunBurstCount = 3;
+static constexpr auto kXrunBurstWindow = std::chrono::seconds(2);
 
 /* Max restart attempts before giving up. */
 static constexpr int kMaxRestartAttempts = 5;
 
+/*
+ * Supervisor poll interval when idle. Commands are rare (device errors),
+ * so a short sleep keeps the thread cheap without a kernel wait object
+ * that the real-time side would have to signal.
+ */
+static constexpr int kSupervisorPollMs = 5;
+
+/** Destroy an arena-carved ring and rewind the arena to the run mark. */
+template <typename Ring>
+static void releaseRing(SessionArena& arena, size_t mark, Ring*& ring) {
+  if (ring) ring->~Ring();
+  ring = nullptr;
+  arena.rewind(mark);
+}
+
+/** Convert n captured samples from offset of input into dst (see CaptureFormat). */
+static void convertCapture(CaptureFormat format, const void* input, size_t offset,
+                           float* dst, size_t n) {
+  switch (format) {
+    case CaptureFormat::kFloat32:
+      std::memcpy(dst, static_cast<const float*>(input) + offset, n * sizeof(float));
+      break;
+    case CaptureFormat::kInt16:
+      int16ToScaledFloat(static_cast<const int16_t*>(input) + offset, dst, n);
+      break;
+    case CaptureFormat::kInt24:
+      int24ToScaledFloat(static_cast<const uint8_t*>(input) + 3 * offset, dst, n);
+      break;
+  }
+}
+
 /* ───────────────────── Constructor / Destructor ───────────────────── */
 
-AudioEngine::AudioEngine() = default;
+AudioEngine::AudioEngine() : outputFrames_(std::make_unique<FrameBroadcast>()) {
+  /* Construct the pool first so it outlives static AudioEngine instances. */
+  ProcessingPool::instance();
+
+  /* Wrapper for the engine's lifetime, room for one run's states + ring. */
+  const size_t bytes = arenaFootprint(sizeof(RNNoiseWrapper)) +
+                       RNNoiseWrapper::stateBytes() +
+                       arenaFootprint(sizeof(CaptureRing));
+  if (!arena_.reserve(bytes, true).empty()) throw std::bad_alloc();
+  rnnoise_ = arena_.create<RNNoiseWrapper>();
+  runMark_ = arena_.used();
+}
 
-AudioEngine::~AudioEngine() { stop(); }
+AudioEngine::~AudioEngine() {
+  stop();
+  detachSharedOutput();
+  stopRecording();
+  stopCapture();
+  releaseRing(arena_, runMark_, captureRing_);
+  rnnoise_->~RNNoiseWrapper();
+}
 
 /* ───────────────────── Device Enumeration ───────────────────── */
 
 std::vector<DeviceInfo> AudioEngine::enumerateDevices() {
-  std::vector<DeviceInfo> devices;
-
-  PaError err = Pa_Initialize();
-  if (err != paNoError) return devices;
-
-  int numDevices = Pa_GetDeviceCount();
-  for (int i = 0; i < numDevices; i++) {
-    const PaDeviceInfo* info = Pa_GetDeviceInfo(i);
-    if (!info) continue;
-
-    DeviceInfo d;
-    d.index = i;
-    d.name = info->name ? info->name : "(unknown)";
-    d.maxInputChannels = info->maxInputChannels;
-    d.maxOutputChannels = info->maxOutputChannels;
-    d.defaultSampleRate = info->defaultSampleRate;
-    devices.push_back(d);
-  }
-
-  Pa_Terminate();
-  return devices;
+  return HostSession::instance().devices();
 }
 
 /* ───────────────────── Start / Stop ───────────────────── */
@@ -77,36 +127,73 @@ std::string AudioEngine::start(const AudioConfig& config) {
 
   config_ = config;
 
-  /* Initialize PortAudio. */
-  PaError err = Pa_Initialize();
-  if (err != paNoError) {
-    return std::string("Pa_Initialize failed: ") + Pa_GetErrorText(err);
+  /*
+   * Take a reference on the process-wide PortAudio session. Normally the
+   * addon already holds one, so this is just a counter increment. Streams
+   * are registered so the session never re-initializes PortAudio under them.
+   */
+  HostSession& session = HostSession::instance();
+  std::string sessionErr = session.acquire();
+  if (!sessionErr.empty()) return sessionErr;
+  session.retainStreams();
+
+  /* Stable ids -> this session's indices, fixed while streams are retained. */
+  if (!config_.inputDeviceId.empty()) {
+    config_.inputDeviceIndex = session.findDevice(config_.inputDeviceId);
+    if (config_.inputDeviceIndex < 0) {
+      session.releaseStreams();
+      session.release();
+      return "Input device not found: " + config_.inputDeviceId;
+    }
+  }
+  if (!config_.outputDeviceId.empty()) {
+    config_.outputDeviceIndex = session.findDevice(config_.outputDeviceId);
+    if (config_.outputDeviceIndex < 0) {
+      session.releaseStreams();
+      session.release();
+      return "Output device not found: " + config_.outputDeviceId;
+    }
   }
 
-  /* Allocate ring buffers. Done once here, never in callbacks. */
-  captureRing_ = std::make_unique<RingBuffer>(kRingCapacity);
-  outputRing_ = std::make_unique<RingBuffer>(kRingCapacity);
+  /* Per-device buffer size / latency found by a previous calibration. */
+  if (config_.useCalibratedLatency) {
+    LatencyTuner::applyCached(config_);
+  }
 
-  /* Initialize RNNoise. */
-  if (!rnnoise_.init()) {
-    Pa_Terminate();
+  /* Carve this run's ring buffer. Done once here, never in callbacks. */
+  releaseRing(arena_, runMark_, captureRing_);
+  captureRing_ = arena_.create<CaptureRing>();
+  captureFilled_ = 0;
+  capturePendingFlags_ = 0;
+  outputReader_ = outputFrames_->reader(OverrunPolicy::kSkipAhead, kOutputLagFrames);
+  playPos_ = kRNNoiseFrameSize;
+  engineMetrics_.processLatencyMs.store(0.0, std::memory_order_relaxed);
+  engineMetrics_.outputLatencyMs.store(0.0, std::memory_order_relaxed);
+  engineMetrics_.maxOutputLatencyMs.store(0.0, std::memory_order_relaxed);
+
+  /* Initialize RNNoise, its states carved after the ring. */
+  if (!rnnoise_->init(arena_)) {
+    session.releaseStreams();
+    session.release();
     return "RNNoise initialization failed";
   }
 
   /* Open PortAudio streams. */
   std::string openErr = openStreams();
   if (!openErr.empty()) {
-    rnnoise_.destroy();
-    Pa_Terminate();
+    rnnoise_->destroy();
+    session.releaseStreams();
+    session.release();
     return openErr;
   }
 
   /* Start streams. */
-  err = Pa_StartStream(captureStream_);
+  PaError err = Pa_StartStream(captureStream_);
   if (err != paNoError) {
     closeStreams();
-    rnnoise_.destroy();
-    Pa_Terminate();
+    rnnoise_->destroy();
+    session.releaseStreams();
+    session.release();
     return std::string("Failed to start capture stream: ") + Pa_GetErrorText(err);
   }
 
@@ -116,15 +203,25 @@ std::string AudioEngine::start(const AudioConfig& config) {
     if (err != paNoError) {
       Pa_StopStream(captureStream_);
       closeStreams();
-      rnnoise_.destroy();
-      Pa_Terminate();
+      rnnoise_->destroy();
+      session.releaseStreams();
+      session.release();
       return std::string("Failed to start output stream: ") + Pa_GetErrorText(err);
     }
   }
 
-  /* Launch processing thread. */
+  /* Drop any stale commands from a previous run. */
+  SupervisorCommand stale;
+  while (commandQueue_.pop(stale)) {}
+
+  /* An armed capture starts with this run's first frame (fresh chain). */
+  if (captureActive_) rnnoise_->setCapture(capture_.get());
+
+  /* Start processing + supervisor. From here on, only the supervisor
+   * touches the streams until stop() joins it. */
   running_.store(true, std::memory_order_release);
-  processingThread_ = std::thread(&AudioEngine::processingLoop, this);
+  ProcessingPool::instance().attach(this, &AudioEngine::processPending);
+  supervisorThread_ = std::thread(&AudioEngine::supervisorLoop, this);
 
   return "";  /* Success */
 }
@@ -132,25 +229,31 @@ std::string AudioEngine::start(const AudioConfig& config) {
 void AudioEngine::stop() {
   if (!running_.load(std::memory_order_acquire)) return;
 
-  /* Signal processing thread to exit. */
+  /* Signal the supervisor to exit and take us off the processing pool. */
   running_.store(false, std::memory_order_release);
+  commandQueue_.push(SupervisorCommand::kShutdown);
 
-  /* Wait for processing thread to finish. */
-  if (processingThread_.joinable()) {
-    processingThread_.join();
+  /* Wait for both. After this the streams and rings are ours again. */
+  if (supervisorThread_.joinable()) {
+    supervisorThread_.join();
   }
+  ProcessingPool::instance().detach(this);
 
   /* Stop and close streams. */
   if (captureStream_) Pa_StopStream(captureStream_);
   if (outputStream_) Pa_StopStream(outputStream_);
   closeStreams();
 
+  /* A capture covers exactly one run: the next start() resets the chain. */
+  stopCapture();
+
   /* Cleanup. */
-  rnnoise_.destroy();
-  captureRing_.reset();
-  outputRing_.reset();
+  rnnoise_->destroy();
+  releaseRing(arena_, runMark_, captureRing_);
 
-  Pa_Terminate();
+  HostSession& session = HostSession::instance();
+  session.releaseStreams();
+  session.release();
 }
 
 /* ───────────────────── Stream Setup ───────────────────── */
@@ -173,9 +276,13 @@ std::string AudioEngine::openStreams() {
   PaStreamParameters inputParams;
   inputParams.device = inputIdx;
   inputParams.channelCount = 1;  /* Mono -- RNNoise is mono only. */
-  inputParams.sampleFormat = paFloat32;
+  switch (config_.captureFormat) {
+    case CaptureFormat::kInt16: inputParams.sampleFormat = paInt16; break;
+    case CaptureFormat::kInt24: inputParams.sampleFormat = paInt24; break;
+    default:                    inputParams.sampleFormat = paFloat32; break;
+  }
   inputParams.suggestedLatency =
-      Pa_GetDeviceInfo(inputIdx)->defaultLowInputLatency;
+      resolveSuggestedLatency(inputIdx, true, config_.inputLatency);
   inputParams.hostApiSpecificStreamInfo = nullptr;
 
   /* ── Output stream parameters (optional) ── */
@@ -185,7 +292,7 @@ std::string AudioEngine::openStreams() {
     outputParams.channelCount = 1;  /* Mono output. */
     outputParams.sampleFormat = paFloat32;
     outputParams.suggestedLatency =
-        Pa_GetDeviceInfo(outputIdx)->defaultLowOutputLatency;
+        resolveSuggestedLatency(outputIdx, false, config_.outputLatency);
     outputParams.hostApiSpecificStreamInfo = nullptr;
   }
 
@@ -198,34 +305,13 @@ std::string AudioEngine::openStreams() {
   PaWasapiStreamInfo wasapiInputInfo;
   PaWasapiStreamInfo wasapiOutputInfo;
 
-  if (config_.tryExclusiveMode) {
-    const PaHostApiInfo* wasapiInfo = nullptr;
-    for (PaHostApiIndex i = 0; i < Pa_GetHostApiCount(); i++) {
-      const PaHostApiInfo* api = Pa_GetHostApiInfo(i);
-      if (api && api->type == paWASAPI) {
-        wasapiInfo = api;
-        break;
-      }
-    }
+  if (config_.tryExclusiveMode && hasWasapiHostApi()) {
+    fillWasapiExclusive(wasapiInputInfo);
+    inputParams.hostApiSpecificStreamInfo = &wasapiInputInfo;
 
-    if (wasapiInfo) {
-      memset(&wasapiInputInfo, 0, sizeof(wasapiInputInfo));
-      wasapiInputInfo.size = sizeof(PaWasapiStreamInfo);
-      wasapiInputInfo.hostApiType = paWASAPI;
-      wasapiInputInfo.version = 1;
-      wasapiInputInfo.flags = paWinWasapiExclusive | paWinWasapiThreadPriority;
-      wasapiInputInfo.threadPriority = eThreadPriorityProAudio;
-      inputParams.hostApiSpecificStreamInfo = &wasapiInputInfo;
-
-      if (outputEnabled) {
-        memset(&wasapiOutputInfo, 0, sizeof(wasapiOutputInfo));
-        wasapiOutputInfo.size = sizeof(PaWasapiStreamInfo);
-        wasapiOutputInfo.hostApiType = paWASAPI;
-        wasapiOutputInfo.version = 1;
-        wasapiOutputInfo.flags = paWinWasapiExclusive | paWinWasapiThreadPriority;
-        wasapiOutputInfo.threadPriority = eThreadPriorityProAudio;
-        outputParams.hostApiSpecificStreamInfo = &wasapiOutputInfo;
-      }
+    if (outputEnabled) {
+      fillWasapiExclusive(wasapiOutputInfo);
+      outputParams.hostApiSpecificStreamInfo = &wasapiOutputInfo;
     }
   }
 #endif
@@ -264,8 +350,11 @@ std::string AudioEngine::openStreams() {
     return ""; /* Success: capture-only (mute output) */
   }
 
+  const unsigned long outputFrames = config_.outputFramesPerBuffer
+      ? config_.outputFramesPerBuffer : config_.framesPerBuffer;
+
   err = Pa_OpenStream(&outputStream_, nullptr, &outputParams,
-                      config_.sampleRate, config_.framesPerBuffer,
+                      config_.sampleRate, outputFrames,
                       paClipOff,
                       outputCallback, this);
 
@@ -274,7 +363,7 @@ std::string AudioEngine::openStreams() {
     if (config_.tryExclusiveMode) {
       outputParams.hostApiSpecificStreamInfo = nullptr;
       err = Pa_OpenStream(&outputStream_, nullptr, &outputParams,
-                          config_.sampleRate, config_.framesPerBuffer,
+                          config_.sampleRate, outputFrames,
                           paClipOff, outputCallback, this);
     }
 #endif
@@ -304,34 +393,81 @@ void AudioEngine::closeStreams() {
 
 int AudioEngine::captureCallback(const void* input, void* /*output*/,
                                  unsigned long frameCount,
-                                 const PaStreamCallbackTimeInfo* /*timeInfo*/,
+                                 const PaStreamCallbackTimeInfo* timeInfo,
                                  PaStreamCallbackFlags statusFlags,
                                  void* userData) {
   /*
    * REAL-TIME SAFE: This runs on PortAudio's high-priority audio thread.
    * Absolutely NO allocations, NO locks, NO system calls here.
-   * We only write to the lock-free ring buffer.
+   * We only fill slots of the lock-free frame ring.
    */
+  RtScope rtScope("captureCallback");
+  TraceSpan traceSpan("capture_callback");
   auto* engine = static_cast<AudioEngine*>(userData);
 
   if (!input || !engine->running_.load(std::memory_order_relaxed)) {
     return paContinue;
   }
 
-  const auto* samples = static_cast<const float*>(input);
+  /*
+   * When the first sample of this buffer hit the ADC, on the frame clock.
+   * PortAudio's times are in the stream's own clock, so only their
+   * difference is used; without them, assume the buffer just completed.
+   */
+  const double rate = engine->config_.sampleRate;
+  double firstSample = frameClockSeconds();
+  if (timeInfo && timeInfo->inputBufferAdcTime > 0.0) {
+    firstSample -= timeInfo->currentTime - timeInfo->inputBufferAdcTime;
+  } else {
+    firstSample -= static_cast<double>(frameCount) / rate;
+  }
+  if (statusFlags & 0x00000003 /* paInputUnderflow | paInputOverflow */) {
+    engine->capturePendingFlags_ |= kFrameXrun;
+  }
 
   /*
-   * Write captured samples to ring buffer.
-   * If the ring buffer is full, samples are silently dropped.
-   * This is intentional: in real-time audio, dropping frames is
-   * better than blocking or introducing unbounded latency.
+   * Fill frame slots in place, stamping each frame as it starts.
+   * If the ring is full, the rest of the buffer is silently dropped and the
+   * next frame is flagged kFrameGap. This is intentional: in real-time
+   * audio, dropping frames is better than blocking or introducing
+   * unbounded latency.
+   *
+   * Integer formats go straight into RNNoise's int16-range float domain.
    */
-  engine->captureRing_->write(samples, frameCount);
+  CaptureRing& ring = *engine->captureRing_;
+  for (unsigned long done = 0; done < frameCount;) {
+    AudioFrame* frame = ring.writeSlot();
+    if (!frame) {
+      engine->capturePendingFlags_ |= kFrameGap;
+      break;
+    }
+    if (engine->captureFilled_ == 0) {
+      frame->captureTime = firstSample + static_cast<double>(done) / rate;
+      frame->sequence = engine->captureSequence_++;
+      frame->flags = engine->capturePendingFlags_;
+      engine->capturePendingFlags_ = 0;
+    }
+    size_t n = std::min<size_t>(kRNNoiseFrameSize - engine->captureFilled_, frameCount - done);
+    convertCapture(engine->config_.captureFormat, input, done,
+                   frame->samples + engine->captureFilled_, n);
+    engine->captureFilled_ += n;
+    done += n;
+    if (engine->captureFilled_ == kRNNoiseFrameSize) {
+      ring.commitWrite();
+      engine->captureFilled_ = 0;
+    }
+  }
+  if (traceEnabled()) {
+    traceCounter("capture_ring_fill",
+                 static_cast<float>(ring.available_read() * kRNNoiseFrameSize));
+  }
 
-  /* Detect device issues via statusFlags. */
+  /* Detect device issues via statusFlags. Recovery runs on the supervisor. */
   if (statusFlags & 0x00000001 /* paInputUnderflow */ ||
       statusFlags & 0x00000002 /* paInputOverflow */) {
-    engine->shouldRestart_.store(true, std::memory_order_relaxed);
+    traceInstant("capture_xrun", static_cast<float>(statusFlags));
+    engine->engineMetrics_.xruns.fetch_add(1, std::memory_order_relaxed);
+    engine->commandQueue_.push(SupervisorCommand::kRestart);
   }
 
   return paContinue;
@@ -341,14 +477,16 @@ int AudioEngine::captureCallback(const void* input, void* /*output*/,
 
 int AudioEngine::outputCallback(const void* /*input*/, void* output,
                                 unsigned long frameCount,
-                                const PaStreamCallbackTimeInfo* /*timeInfo*/,
+                                const PaStreamCallbackTimeInfo* timeInfo,
                                 PaStreamCallbackFlags statusFlags,
                                 void* userData) {
   /*
    * REAL-TIME SAFE: Same rules as captureCallback.
-   * Read processed samples from the output ring buffer.
+   * Play processed frames from our outputFrames_ reader.
    * If not enough data is available, output silence (zero-fill).
    */
+  RtScope rtScope("outputCallback");
+  TraceSpan traceSpan("output_callback");
   auto* engine = static_cast<AudioEngine*>(userData);
   auto* out = static_cast<float*>(output);
 
@@ -357,83 +495,371 @@ int AudioEngine::outputCallback(const void* /*input*/, void* output,
     return paContinue;
   }
 
-  size_t read = engine->outputRing_->read(out, frameCount);
+  /*
+   * Play out whole frames from our broadcast reader. When a frame starts,
+   * its first sample reaches the DAC at the buffer's DAC time plus its
+   * offset; that minus the capture stamp is the frame's end-to-end latency.
+   */
+  const double rate = engine->config_.sampleRate;
+  double dacTime = frameClockSeconds();
+  if (timeInfo && timeInfo->outputBufferDacTime > 0.0) {
+    dacTime += timeInfo->outputBufferDacTime - timeInfo->currentTime;
+  }
+  EngineMetrics& em = engine->engineMetrics_;
+  size_t read = 0;
+  while (read < frameCount) {
+    if (engine->playPos_ == kRNNoiseFrameSize) {
+      if (!engine->outputReader_.read(engine->playing_)) break;
+      engine->playPos_ = 0;
+      const double playout = dacTime + static_cast<double>(read) / rate;
+      const double ms = (playout - engine->playing_.captureTime) * 1000.0;
+      em.outputLatencyMs.store(ms, std::memory_order_relaxed);
+      if (ms > em.maxOutputLatencyMs.load(std::memory_order_relaxed)) {
+        em.maxOutputLatencyMs.store(ms, std::memory_order_relaxed);
+      }
+    }
+    size_t n = std::min<size_t>(kRNNoiseFrameSize - engine->playPos_, frameCount - read);
+    std::memcpy(out + read, engine->playing_.samples + engine->playPos_, n * sizeof(float));
+    engine->playPos_ += n;
+    read += n;
+  }
 
   /* Zero-fill remainder if underrun (not enough processed data yet). */
   if (read < frameCount) {
     memset(out + read, 0, (frameCount - read) * sizeof(float));
+    traceInstant("output_underrun", static_cast<float>(frameCount - read));
+  }
+  if (traceEnabled()) {
+    traceCounter("output_ring_fill",
+                 static_cast<float>(engine->outputReader_.available() * kRNNoiseFrameSize +
+                                    (kRNNoiseFrameSize - engine->playPos_)));
   }
 
   /* Detect output issues. */
   if (statusFlags & 0x00000004 /* paOutputUnderflow */ ||
       statusFlags & 0x00000008 /* paOutputOverflow */) {
-    engine->shouldRestart_.store(true, std::memory_order_relaxed);
+    traceInstant("output_xrun", static_cast<float>(statusFlags));
+    engine->engineMetrics_.xruns.fetch_add(1, std::memory_order_relaxed);
+    engine->commandQueue_.push(SupervisorCommand::kRestart);
   }
 
   return paContinue;
 }
 
-/* ───────────────────── Processing Thread ───────────────────── */
+/* ───────────────────── Processing ───────────────────── */
 
-void AudioEngine::processingLoop() {
+bool AudioEngine::processPending(void* self) {
   /*
-   * This thread reads from captureRing_, processes through RNNoise,
-   * and writes to outputRing_. It runs at slightly below real-time
-   * priority (PortAudio callbacks are higher priority).
-   *
-   * We process in chunks of kRNNoiseFrameSize (480 samples = 10ms).
+   * Runs on a pool worker that may serve other engines too, so it never
+   * sleeps or waits: it drains what is there (up to kMaxFramesPerPass
+   * frames of kRNNoiseFrameSize = 10ms each) and returns.
    */
-  float frame[kRNNoiseFrameSize];
+  RtScope rtScope("processPending");
+  auto* engine = static_cast<AudioEngine*>(self);
+  if (!engine->running_.load(std::memory_order_acquire)) return false;
+
+  /* Integer captures arrive already in RNNoise's int16-range domain. */
+  const bool scaledInput =
+      (engine->config_.captureFormat != CaptureFormat::kFloat32);
+
+  /* Frames are processed in their ring slot, released once done. */
+  CaptureRing& ring = *engine->captureRing_;
+  int frames = 0;
+  AudioFrame* captured;
+  while (frames < kMaxFramesPerPass && (captured = ring.readSlot()) != nullptr) {
+    TraceSpan traceSpan("process_frame");
+    float* frame = captured->samples;
+    engine->flight_.recordInput(frame, scaledInput ? kInvInt16Scale : 1.0f);
+
+    /* Sinks (taps, shared ring) stay valid until sinkUsers_ drops. */
+    engine->sinkUsers_.fetch_add(1, std::memory_order_seq_cst);
+    TapRecorder* taps = engine->taps_.load(std::memory_order_seq_cst);
+    if (taps) {
+      taps->write(TapPoint::kPreRNNoise, frame, kRNNoiseFrameSize,
+                  scaledInput ? kInvInt16Scale : 1.0f);
+    }
+
+    /* Run noise suppression. */
+    if (scaledInput) {
+      engine->rnnoise_->processFrameScaled(frame);
+      scaleSamples(frame, kRNNoiseFrameSize, kInvInt16Scale);  /* The one output conversion. */
+    } else {
+      engine->rnnoise_->processFrame(frame);
+    }
+
+    const double processedMs =
+        (frameClockSeconds() - captured->captureTime) * 1000.0;
+    engine->engineMetrics_.processLatencyMs.store(processedMs, std::memory_order_relaxed);
+
+    /*
+     * Publish once for every consumer: the output callback (if there is
+     * an output device), the kFinal tap and outputFrames() readers.
+     */
+    if (taps) taps->follow(TapPoint::kFinal, captured->sequence);
+    engine->outputFrames_->write(*captured);
+
+    const AudioMetrics& m = engine->rnnoise_->metrics();
+    FlightFrameInfo info;
+    info.timeMs = engine->flight_.nowMs();
+    info.inputRms = m.inputRms.load(std::memory_order_relaxed);
+    info.outputRms = m.outputRms.load(std::memory_order_relaxed);
+    info.vad = m.vadProbability.load(std::memory_order_relaxed);
+    info.gain = m.currentGain.load(std::memory_order_relaxed);
+    info.captureFill = static_cast<uint32_t>((ring.available_read() - 1) * kRNNoiseFrameSize);
+    info.xruns = static_cast<uint32_t>(
+        engine->engineMetrics_.xruns.load(std::memory_order_relaxed));
+    info.latencyMs = static_cast<float>(processedMs);
+    info.flags = captured->flags;
+    engine->flight_.recordOutput(frame, info);
+    engine->publishShared(frame);
+    engine->sinkUsers_.fetch_sub(1, std::memory_order_release);
+    ring.commitRead();
+    frames++;
+  }
+  return frames > 0;
+}
+
+/* ───────────────────── Shared-Memory Output ───────────────────── */
 
+std::string AudioEngine::attachSharedOutput(void* memory, size_t bytes) {
+  auto ring = std::make_unique<SharedRingWriter>();
+  std::string err = ring->bind(memory, bytes);
+  if (!err.empty()) return err;
+
+  detachSharedOutput();
+  sharedRing_ = std::move(ring);
+  sharedOutput_.store(sharedRing_.get(), std::memory_order_seq_cst);
+  return "";
+}
+
+void AudioEngine::detachSharedOutput() {
+  if (!sharedRing_) return;
+  sharedOutput_.store(nullptr, std::memory_order_seq_cst);
+  waitForSinks();
+  sharedRing_.reset();
+}
+
+void AudioEngine::publishShared(const float* frame) {
+  /* Called inside the worker's sinkUsers_ window. */
+  SharedRingWriter* ring = sharedOutput_.load(std::memory_order_seq_cst);
+  if (ring) ring->write(frame, kRNNoiseFrameSize);
+}
+
+void AudioEngine::waitForSinks() {
+  /*
+   * The worker bumps sinkUsers_ before loading any sink pointer and the
+   * caller cleared the pointer before this load (all seq_cst), so once the
+   * count reads zero no pass can still hold the old sink. The wait is at
+   * most one frame of processing.
+   */
+  while (sinkUsers_.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+}
+
+/* ───────────────────── QA Recording Taps ───────────────────── */
+
+std::string AudioEngine::startRecording(const TapConfig& config) {
+  /* Finish the previous recording first: it may use the same paths. */
+  stopRecording();
+  auto recorder = std::make_unique<TapRecorder>();
+  std::string err = recorder->start(config, outputFrames_.get());
+  if (!err.empty()) return err;
+
+  recorder_ = std::move(recorder);
+  rnnoise_->setTap(recorder_.get());
+  taps_.store(recorder_.get(), std::memory_order_seq_cst);
+  return "";
+}
+
+void AudioEngine::stopRecording() {
+  if (!recorder_) return;
+  taps_.store(nullptr, std::memory_order_seq_cst);
+  rnnoise_->setTap(nullptr);
+  waitForSinks();
+  recorder_->stop();  /* Kept for recordingStats(). */
+}
+
+TapStats AudioEngine::recordingStats(TapPoint point) const {
+  return recorder_ ? recorder_->stats(point) : TapStats{};
+}
+
+/* ───────────────────── Supervisor Thread ───────────────────── */
+
+void AudioEngine::supervisorLoop() {
+  /*
+   * Owns the PortAudio streams while the engine is running. Callbacks
+   * report device trouble by posting kRestart; a burst of xruns produces
+   * many commands, which are coalesced into a single recovery pass.
+   */
+  Tracer::nameThread("supervisor");
+  xrunsSeen_ = engineMetrics_.xruns.load(std::memory_order_relaxed);
+  xrunWindowBase_ = xrunsSeen_;
+  xrunWindowStart_ = {};
   while (running_.load(std::memory_order_acquire)) {
-    /* Check if we have a full RNNoise frame available. */
-    if (captureRing_->available_read() >= kRNNoiseFrameSize) {
-      captureRing_->read(frame, kRNNoiseFrameSize);
+    bool restartRequested = false;
+    SupervisorCommand cmd;
+    while (commandQueue_.pop(cmd)) {
+      if (cmd == SupervisorCommand::kShutdown) return;
+      if (cmd == SupervisorCommand::kRestart) restartRequested = true;
+    }
 
-      /* Run noise suppression. */
-      rnnoise_.processFrame(frame);
+    if (!restartRequested) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(kSupervisorPollMs));
+      continue;
+    }
 
-      /* If output is disabled, discard processed audio (no monitoring). */
-      if (outputStream_) {
-        outputRing_->write(frame, kRNNoiseFrameSize);
-      }
-    } else {
-      /*
-       * Not enough data yet. Sleep briefly to avoid spinning at 100% CPU.
-       * 1ms sleep is fine: at 48kHz, a 480-sample frame arrives every 10ms,
-       * so we'll check ~10 times per frame period. The ring buffer smooths
-       * any scheduling jitter.
-       */
-      std::this_thread::sleep_for(std::chrono::microseconds(500));
+    auto t0 = std::chrono::steady_clock::now();
+    const bool burst = xrunBurst(t0);
+    bool ok;
+    {
+      TraceSpan traceSpan("device_restart");
+      ok = attemptRestart();
     }
+    traceInstant(ok ? "restart_ok" : "restart_failed");
+    double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    if (ok) {
+      engineMetrics_.restarts.fetch_add(1, std::memory_order_relaxed);
+      engineMetrics_.lastRecoveryMs.store(ms, std::memory_order_relaxed);
+      engineMetrics_.totalRecoveryMs.store(
+          engineMetrics_.totalRecoveryMs.load(std::memory_order_relaxed) + ms,
+          std::memory_order_relaxed);
+    } else if (running_.load(std::memory_order_acquire)) {
+      engineMetrics_.failedRestarts.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (burst) autoDumpFlight();
 
-    /* Handle device disconnect / restart. */
-    if (shouldRestart_.load(std::memory_order_relaxed)) {
-      shouldRestart_.store(false, std::memory_order_relaxed);
-      attemptRestart();
+    /* Flags raised by the streams we just tore down are stale. */
+    while (commandQueue_.pop(cmd)) {
+      if (cmd == SupervisorCommand::kShutdown) return;
     }
   }
 }
 
+bool AudioEngine::supervisorSleep(int ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(ms);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (!running_.load(std::memory_order_acquire)) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(kSupervisorPollMs));
+  }
+  return running_.load(std::memory_order_acquire);
+}
+
+/* ───────────────────── Frame Capture ───────────────────── */
+
+std::string AudioEngine::startCapture(const std::string& path) {
+  if (running_.load(std::memory_order_acquire)) {
+    return "Stop the engine before starting a capture";
+  }
+  stopCapture();
+  auto capture = std::make_unique<FrameCaptureWriter>();
+  std::string err = capture->start(path);
+  if (!err.empty()) return err;
+  capture_ = std::move(capture);
+  captureActive_ = true;
+  return "";
+}
+
+void AudioEngine::stopCapture() {
+  if (!captureActive_) return;
+  rnnoise_->setCapture(nullptr);
+  waitForSinks();
+  capture_->stop();  /* Kept for capturedFrames() / captureTruncated(). */
+  captureActive_ = false;
+}
+
+/* ───────────────────── Flight Recorder ───────────────────── */
+
+std::string AudioEngine::dumpFlightRecorder(const std::string& basePath) const {
+  return flight_.dump(basePath);
+}
+
+void AudioEngine::setFlightDumpDir(const std::string& dir) {
+  std::lock_guard<std::mutex> lock(flightDirMutex_);
+  flightDumpDir_ = dir;
+}
+
+bool AudioEngine::xrunBurst(std::chrono::steady_clock::time_point now) {
+  /*
+   * The window opens at the first xrun after a quiet spell; xruns counted
+   * since then, including the ones that triggered this recovery, decide.
+   */
+  const uint64_t xruns = engineMetrics_.xruns.load(std::memory_order_relaxed);
+  if (xrunWindowStart_ == std::chrono::steady_clock::time_point{} ||
+      now - xrunWindowStart_ > kXrunBurstWindow) {
+    xrunWindowStart_ = now;
+    xrunWindowBase_ = xrunsSeen_;
+  }
+  xrunsSeen_ = xruns;
+  return xruns - xrunWindowBase_ >= kXrunBurstCount;
+}
+
+void AudioEngine::autoDumpFlight() {
+  /*
+   * Runs after the recovery, not before: the window still holds the
+   * seconds leading up to the xruns, and recovery is not delayed by I/O.
+   */
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(flightDirMutex_);
+    dir = flightDumpDir_;
+  }
+  if (dir.empty()) return;
+
+  auto now = std::chrono::steady_clock::now();
+  if (lastAutoDump_ != std::chrono::steady_clock::time_point{} &&
+      now - lastAutoDump_ < kAutoDumpCooldown) {
+    return;
+  }
+  lastAutoDump_ = now;
+
+  char stamp[32];
+  std::time_t t = std::time(nullptr);
+  std::tm local{};
+#ifdef _WIN32
+  localtime_s(&local, &t);
+#else
+  localtime_r(&t, &local);
+#endif
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+  std::string err = flight_.dump(dir + "/flight-" + stamp);
+  if (statusCallback_) {
+    statusCallback_(err.empty() ? std::string("Flight recorder saved to ") + dir
+                                : "Flight recorder dump failed: " + err);
+  }
+}
+
 /* ───────────────────── Auto-Restart ───────────────────── */
 
-void AudioEngine::attemptRestart() {
+bool AudioEngine::attemptRestart() {
   if (statusCallback_) {
     statusCallback_("Device issue detected, attempting restart...");
   }
 
   for (int attempt = 0; attempt < kMaxRestartAttempts; attempt++) {
-    /* Exponential backoff: 100ms, 200ms, 400ms, 800ms, 1600ms */
-    std::this_thread::sleep_for(
-        std::chrono::milliseconds(100 * (1 << attempt)));
+    /* Exponential backoff: 100ms, 200ms, 400ms, 800ms, 1600ms.
+     * Interruptible so stop() never waits out the full schedule. */
+    if (!supervisorSleep(100 * (1 << attempt))) return false;
 
-    if (!running_.load(std::memory_order_acquire)) return;
+    /* Processing thread keeps draining captureRing_ meanwhile; it just
+     * sees no new input until the capture stream is back. */
 
     /* Stop current streams. */
     if (captureStream_) Pa_StopStream(captureStream_);
     if (outputStream_) Pa_StopStream(outputStream_);
     closeStreams();
 
+    /* No callback runs now. A half-filled frame would span the outage:
+     * refill it from the new stream, and flag the discontinuity. Playback
+     * resumes with current audio, not what piled up meanwhile. */
+    captureFilled_ = 0;
+    capturePendingFlags_ |= kFrameGap;
+    outputReader_ = outputFrames_->reader(OverrunPolicy::kSkipAhead, kOutputLagFrames);
+    playPos_ = kRNNoiseFrameSize;
+
     /* Try to reopen. */
     std::string err = openStreams();
     if (!err.empty()) continue;
@@ -456,22 +882,24 @@ void AudioEngine::attemptRestart() {
     if (statusCallback_) {
       statusCallback_("Audio engine restarted successfully");
     }
-    return;
+    return true;
   }
 
   if (statusCallback_) {
     statusCallback_("Failed to restart audio engine after multiple attempts");
   }
+  return false;
 }
 
 /* ───────────────────── Level Control ───────────────────── */
 
 void AudioEngine::setSuppressionLevel(float level) {
-  rnnoise_.setSuppressionLevel(level);
+  traceInstant("set_suppression_level", level);
+  rnnoise_->setSuppressionLevel(level);
 }
 
 float AudioEngine::getSuppressionLevel() const {
-  return rnnoise_.getSuppressionLevel();
+  return rnnoise_->getSuppressionLevel();
 }
 
 void AudioEngine::setStatusCallback(StatusCallback cb) {
@@ -479,11 +907,21 @@ void AudioEngine::setStatusCallback(StatusCallback cb) {
 }
 
 void AudioEngine::setVadThreshold(float threshold) {
-  rnnoise_.setVadThreshold(threshold);
+  traceInstant("set_vad_threshold", threshold);
+  rnnoise_->setVadThreshold(threshold);
 }
 
 float AudioEngine::getVadThreshold() const {
-  return rnnoise_.getVadThreshold();
+  return rnnoise_->getVadThreshold();
+}
+
+bool AudioEngine::setPostChain(const std::vector<PostStage>& stages) {
+  traceInstant("set_post_chain", static_cast<float>(stages.size()));
+  return rnnoise_->setPostChain(stages);
+}
+
+std::vector<PostStage> AudioEngine::postChain() const {
+  return rnnoise_->postChain();
 }
 
 }  // namespace noiseguard
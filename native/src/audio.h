@@ -2,13 +2,28 @@
  * AudioEngine -- PortAudio-based real-time capture/playback with RNNoise processing.
  *
  * Architecture:
- *   [Mic] -> CaptureCallback -> captureRing_ -> ProcessingThread -> outputRing_ -> OutputCallback -> [Speaker/VB-Cable]
+ *   [Mic] -> CaptureCallback -> captureRing_ -> ProcessingPool worker -> outputFrames_ -> OutputCallback -> [Speaker/VB-Cable]
+ *                                                                    |                \-> kFinal tap, outputFrames() readers
+ *                                                                    \-> shared ring (optional) -> in-process JS
+ *   Both rings hold whole AudioFrames (frame_ring.h) stamped at capture, so
+ *   the output callback measures capture -> playout latency. outputFrames_
+ *   is a broadcast ring: each processed frame is written once and every
+ *   consumer follows it with its own cursor; none can stall the worker.
+ *   Optional QA taps (pre-RNNoise, post-RNNoise, final) -> TapRecorder writer thread -> files
+ *   Always: last 30 s of input/output + per-frame metrics -> FlightRecorder
+ *
+ *   Callbacks / ProcessingThread --(commandQueue_)--> SupervisorThread
+ *     (owns PortAudio stream lifecycle: stop, close, reopen, restart)
  *
  * REAL-TIME RULES ENFORCED:
  * - Capture/Output callbacks: NO allocations, NO locks, NO syscalls.
- *   They only read/write the lock-free ring buffers.
- * - Processing thread: Allowed to call RNNoise (which is allocation-free per frame).
- *   Spins on captureRing_ with a short sleep to avoid burning CPU.
+ *   They only read/write the lock-free ring buffers and post commands.
+ * - Processing (a ProcessingPool worker shared with other engines): Allowed to
+ *   call RNNoise (which is allocation-free per frame). Polls captureRing_,
+ *   sleeping briefly when no engine has a full frame.
+ *   Never blocks on device recovery -- that is the supervisor's job.
+ * - Supervisor thread: NOT real-time. The only thread that touches the
+ *   PortAudio streams while the engine is running.
  *
  * WASAPI NOTES (Windows):
  * - We attempt exclusive mode for lowest latency. Falls back to shared if unavailable.
@@ -19,14 +34,26 @@
 #define NOISEGUARD_AUDIO_H
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "audio_tap.h"
+#include "command_queue.h"
+#include "flight_recorder.h"
+#include "frame_capture.h"
+#include "frame_ring.h"
+#include "host_session.h"
+#include "processing_pool.h"
 #include "ringbuffer.h"
 #include "rnnoise_wrapper.h"
+#include "session_arena.h"
+#include "shared_ring.h"
 
 /* Forward-declare PortAudio types to avoid including portaudio.h in this header. */
 typedef void PaStream;
@@ -35,27 +62,57 @@ typedef unsigned long PaStreamCallbackFlags;
 
 namespace noiseguard {
 
-/** Audio device info exposed to JavaScript. */
-struct DeviceInfo {
-  int index;
-  std::string name;
-  int maxInputChannels;
-  int maxOutputChannels;
-  double defaultSampleRate;
+/**
+ * Capture sample format requested from PortAudio.
+ * Integer formats are converted straight into RNNoise's int16-range domain
+ * in the capture callback; the chain stays in that domain and is converted
+ * to normalized float once, on the way to the output frames.
+ */
+enum class CaptureFormat : uint8_t {
+  kFloat32,  /* paFloat32, normalized [-1, 1] (default) */
+  kInt16,    /* paInt16 */
+  kInt24,    /* paInt24, packed 3 bytes per sample */
 };
 
 /** Configuration for the audio engine. */
 struct AudioConfig {
   int inputDeviceIndex = -1;   /* -1 = default input */
   int outputDeviceIndex = -1;  /* -1 = default output, -2 = disable output (mute) */
+  /* Stable DeviceInfo::id; when set, start() resolves it and ignores the index. */
+  std::string inputDeviceId;
+  std::string outputDeviceId;
   double sampleRate = 48000.0;
   unsigned long framesPerBuffer = 480;  /* 10ms @ 48kHz = RNNoise frame size */
+  unsigned long outputFramesPerBuffer = 0;  /* 0 = same as framesPerBuffer */
+  double inputLatency = 0.0;   /* Suggested latency (s); <= 0 = device defaultLow */
+  double outputLatency = 0.0;  /* Suggested latency (s); <= 0 = device defaultLow */
   bool tryExclusiveMode = true;
+  bool useCalibratedLatency = true;  /* Override the above from LatencyTuner's cache */
+  CaptureFormat captureFormat = CaptureFormat::kFloat32;
+};
+
+/**
+ * Engine-level metrics (device recovery, latency), updated by the supervisor
+ * thread (xruns by the callbacks, latencies by the processing worker and
+ * the output callback). Read lock-free from any thread.
+ *
+ * Latencies run from the capture of a frame's first sample, so they include
+ * the 10 ms of filling the frame.
+ */
+struct EngineMetrics {
+  std::atomic<uint64_t> xruns{0};             /* Under/overflows reported by PortAudio */
+  std::atomic<uint64_t> restarts{0};          /* Successful recoveries */
+  std::atomic<uint64_t> failedRestarts{0};    /* Recoveries that gave up */
+  std::atomic<double> lastRecoveryMs{0.0};    /* Detection -> streams running */
+  std::atomic<double> totalRecoveryMs{0.0};   /* Sum over all recoveries */
+  std::atomic<double> processLatencyMs{0.0};  /* Last frame: capture -> processed */
+  std::atomic<double> outputLatencyMs{0.0};   /* Last frame: capture -> output DAC */
+  std::atomic<double> maxOutputLatencyMs{0.0};
 };
 
 /**
  * Callback for engine status changes (e.g., device disconnected, restarted).
- * Called from the processing thread -- keep it lightweight.
+ * Called from the supervisor thread -- keep it lightweight.
  */
 using StatusCallback = std::function<void(const std::string& status)>;
 
@@ -67,17 +124,24 @@ class AudioEngine {
   AudioEngine(const AudioEngine&) = delete;
   AudioEngine& operator=(const AudioEngine&) = delete;
 
-  /** Enumerate all available audio devices. Safe to call anytime. */
+  /**
+   * Enumerate all available audio devices. Safe to call anytime.
+   * Served from the HostSession cache when a session is held (near-instant).
+   */
   static std::vector<DeviceInfo> enumerateDevices();
 
   /**
    * Start the audio engine with given configuration.
-   * Opens PortAudio streams and launches the processing thread.
+   * Takes a HostSession reference, opens PortAudio streams, attaches to the
+   * ProcessingPool and launches the supervisor thread.
    * Returns empty string on success, or an error message.
    */
   std::string start(const AudioConfig& config);
 
-  /** Stop the audio engine. Blocks until processing thread exits. */
+  /**
+   * Stop the audio engine. Blocks until the supervisor thread has exited and
+   * the pool no longer runs this engine.
+   */
   void stop();
 
   /** Check if the engine is currently running. */
@@ -96,13 +160,97 @@ class AudioEngine {
   void setVadThreshold(float threshold);
   float getVadThreshold() const;
 
+  /** Select / reorder post-RNNoise stages. See RNNoiseWrapper::setPostChain(). */
+  bool setPostChain(const std::vector<PostStage>& stages);
+  std::vector<PostStage> postChain() const;
+
+  /**
+   * Also publish processed frames into a shared-memory SPSC ring (see
+   * shared_ring.h), e.g. a SharedArrayBuffer read by an AudioWorklet.
+   * Replaces any previous ring. The memory must stay valid until
+   * detachSharedOutput() returns. Works with or without an output device.
+   * Returns empty string on success, or an error message.
+   */
+  std::string attachSharedOutput(void* memory, size_t bytes);
+
+  /** Stop publishing; blocks until the processing worker has let go of it. */
+  void detachSharedOutput();
+
+  /**
+   * Record the chain's tap points to files (see audio_tap.h) until
+   * stopRecording(). Replaces a recording in progress. Independent of
+   * start()/stop(): frames are recorded while the engine runs.
+   * Returns empty string on success, or an error message.
+   */
+  std::string startRecording(const TapConfig& config);
+
+  /** Unhook the taps, then flush, fsync and close the files. Blocks. */
+  void stopRecording();
+
+  /** Progress of the current (or last) recording at one tap point. */
+  TapStats recordingStats(TapPoint point) const;
+
+  /**
+   * Capture every frame of the next run (start() .. stop()) for bit-exact
+   * replay with tools/ng_replay (see frame_capture.h). Only while stopped,
+   * so the capture begins with a freshly initialized chain. stop() finishes
+   * the capture. Returns empty string on success, or an error message.
+   */
+  std::string startCapture(const std::string& path);
+
+  /** Finish the capture early. Blocks until the file is closed. */
+  void stopCapture();
+
+  /** Frames captured by the current (or last) capture; truncated if the writer fell behind. */
+  uint64_t capturedFrames() const { return capture_ ? capture_->framesCaptured() : 0; }
+  bool captureTruncated() const { return capture_ && capture_->truncated(); }
+
+  /**
+   * Write the flight recorder's window (last ~30 s of input, output and
+   * per-frame metrics) to basePath + ".wav" / ".csv". Any thread.
+   * Returns empty string on success, or an error message.
+   */
+  std::string dumpFlightRecorder(const std::string& basePath) const;
+
+  /**
+   * Processed frames, for extra consumers (meters, visualizers): take a
+   * reader() on any thread and poll it there. Valid for the engine's life;
+   * frames flow while it runs.
+   */
+  const FrameBroadcast& outputFrames() const { return *outputFrames_; }
+
+  /**
+   * Directory for automatic flight-recorder dumps after an xrun burst
+   * (at most one per kAutoDumpCooldown); empty disables them.
+   */
+  void setFlightDumpDir(const std::string& dir);
+
   /** Access real-time metrics from the RNNoise wrapper (lock-free). */
-  const AudioMetrics& metrics() const { return rnnoise_.metrics(); }
+  const AudioMetrics& metrics() const { return rnnoise_->metrics(); }
+
+  /** Access device-recovery metrics (lock-free). */
+  const EngineMetrics& engineMetrics() const { return engineMetrics_; }
 
  private:
+  /** Commands posted to the supervisor thread. */
+  enum class SupervisorCommand : uint8_t {
+    kRestart,   /* Device error / xrun reported by a callback. */
+    kShutdown,  /* Engine is stopping; exit the supervisor loop. */
+  };
+
+  /* Capture ring length: 8 frames = 80 ms of jitter headroom. */
+  static constexpr size_t kCaptureFrames = 8;
+  /*
+   * How far playback may fall behind the worker (8 frames = 80 ms) before
+   * it skips ahead to the newest frame.
+   */
+  static constexpr size_t kOutputLagFrames = 8;
+
+  using CaptureRing = FrameRing<kCaptureFrames>;
+
   /**
    * PortAudio capture callback (static C function).
-   * REAL-TIME SAFE: Only writes to captureRing_. No allocations/locks.
+   * REAL-TIME SAFE: Only fills captureRing_ slots. No allocations/locks.
    */
   static int captureCallback(const void* input, void* output,
                              unsigned long frameCount,
@@ -112,7 +260,7 @@ class AudioEngine {
 
   /**
    * PortAudio output callback (static C function).
-   * REAL-TIME SAFE: Only reads from outputRing_. Outputs silence if underrun.
+   * REAL-TIME SAFE: Only reads from outputFrames_. Outputs silence if underrun.
    */
   static int outputCallback(const void* input, void* output,
                             unsigned long frameCount,
@@ -120,11 +268,41 @@ class AudioEngine {
                             PaStreamCallbackFlags statusFlags,
                             void* userData);
 
-  /** Processing thread entry point. Reads capture -> RNNoise -> output ring. */
-  void processingLoop();
+  /**
+   * ProcessingPool task: capture ring -> RNNoise -> outputFrames_ for every
+   * full frame available (bounded per call). Returns true if it processed any.
+   */
+  static bool processPending(void* self);
+
+  /** Copy one processed frame to the shared ring, if attached. Never blocks. */
+  void publishShared(const float* frame);
 
-  /** Attempt to restart audio after a device disconnect. */
-  void attemptRestart();
+  /**
+   * Wait until no processing pass can still see a sink (shared ring, taps)
+   * that was unpublished before the call. Control thread only.
+   */
+  void waitForSinks();
+
+  /**
+   * Account the xruns seen so far at a recovery starting at now; true if
+   * they make a burst (kXrunBurstCount within kXrunBurstWindow). Supervisor only.
+   */
+  bool xrunBurst(std::chrono::steady_clock::time_point now);
+
+  /** After an xrun-burst recovery: dump the flight recorder if configured. Supervisor only. */
+  void autoDumpFlight();
+
+  /** Supervisor thread entry point. Drains commandQueue_, runs recovery. */
+  void supervisorLoop();
+
+  /**
+   * Restart audio after a device disconnect (supervisor thread only).
+   * Returns true once streams are running again.
+   */
+  bool attemptRestart();
+
+  /** Sleep for ms, waking early if the engine stops. Supervisor thread only. */
+  bool supervisorSleep(int ms);
 
   /** Open PortAudio streams with current config_. */
   std::string openStreams();
@@ -134,23 +312,78 @@ class AudioEngine {
 
   /* State */
   std::atomic<bool> running_{false};
-  std::atomic<bool> shouldRestart_{false};
   AudioConfig config_;
   StatusCallback statusCallback_;
+  EngineMetrics engineMetrics_;
 
-  /* PortAudio streams */
+  /*
+   * PortAudio streams. Owned by the caller of start()/stop() while the
+   * engine is stopped, and by the supervisor thread while it is running.
+   */
   PaStream* captureStream_ = nullptr;
   PaStream* outputStream_ = nullptr;
 
-  /* Lock-free ring buffers (allocated once in start(), not in callbacks) */
-  std::unique_ptr<RingBuffer> captureRing_;
-  std::unique_ptr<RingBuffer> outputRing_;
+  /* Control requests from callbacks / processing thread to the supervisor. */
+  CommandQueue<SupervisorCommand, 64> commandQueue_;
 
-  /* RNNoise processor */
-  RNNoiseWrapper rnnoise_;
+  /*
+   * One block, on huge pages where the OS allows, reserved by the
+   * constructor: the RNNoise wrapper (engine lifetime) up to runMark_, then
+   * each run's RNNoise states and lock-free capture ring, carved by start()
+   * (never in callbacks) and rewound by stop().
+   */
+  SessionArena arena_;
+  size_t runMark_ = 0;
+  CaptureRing* captureRing_ = nullptr;
 
-  /* Processing thread */
-  std::thread processingThread_;
+  /*
+   * Processed frames, written once by the worker. Allocated with the engine
+   * and never moved, so readers outlive start()/stop().
+   */
+  std::unique_ptr<FrameBroadcast> outputFrames_;
+
+  /*
+   * Ring cursors private to one side, reset by start() / the supervisor
+   * while no stream runs. Capture callback: the slot being filled.
+   */
+  size_t captureFilled_ = 0;        /* Samples in captureRing_->writeSlot() */
+  uint64_t captureSequence_ = 0;
+  uint32_t capturePendingFlags_ = 0; /* For the next frame started */
+  /* Output callback: its reader and the frame being played. */
+  FrameBroadcast::Reader outputReader_;
+  AudioFrame playing_;
+  size_t playPos_ = kRNNoiseFrameSize;  /* Next sample of playing_ */
+
+  /*
+   * Optional frame sinks. Each is owned by the control thread and seen by
+   * the processing worker through an atomic pointer; the worker announces
+   * each frame's use of them in sinkUsers_ so removal can wait it out.
+   */
+  std::unique_ptr<SharedRingWriter> sharedRing_;
+  std::atomic<SharedRingWriter*> sharedOutput_{nullptr};
+  std::unique_ptr<TapRecorder> recorder_;
+  std::atomic<TapRecorder*> taps_{nullptr};
+  std::atomic<int> sinkUsers_{0};
+
+  /* Frame capture for replay (hooked into rnnoise_ for one run) */
+  std::unique_ptr<FrameCaptureWriter> capture_;
+  bool captureActive_ = false;
+
+  /* Always-on record of the last ~30 s (written by the processing worker) */
+  FlightRecorder flight_;
+  std::mutex flightDirMutex_;
+  std::string flightDumpDir_;
+  std::chrono::steady_clock::time_point lastAutoDump_{};  /* Supervisor only */
+  /* Xrun-burst window for auto-dumps (supervisor only) */
+  std::chrono::steady_clock::time_point xrunWindowStart_{};
+  uint64_t xrunWindowBase_ = 0;  /* xruns before the window opened */
+  uint64_t xrunsSeen_ = 0;       /* xruns at the last recovery */
+
+  /* RNNoise processor (filters, gate, metrics), carved from arena_ */
+  RNNoiseWrapper* rnnoise_ = nullptr;
+
+  /* Supervisor thread (stream lifecycle + recovery) */
+  std::thread supervisorThread_;
 };
 
 }  // namespace noiseguard
@@ -0,0 +1,742 @@
+/**
+ * Streaming audio file reader / writer implementation.
+ */
+
+#include "audio_file.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include <FLAC/stream_decoder.h>
+#include <FLAC/stream_encoder.h>
+#include <ogg/ogg.h>
+#include <opus.h>
+#include <opus_multistream.h>
+
+#include "wav_header.h"
+
+namespace noiseguard {
+
+namespace {
+
+uint16_t le16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+uint32_t le32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void putLe16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(static_cast<uint8_t>(v));
+  out.push_back(static_cast<uint8_t>(v >> 8));
+}
+
+void putLe32(std::vector<uint8_t>& out, uint32_t v) {
+  putLe16(out, static_cast<uint16_t>(v));
+  putLe16(out, static_cast<uint16_t>(v >> 16));
+}
+
+/** Normalized float -> 16-bit PCM, rounded and clipped (WAV and FLAC). */
+int16_t toPcm16(float v) {
+  return static_cast<int16_t>(std::lrint(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+/* Frames converted per fread() in read(). */
+static constexpr size_t kReadChunkFrames = 4096;
+
+/* FLAC encoder effort (0..8): libFLAC's default, close to 8 in size. */
+static constexpr unsigned kFlacCompression = 5;
+
+/* Opus always decodes at 48 kHz; granule positions count 48 kHz samples. */
+static constexpr uint32_t kOpusRate = 48000;
+/* Largest Opus packet duration (120 ms at 48 kHz), the decode buffer size. */
+static constexpr int kOpusMaxFrame = 5760;
+/* Encoder packet duration: 20 ms, Opus's most efficient frame size. */
+static constexpr uint32_t kOpusPacketsPerSecond = 50;
+/* Upper bound for one encoded packet (the recommended max_data_bytes). */
+static constexpr int kOpusMaxPacketBytes = 4000;
+/* Bytes handed to ogg_sync per fread(). */
+static constexpr size_t kOggReadBytes = 8192;
+
+}  // namespace
+
+AudioContainer sniffAudioContainer(const uint8_t* head, size_t size) {
+  if (size >= 12 && std::memcmp(head, "RIFF", 4) == 0 && std::memcmp(head + 8, "WAVE", 4) == 0) {
+    return AudioContainer::kWav;
+  }
+  if (size >= 4 && std::memcmp(head, "fLaC", 4) == 0) return AudioContainer::kFlac;
+  if (size >= 4 && std::memcmp(head, "OggS", 4) == 0) return AudioContainer::kOgg;
+  return AudioContainer::kUnknown;
+}
+
+bool opusSupportsRate(uint32_t sampleRate) {
+  return sampleRate == 8000 || sampleRate == 12000 || sampleRate == 16000 ||
+         sampleRate == 24000 || sampleRate == 48000;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  DECODERS (libFLAC, libogg + libopus)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+struct AudioFileReader::FlacDecoder {
+  FLAC__StreamDecoder* decoder = nullptr;
+  std::vector<float>* out = nullptr;  /* Target of the write callback */
+  uint32_t sampleRate = 0;
+  uint32_t channels = 0;
+  uint32_t bits = 0;
+  uint64_t totalSamples = 0;
+  std::string error;
+
+  ~FlacDecoder() {
+    if (!decoder) return;
+    FLAC__stream_decoder_finish(decoder);  /* Closes the file */
+    FLAC__stream_decoder_delete(decoder);
+  }
+
+  /* Downmix one decoded frame to mono normalized floats. */
+  static FLAC__StreamDecoderWriteStatus onWrite(const FLAC__StreamDecoder*,
+                                                const FLAC__Frame* frame,
+                                                const FLAC__int32* const buffer[],
+                                                void* client) {
+    auto* self = static_cast<FlacDecoder*>(client);
+    const uint32_t channels = frame->header.channels;
+    const uint32_t blocksize = frame->header.blocksize;
+    const float scale = 1.0f / (static_cast<float>(1u << (frame->header.bits_per_sample - 1)) *
+                                static_cast<float>(channels));
+    const size_t base = self->out->size();
+    self->out->resize(base + blocksize);
+    float* dst = self->out->data() + base;
+    for (uint32_t i = 0; i < blocksize; i++) {
+      float sum = 0.0f;
+      for (uint32_t c = 0; c < channels; c++) sum += static_cast<float>(buffer[c][i]);
+      dst[i] = sum * scale;
+    }
+    return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+  }
+
+  static void onMetadata(const FLAC__StreamDecoder*, const FLAC__StreamMetadata* metadata,
+                         void* client) {
+    if (metadata->type != FLAC__METADATA_TYPE_STREAMINFO) return;
+    auto* self = static_cast<FlacDecoder*>(client);
+    const FLAC__StreamMetadata_StreamInfo& info = metadata->data.stream_info;
+    self->sampleRate = info.sample_rate;
+    self->channels = info.channels;
+    self->bits = info.bits_per_sample;
+    self->totalSamples = info.total_samples;
+  }
+
+  static void onError(const FLAC__StreamDecoder*, FLAC__StreamDecoderErrorStatus status,
+                      void* client) {
+    auto* self = static_cast<FlacDecoder*>(client);
+    if (self->error.empty()) {
+      self->error = "FLAC decode error (status " + std::to_string(static_cast<int>(status)) + ")";
+    }
+  }
+
+  /** Decode frames until one yields samples. False at the end or on error. */
+  bool decode(std::vector<float>& dst) {
+    out = &dst;
+    const size_t before = dst.size();
+    while (dst.size() == before && error.empty()) {
+      if (FLAC__stream_decoder_get_state(decoder) == FLAC__STREAM_DECODER_END_OF_STREAM) break;
+      if (!FLAC__stream_decoder_process_single(decoder)) {
+        error = "FLAC decoder failed (state " +
+                std::to_string(static_cast<int>(FLAC__stream_decoder_get_state(decoder))) + ")";
+      }
+    }
+    return dst.size() > before;
+  }
+};
+
+struct AudioFileReader::OggOpusDecoder {
+  FILE* file = nullptr;  /* Borrowed from the reader */
+  ogg_sync_state sync;
+  ogg_stream_state stream;
+  bool streamOpen = false;
+  bool ended = false;
+  OpusMSDecoder* decoder = nullptr;
+  int channels = 0;
+  uint32_t preSkipLeft = 0;   /* 48 kHz samples still to drop */
+  float gain = 1.0f;          /* Header output gain / channels (downmix) */
+  int64_t granule = 0;        /* Samples decoded so far, pre-skip included */
+  std::vector<float> pcm;
+  std::string error;
+
+  OggOpusDecoder() { ogg_sync_init(&sync); }
+
+  ~OggOpusDecoder() {
+    if (decoder) opus_multistream_decoder_destroy(decoder);
+    if (streamOpen) ogg_stream_clear(&stream);
+    ogg_sync_clear(&sync);
+  }
+
+  /**
+   * Next packet of the first logical stream. False at its end, at EOF or on
+   * a read error. Pages of other logical streams are skipped.
+   */
+  bool nextPacket(ogg_packet& packet) {
+    for (;;) {
+      if (streamOpen) {
+        int r = ogg_stream_packetout(&stream, &packet);
+        if (r == 1) return true;
+        if (r < 0) continue;  /* Lost pages: resume at the next packet */
+        if (ended) return false;
+      }
+      ogg_page page;
+      while (ogg_sync_pageout(&sync, &page) != 1) {
+        char* buf = ogg_sync_buffer(&sync, static_cast<long>(kOggReadBytes));
+        size_t got = std::fread(buf, 1, kOggReadBytes, file);
+        if (got == 0) {
+          if (std::ferror(file)) error = "Read error";
+          return false;
+        }
+        ogg_sync_wrote(&sync, static_cast<long>(got));
+      }
+      if (!streamOpen) {
+        ogg_stream_init(&stream, ogg_page_serialno(&page));
+        streamOpen = true;
+      }
+      if (ogg_page_serialno(&page) != stream.serialno) continue;
+      if (ogg_page_eos(&page)) ended = true;
+      ogg_stream_pagein(&stream, &page);
+    }
+  }
+
+  /** Parse OpusHead (RFC 7845 section 5.1) and create the decoder. */
+  std::string parseHead(const ogg_packet& packet) {
+    const uint8_t* p = packet.packet;
+    const size_t size = static_cast<size_t>(packet.bytes);
+    if (size < 19 || std::memcmp(p, "OpusHead", 8) != 0) return "Ogg stream is not Opus";
+    if ((p[8] >> 4) != 0) return "Unsupported Opus header version";
+    channels = p[9];
+    preSkipLeft = le16(p + 10);
+    const int16_t gainQ8 = static_cast<int16_t>(le16(p + 16));
+    gain = std::pow(10.0f, static_cast<float>(gainQ8) / (20.0f * 256.0f)) /
+           static_cast<float>(std::max(channels, 1));
+
+    int streams = 1;
+    int coupled = channels - 1;
+    uint8_t mapping[255] = {0, 1};
+    const uint8_t family = p[18];
+    if (family == 0) {
+      if (channels < 1 || channels > 2) return "Invalid Opus channel count";
+    } else if (family == 1 || family == 255) {
+      if (channels < 1 || size < 21u + channels) return "Truncated Opus header";
+      streams = p[19];
+      coupled = p[20];
+      std::memcpy(mapping, p + 21, channels);
+    } else {
+      return "Unsupported Opus channel mapping family " + std::to_string(family);
+    }
+
+    int err = OPUS_OK;
+    decoder = opus_multistream_decoder_create(static_cast<opus_int32>(kOpusRate), channels,
+                                              streams, coupled, mapping, &err);
+    if (err != OPUS_OK) return std::string("Opus decoder: ") + opus_strerror(err);
+    pcm.resize(static_cast<size_t>(kOpusMaxFrame) * channels);
+    return "";
+  }
+
+  /** Decode packets until one yields samples. False at the end or on error. */
+  bool decode(std::vector<float>& dst) {
+    ogg_packet packet;
+    while (error.empty() && nextPacket(packet)) {
+      int n = opus_multistream_decode_float(decoder, packet.packet,
+                                            static_cast<opus_int32>(packet.bytes),
+                                            pcm.data(), kOpusMaxFrame, 0);
+      if (n < 0) {
+        error = std::string("Opus decode error: ") + opus_strerror(n);
+        break;
+      }
+      /* End trimming: the last packet's granule marks the true end. */
+      int64_t end = granule + n;
+      if (packet.e_o_s && packet.granulepos >= 0 && packet.granulepos < end) {
+        end = std::max<int64_t>(packet.granulepos, granule);
+      }
+      const size_t last = static_cast<size_t>(end - granule);
+      const size_t first = std::min<size_t>(preSkipLeft, last);
+      preSkipLeft -= static_cast<uint32_t>(first);
+      granule += n;
+      if (first < last) {
+        const size_t base = dst.size();
+        dst.resize(base + (last - first));
+        const float* src = pcm.data() + first * channels;
+        for (size_t i = 0; i < last - first; i++, src += channels) {
+          float sum = 0.0f;
+          for (int c = 0; c < channels; c++) sum += src[c];
+          dst[base + i] = sum * gain;
+        }
+      }
+      if (packet.e_o_s) break;
+      if (first < last) return true;
+    }
+    return false;
+  }
+};
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  READER
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+AudioFileReader::AudioFileReader() = default;
+
+AudioFileReader::~AudioFileReader() { close(); }
+
+std::string AudioFileReader::open(const std::string& path) {
+  close();
+  error_.clear();
+  container_ = AudioContainer::kUnknown;
+  sampleRate_ = 0;
+  channels_ = 0;
+  bits_ = 0;
+  float_ = false;
+  frames_ = 0;
+  dataOffset_ = 0;
+  file_ = std::fopen(path.c_str(), "rb");
+  if (!file_) return error_ = "Cannot open " + path;
+
+  uint8_t head[12];
+  size_t got = std::fread(head, 1, sizeof(head), file_);
+  container_ = sniffAudioContainer(head, got);
+  std::string err;
+  switch (container_) {
+    case AudioContainer::kWav:
+      err = openWav(path);
+      break;
+    case AudioContainer::kFlac:
+      err = openFlac(path);
+      break;
+    case AudioContainer::kOgg:
+      err = openOggOpus(path);
+      break;
+    case AudioContainer::kUnknown:
+      err = "Not a WAV, FLAC or Ogg/Opus file: " + path;
+      break;
+  }
+  if (!err.empty()) {
+    close();
+    return error_ = err;
+  }
+  return "";
+}
+
+std::string AudioFileReader::openWav(const std::string& path) {
+  uint16_t format = 0;
+  uint8_t chunk[8];
+  while (std::fread(chunk, 1, 8, file_) == 8) {
+    uint32_t size = le32(chunk + 4);
+    if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      std::vector<uint8_t> fmt(size);
+      if (std::fread(fmt.data(), 1, size, file_) != size) break;
+      format = le16(&fmt[0]);
+      channels_ = le16(&fmt[2]);
+      sampleRate_ = le32(&fmt[4]);
+      bits_ = le16(&fmt[14]);
+      /* WAVE_FORMAT_EXTENSIBLE: the real tag leads the subformat GUID. */
+      if (format == 0xFFFE && size >= 26) format = le16(&fmt[24]);
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      remaining_ = (size == 0 || size == 0xFFFFFFFFu) ? UINT64_MAX : size;
+      dataOffset_ = static_cast<uint64_t>(std::ftell(file_));
+      break;
+    } else if (std::fseek(file_, static_cast<long>(size), SEEK_CUR) != 0) {
+      break;
+    }
+    if (size & 1) std::fseek(file_, 1, SEEK_CUR);  /* Chunks are word-aligned */
+  }
+
+  bool pcm = format == kWavFormatPcm && (bits_ == 16 || bits_ == 24 || bits_ == 32);
+  float_ = format == kWavFormatFloat && bits_ == 32;
+  if (remaining_ == 0 || channels_ == 0 || sampleRate_ == 0 || (!pcm && !float_)) {
+    return "Unsupported WAV encoding (need PCM 16/24/32 or float 32): " + path;
+  }
+  const size_t frameBytes = size_t{channels_} * (bits_ / 8);
+  frames_ = remaining_ == UINT64_MAX ? 0 : remaining_ / frameBytes;
+  raw_.resize(kReadChunkFrames * frameBytes);
+  return "";
+}
+
+std::string AudioFileReader::openFlac(const std::string& path) {
+  flac_ = std::make_unique<FlacDecoder>();
+  flac_->decoder = FLAC__stream_decoder_new();
+  if (!flac_->decoder) return "FLAC decoder allocation failed";
+  std::rewind(file_);
+  FLAC__StreamDecoderInitStatus status = FLAC__stream_decoder_init_FILE(
+      flac_->decoder, file_, &FlacDecoder::onWrite, &FlacDecoder::onMetadata,
+      &FlacDecoder::onError, flac_.get());
+  if (status != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
+    return "Cannot start FLAC decoder: " + path;  /* close() still owns file_ */
+  }
+  file_ = nullptr;  /* The decoder closes it */
+
+  if (!FLAC__stream_decoder_process_until_end_of_metadata(flac_->decoder) ||
+      !flac_->error.empty() || flac_->sampleRate == 0 || flac_->channels == 0) {
+    return "Invalid FLAC file: " + path;
+  }
+  sampleRate_ = flac_->sampleRate;
+  channels_ = static_cast<uint16_t>(flac_->channels);
+  bits_ = static_cast<uint16_t>(flac_->bits);
+  frames_ = flac_->totalSamples;
+  return "";
+}
+
+std::string AudioFileReader::openOggOpus(const std::string& path) {
+  opus_ = std::make_unique<OggOpusDecoder>();
+  opus_->file = file_;
+  std::rewind(file_);
+
+  ogg_packet packet;
+  if (!opus_->nextPacket(packet)) return "Truncated Ogg file: " + path;
+  std::string err = opus_->parseHead(packet);
+  if (!err.empty()) return err + ": " + path;
+  if (!opus_->nextPacket(packet) || packet.bytes < 8 ||
+      std::memcmp(packet.packet, "OpusTags", 8) != 0) {
+    return "Missing OpusTags header: " + path;
+  }
+  sampleRate_ = kOpusRate;
+  channels_ = static_cast<uint16_t>(opus_->channels);
+  bits_ = 0;
+  float_ = true;
+  return "";
+}
+
+void AudioFileReader::close() {
+  flac_.reset();
+  opus_.reset();
+  if (file_) std::fclose(file_);
+  file_ = nullptr;
+  remaining_ = 0;
+  decoded_.clear();
+  decodedPos_ = 0;
+}
+
+bool AudioFileReader::decodeMore() {
+  decoded_.clear();
+  decodedPos_ = 0;
+  bool more = false;
+  if (flac_) {
+    more = flac_->decode(decoded_);
+    if (!flac_->error.empty()) error_ = flac_->error;
+  } else if (opus_) {
+    more = opus_->decode(decoded_);
+    if (!opus_->error.empty()) error_ = opus_->error;
+  }
+  return more || !decoded_.empty();
+}
+
+size_t AudioFileReader::read(float* mono, size_t count) {
+  if (container_ == AudioContainer::kWav) return readWav(mono, count);
+
+  size_t done = 0;
+  while (done < count) {
+    if (decodedPos_ == decoded_.size() && !decodeMore()) break;
+    size_t n = std::min(count - done, decoded_.size() - decodedPos_);
+    std::memcpy(mono + done, decoded_.data() + decodedPos_, n * sizeof(float));
+    decodedPos_ += n;
+    done += n;
+  }
+  return done;
+}
+
+size_t AudioFileReader::readWav(float* mono, size_t count) {
+  if (!file_) return 0;
+  const size_t bytes = bits_ / 8;
+  const size_t frameBytes = bytes * channels_;
+  const float downmix = 1.0f / static_cast<float>(channels_);
+
+  size_t done = 0;
+  while (done < count && remaining_ >= frameBytes) {
+    size_t want = std::min(count - done, kReadChunkFrames);
+    want = static_cast<size_t>(std::min<uint64_t>(want, remaining_ / frameBytes));
+    size_t got = std::fread(raw_.data(), frameBytes, want, file_);
+    if (remaining_ != UINT64_MAX) remaining_ -= got * frameBytes;
+    if (got < want) {
+      if (std::ferror(file_)) error_ = "Read error";
+      remaining_ = 0;  /* Truncated file: stop at its last whole frame. */
+    }
+
+    const uint8_t* p = raw_.data();
+    for (size_t i = 0; i < got; i++) {
+      float sum = 0.0f;
+      for (uint16_t c = 0; c < channels_; c++, p += bytes) {
+        if (float_) {
+          float v;
+          std::memcpy(&v, p, sizeof(v));
+          sum += v;
+        } else if (bytes == 2) {
+          sum += static_cast<float>(static_cast<int16_t>(le16(p))) / 32768.0f;
+        } else if (bytes == 3) {
+          /* Assemble into the top 24 bits so the shift sign-extends. */
+          int32_t v = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                           (static_cast<uint32_t>(p[1]) << 16) |
+                                           (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+          sum += static_cast<float>(v) / 8388608.0f;
+        } else {
+          sum += static_cast<float>(static_cast<int32_t>(le32(p)) / 2147483648.0);
+        }
+      }
+      mono[done + i] = sum * downmix;
+    }
+    done += got;
+  }
+  return done;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  ENCODERS (libFLAC, libogg + libopus)
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+struct AudioFileWriter::FlacEncoder {
+  FLAC__StreamEncoder* encoder = nullptr;
+  std::vector<FLAC__int32> pcm;
+
+  ~FlacEncoder() {
+    if (!encoder) return;
+    FLAC__stream_encoder_finish(encoder);  /* Closes the file */
+    FLAC__stream_encoder_delete(encoder);
+  }
+};
+
+struct AudioFileWriter::OggOpusEncoder {
+  OpusEncoder* encoder = nullptr;
+  ogg_stream_state stream;
+  bool streamOpen = false;
+  uint32_t frameSize = 0;     /* Samples per packet at the file's rate */
+  uint32_t granuleScale = 1;  /* 48 kHz samples per input sample */
+  uint32_t lookahead = 0;     /* Encoder delay, input samples */
+  std::vector<float> frame;   /* The packet being filled */
+  size_t filled = 0;
+  uint64_t encoded = 0;       /* Input samples fed to the encoder, padding included */
+  int64_t packetNo = 0;
+  std::vector<uint8_t> packet;
+
+  ~OggOpusEncoder() {
+    if (encoder) opus_encoder_destroy(encoder);
+    if (streamOpen) ogg_stream_clear(&stream);
+  }
+
+  /** Write finished pages to f; all of them (page boundary) when flush. */
+  bool writePages(FILE* f, bool flush) {
+    ogg_page page;
+    bool ok = true;
+    while (flush ? ogg_stream_flush(&stream, &page) : ogg_stream_pageout(&stream, &page)) {
+      ok &= std::fwrite(page.header, 1, static_cast<size_t>(page.header_len), f) ==
+                static_cast<size_t>(page.header_len) &&
+            std::fwrite(page.body, 1, static_cast<size_t>(page.body_len), f) ==
+                static_cast<size_t>(page.body_len);
+    }
+    return ok;
+  }
+
+  /** Queue one packet; granule -1 = the running position. */
+  void queue(uint8_t* data, long bytes, bool bos, bool eos, int64_t granule) {
+    ogg_packet op;
+    op.packet = data;
+    op.bytes = bytes;
+    op.b_o_s = bos ? 1 : 0;
+    op.e_o_s = eos ? 1 : 0;
+    op.granulepos = granule;
+    op.packetno = packetNo++;
+    ogg_stream_packetin(&stream, &op);
+  }
+
+  /**
+   * Encode frame (filled up with zeros) as the next packet and write the
+   * pages it completes. False on failure; err is set if Opus failed.
+   */
+  bool encode(FILE* f, bool last, int64_t endGranule, std::string& err) {
+    std::fill(frame.begin() + static_cast<std::ptrdiff_t>(filled), frame.end(), 0.0f);
+    packet.resize(kOpusMaxPacketBytes);
+    opus_int32 bytes = opus_encode_float(encoder, frame.data(), static_cast<int>(frameSize),
+                                         packet.data(), kOpusMaxPacketBytes);
+    if (bytes < 0) {
+      err = std::string("Opus encode error: ") + opus_strerror(bytes);
+      return false;
+    }
+    encoded += frameSize;
+    filled = 0;
+    queue(packet.data(), bytes, false, last,
+          last ? endGranule : static_cast<int64_t>(encoded * granuleScale));
+    return writePages(f, last);
+  }
+};
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  WRITER
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+AudioFileWriter::AudioFileWriter() = default;
+
+AudioFileWriter::~AudioFileWriter() { close(); }
+
+std::string AudioFileWriter::open(const std::string& path, AudioFileEncoding encoding,
+                                  uint32_t sampleRate) {
+  close();
+  if (encoding == AudioFileEncoding::kOpus && !opusSupportsRate(sampleRate)) {
+    return "Opus needs 8, 12, 16, 24 or 48 kHz (got " + std::to_string(sampleRate) + " Hz)";
+  }
+  /* libFLAC seeks back to write STREAMINFO and reads while doing so. */
+  file_ = std::fopen(path.c_str(), encoding == AudioFileEncoding::kFlac ? "w+b" : "wb");
+  if (!file_) return "Cannot open " + path;
+  path_ = path;
+  encoding_ = encoding;
+  sampleRate_ = sampleRate;
+  samples_ = 0;
+  failed_ = false;
+
+  if (encoding == AudioFileEncoding::kFlac) {
+    flac_ = std::make_unique<FlacEncoder>();
+    FLAC__StreamEncoder* enc = FLAC__stream_encoder_new();
+    flac_->encoder = enc;
+    bool ok = enc && FLAC__stream_encoder_set_channels(enc, 1) &&
+              FLAC__stream_encoder_set_bits_per_sample(enc, 16) &&
+              FLAC__stream_encoder_set_sample_rate(enc, sampleRate) &&
+              FLAC__stream_encoder_set_compression_level(enc, kFlacCompression) &&
+              FLAC__stream_encoder_init_FILE(enc, file_, nullptr, nullptr) ==
+                  FLAC__STREAM_ENCODER_INIT_STATUS_OK;
+    if (!ok) {
+      flac_.reset();
+      std::fclose(file_);
+      file_ = nullptr;
+      return "Cannot start FLAC encoder: " + path;
+    }
+    file_ = nullptr;  /* The encoder closes it */
+    return "";
+  }
+  if (encoding == AudioFileEncoding::kOpus) {
+    std::string err = openOggOpus();
+    if (!err.empty()) {
+      opus_.reset();
+      std::fclose(file_);
+      file_ = nullptr;
+    }
+    return err;
+  }
+
+  /* Placeholder; close() writes the real sizes. */
+  uint8_t header[kWavHeaderBytes];
+  std::memset(header, 0, sizeof(header));
+  failed_ = std::fwrite(header, 1, sizeof(header), file_) != sizeof(header);
+  return failed_ ? "Failed writing " + path : "";
+}
+
+std::string AudioFileWriter::openOggOpus() {
+  opus_ = std::make_unique<OggOpusEncoder>();
+  OggOpusEncoder& o = *opus_;
+  int err = OPUS_OK;
+  o.encoder = opus_encoder_create(static_cast<opus_int32>(sampleRate_), 1,
+                                  OPUS_APPLICATION_AUDIO, &err);
+  if (err != OPUS_OK) return std::string("Opus encoder: ") + opus_strerror(err);
+  opus_int32 lookahead = 0;
+  opus_encoder_ctl(o.encoder, OPUS_SET_BITRATE(kOpusBitrate));
+  opus_encoder_ctl(o.encoder, OPUS_GET_LOOKAHEAD(&lookahead));
+  o.lookahead = static_cast<uint32_t>(lookahead);
+  o.frameSize = sampleRate_ / kOpusPacketsPerSecond;
+  o.granuleScale = kOpusRate / sampleRate_;
+  o.frame.resize(o.frameSize);
+
+  /* Serial numbers only need to differ between chained streams: any will do. */
+  ogg_stream_init(&o.stream, static_cast<int>(std::hash<std::string>{}(path_) & 0x7fffffff));
+  o.streamOpen = true;
+
+  /* OpusHead (RFC 7845 section 5.1): mono, mapping family 0. */
+  std::vector<uint8_t> head(reinterpret_cast<const uint8_t*>("OpusHead"),
+                            reinterpret_cast<const uint8_t*>("OpusHead") + 8);
+  head.push_back(1);  /* Version */
+  head.push_back(1);  /* Channels */
+  putLe16(head, static_cast<uint16_t>(o.lookahead * o.granuleScale));  /* Pre-skip */
+  putLe32(head, sampleRate_);  /* Original rate (informational) */
+  putLe16(head, 0);   /* Output gain */
+  head.push_back(0);  /* Mapping family */
+  o.queue(head.data(), static_cast<long>(head.size()), true, false, 0);
+
+  /* OpusTags (section 5.2): vendor string, no comments. */
+  const char* vendor = opus_get_version_string();
+  std::vector<uint8_t> tags(reinterpret_cast<const uint8_t*>("OpusTags"),
+                            reinterpret_cast<const uint8_t*>("OpusTags") + 8);
+  putLe32(tags, static_cast<uint32_t>(std::strlen(vendor)));
+  tags.insert(tags.end(), vendor, vendor + std::strlen(vendor));
+  putLe32(tags, 0);
+  o.queue(tags.data(), static_cast<long>(tags.size()), false, false, 0);
+
+  /* Each header ends its page, as the spec requires. */
+  failed_ = !o.writePages(file_, true);
+  return failed_ ? "Failed writing " + path_ : "";
+}
+
+std::string AudioFileWriter::write(const float* mono, size_t count) {
+  if (!file_ && !flac_) return "Not open";
+  if (encoding_ == AudioFileEncoding::kFloat32) {
+    failed_ |= std::fwrite(mono, sizeof(float), count, file_) != count;
+  } else if (encoding_ == AudioFileEncoding::kPcm16) {
+    pcm_.resize(count);
+    for (size_t i = 0; i < count; i++) pcm_[i] = toPcm16(mono[i]);
+    failed_ |= std::fwrite(pcm_.data(), sizeof(int16_t), count, file_) != count;
+  } else if (encoding_ == AudioFileEncoding::kFlac) {
+    flac_->pcm.resize(count);
+    for (size_t i = 0; i < count; i++) flac_->pcm[i] = toPcm16(mono[i]);
+    failed_ |= !FLAC__stream_encoder_process_interleaved(flac_->encoder, flac_->pcm.data(),
+                                                        static_cast<uint32_t>(count));
+  } else {
+    OggOpusEncoder& o = *opus_;
+    std::string err;
+    for (size_t i = 0; i < count && !failed_;) {
+      size_t n = std::min<size_t>(count - i, o.frameSize - o.filled);
+      std::memcpy(o.frame.data() + o.filled, mono + i, n * sizeof(float));
+      o.filled += n;
+      i += n;
+      if (o.filled == o.frameSize) failed_ |= !o.encode(file_, false, 0, err);
+    }
+    if (!err.empty()) return err;
+  }
+  samples_ += count;
+  return failed_ ? "Failed writing " + path_ : "";
+}
+
+std::string AudioFileWriter::closeOggOpus() {
+  OggOpusEncoder& o = *opus_;
+  /*
+   * Feed the encoder's look-ahead worth of silence past the end so the
+   * last real samples come out, then mark the true end in the final
+   * packet's granule (pre-skip + samples) for the decoder to trim to.
+   */
+  const uint64_t needed = samples_ + o.lookahead;
+  const int64_t endGranule = static_cast<int64_t>(needed * o.granuleScale);
+  std::string err;
+  while (!failed_) {
+    const bool last = o.encoded + o.frameSize >= needed;
+    failed_ |= !o.encode(file_, last, endGranule, err);
+    if (last) break;
+  }
+  return err;
+}
+
+std::string AudioFileWriter::close() {
+  std::string err;
+  if (flac_) {
+    failed_ |= !FLAC__stream_encoder_finish(flac_->encoder);
+    FLAC__stream_encoder_delete(flac_->encoder);
+    flac_->encoder = nullptr;
+    flac_.reset();
+    return failed_ ? "Failed writing " + path_ : "";
+  }
+  if (!file_) return "";
+  if (opus_) {
+    err = closeOggOpus();
+    opus_.reset();
+  } else {
+    const bool pcm16 = encoding_ == AudioFileEncoding::kPcm16;
+    uint8_t header[kWavHeaderBytes];
+    fillWavHeader(header, pcm16 ? kWavFormatPcm : kWavFormatFloat, 1, sampleRate_,
+                  pcm16 ? 16 : 32, samples_ * (pcm16 ? 2 : 4));
+    failed_ |= std::fseek(file_, 0, SEEK_SET) != 0 ||
+               std::fwrite(header, 1, sizeof(header), file_) != sizeof(header);
+  }
+  failed_ |= std::fclose(file_) != 0;
+  file_ = nullptr;
+  if (!err.empty()) return err;
+  return failed_ ? "Failed writing " + path_ : "";
+}
+
+}  // namespace noiseguard
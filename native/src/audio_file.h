@@ -0,0 +1,171 @@
+/**
+ * Streaming audio file reader / writer for the offline engine.
+ *
+ * Unlike tools/wav_io.h (whole file in memory), these move a block at a
+ * time, so a multi-hour recording is decoded and encoded in constant
+ * memory:
+ *
+ *   AudioFileReader  any supported file, any rate and channel count,
+ *                    downmixed to mono normalized floats:
+ *                    WAV   PCM 16/24/32-bit or float 32. Unknown chunks are
+ *                          skipped; a data chunk of size 0 or 0xFFFFFFFF
+ *                          (unfinished / streamed file) runs to EOF.
+ *                    FLAC  native FLAC, 4..32-bit (libFLAC).
+ *                    Opus  Ogg/Opus, mapping family 0 or 1 (libogg + libopus),
+ *                          always decoded at 48 kHz; pre-skip, output gain
+ *                          and end trimming applied. Only the first logical
+ *                          stream of a chained / multiplexed file is read.
+ *   AudioFileWriter  mono, in one of:
+ *                    kPcm16 / kFloat32  WAV; the header is patched with the
+ *                          final size on close().
+ *                    kFlac  16-bit FLAC; STREAMINFO (length, MD5) written on
+ *                          close().
+ *                    kOpus  Ogg/Opus at 8/12/16/24/48 kHz, 20 ms packets,
+ *                          kOpusBitrate. close() flushes the encoder's
+ *                          look-ahead and marks the true end, so the file
+ *                          decodes to exactly the samples written.
+ *
+ * The codecs are fetched by native/CMakeLists.txt (tools builds only).
+ *
+ * THREADING: one thread at a time per object. NOT real-time code.
+ */
+
+#ifndef NOISEGUARD_AUDIO_FILE_H
+#define NOISEGUARD_AUDIO_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace noiseguard {
+
+enum class AudioContainer : uint8_t {
+  kUnknown,
+  kWav,
+  kFlac,
+  kOgg,
+};
+
+/** Identify a file from its first bytes (12 are enough). */
+AudioContainer sniffAudioContainer(const uint8_t* head, size_t size);
+
+enum class AudioFileEncoding : uint8_t {
+  kPcm16,    /* WAV */
+  kFloat32,  /* WAV */
+  kFlac,
+  kOpus,     /* Ogg/Opus */
+};
+
+/* Opus encoder bitrate (bits/s): transparent for mono speech. */
+static constexpr int32_t kOpusBitrate = 64000;
+
+/** True if Opus can encode at sampleRate (AudioFileWriter kOpus). */
+bool opusSupportsRate(uint32_t sampleRate);
+
+class AudioFileReader {
+ public:
+  AudioFileReader();
+  ~AudioFileReader();
+
+  AudioFileReader(const AudioFileReader&) = delete;
+  AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+  /** Open and parse the header. Returns empty string on success, or an error. */
+  std::string open(const std::string& path);
+  void close();
+
+  /**
+   * Decode up to count frames into mono. Returns the frames decoded; fewer
+   * than count only at the end of the data (or on error, see error()).
+   */
+  size_t read(float* mono, size_t count);
+
+  AudioContainer container() const { return container_; }
+  uint32_t sampleRate() const { return sampleRate_; }
+  uint16_t channels() const { return channels_; }
+  /** Frames in the file, or 0 if the header does not say (always for Opus). */
+  uint64_t frames() const { return frames_; }
+  /** Bits per stored sample (0 for Opus). */
+  uint16_t bitsPerSample() const { return bits_; }
+  bool isFloat() const { return float_; }
+  /**
+   * Byte offset of the first sample (for positional readers, see
+   * denoise_tasks.h). WAV only: compressed samples have no fixed offset.
+   */
+  uint64_t dataOffset() const { return dataOffset_; }
+  const std::string& error() const { return error_; }
+
+ private:
+  struct FlacDecoder;
+  struct OggOpusDecoder;
+
+  std::string openWav(const std::string& path);
+  std::string openFlac(const std::string& path);
+  std::string openOggOpus(const std::string& path);
+  size_t readWav(float* mono, size_t count);
+  /* Decode the next block into decoded_ (FLAC / Opus). False at the end or on error. */
+  bool decodeMore();
+
+  AudioContainer container_ = AudioContainer::kUnknown;
+  FILE* file_ = nullptr;
+  uint32_t sampleRate_ = 0;
+  uint16_t channels_ = 0;
+  uint16_t bits_ = 0;
+  bool float_ = false;
+  uint64_t frames_ = 0;
+  uint64_t dataOffset_ = 0;
+  uint64_t remaining_ = 0;  /* Data bytes left; UINT64_MAX = until EOF */
+  std::vector<uint8_t> raw_;
+  std::unique_ptr<FlacDecoder> flac_;      /* Owns the file once open */
+  std::unique_ptr<OggOpusDecoder> opus_;
+  std::vector<float> decoded_;             /* Mono, not yet returned by read() */
+  size_t decodedPos_ = 0;
+  std::string error_;
+};
+
+class AudioFileWriter {
+ public:
+  AudioFileWriter();
+  ~AudioFileWriter();
+
+  AudioFileWriter(const AudioFileWriter&) = delete;
+  AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+  /**
+   * Create path as a mono file in encoding (kOpus needs opusSupportsRate()).
+   * Returns empty string on success, or an error.
+   */
+  std::string open(const std::string& path, AudioFileEncoding encoding, uint32_t sampleRate);
+
+  /** Append count normalized samples (PCM 16 and FLAC are rounded and clipped). */
+  std::string write(const float* mono, size_t count);
+
+  /** Finish the stream and close. Returns empty string on success, or an error. */
+  std::string close();
+
+  uint64_t samplesWritten() const { return samples_; }
+
+ private:
+  struct FlacEncoder;
+  struct OggOpusEncoder;
+
+  std::string openOggOpus();
+  std::string closeOggOpus();
+
+  FILE* file_ = nullptr;                   /* WAV and Ogg (FLAC: owned by flac_) */
+  std::string path_;
+  AudioFileEncoding encoding_ = AudioFileEncoding::kFloat32;
+  uint32_t sampleRate_ = 0;
+  uint64_t samples_ = 0;
+  bool failed_ = false;
+  std::vector<int16_t> pcm_;
+  std::unique_ptr<FlacEncoder> flac_;
+  std::unique_ptr<OggOpusEncoder> opus_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_AUDIO_FILE_H
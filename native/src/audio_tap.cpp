@@ -0,0 +1,207 @@
+/**
+ * TapRecorder implementation.
+ */
+
+#include "audio_tap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "io_util.h"
+#include "wav_header.h"
+
+namespace noiseguard {
+
+/*
+ * Per-tap ring capacity in samples. 2^17 @ 48kHz ~= 2.7s: the writer can
+ * stall that long on a slow disk before a tap starts dropping.
+ */
+static constexpr size_t kTapRingSamples = size_t{1} << 17;
+
+/* Samples moved from a ring to stdio per read (64 KiB). */
+static constexpr size_t kBlockSamples = 16384;
+
+/* stdio buffer per file, so the OS sees few, large writes. */
+static constexpr size_t kFileBufferBytes = 256 * 1024;
+
+/* Writer wake-up interval. Rings hold seconds, so this is not latency-critical. */
+static constexpr auto kWriterPoll = std::chrono::milliseconds(20);
+
+/* How often buffered data is pushed to the device with fsync. */
+static constexpr auto kSyncInterval = std::chrono::seconds(1);
+
+/* Frames are copied into the ring through a stack buffer of this size. */
+static constexpr size_t kScaleChunk = 480;
+
+TapRecorder::~TapRecorder() { stop(); }
+
+std::string TapRecorder::start(const TapConfig& config, const FrameBroadcast* finalFrames) {
+  stop();
+  format_ = config.format;
+  sampleRate_ = config.sampleRate;
+
+  for (size_t i = 0; i < kTapPointCount; i++) {
+    Tap& tap = taps_[i];
+    tap.written.store(0, std::memory_order_relaxed);
+    tap.dropped.store(0, std::memory_order_relaxed);
+    tap.dataBytes = 0;
+    tap.ring.reset();
+    tap.broadcast = false;
+    tap.frames = FrameBroadcast::Reader();
+    tap.firstSequence.store(UINT64_MAX, std::memory_order_relaxed);
+    tap.lastSequence.store(0, std::memory_order_relaxed);
+    if (config.paths[i].empty()) continue;
+
+    tap.file = std::fopen(config.paths[i].c_str(), "wb");
+    if (!tap.file) {
+      closeFiles();
+      for (Tap& t : taps_) {
+        t.ring.reset();
+        t.broadcast = false;
+      }
+      return "Cannot open tap file: " + config.paths[i];
+    }
+    std::setvbuf(tap.file, nullptr, _IOFBF, kFileBufferBytes);
+    if (format_ == TapFileFormat::kWav) {
+      uint8_t header[kWavHeaderBytes];
+      fillWavHeader(header, kWavFormatFloat, 1, sampleRate_, 32, 0);
+      std::fwrite(header, 1, sizeof(header), tap.file);
+    }
+    if (finalFrames && i == static_cast<size_t>(TapPoint::kFinal)) {
+      tap.broadcast = true;
+      tap.frames = finalFrames->reader(OverrunPolicy::kDrop);
+    } else {
+      tap.ring = std::make_unique<RingBuffer>(kTapRingSamples);
+    }
+  }
+
+  block_.resize(kBlockSamples);
+  running_.store(true, std::memory_order_release);
+  writer_ = std::thread(&TapRecorder::writerLoop, this);
+  return "";
+}
+
+void TapRecorder::stop() {
+  if (!writer_.joinable()) return;
+  running_.store(false, std::memory_order_release);
+  writer_.join();  /* The writer drains the rings before it exits. */
+  closeFiles();
+}
+
+void TapRecorder::write(TapPoint point, const float* samples, size_t count,
+                        float scale) {
+  Tap& tap = taps_[static_cast<size_t>(point)];
+  if (!tap.ring) return;
+  if (tap.ring->available_write() < count) {
+    tap.dropped.fetch_add(count, std::memory_order_relaxed);
+    return;
+  }
+
+  float scaled[kScaleChunk];
+  for (size_t done = 0; done < count;) {
+    size_t n = std::min(count - done, kScaleChunk);
+    for (size_t i = 0; i < n; i++) scaled[i] = samples[done + i] * scale;
+    tap.ring->write(scaled, n);
+    done += n;
+  }
+}
+
+void TapRecorder::follow(TapPoint point, uint64_t sequence) {
+  Tap& tap = taps_[static_cast<size_t>(point)];
+  if (!tap.broadcast) return;
+  if (tap.firstSequence.load(std::memory_order_relaxed) == UINT64_MAX) {
+    tap.firstSequence.store(sequence, std::memory_order_relaxed);
+  }
+  tap.lastSequence.store(sequence, std::memory_order_release);
+}
+
+TapStats TapRecorder::stats(TapPoint point) const {
+  const Tap& tap = taps_[static_cast<size_t>(point)];
+  TapStats s;
+  s.enabled = tap.ring != nullptr || tap.broadcast;
+  s.samplesWritten = tap.written.load(std::memory_order_relaxed);
+  s.samplesDropped = tap.dropped.load(std::memory_order_relaxed);
+  return s;
+}
+
+void TapRecorder::writerLoop() {
+  lowerCurrentThreadPriority();
+
+  auto lastSync = std::chrono::steady_clock::now();
+  for (;;) {
+    /* Read the flag first: after stop() is seen, one more pass empties the rings. */
+    bool running = running_.load(std::memory_order_acquire);
+
+    size_t moved = 0;
+    for (Tap& tap : taps_) {
+      if (tap.file) moved += tap.broadcast ? drainFrames(tap) : drain(tap);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSync >= kSyncInterval) {
+      syncFiles();
+      lastSync = now;
+    }
+
+    if (!running) break;
+    if (moved == 0) std::this_thread::sleep_for(kWriterPoll);
+  }
+}
+
+size_t TapRecorder::drain(Tap& tap) {
+  size_t total = 0;
+  for (;;) {
+    size_t n = tap.ring->read(block_.data(), block_.size());
+    if (n == 0) break;
+    std::fwrite(block_.data(), sizeof(float), n, tap.file);
+    tap.dataBytes += n * sizeof(float);
+    tap.written.fetch_add(n, std::memory_order_relaxed);
+    total += n;
+  }
+  return total;
+}
+
+size_t TapRecorder::drainFrames(Tap& tap) {
+  size_t total = 0;
+  const uint64_t droppedBefore = tap.frames.dropped();
+  while (tap.frames.read(frame_)) {
+    /*
+     * follow() precedes the frame's publication, so it is visible here.
+     * Frames outside first..last went by while the taps were unhooked.
+     */
+    const uint64_t last = tap.lastSequence.load(std::memory_order_acquire);
+    const uint64_t first = tap.firstSequence.load(std::memory_order_relaxed);
+    if (first == UINT64_MAX || frame_.sequence < first || frame_.sequence > last) continue;
+    std::fwrite(frame_.samples, sizeof(float), kRNNoiseFrameSize, tap.file);
+    tap.dataBytes += kRNNoiseFrameSize * sizeof(float);
+    tap.written.fetch_add(kRNNoiseFrameSize, std::memory_order_relaxed);
+    total += kRNNoiseFrameSize;
+  }
+  const uint64_t lost = tap.frames.dropped() - droppedBefore;
+  if (lost > 0) tap.dropped.fetch_add(lost * kRNNoiseFrameSize, std::memory_order_relaxed);
+  return total;
+}
+
+void TapRecorder::syncFiles() {
+  for (Tap& tap : taps_) {
+    if (tap.file) syncFile(tap.file);
+  }
+}
+
+void TapRecorder::closeFiles() {
+  for (Tap& tap : taps_) {
+    if (!tap.file) continue;
+    if (format_ == TapFileFormat::kWav) {
+      uint8_t header[kWavHeaderBytes];
+      fillWavHeader(header, kWavFormatFloat, 1, sampleRate_, 32, tap.dataBytes);
+      std::fseek(tap.file, 0, SEEK_SET);
+      std::fwrite(header, 1, sizeof(header), tap.file);
+    }
+    syncFile(tap.file);
+    std::fclose(tap.file);
+    tap.file = nullptr;
+  }
+}
+
+}  // namespace noiseguard
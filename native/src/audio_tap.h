@@ -0,0 +1,146 @@
+/**
+ * TapRecorder -- QA recording of the audio at fixed points in the chain.
+ *
+ *   capture -> [kPreRNNoise] -> RNNoise x2 -> [kPostRNNoise] -> post chain -> [kFinal] -> output
+ *
+ * Each enabled tap owns a lock-free SPSC ring. The processing worker copies
+ * every frame into it (write(), real-time safe) and a low-priority writer
+ * thread drains the rings into files in large blocks:
+ *
+ *   processing worker --write()--> [tap ring] --> writer thread --> WAV / raw file
+ *                        |                         (fwrite in 256 KiB buffers,
+ *                        +-- ring full: samples     fsync about once a second)
+ *                            counted as dropped
+ *
+ * A tap whose frames are already published to a FrameBroadcast (the
+ * engine's kFinal output) needs no ring of its own: the writer thread reads
+ * them through a Reader (kDrop policy), and the producer only calls
+ * follow() with each frame's sequence number, so the tap starts and ends on
+ * the same frames as the others.
+ *
+ * Files are mono 32-bit float, normalized [-1, 1]: WAV (IEEE float) or raw
+ * f32le. Taps start together, so equal sample offsets line up across files.
+ *
+ * THREADING:
+ * - start()/stop() from one control thread. NOT real-time safe.
+ * - write()/follow() from one producer thread (the engine's processing worker).
+ * - stats() from any thread.
+ */
+
+#ifndef NOISEGUARD_AUDIO_TAP_H
+#define NOISEGUARD_AUDIO_TAP_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_ring.h"
+#include "ringbuffer.h"
+
+namespace noiseguard {
+
+enum class TapPoint : uint8_t {
+  kPreRNNoise,   /* Captured input, before any processing */
+  kPostRNNoise,  /* RNNoise output, before the post chain */
+  kFinal,        /* What goes to the output device */
+};
+static constexpr size_t kTapPointCount = 3;
+
+enum class TapFileFormat : uint8_t {
+  kWav,  /* RIFF/WAVE, IEEE float */
+  kRaw,  /* Headerless f32le */
+};
+
+struct TapConfig {
+  std::string paths[kTapPointCount];  /* Indexed by TapPoint; empty = tap off */
+  TapFileFormat format = TapFileFormat::kWav;
+  uint32_t sampleRate = 48000;
+};
+
+struct TapStats {
+  bool enabled = false;
+  uint64_t samplesWritten = 0;  /* Reached the file (may still be in the OS cache) */
+  uint64_t samplesDropped = 0;  /* Lost because the ring was full */
+};
+
+class TapRecorder {
+ public:
+  TapRecorder() = default;
+  ~TapRecorder();
+
+  TapRecorder(const TapRecorder&) = delete;
+  TapRecorder& operator=(const TapRecorder&) = delete;
+
+  /**
+   * Open the configured files and start the writer thread. If finalFrames
+   * is given, the kFinal tap reads it instead of taking write() calls.
+   * Returns empty string on success, or an error message.
+   */
+  std::string start(const TapConfig& config, const FrameBroadcast* finalFrames = nullptr);
+
+  /**
+   * Drain what is buffered, finalize WAV headers, fsync and close. stats()
+   * stay readable. The producer must no longer call write(). Idempotent.
+   */
+  void stop();
+
+  /**
+   * Queue count samples, multiplied by scale (to normalize the chain's
+   * int16-range domain). All-or-nothing: a frame that does not fit is
+   * dropped whole. REAL-TIME SAFE.
+   */
+  void write(TapPoint point, const float* samples, size_t count, float scale);
+
+  /**
+   * For a tap fed from a FrameBroadcast: frame sequence is about to be
+   * published there. The tap records exactly the frames named this way,
+   * so it lines up with the write() taps. REAL-TIME SAFE.
+   */
+  void follow(TapPoint point, uint64_t sequence);
+
+  TapStats stats(TapPoint point) const;
+
+ private:
+  struct Tap {
+    std::unique_ptr<RingBuffer> ring;  /* Set while enabled; kept after stop() for stats */
+    bool broadcast = false;            /* Enabled, fed from frames instead of ring */
+    FrameBroadcast::Reader frames;     /* Writer thread only */
+    std::atomic<uint64_t> firstSequence{UINT64_MAX};  /* From follow() */
+    std::atomic<uint64_t> lastSequence{0};
+    FILE* file = nullptr;
+    uint64_t dataBytes = 0;  /* Writer thread only */
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> dropped{0};
+  };
+
+  /** Writer thread: drain rings, flush periodically, until stopped. */
+  void writerLoop();
+
+  /** Move everything currently in tap's ring to its file. Returns samples moved. */
+  size_t drain(Tap& tap);
+
+  /** Same for a broadcast-fed tap. */
+  size_t drainFrames(Tap& tap);
+
+  /** Flush stdio buffers and fsync every open file. */
+  void syncFiles();
+
+  /** Patch RIFF/data sizes (WAV) and close every file. */
+  void closeFiles();
+
+  Tap taps_[kTapPointCount];
+  TapFileFormat format_ = TapFileFormat::kWav;
+  uint32_t sampleRate_ = 48000;
+  std::vector<float> block_;  /* Writer thread staging */
+  AudioFrame frame_;          /* Writer thread staging (broadcast taps) */
+  std::thread writer_;
+  std::atomic<bool> running_{false};
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_AUDIO_TAP_H
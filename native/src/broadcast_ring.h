@@ -0,0 +1,185 @@
+/**
+ * Lock-free Single-Producer Multi-Consumer (SPMC) broadcast ring.
+ *
+ * One producer writes each element once; any number of readers follow it,
+ * each with its own cursor, and every reader sees every element (unless it
+ * falls behind). The producer never looks at the readers, so a slow or
+ * stalled reader can never hold it up -- it is simply lapped:
+ *
+ *   producer --write()--> [ ring of Capacity slots ] --> Reader A (cursor)
+ *                                                   \--> Reader B (cursor)
+ *                                                    \-> ...
+ *
+ * A reader that falls more than its lag limit behind (at most Capacity - 1)
+ * has overrun; what happens next is its OverrunPolicy:
+ *
+ *   kDrop       resume at the oldest element within the limit: only what
+ *               was overwritten is lost (recorders, which want everything).
+ *   kSkipAhead  jump to the newest element, discarding the backlog
+ *               (playback, meters, which want to be current).
+ *
+ * Either way the loss is counted in the reader.
+ *
+ * Each slot carries a sequence word (a seqlock): odd while the producer is
+ * writing it, 2 * (position + 1) once written. A reader copies the element
+ * out and then checks the word again, so an element overwritten during the
+ * copy is detected and discarded, never returned torn. Only an overrun can
+ * cause that overlap; in normal operation a reader copies slots the
+ * producer is done with.
+ *
+ * RULES FOR REAL-TIME AUDIO:
+ * - write() / writeSlot() + commitWrite() never block, allocate or fail.
+ * - Reader::read() never blocks or waits on the producer, so it is safe in
+ *   a device callback.
+ * - Capacity must be power-of-2; T must be trivially copyable.
+ *
+ * THREADING: one producer thread. Each Reader belongs to one consumer
+ * thread; create as many as needed with reader() (any thread). The ring
+ * must outlive its readers.
+ */
+
+#ifndef NOISEGUARD_BROADCAST_RING_H
+#define NOISEGUARD_BROADCAST_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace noiseguard {
+
+enum class OverrunPolicy : uint8_t {
+  kDrop,       /* Resume at the oldest element still within the lag limit */
+  kSkipAhead,  /* Resume at the newest element */
+};
+
+template <typename T, size_t Capacity>
+class BroadcastRing {
+  static_assert((Capacity & (Capacity - 1)) == 0 && Capacity >= 2,
+                "BroadcastRing capacity must be a power of 2");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "BroadcastRing element must be trivially copyable");
+
+ public:
+  /* Largest lag a reader can be allowed: one slot short of a full lap. */
+  static constexpr size_t kMaxLag = Capacity - 1;
+
+  class Reader {
+   public:
+    /** Detached: read() returns false until assigned from reader(). */
+    Reader() = default;
+
+    /**
+     * Copy the next element to out. Returns false if there is none yet.
+     * Applies the overrun policy first if the producer got too far ahead.
+     */
+    bool read(T& out) {
+      if (!ring_) return false;
+      for (;;) {
+        const uint64_t w = ring_->write_idx_.load(std::memory_order_acquire);
+        if (w - cursor_ > maxLag_) {
+          const uint64_t resume = policy_ == OverrunPolicy::kDrop ? w - maxLag_ : w - 1;
+          dropped_ += resume - cursor_;
+          overruns_++;
+          cursor_ = resume;
+        }
+        if (cursor_ == w) return false;
+
+        const Slot& slot = ring_->slots_[cursor_ & kMask];
+        const uint64_t expected = 2 * (cursor_ + 1);
+        if (slot.seq.load(std::memory_order_acquire) != expected) continue;  /* Lapped */
+        std::memcpy(&out, &slot.value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != expected) continue;  /* Torn */
+        cursor_++;
+        return true;
+      }
+    }
+
+    /** Elements written but not yet read (may exceed the lag limit). */
+    size_t available() const {
+      return ring_ ? static_cast<size_t>(
+                         ring_->write_idx_.load(std::memory_order_acquire) - cursor_)
+                   : 0;
+    }
+
+    /** Elements skipped by overruns. */
+    uint64_t dropped() const { return dropped_; }
+    /** Times the reader fell behind its lag limit. */
+    uint64_t overruns() const { return overruns_; }
+
+   private:
+    friend class BroadcastRing;
+
+    const BroadcastRing* ring_ = nullptr;
+    uint64_t cursor_ = 0;  /* Position of the next element to read */
+    uint64_t maxLag_ = kMaxLag;
+    OverrunPolicy policy_ = OverrunPolicy::kDrop;
+    uint64_t dropped_ = 0;
+    uint64_t overruns_ = 0;
+  };
+
+  BroadcastRing() = default;
+
+  BroadcastRing(const BroadcastRing&) = delete;
+  BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+  /**
+   * A reader starting with the next element written. maxLag (clamped to
+   * 1..kMaxLag) is how far it may fall behind before policy applies.
+   */
+  Reader reader(OverrunPolicy policy, size_t maxLag = kMaxLag) const {
+    Reader r;
+    r.ring_ = this;
+    r.cursor_ = write_idx_.load(std::memory_order_acquire);
+    r.maxLag_ = maxLag < 1 ? 1 : (maxLag > kMaxLag ? kMaxLag : maxLag);
+    r.policy_ = policy;
+    return r;
+  }
+
+  /**
+   * Producer: the slot for the next element, to fill in place. Readers
+   * treat it as unwritten until commitWrite().
+   */
+  T& writeSlot() {
+    const uint64_t w = write_idx_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[w & kMask];
+    slot.seq.store(2 * w + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return slot.value;
+  }
+
+  /** Producer: publish the slot from writeSlot(). */
+  void commitWrite() {
+    const uint64_t w = write_idx_.load(std::memory_order_relaxed);
+    slots_[w & kMask].seq.store(2 * (w + 1), std::memory_order_release);
+    write_idx_.store(w + 1, std::memory_order_release);
+  }
+
+  /** Producer: append one element. */
+  void write(const T& value) {
+    std::memcpy(&writeSlot(), &value, sizeof(T));
+    commitWrite();
+  }
+
+  /** Elements ever written. */
+  uint64_t written() const { return write_idx_.load(std::memory_order_acquire); }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    T value{};
+  };
+
+  Slot slots_[Capacity];
+  alignas(64) std::atomic<uint64_t> write_idx_{0};
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_BROADCAST_RING_H
@@ -0,0 +1,96 @@
+/**
+ * Lock-free bounded Multi-Producer Single-Consumer (MPSC) command queue.
+ *
+ * Used to hand control requests (restart, shutdown, ...) from real-time
+ * threads to a non-real-time owner thread without ever blocking the sender.
+ *
+ * RULES FOR REAL-TIME AUDIO:
+ * - push() never blocks, never allocates, never makes a syscall.
+ *   If the queue is full the command is dropped and push() returns false.
+ * - Any number of producers (PortAudio callbacks, processing thread, main thread).
+ * - Exactly one consumer calls pop().
+ * - Capacity must be power-of-2; T must be trivially copyable.
+ *
+ * Algorithm: Dmitry Vyukov's bounded MPMC queue, restricted to one consumer.
+ * Each slot carries a sequence number so producers can claim slots with a
+ * single CAS and the consumer can detect a half-written slot.
+ */
+
+#ifndef NOISEGUARD_COMMAND_QUEUE_H
+#define NOISEGUARD_COMMAND_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace noiseguard {
+
+template <typename T, size_t Capacity>
+class CommandQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0 && Capacity >= 2,
+                "CommandQueue capacity must be a power of 2");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "CommandQueue element must be trivially copyable");
+
+ public:
+  CommandQueue() {
+    for (size_t i = 0; i < Capacity; i++) {
+      slots_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  CommandQueue(const CommandQueue&) = delete;
+  CommandQueue& operator=(const CommandQueue&) = delete;
+
+  /** Enqueue a command. Returns false (command dropped) if the queue is full. */
+  bool push(const T& value) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      Slot& slot = slots_[pos & kMask];
+      size_t seq = slot.seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = value;
+          slot.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  /* Full. */
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /** Dequeue one command. Returns false if the queue is empty. Consumer only. */
+  bool pop(T& out) {
+    Slot& slot = slots_[head_ & kMask];
+    size_t seq = slot.seq.load(std::memory_order_acquire);
+    if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(head_ + 1) < 0) {
+      return false;  /* Empty, or a producer has not finished writing yet. */
+    }
+    out = slot.value;
+    slot.seq.store(head_ + Capacity, std::memory_order_release);
+    head_++;
+    return true;
+  }
+
+ private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  struct Slot {
+    std::atomic<size_t> seq{0};
+    T value{};
+  };
+
+  Slot slots_[Capacity];
+  alignas(64) std::atomic<size_t> tail_{0};  /* Shared by producers. */
+  alignas(64) size_t head_ = 0;              /* Consumer-private. */
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_COMMAND_QUEUE_H
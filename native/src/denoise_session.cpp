@@ -0,0 +1,123 @@
+/**
+ * DenoiseSession implementation.
+ */
+
+#include "denoise_session.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "state_blob.h"
+
+namespace noiseguard {
+
+std::string DenoiseSession::init() {
+  clearStream();
+  stateMemory_ = nullptr;
+  return rnnoise_.init() ? "" : "RNNoise initialization failed";
+}
+
+std::string DenoiseSession::init(void* stateMemory) {
+  clearStream();
+  stateMemory_ = stateMemory;
+  return rnnoise_.init(stateMemory) ? "" : "RNNoise initialization failed";
+}
+
+std::string DenoiseSession::reset() {
+  return stateMemory_ ? init(stateMemory_) : init();
+}
+
+void DenoiseSession::clearStream() {
+  std::fill(std::begin(frame_), std::end(frame_), 0.0f);
+  pos_ = 0;
+  samples_ = 0;
+}
+
+void DenoiseSession::run(float* samples, size_t count, bool scaled) {
+  samples_ += count;
+  while (count > 0) {
+    /*
+     * Exchange the caller's next samples with the delay line: the caller
+     * receives processed output, the delay line receives new input. When the
+     * input part fills the whole frame, it is denoised in place and becomes
+     * the output for the next kLatency samples.
+     */
+    size_t m = std::min(kRNNoiseFrameSize - pos_, count);
+    std::swap_ranges(samples, samples + m, frame_ + pos_);
+    samples += m;
+    count -= m;
+    pos_ += m;
+
+    if (pos_ == kRNNoiseFrameSize) {
+      processDelayLine(scaled);
+      pos_ = 0;
+    }
+  }
+}
+
+void DenoiseSession::drainTail(float* out, bool scaled) {
+  /* Processed samples of the previous frame that were never handed back. */
+  size_t tail = kRNNoiseFrameSize - pos_;
+  std::memcpy(out, frame_ + pos_, tail * sizeof(float));
+
+  /* Last partial input frame: zero-pad, denoise, emit its pos_ samples. */
+  if (pos_ > 0) {
+    std::fill(frame_ + pos_, frame_ + kRNNoiseFrameSize, 0.0f);
+    processDelayLine(scaled);
+    std::memcpy(out + tail, frame_, pos_ * sizeof(float));
+  }
+
+  std::fill(std::begin(frame_), std::end(frame_), 0.0f);
+  pos_ = 0;
+}
+
+static constexpr char kSessionMagic[4] = {'N', 'G', 'D', 'S'};
+static constexpr uint32_t kSessionVersion = 1;
+
+std::string DenoiseSession::saveState(std::vector<uint8_t>& out) const {
+  std::vector<uint8_t> chainState;
+  std::string err = rnnoise_.saveState(chainState);
+  if (!err.empty()) return err;
+
+  out.clear();
+  StateWriter w(out);
+  w.bytes(kSessionMagic, sizeof(kSessionMagic));
+  w.u32(kSessionVersion);
+  w.u32(static_cast<uint32_t>(pos_));
+  w.u64(samples_);
+  w.bytes(frame_, sizeof(frame_));
+  w.u32(static_cast<uint32_t>(chainState.size()));
+  w.bytes(chainState.data(), chainState.size());
+  return "";
+}
+
+std::string DenoiseSession::loadState(const uint8_t* data, size_t size) {
+  StateReader r(data, size);
+  char magic[4];
+  r.bytes(magic, sizeof(magic));
+  if (!r.ok() || std::memcmp(magic, kSessionMagic, sizeof(magic)) != 0) {
+    return "not a NoiseGuard session state";
+  }
+  uint32_t version = r.u32();
+  if (version != kSessionVersion) {
+    return "unsupported session state version " + std::to_string(version);
+  }
+  size_t pos = r.u32();
+  uint64_t samples = r.u64();
+  float frame[kRNNoiseFrameSize];
+  r.bytes(frame, sizeof(frame));
+  size_t chainBytes = r.u32();
+  const uint8_t* chainState = r.take(chainBytes);
+  if (!r.ok() || r.remaining() != 0 || pos >= kRNNoiseFrameSize) {
+    return "session state has the wrong size";
+  }
+
+  std::string err = rnnoise_.loadState(chainState, chainBytes);
+  if (!err.empty()) return err;
+  std::memcpy(frame_, frame, sizeof(frame_));
+  pos_ = pos;
+  samples_ = samples;
+  return "";
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,131 @@
+/**
+ * DenoiseSession -- offline / streaming denoising without an audio device.
+ *
+ * Runs caller-provided audio through the exact production chain
+ * (RNNoiseWrapper) in chunks of any length. Samples are processed IN PLACE:
+ * the session keeps one 480-sample delay line and swaps it with the
+ * caller's samples, so each process() call returns the same number of
+ * samples it was given, delayed by exactly kLatency samples:
+ *
+ *   caller buf:  [ x0 x1 ... ]  --swap-->  [ y(n-480) y(n-479) ... ]
+ *   delay line:  holds processed samples not yet emitted + new input
+ *                waiting for a full frame
+ *
+ * The first kLatency output samples of a stream are silence; flush() emits
+ * the final kLatency samples (the last partial frame is zero-padded).
+ *
+ * Samples are normalized floats [-1.0, 1.0], mono, 48 kHz -- or, through
+ * processScaled() / flushScaled(), RNNoise's int16-range domain (e.g. s16
+ * PCM converted with int16ToScaledFloat()), which skips the chain's
+ * normalize/denormalize passes. A stream stays in one domain throughout;
+ * its saved state holds the delay line in that domain.
+ *
+ * saveState() / loadState() checkpoint a stream mid-way: the chain's
+ * state blob (RNNoiseWrapper::saveState()) plus the delay line, so a
+ * session restored from it -- later, or on another host -- emits exactly
+ * the samples the original would have. Blob (little-endian, version 1):
+ *
+ *   "NGDS"  u32 version  u32 pos  u64 samples  f32 delayLine[480]
+ *   u32 chainBytes  u8 chain[chainBytes]
+ *
+ * THREADING: not thread-safe; one thread at a time per session. process()
+ * does no allocations.
+ */
+
+#ifndef NOISEGUARD_DENOISE_SESSION_H
+#define NOISEGUARD_DENOISE_SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+class DenoiseSession {
+ public:
+  /* Output lags input by one RNNoise frame. */
+  static constexpr size_t kLatency = kRNNoiseFrameSize;
+
+  DenoiseSession() = default;
+
+  DenoiseSession(const DenoiseSession&) = delete;
+  DenoiseSession& operator=(const DenoiseSession&) = delete;
+
+  /** Create the RNNoise state. Returns empty string on success, or an error. */
+  std::string init();
+
+  /**
+   * Same, but build the RNNoise states in stateMemory (stateBytes(),
+   * kArenaAlign-aligned; e.g. right behind the session in one arena slot)
+   * instead of the heap. reset() reuses it; it must outlive the session.
+   */
+  std::string init(void* stateMemory);
+
+  /** Bytes init(void*) builds the RNNoise states in. */
+  static size_t stateBytes() { return RNNoiseWrapper::stateBytes(); }
+
+  /** Denoise count samples in place (output delayed by kLatency). */
+  void process(float* samples, size_t count) { run(samples, count, false); }
+
+  /** Same, for samples in the int16-range domain (left in it). */
+  void processScaled(float* samples, size_t count) { run(samples, count, true); }
+
+  /**
+   * End of stream: write the kLatency samples still in the delay line to out
+   * and clear it. RNNoise state is kept; call reset() to start a new stream.
+   */
+  void flush(float* out) { drainTail(out, false); }
+
+  /** flush() for a stream fed through processScaled(). */
+  void flushScaled(float* out) { drainTail(out, true); }
+
+  /** Start a new, unrelated stream (fresh RNNoise state, empty delay line). */
+  std::string reset();
+
+  /** Settings / metrics of the underlying chain. */
+  RNNoiseWrapper& chain() { return rnnoise_; }
+  const RNNoiseWrapper& chain() const { return rnnoise_; }
+
+  /** Serialize the stream state into out (replaced). Empty string on success. */
+  std::string saveState(std::vector<uint8_t>& out) const;
+
+  /** Continue from a saveState() blob. init() first. Unchanged on error. */
+  std::string loadState(const uint8_t* data, size_t size);
+
+  /** Samples passed to process() since init()/reset(). */
+  uint64_t samplesProcessed() const { return samples_; }
+
+ private:
+  void run(float* samples, size_t count, bool scaled);
+  void drainTail(float* out, bool scaled);
+
+  /** Empty delay line, zero sample count. */
+  void clearStream();
+
+  /** Denoise frame_ in the stream's domain. */
+  void processDelayLine(bool scaled) {
+    if (scaled) {
+      rnnoise_.processFrameScaled(frame_);
+    } else {
+      rnnoise_.processFrame(frame_);
+    }
+  }
+
+  RNNoiseWrapper rnnoise_;
+  void* stateMemory_ = nullptr;  /* init(void*) memory, or nullptr = heap states */
+
+  /*
+   * frame_[0, pos_)            = input collected for the next RNNoise frame
+   * frame_[pos_, kLatency)     = processed output not yet handed back
+   */
+  float frame_[kRNNoiseFrameSize] = {};
+  size_t pos_ = 0;
+  uint64_t samples_ = 0;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_DENOISE_SESSION_H
@@ -0,0 +1,220 @@
+/**
+ * RNNoise pipeline tasks implementation.
+ */
+
+#include "denoise_tasks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace noiseguard {
+
+namespace {
+
+size_t bytesPerSample(AudioFileEncoding encoding) {
+  return encoding == AudioFileEncoding::kPcm16 ? sizeof(int16_t) : sizeof(float);
+}
+
+}  // namespace
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  STREAM
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+StreamDenoiseTask::StreamDenoiseTask(TaskChannel& in, TaskChannel& out)
+    : in_(in), out_(out), task_(&StreamDenoiseTask::step, this) {}
+
+std::string StreamDenoiseTask::init(const ChainParams& params) {
+  if (!chain_.init()) return "RNNoise initialization failed";
+  if (!chain_.applyParams(params)) return "Invalid chain parameters";
+  return "";
+}
+
+void StreamDenoiseTask::spawn(TaskExecutor& executor) {
+  in_.bindReader(&task_);
+  out_.bindWriter(&task_);
+  executor.spawn(task_);
+}
+
+TaskStatus StreamDenoiseTask::step(Task&, void* ctx) {
+  auto* self = static_cast<StreamDenoiseTask*>(ctx);
+  for (size_t frames = 0; frames < kStepFrames;) {
+    if (self->outLen_ > 0) {
+      size_t n = self->out_.write(self->frame_ + self->outPos_, self->outLen_);
+      self->outPos_ += n;
+      self->outLen_ -= n;
+      if (self->outLen_ > 0) return TaskStatus::kPending;  /* Output full */
+    }
+    if (self->finished_) {
+      self->out_.close();
+      return TaskStatus::kDone;
+    }
+
+    const bool closed = self->in_.closed();
+    const size_t avail = self->in_.readable();
+    size_t count = kRNNoiseFrameSize;
+    if (avail < kRNNoiseFrameSize) {
+      if (!closed) return TaskStatus::kPending;  /* Waiting for input */
+      self->finished_ = true;
+      if (avail == 0) continue;
+      count = avail;  /* Final partial frame */
+      std::fill(self->frame_ + count, self->frame_ + kRNNoiseFrameSize, 0.0f);
+    }
+    self->in_.read(self->frame_, count);
+    self->chain_.processFrame(self->frame_);
+    self->samples_ += count;
+    self->outPos_ = 0;
+    self->outLen_ = count;
+    frames++;
+  }
+  return TaskStatus::kYield;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  FILE
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+FileDenoiseTask::FileDenoiseTask() : task_(&FileDenoiseTask::step, this) {}
+
+std::string FileDenoiseTask::init(const FileTaskConfig& config, const ChainParams& params) {
+  if (!config.in || !config.out) return "Missing input or output file";
+  config_ = config;
+  const size_t frames = std::max<size_t>(
+      1, (config.blockSamples + kRNNoiseFrameSize - 1) / kRNNoiseFrameSize);
+  config_.blockSamples = frames * kRNNoiseFrameSize;
+  blocks_ = (config.samples + config_.blockSamples - 1) / config_.blockSamples;
+
+  if (!chain_.init()) return "RNNoise initialization failed";
+  if (!chain_.applyParams(params)) return "Invalid chain parameters";
+
+  blockBytes_ = config_.blockSamples *
+      std::max(bytesPerSample(config.inEncoding), bytesPerSample(config.outEncoding));
+  for (Slot& slot : slots_) slot.samples.resize(config_.blockSamples);
+  return "";
+}
+
+void FileDenoiseTask::spawn(TaskExecutor& executor) {
+  for (Slot& slot : slots_) {
+    slot.io.buffer = -1;
+    slot.raw = static_cast<uint8_t*>(executor.acquireIoBuffer(blockBytes_, &slot.io.buffer));
+    if (!slot.raw) {
+      slot.ownRaw.resize(blockBytes_);
+      slot.raw = slot.ownRaw.data();
+    }
+    slot.io.data = slot.raw;
+  }
+  executor.spawn(task_);
+}
+
+void FileDenoiseTask::releaseBuffers(TaskExecutor& executor) {
+  for (Slot& slot : slots_) {
+    executor.releaseIoBuffer(slot.io.buffer);
+    slot.io.buffer = -1;
+  }
+}
+
+TaskStatus FileDenoiseTask::step(Task& task, void* ctx) {
+  auto* self = static_cast<FileDenoiseTask*>(ctx);
+  TaskExecutor& executor = *task.executor();
+
+  /* Collect completed I/O. */
+  bool inFlight = false;
+  for (Slot& slot : self->slots_) {
+    if (slot.state != SlotState::kReading && slot.state != SlotState::kWriting) continue;
+    if (!slot.io.done.load(std::memory_order_acquire)) {
+      inFlight = true;
+      continue;
+    }
+    if (slot.io.result != static_cast<int64_t>(slot.io.bytes) && self->error_.empty()) {
+      self->error_ = slot.state == SlotState::kReading
+          ? (slot.io.result < 0 ? "Read error" : "Unexpected end of input")
+          : "Write error";
+    }
+    slot.state = slot.state == SlotState::kReading ? SlotState::kRead : SlotState::kFree;
+  }
+  if (!self->error_.empty()) {
+    /* Buffers belong to in-flight requests until they complete. */
+    if (inFlight) return TaskStatus::kPending;
+    self->releaseBuffers(executor);
+    return TaskStatus::kDone;
+  }
+
+  /* Denoise blocks strictly in order: the chain is sequential. */
+  for (bool progressed = true; progressed;) {
+    progressed = false;
+    for (Slot& slot : self->slots_) {
+      if (slot.state == SlotState::kRead && slot.block == self->nextProcess_) {
+        self->processBlock(slot);
+        executor.submitIo(task, slot.io);
+        self->nextProcess_++;
+        progressed = true;
+      }
+    }
+  }
+
+  /* Refill free slots. */
+  const size_t inBytes = bytesPerSample(self->config_.inEncoding);
+  for (Slot& slot : self->slots_) {
+    if (slot.state != SlotState::kFree || self->nextRead_ >= self->blocks_) continue;
+    const uint64_t first = self->nextRead_ * self->config_.blockSamples;
+    slot.block = self->nextRead_++;
+    slot.count = static_cast<size_t>(
+        std::min<uint64_t>(self->config_.blockSamples, self->config_.samples - first));
+    slot.state = SlotState::kReading;
+    slot.io.file = self->config_.in;
+    slot.io.write = false;
+    slot.io.bytes = slot.count * inBytes;
+    slot.io.offset = self->config_.inOffset + first * inBytes;
+    executor.submitIo(task, slot.io);
+  }
+
+  if (self->nextProcess_ == self->blocks_) {
+    bool idle = true;
+    for (const Slot& slot : self->slots_) idle = idle && slot.state == SlotState::kFree;
+    if (idle) {
+      self->releaseBuffers(executor);
+      return TaskStatus::kDone;
+    }
+  }
+  return TaskStatus::kPending;
+}
+
+void FileDenoiseTask::processBlock(Slot& slot) {
+  float* x = slot.samples.data();
+  const uint8_t* raw = slot.raw;
+  if (config_.inEncoding == AudioFileEncoding::kPcm16) {
+    for (size_t i = 0; i < slot.count; i++) {
+      int16_t v;
+      std::memcpy(&v, raw + i * sizeof(v), sizeof(v));
+      x[i] = static_cast<float>(v) / 32768.0f;
+    }
+  } else {
+    std::memcpy(x, raw, slot.count * sizeof(float));
+  }
+
+  /* Only the file's last block can end mid-frame. */
+  const size_t padded =
+      (slot.count + kRNNoiseFrameSize - 1) / kRNNoiseFrameSize * kRNNoiseFrameSize;
+  std::fill(x + slot.count, x + padded, 0.0f);
+  for (size_t f = 0; f < padded; f += kRNNoiseFrameSize) chain_.processFrame(x + f);
+
+  const uint64_t first = slot.block * config_.blockSamples;
+  const size_t outBytes = bytesPerSample(config_.outEncoding);
+  if (config_.outEncoding == AudioFileEncoding::kPcm16) {
+    for (size_t i = 0; i < slot.count; i++) {
+      float v = std::clamp(x[i], -1.0f, 1.0f) * 32767.0f;
+      int16_t s = static_cast<int16_t>(std::lrint(v));
+      std::memcpy(slot.raw + i * sizeof(s), &s, sizeof(s));
+    }
+  } else {
+    std::memcpy(slot.raw, x, slot.count * sizeof(float));
+  }
+  slot.state = SlotState::kWriting;
+  slot.io.file = config_.out;
+  slot.io.write = true;
+  slot.io.bytes = slot.count * outBytes;
+  slot.io.offset = config_.outOffset + first * outBytes;
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,149 @@
+/**
+ * RNNoise pipelines as TaskExecutor tasks (task_executor.h).
+ *
+ *   StreamDenoiseTask  server mode: one live stream per task.
+ *                      in channel --480-sample frames--> chain --> out channel
+ *                      Waits on an empty input or a full output ring; at
+ *                      most kStepFrames frames per step, then yields, so one
+ *                      busy stream cannot starve the rest. After the input
+ *                      closes, the final partial frame is zero-padded
+ *                      (output keeps the input's length) and out is closed.
+ *   FileDenoiseTask    offline mode: a region of raw mono 48 kHz samples in
+ *                      one file into a region of another, through TaskIo.
+ *                      kFileSlots blocks circulate (read -> denoise -> write),
+ *                      so reads of later blocks and writes of earlier ones
+ *                      overlap the DSP. Frame-aligned, no latency. Blocks
+ *                      use the executor's registered I/O buffers when it
+ *                      has them free (TaskExecutor::acquireIoBuffer()).
+ *
+ * Neither adds delay: output sample n comes from input frame n / 480 (as in
+ * offline_pipeline.h). An idle task costs its RNNoise state, its buffers
+ * and nothing else.
+ *
+ * THREADING: configure and spawn() from one thread; afterwards the task is
+ * driven by the executor. Read stats and error() after the task is done.
+ */
+
+#ifndef NOISEGUARD_DENOISE_TASKS_H
+#define NOISEGUARD_DENOISE_TASKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "audio_file.h"
+#include "rnnoise_wrapper.h"
+#include "task_executor.h"
+
+namespace noiseguard {
+
+class StreamDenoiseTask {
+ public:
+  /* Frames per step before yielding to other tasks. */
+  static constexpr size_t kStepFrames = 8;
+
+  /** Channels must outlive the task. */
+  StreamDenoiseTask(TaskChannel& in, TaskChannel& out);
+
+  StreamDenoiseTask(const StreamDenoiseTask&) = delete;
+  StreamDenoiseTask& operator=(const StreamDenoiseTask&) = delete;
+
+  /** Create the chain. Returns empty string on success, or an error. */
+  std::string init(const ChainParams& params = RNNoiseWrapper::defaultParams());
+
+  /** Bind to both channels and start running on executor. */
+  void spawn(TaskExecutor& executor);
+
+  Task& task() { return task_; }
+  RNNoiseWrapper& chain() { return chain_; }
+
+  /** Samples denoised so far (task thread; read once done). */
+  uint64_t samples() const { return samples_; }
+
+ private:
+  static TaskStatus step(Task& task, void* ctx);
+
+  TaskChannel& in_;
+  TaskChannel& out_;
+  RNNoiseWrapper chain_;
+  Task task_;
+  float frame_[kRNNoiseFrameSize];
+  size_t outPos_ = 0;   /* Next sample of frame_ to emit */
+  size_t outLen_ = 0;   /* Samples of frame_ still to emit */
+  bool finished_ = false;
+  uint64_t samples_ = 0;
+};
+
+struct FileTaskConfig {
+  FILE* in = nullptr;
+  uint64_t inOffset = 0;    /* Byte offset of the first sample */
+  AudioFileEncoding inEncoding = AudioFileEncoding::kFloat32;
+  uint64_t samples = 0;     /* Samples to denoise */
+  FILE* out = nullptr;
+  uint64_t outOffset = 0;
+  AudioFileEncoding outEncoding = AudioFileEncoding::kFloat32;
+  size_t blockSamples = 4800;  /* Per read / write; rounded up to whole frames */
+};
+
+class FileDenoiseTask {
+ public:
+  /* Blocks in flight at once. */
+  static constexpr size_t kFileSlots = 4;
+
+  FileDenoiseTask();
+
+  FileDenoiseTask(const FileDenoiseTask&) = delete;
+  FileDenoiseTask& operator=(const FileDenoiseTask&) = delete;
+
+  /** Create the chain and buffers. Returns empty string on success, or an error. */
+  std::string init(const FileTaskConfig& config,
+                   const ChainParams& params = RNNoiseWrapper::defaultParams());
+
+  /** Take I/O buffers (pooled if available) and start running on executor. */
+  void spawn(TaskExecutor& executor);
+
+  /** Bytes of one block's I/O buffer (for ExecutorConfig::ioBufferBytes). */
+  size_t blockBytes() const { return blockBytes_; }
+
+  Task& task() { return task_; }
+
+  /** Empty on success; set once the task is done. */
+  const std::string& error() const { return error_; }
+
+ private:
+  enum class SlotState : uint8_t { kFree, kReading, kRead, kWriting };
+
+  struct Slot {
+    SlotState state = SlotState::kFree;
+    uint64_t block = 0;
+    size_t count = 0;               /* Samples in this block */
+    uint8_t* raw = nullptr;         /* Encoded in, then encoded out */
+    std::vector<uint8_t> ownRaw;    /* raw's storage when not pooled */
+    std::vector<float> samples;     /* Whole frames */
+    TaskIo io;
+  };
+
+  static TaskStatus step(Task& task, void* ctx);
+
+  /** Decode, denoise and encode slot's block, then start its write. */
+  void processBlock(Slot& slot);
+
+  /** Return pooled buffers; the task is about to finish. */
+  void releaseBuffers(TaskExecutor& executor);
+
+  FileTaskConfig config_;
+  RNNoiseWrapper chain_;
+  Task task_;
+  Slot slots_[kFileSlots];
+  size_t blockBytes_ = 0;
+  uint64_t blocks_ = 0;
+  uint64_t nextRead_ = 0;
+  uint64_t nextProcess_ = 0;
+  std::string error_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_DENOISE_TASKS_H
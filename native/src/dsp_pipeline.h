@@ -0,0 +1,75 @@
+/**
+ * Compile-time composed DSP stage pipelines.
+ *
+ * A stage is any type with
+ *     static void process(State& state, Context& ctx);
+ * Pipeline<A, B, C>::run(state, ctx) calls A, B, C in order. Everything is
+ * resolved at compile time, so with force-inlined stages each instantiation
+ * is one straight-line per-frame kernel: no virtual calls, no per-stage
+ * "enabled?" branches.
+ *
+ * Runtime choice happens ONCE per frame, by picking a pre-instantiated
+ * kernel from a table (see makeKernelTable): bit i of the table index
+ * enables the i-th optional stage of a layout.
+ *
+ * Example:
+ *   template <uint32_t M>
+ *   using MyChain = Pipeline<Optional<(M & 1) != 0, Hpf>, Gate,
+ *                            Optional<(M & 2) != 0, Limiter>>;
+ *   static constexpr auto kTable =
+ *       makeKernelTable<MyChain, State, Ctx>(std::make_index_sequence<4>{});
+ *   kTable[mask](state, ctx);
+ */
+
+#ifndef NOISEGUARD_DSP_PIPELINE_H
+#define NOISEGUARD_DSP_PIPELINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#if defined(_MSC_VER)
+#define NOISEGUARD_FORCE_INLINE __forceinline
+#else
+#define NOISEGUARD_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace noiseguard {
+
+/** Stages run in declaration order. */
+template <typename... Stages>
+struct Pipeline {
+  template <typename State, typename Context>
+  static void run(State& state, Context& ctx) {
+    (Stages::process(state, ctx), ...);
+  }
+};
+
+/** Wraps a stage that is compiled out entirely when Enabled is false. */
+template <bool Enabled, typename Stage>
+struct Optional {
+  template <typename State, typename Context>
+  static NOISEGUARD_FORCE_INLINE void process(State& state, Context& ctx) {
+    if constexpr (Enabled) Stage::process(state, ctx);
+  }
+};
+
+/** Per-frame kernel signature produced by a Pipeline instantiation. */
+template <typename State, typename Context>
+using StageKernel = void (*)(State&, Context&);
+
+/**
+ * Instantiate Layout<Mask> for every Mask in the sequence and return their
+ * run() functions as a table indexed by mask.
+ */
+template <template <uint32_t> class Layout, typename State, typename Context,
+          size_t... Masks>
+constexpr std::array<StageKernel<State, Context>, sizeof...(Masks)>
+makeKernelTable(std::index_sequence<Masks...>) {
+  return {{&Layout<static_cast<uint32_t>(Masks)>::template run<State, Context>...}};
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_DSP_PIPELINE_H
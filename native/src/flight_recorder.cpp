@@ -0,0 +1,109 @@
+/**
+ * FlightRecorder implementation.
+ */
+
+#include "flight_recorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "sample_convert.h"
+#include "wav_header.h"
+
+namespace noiseguard {
+
+static constexpr uint32_t kFlightSampleRate = 48000;
+
+namespace {
+
+int64_t steadyNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+FlightRecorder::FlightRecorder()
+    : slots_(new Slot[kFrames]()), epochNs_(steadyNs()) {}
+
+double FlightRecorder::nowMs() const {
+  return static_cast<double>(steadyNs() - epochNs_) / 1e6;
+}
+
+void FlightRecorder::recordInput(const float* frame, float scale) {
+  Slot& slot = slots_[head_.load(std::memory_order_relaxed) % kFrames];
+  float normalized[kRNNoiseFrameSize];
+  for (size_t i = 0; i < kRNNoiseFrameSize; i++) normalized[i] = frame[i] * scale;
+  normalizedToInt16(normalized, slot.input, kRNNoiseFrameSize);
+}
+
+void FlightRecorder::recordOutput(const float* frame, const FlightFrameInfo& info) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[head % kFrames];
+  normalizedToInt16(frame, slot.output, kRNNoiseFrameSize);
+  slot.info = info;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+std::string FlightRecorder::dump(const std::string& basePath) const {
+  /*
+   * Seqlock-style snapshot: copy the window, then re-read head. Slots the
+   * producer may have reused meanwhile (and the one it is filling) are
+   * dropped from the front; the copy takes milliseconds, the window 30 s.
+   */
+  uint64_t end = head_.load(std::memory_order_acquire);
+  uint64_t begin = end > kFrames ? end - kFrames : 0;
+  if (end == begin) return "Flight recorder is empty";
+
+  std::vector<Slot> copy(end - begin);
+  for (uint64_t f = begin; f < end; f++) {
+    std::memcpy(&copy[f - begin], &slots_[f % kFrames], sizeof(Slot));
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = head_.load(std::memory_order_relaxed);
+  uint64_t firstValid = after + 1 > kFrames ? after + 1 - kFrames : 0;
+  size_t skip = firstValid > begin ? static_cast<size_t>(firstValid - begin) : 0;
+  if (skip >= copy.size()) return "Flight recorder overran the snapshot";
+
+  /* <base>.wav: stereo int16, L = input, R = output. */
+  std::string wavPath = basePath + ".wav";
+  FILE* wav = std::fopen(wavPath.c_str(), "wb");
+  if (!wav) return "Cannot open " + wavPath;
+
+  size_t frames = copy.size() - skip;
+  uint64_t dataBytes = uint64_t{frames} * kRNNoiseFrameSize * 2 * sizeof(int16_t);
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, kWavFormatPcm, 2, kFlightSampleRate, 16, dataBytes);
+  bool ok = std::fwrite(header, 1, sizeof(header), wav) == sizeof(header);
+
+  int16_t interleaved[2 * kRNNoiseFrameSize];
+  for (size_t f = skip; ok && f < copy.size(); f++) {
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      interleaved[2 * i] = copy[f].input[i];
+      interleaved[2 * i + 1] = copy[f].output[i];
+    }
+    ok = std::fwrite(interleaved, sizeof(interleaved), 1, wav) == 1;
+  }
+  ok = (std::fclose(wav) == 0) && ok;
+  if (!ok) return "Failed writing " + wavPath;
+
+  /* <base>.csv: one row per frame, same order as the WAV. */
+  std::string csvPath = basePath + ".csv";
+  FILE* csv = std::fopen(csvPath.c_str(), "w");
+  if (!csv) return "Cannot open " + csvPath;
+  std::fprintf(csv, "frame,time_ms,input_rms,output_rms,vad,gain,capture_fill,xruns,"
+                    "latency_ms,flags\n");
+  for (size_t f = skip; f < copy.size(); f++) {
+    const FlightFrameInfo& m = copy[f].info;
+    std::fprintf(csv, "%llu,%.3f,%.6f,%.6f,%.4f,%.4f,%u,%u,%.3f,%u\n",
+                 static_cast<unsigned long long>(begin + f), m.timeMs,
+                 m.inputRms, m.outputRms, m.vad, m.gain,
+                 m.captureFill, m.xruns, m.latencyMs, m.flags);
+  }
+  if (std::fclose(csv) != 0) return "Failed writing " + csvPath;
+  return "";
+}
+
+}  // namespace noiseguard
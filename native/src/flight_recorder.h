@@ -0,0 +1,96 @@
+/**
+ * FlightRecorder -- always-on, fixed-memory record of the last ~30 seconds.
+ *
+ * When a user reports "robotic" audio the moment is gone by the time anyone
+ * looks. The engine therefore keeps a circular window of what it heard and
+ * produced, frame by frame:
+ *
+ *   slot[i % kFrames] = { input  int16 x 480,     (before RNNoise)
+ *                         output int16 x 480,     (what went to the device)
+ *                         metrics: RMS in/out, VAD, gate gain,
+ *                                  capture ring fill, cumulative xruns }
+ *
+ * ~5.9 MB, allocated once. Per frame the producer converts 960 samples to
+ * int16 and stores 32 bytes of metrics -- a few microseconds every 10 ms.
+ *
+ * dump() snapshots the window from any thread without stopping the
+ * producer and writes <base>.wav (stereo int16: L = input, R = output) and
+ * <base>.csv (one row of metrics per frame).
+ *
+ * THREADING:
+ * - recordInput()/recordOutput() from one producer (the processing worker),
+ *   in that order, once per frame. REAL-TIME SAFE.
+ * - dump()/framesRecorded() from any thread. NOT real-time safe.
+ */
+
+#ifndef NOISEGUARD_FLIGHT_RECORDER_H
+#define NOISEGUARD_FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+/** Per-frame metrics kept next to the audio. */
+struct FlightFrameInfo {
+  double timeMs = 0.0;       /* Steady clock, ms since the recorder was created */
+  float inputRms = 0.0f;
+  float outputRms = 0.0f;
+  float vad = 0.0f;
+  float gain = 1.0f;
+  uint32_t captureFill = 0;  /* Samples waiting in the capture ring */
+  uint32_t xruns = 0;        /* Cumulative device xruns seen by the engine */
+  float latencyMs = 0.0f;    /* Capture of the frame's first sample -> processed */
+  uint32_t flags = 0;        /* AudioFrame::flags (kFrameGap, kFrameXrun) */
+};
+
+class FlightRecorder {
+ public:
+  /* 3000 frames of 10 ms = 30 s. */
+  static constexpr size_t kFrames = 3000;
+
+  FlightRecorder();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  /** Store the frame entering RNNoise, multiplied by scale to normalize. */
+  void recordInput(const float* frame, float scale);
+
+  /** Store the processed (normalized) frame and its metrics; completes the slot. */
+  void recordOutput(const float* frame, const FlightFrameInfo& info);
+
+  /**
+   * Write the current window to basePath + ".wav" / ".csv".
+   * Returns empty string on success, or an error message.
+   */
+  std::string dump(const std::string& basePath) const;
+
+  /** Frames recorded since creation (the window holds the last kFrames). */
+  uint64_t framesRecorded() const { return head_.load(std::memory_order_acquire); }
+
+  /** Milliseconds on the recorder's clock (for FlightFrameInfo::timeMs). */
+  double nowMs() const;
+
+ private:
+  struct Slot {
+    int16_t input[kRNNoiseFrameSize];
+    int16_t output[kRNNoiseFrameSize];
+    FlightFrameInfo info;
+  };
+
+  std::unique_ptr<Slot[]> slots_;
+  int64_t epochNs_;  /* steady_clock at construction */
+
+  /* Frames completed. The producer publishes each slot by bumping it. */
+  std::atomic<uint64_t> head_{0};
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_FLIGHT_RECORDER_H
@@ -0,0 +1,240 @@
+/**
+ * Frame capture writer / reader implementation.
+ */
+
+#include "frame_capture.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "io_util.h"
+
+namespace noiseguard {
+
+static constexpr char kCaptureMagic[4] = {'N', 'G', 'C', 'P'};
+
+/* stdio buffer: a frame record is ~3.9 KB, so this batches ~64 of them. */
+static constexpr size_t kCaptureFileBuffer = 256 * 1024;
+
+/* Writer wake-up interval and fsync cadence (same as the tap recorder). */
+static constexpr auto kCapturePoll = std::chrono::milliseconds(20);
+static constexpr auto kCaptureSyncInterval = std::chrono::seconds(1);
+
+namespace {
+
+/* Fixed-size part of a record, before the payload. */
+struct RecordHeader {
+  uint32_t kind;
+  uint32_t payloadBytes;
+  uint64_t frameIndex;
+};
+static_assert(sizeof(RecordHeader) == 16, "record header is 16 bytes on disk");
+
+struct ParamsPayload {
+  float level;
+  float vadThreshold;
+  uint32_t comfortNoise;
+  uint32_t chainSelector;
+};
+
+bool sameParams(const ChainParams& a, const ChainParams& b) {
+  /* Bitwise on the floats: replay must see exactly the recorded values. */
+  return std::memcmp(&a.level, &b.level, sizeof(float)) == 0 &&
+         std::memcmp(&a.vadThreshold, &b.vadThreshold, sizeof(float)) == 0 &&
+         a.comfortNoise == b.comfortNoise && a.chainSelector == b.chainSelector;
+}
+
+}  // namespace
+
+/* ═══ Writer ═══ */
+
+FrameCaptureWriter::~FrameCaptureWriter() { stop(); }
+
+std::string FrameCaptureWriter::start(const std::string& path) {
+  stop();
+
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) return "Cannot open capture file: " + path;
+  std::setvbuf(file_, nullptr, _IOFBF, kCaptureFileBuffer);
+
+  uint32_t header[3] = {kCaptureVersion, static_cast<uint32_t>(kRNNoiseFrameSize), 48000};
+  std::fwrite(kCaptureMagic, 1, sizeof(kCaptureMagic), file_);
+  std::fwrite(header, sizeof(header), 1, file_);
+
+  queue_ = std::make_unique<CommandQueue<Frame, kQueueFrames>>();
+  nextIndex_ = 0;
+  haveParams_ = false;
+  captured_.store(0, std::memory_order_relaxed);
+  truncated_.store(false, std::memory_order_relaxed);
+
+  running_.store(true, std::memory_order_release);
+  writer_ = std::thread(&FrameCaptureWriter::writerLoop, this);
+  return "";
+}
+
+void FrameCaptureWriter::stop() {
+  if (!writer_.joinable()) return;
+  running_.store(false, std::memory_order_release);
+  writer_.join();  /* Drains the queue before exiting. */
+
+  uint32_t truncated = truncated_.load(std::memory_order_relaxed) ? 1 : 0;
+  writeRecord(CaptureRecordKind::kEnd, nextIndex_, &truncated, sizeof(truncated));
+  syncFile(file_);
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+void FrameCaptureWriter::beginFrame(const ChainParams& p, CaptureEntry entry,
+                                    const float* input) {
+  if (!queue_ || truncated_.load(std::memory_order_relaxed)) return;
+  pending_.index = nextIndex_;
+  pending_.params = p;
+  pending_.entry = entry;
+  std::memcpy(pending_.input, input, sizeof(pending_.input));
+}
+
+void FrameCaptureWriter::endFrame(const float* output, float vad) {
+  if (!queue_ || truncated_.load(std::memory_order_relaxed)) return;
+  pending_.vad = vad;
+  std::memcpy(pending_.output, output, sizeof(pending_.output));
+
+  /* A gap would make everything after it unreplayable: stop here instead. */
+  if (!queue_->push(pending_)) {
+    truncated_.store(true, std::memory_order_relaxed);
+    return;
+  }
+  nextIndex_++;
+  captured_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FrameCaptureWriter::writerLoop() {
+  lowerCurrentThreadPriority();
+
+  /* Too big for the writer's stack alongside stdio; one per writer. */
+  auto frame = std::make_unique<Frame>();
+  auto lastSync = std::chrono::steady_clock::now();
+  for (;;) {
+    bool running = running_.load(std::memory_order_acquire);
+
+    bool moved = false;
+    while (queue_->pop(*frame)) {
+      writeFrame(*frame);
+      moved = true;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastSync >= kCaptureSyncInterval) {
+      syncFile(file_);
+      lastSync = now;
+    }
+
+    if (!running) break;
+    if (!moved) std::this_thread::sleep_for(kCapturePoll);
+  }
+}
+
+void FrameCaptureWriter::writeRecord(CaptureRecordKind kind, uint64_t frameIndex,
+                                     const void* payload, uint32_t bytes) {
+  RecordHeader h{static_cast<uint32_t>(kind), bytes, frameIndex};
+  std::fwrite(&h, sizeof(h), 1, file_);
+  std::fwrite(payload, 1, bytes, file_);
+}
+
+void FrameCaptureWriter::writeFrame(const Frame& f) {
+  if (!haveParams_ || !sameParams(f.params, lastParams_)) {
+    ParamsPayload p{f.params.level, f.params.vadThreshold,
+                    f.params.comfortNoise ? 1u : 0u, f.params.chainSelector};
+    writeRecord(CaptureRecordKind::kParams, f.index, &p, sizeof(p));
+    lastParams_ = f.params;
+    haveParams_ = true;
+  }
+
+  RecordHeader h{static_cast<uint32_t>(CaptureRecordKind::kFrame),
+                 static_cast<uint32_t>(2 * sizeof(uint32_t) + sizeof(f.input) +
+                                       sizeof(f.output)),
+                 f.index};
+  uint32_t entry = static_cast<uint32_t>(f.entry);
+  std::fwrite(&h, sizeof(h), 1, file_);
+  std::fwrite(&entry, sizeof(entry), 1, file_);
+  std::fwrite(&f.vad, sizeof(f.vad), 1, file_);
+  std::fwrite(f.input, sizeof(f.input), 1, file_);
+  std::fwrite(f.output, sizeof(f.output), 1, file_);
+}
+
+/* ═══ Reader ═══ */
+
+FrameCaptureReader::~FrameCaptureReader() {
+  if (file_) std::fclose(file_);
+}
+
+std::string FrameCaptureReader::open(const std::string& path) {
+  file_ = std::fopen(path.c_str(), "rb");
+  if (!file_) return "Cannot open " + path;
+
+  char magic[4];
+  uint32_t header[3];
+  if (std::fread(magic, 1, 4, file_) != 4 || std::memcmp(magic, kCaptureMagic, 4) != 0 ||
+      std::fread(header, sizeof(header), 1, file_) != 1) {
+    return "Not a NoiseGuard capture: " + path;
+  }
+  if (header[0] != kCaptureVersion) {
+    return "Unsupported capture version " + std::to_string(header[0]);
+  }
+  if (header[1] != kRNNoiseFrameSize) {
+    return "Capture frame size " + std::to_string(header[1]) + " != " +
+           std::to_string(kRNNoiseFrameSize);
+  }
+  sampleRate_ = header[2];
+  return "";
+}
+
+bool FrameCaptureReader::next(CaptureRecord& rec) {
+  for (;;) {
+    RecordHeader h;
+    if (std::fread(&h, sizeof(h), 1, file_) != 1) return false;  /* Clean EOF */
+
+    rec.kind = static_cast<CaptureRecordKind>(h.kind);
+    rec.frameIndex = h.frameIndex;
+    bool ok = true;
+    switch (rec.kind) {
+      case CaptureRecordKind::kParams: {
+        ParamsPayload p;
+        ok = h.payloadBytes == sizeof(p) && std::fread(&p, sizeof(p), 1, file_) == 1;
+        rec.params.level = p.level;
+        rec.params.vadThreshold = p.vadThreshold;
+        rec.params.comfortNoise = p.comfortNoise != 0;
+        rec.params.chainSelector = p.chainSelector;
+        break;
+      }
+      case CaptureRecordKind::kFrame: {
+        uint32_t entry = 0;
+        ok = h.payloadBytes == 2 * sizeof(uint32_t) + sizeof(rec.input) + sizeof(rec.output) &&
+             std::fread(&entry, sizeof(entry), 1, file_) == 1 &&
+             std::fread(&rec.vad, sizeof(rec.vad), 1, file_) == 1 &&
+             std::fread(rec.input, sizeof(rec.input), 1, file_) == 1 &&
+             std::fread(rec.output, sizeof(rec.output), 1, file_) == 1;
+        rec.entry = static_cast<CaptureEntry>(entry);
+        break;
+      }
+      case CaptureRecordKind::kEnd: {
+        uint32_t truncated = 0;
+        ok = h.payloadBytes == sizeof(truncated) &&
+             std::fread(&truncated, sizeof(truncated), 1, file_) == 1;
+        rec.truncated = truncated != 0;
+        break;
+      }
+      default:
+        /* Unknown kind from a newer writer: skip its payload. */
+        ok = std::fseek(file_, static_cast<long>(h.payloadBytes), SEEK_CUR) == 0;
+        if (ok) continue;
+        break;
+    }
+    if (!ok) {
+      error_ = "Damaged record at frame " + std::to_string(h.frameIndex);
+      return false;
+    }
+    return true;
+  }
+}
+
+}  // namespace noiseguard
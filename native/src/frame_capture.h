@@ -0,0 +1,164 @@
+/**
+ * Frame capture -- deterministic record of what RNNoiseWrapper processed,
+ * for replaying field issues bit-exactly through any build (tools/ng_replay).
+ *
+ * For every frame the capture stores the input exactly as it entered
+ * processFrame()/processFrameScaled(), which entry point was used, the
+ * output and VAD, and the parameters that frame ran with (see ChainParams:
+ * loaded once per frame, so recorded values are the ones actually used).
+ * Started right after RNNoiseWrapper::init(), a replay from a freshly
+ * initialized wrapper reproduces the output bit for bit on the same build.
+ *
+ * FILE FORMAT (little-endian, version 1):
+ *
+ *   header   "NGCP"  u32 version  u32 frameSize  u32 sampleRate
+ *   records  u32 kind  u32 payloadBytes  u64 frameIndex  payload
+ *     kParams  f32 level  f32 vadThreshold  u32 comfortNoise  u32 chainSelector
+ *              -- applies from frameIndex on; written before frame 0 and
+ *                 whenever a parameter changes
+ *     kFrame   u32 entry (0 = normalized, 1 = int16-range)  f32 vad
+ *              f32 input[frameSize]  f32 output[frameSize]
+ *     kEnd     u32 truncated  -- written on a clean stop
+ *
+ * Readers skip record kinds they do not know.
+ *
+ * THREADING (writer): start()/stop() from one control thread;
+ * beginFrame()/endFrame() from the processing thread, REAL-TIME SAFE --
+ * frames go through a lock-free queue to a low-priority writer thread. If
+ * the writer falls behind, capturing stops at that frame (the file stays a
+ * valid, replayable prefix) and the capture is marked truncated.
+ */
+
+#ifndef NOISEGUARD_FRAME_CAPTURE_H
+#define NOISEGUARD_FRAME_CAPTURE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "command_queue.h"
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+/** Which wrapper entry point a frame went through. */
+enum class CaptureEntry : uint32_t {
+  kNormalized = 0,  /* processFrame(): [-1, 1] */
+  kScaled = 1,      /* processFrameScaled(): int16 range */
+};
+
+enum class CaptureRecordKind : uint32_t {
+  kParams = 1,
+  kFrame = 2,
+  kEnd = 3,
+};
+
+static constexpr uint32_t kCaptureVersion = 1;
+
+/** One decoded record (reader side). */
+struct CaptureRecord {
+  CaptureRecordKind kind = CaptureRecordKind::kEnd;
+  uint64_t frameIndex = 0;
+  ChainParams params;                   /* kParams */
+  CaptureEntry entry = CaptureEntry::kNormalized;  /* kFrame */
+  float vad = 0.0f;                     /* kFrame */
+  float input[kRNNoiseFrameSize];       /* kFrame */
+  float output[kRNNoiseFrameSize];      /* kFrame */
+  bool truncated = false;               /* kEnd */
+};
+
+class FrameCaptureWriter {
+ public:
+  FrameCaptureWriter() = default;
+  ~FrameCaptureWriter();
+
+  FrameCaptureWriter(const FrameCaptureWriter&) = delete;
+  FrameCaptureWriter& operator=(const FrameCaptureWriter&) = delete;
+
+  /** Create the file and start the writer. Empty string on success, or an error. */
+  std::string start(const std::string& path);
+
+  /**
+   * Write out queued frames, append kEnd and close. The producer must no
+   * longer call beginFrame()/endFrame(). Idempotent.
+   */
+  void stop();
+
+  /** Producer: a frame is about to be processed with p. */
+  void beginFrame(const ChainParams& p, CaptureEntry entry, const float* input);
+
+  /** Producer: the same frame after processing. */
+  void endFrame(const float* output, float vad);
+
+  /** Frames handed to the writer so far. */
+  uint64_t framesCaptured() const { return captured_.load(std::memory_order_relaxed); }
+
+  /** True once a frame was lost (the file ends before it). */
+  bool truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Frame {
+    uint64_t index;
+    ChainParams params;
+    CaptureEntry entry;
+    float vad;
+    float input[kRNNoiseFrameSize];
+    float output[kRNNoiseFrameSize];
+  };
+
+  /* ~1 MB: 2.5 s of frames the writer may lag behind. */
+  static constexpr size_t kQueueFrames = 256;
+
+  void writerLoop();
+  void writeRecord(CaptureRecordKind kind, uint64_t frameIndex,
+                   const void* payload, uint32_t bytes);
+  void writeFrame(const Frame& f);
+
+  /* Producer-only: the frame between beginFrame() and endFrame(). */
+  Frame pending_;
+  uint64_t nextIndex_ = 0;
+
+  std::unique_ptr<CommandQueue<Frame, kQueueFrames>> queue_;
+  std::atomic<uint64_t> captured_{0};
+  std::atomic<bool> truncated_{false};
+
+  /* Writer thread. */
+  FILE* file_ = nullptr;
+  bool haveParams_ = false;
+  ChainParams lastParams_;
+  std::thread writer_;
+  std::atomic<bool> running_{false};
+};
+
+class FrameCaptureReader {
+ public:
+  FrameCaptureReader() = default;
+  ~FrameCaptureReader();
+
+  FrameCaptureReader(const FrameCaptureReader&) = delete;
+  FrameCaptureReader& operator=(const FrameCaptureReader&) = delete;
+
+  /** Open and validate the header. Empty string on success, or an error. */
+  std::string open(const std::string& path);
+
+  /**
+   * Read the next known record. Returns false at end of file; error()
+   * tells a clean end from a damaged file.
+   */
+  bool next(CaptureRecord& rec);
+
+  const std::string& error() const { return error_; }
+  uint32_t sampleRate() const { return sampleRate_; }
+
+ private:
+  FILE* file_ = nullptr;
+  uint32_t sampleRate_ = 0;
+  std::string error_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_FRAME_CAPTURE_H
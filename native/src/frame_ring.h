@@ -0,0 +1,66 @@
+/**
+ * Frame-granular rings: whole RNNoise frames with their timing metadata.
+ *
+ * The live engine moves audio in 480-sample frames, but a plain sample ring
+ * forgets where each frame came from. An AudioFrame keeps the samples
+ * together with the moment its first sample was captured, a sequence
+ * number and flags, so that the stages downstream (processing, output) can
+ * account for latency end to end:
+ *
+ *   capture callback --fills AudioFrame slots in place--> FrameRing<N>
+ *       --readSlot()--> processing (in place) --> FrameBroadcast
+ *       --> one Reader per consumer (output callback, recorder, meters)
+ *
+ * Timestamps are seconds on frameClockSeconds(), one steady clock for all
+ * threads. Device callbacks translate PortAudio's per-stream ADC / DAC
+ * times onto it (see audio.cpp), so times from different streams compare.
+ *
+ * THREADING: as FixedRing (ringbuffer.h) -- one producer, one consumer --
+ * and BroadcastRing (broadcast_ring.h) -- one producer, a Reader per consumer.
+ * frameClockSeconds() is a vDSO clock read on the usual platforms: no lock,
+ * no allocation, safe in callbacks.
+ */
+
+#ifndef NOISEGUARD_FRAME_RING_H
+#define NOISEGUARD_FRAME_RING_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "broadcast_ring.h"
+#include "ringbuffer.h"
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+/* AudioFrame::flags bits. */
+static constexpr uint32_t kFrameGap = 1;   /* Samples were dropped just before this frame */
+static constexpr uint32_t kFrameXrun = 2;  /* The device reported an xrun while capturing it */
+
+struct AudioFrame {
+  float samples[kRNNoiseFrameSize];
+  double captureTime = 0.0;  /* frameClockSeconds() when samples[0] was captured */
+  uint64_t sequence = 0;     /* Frames captured before this one (never resets) */
+  uint32_t flags = 0;        /* kFrame* bits */
+};
+
+template <size_t Frames>
+using FrameRing = FixedRing<AudioFrame, Frames>;
+
+/*
+ * Processed-frame fan-out: 256 frames = 2.56 s, the history a recorder may
+ * need through a slow disk. Readers that want low latency cap their lag.
+ */
+static constexpr size_t kBroadcastFrames = 256;
+using FrameBroadcast = BroadcastRing<AudioFrame, kBroadcastFrames>;
+
+/** Steady clock in seconds, the time base of AudioFrame::captureTime. */
+inline double frameClockSeconds() {
+  return std::chrono::duration<double>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_FRAME_RING_H
@@ -0,0 +1,491 @@
+/**
+ * HostSession implementation.
+ *
+ * Lifecycle:
+ *   acquire() [first ref] -> start watcher -> watcher: Pa_Initialize + scan,
+ *                            register the platform hotplug notification
+ *                         -> acquire() returns once the first scan is cached
+ *   watcher loop          -> on refresh() / hotplug: re-initialize + scan if
+ *                            no stream is open, notify on change
+ *   release() [last ref]  -> stop watcher -> watcher: unregister, Pa_Terminate
+ */
+
+#include "host_session.h"
+
+#include <chrono>
+
+#include "portaudio.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <mmdeviceapi.h>
+#elif defined(__APPLE__)
+#include <CoreAudio/CoreAudio.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace noiseguard {
+
+/*
+ * How long the watcher lets a hotplug settle before re-scanning. One plug
+ * raises a burst of notifications (several ALSA nodes, endpoint state
+ * changes per role); they and any refresh() in the window cost one re-scan.
+ */
+static constexpr auto kHotplugSettle = std::chrono::milliseconds(300);
+
+/* ───────────────────── Singleton ───────────────────── */
+
+HostSession& HostSession::instance() {
+  static HostSession session;
+  return session;
+}
+
+HostSession::HostSession() = default;
+
+HostSession::~HostSession() {
+  /* Normally the last release() already stopped the watcher. */
+  {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    watchStop_ = true;
+  }
+  watchCv_.notify_all();
+  if (watcher_.joinable()) watcher_.join();
+}
+
+/* ───────────────────── Reference Counting ───────────────────── */
+
+std::string HostSession::acquire() {
+  std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+  if (refs_++ > 0) return "";
+
+  {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    watchStop_ = false;
+    refreshRequested_ = false;
+    startupDone_ = false;
+    startupError_.clear();
+  }
+  watcher_ = std::thread(&HostSession::watchLoop, this);
+
+  /* Wait for the watcher's Pa_Initialize + first scan. */
+  std::string err;
+  {
+    std::unique_lock<std::mutex> lock(watchMutex_);
+    watchCv_.wait(lock, [this] { return startupDone_; });
+    err = startupError_;
+  }
+
+  if (!err.empty()) {
+    watcher_.join();  /* Watcher exits on its own after a failed init. */
+    refs_ = 0;
+  }
+  return err;
+}
+
+void HostSession::release() {
+  std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+  if (refs_ == 0 || --refs_ > 0) return;
+
+  {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    watchStop_ = true;
+  }
+  watchCv_.notify_all();
+  if (watcher_.joinable()) watcher_.join();
+}
+
+/* ───────────────────── Stream Holders ───────────────────── */
+
+void HostSession::retainStreams() {
+  std::lock_guard<std::mutex> lock(apiMutex_);
+  streamHolders_++;
+}
+
+void HostSession::releaseStreams() {
+  bool rescan = false;
+  {
+    std::lock_guard<std::mutex> lock(apiMutex_);
+    if (streamHolders_ > 0) streamHolders_--;
+    if (streamHolders_ == 0 && rescanDeferred_) {
+      rescanDeferred_ = false;
+      rescan = true;
+    }
+  }
+  /* A hotplug arrived while streaming: pick it up now. */
+  if (rescan) refresh();
+}
+
+/* ───────────────────── Device Cache ───────────────────── */
+
+std::vector<DeviceInfo> HostSession::devices() {
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (cacheValid_) return devices_;
+  }
+
+  /* No session held: one-shot scan (slow path, same cost as before). */
+  std::lock_guard<std::mutex> lock(apiMutex_);
+  std::vector<DeviceInfo> result;
+  if (Pa_Initialize() != paNoError) return result;
+  result = enumerateLocked();
+  Pa_Terminate();
+  return result;
+}
+
+void HostSession::refresh() {
+  {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    refreshRequested_ = true;
+  }
+  watchCv_.notify_all();
+}
+
+int HostSession::findDevice(const std::string& id) {
+  std::lock_guard<std::mutex> lock(apiMutex_);
+  if (!initialized_) return -1;
+  for (const DeviceInfo& d : enumerateLocked()) {
+    if (d.id == id) return d.index;
+  }
+  return -1;
+}
+
+std::string HostSession::deviceId(int index) {
+  std::lock_guard<std::mutex> lock(apiMutex_);
+  if (!initialized_) return "";
+  for (const DeviceInfo& d : enumerateLocked()) {
+    if (d.index == index) return d.id;
+  }
+  return "";
+}
+
+void HostSession::setDeviceChangeCallback(DeviceChangeCallback cb) {
+  std::lock_guard<std::mutex> lock(cacheMutex_);
+  changeCallback_ = std::move(cb);
+}
+
+std::vector<DeviceInfo> HostSession::enumerateLocked() {
+  std::vector<DeviceInfo> devices;
+
+  int numDevices = Pa_GetDeviceCount();
+  for (int i = 0; i < numDevices; i++) {
+    const PaDeviceInfo* info = Pa_GetDeviceInfo(i);
+    if (!info) continue;
+
+    const PaHostApiInfo* api = Pa_GetHostApiInfo(info->hostApi);
+
+    DeviceInfo d;
+    d.index = i;
+    d.name = info->name ? info->name : "(unknown)";
+    d.hostApi = (api && api->name) ? api->name : "";
+    d.maxInputChannels = info->maxInputChannels;
+    d.maxOutputChannels = info->maxOutputChannels;
+    d.defaultSampleRate = info->defaultSampleRate;
+
+    /* Identical devices get "#2", "#3"... The latency cache keys on this too. */
+    d.id = d.hostApi + '|' + d.name;
+    int twins = 0;
+    for (const DeviceInfo& prev : devices) {
+      if (prev.hostApi == d.hostApi && prev.name == d.name) twins++;
+    }
+    if (twins > 0) d.id += '#' + std::to_string(twins + 1);
+
+    devices.push_back(d);
+  }
+
+  return devices;
+}
+
+static bool sameDevices(const std::vector<DeviceInfo>& a,
+                        const std::vector<DeviceInfo>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].index != b[i].index || a[i].id != b[i].id ||
+        a[i].maxInputChannels != b[i].maxInputChannels ||
+        a[i].maxOutputChannels != b[i].maxOutputChannels) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* ───────────────────── Watcher Thread ───────────────────── */
+
+void HostSession::rescan(bool reinitialize) {
+  std::vector<DeviceInfo> fresh;
+  {
+    std::lock_guard<std::mutex> lock(apiMutex_);
+
+    /*
+     * Re-initializing with a stream open would invalidate it, so hotplug
+     * changes are only picked up between engine runs: releaseStreams()
+     * asks again once the last stream closes. While streaming, the
+     * supervisor's recovery path handles a vanished device.
+     */
+    if (reinitialize) {
+      if (streamHolders_ == 0) {
+        if (initialized_) Pa_Terminate();
+        initialized_ = (Pa_Initialize() == paNoError);
+      } else {
+        rescanDeferred_ = true;
+      }
+    }
+    if (!initialized_) return;
+    fresh = enumerateLocked();
+  }
+
+  DeviceChangeCallback notify;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    bool changed = cacheValid_ && !sameDevices(devices_, fresh);
+    devices_ = fresh;
+    cacheValid_ = true;
+    if (changed) notify = changeCallback_;
+  }
+
+  if (notify) notify(fresh);
+}
+
+void HostSession::watchLoop() {
+  /* ── Startup: initialize PortAudio on this thread and prime the cache ── */
+  PaError err;
+  {
+    std::lock_guard<std::mutex> lock(apiMutex_);
+    err = Pa_Initialize();
+    initialized_ = (err == paNoError);
+  }
+  if (err == paNoError) rescan(false);
+
+  {
+    std::lock_guard<std::mutex> lock(watchMutex_);
+    if (err != paNoError) {
+      startupError_ = std::string("Pa_Initialize failed: ") + Pa_GetErrorText(err);
+    }
+    startupDone_ = true;
+  }
+  watchCv_.notify_all();
+  if (err != paNoError) return;
+
+  startHotplugWatch();
+
+  /* ── Re-scan on request until the last reference is released ── */
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(watchMutex_);
+      watchCv_.wait(lock, [this] { return watchStop_ || refreshRequested_; });
+      if (watchStop_) break;
+      watchCv_.wait_for(lock, kHotplugSettle, [this] { return watchStop_; });
+      if (watchStop_) break;
+      refreshRequested_ = false;
+    }
+    rescan(true);
+  }
+
+  /* ── Shutdown: terminate on the same thread that initialized ── */
+  stopHotplugWatch();
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    cacheValid_ = false;
+    devices_.clear();
+  }
+  std::lock_guard<std::mutex> lock(apiMutex_);
+  if (initialized_) Pa_Terminate();
+  initialized_ = false;
+  rescanDeferred_ = false;
+}
+
+/* ───────────────────── Hotplug Notifications ───────────────────── */
+
+/*
+ * Each platform's notification calls refresh() on a system thread; the
+ * watcher does the actual work. If registration fails (no audio service,
+ * no /dev/snd), devices are re-scanned on refresh() only.
+ */
+
+#if defined(_WIN32)
+
+namespace {
+
+/* Forwards endpoint arrivals / removals / state changes to refresh(). */
+class EndpointListener final : public IMMNotificationClient {
+ public:
+  explicit EndpointListener(HostSession* session) : session_(session) {}
+
+  ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&refs_); }
+  ULONG STDMETHODCALLTYPE Release() override {
+    ULONG refs = InterlockedDecrement(&refs_);
+    if (refs == 0) delete this;
+    return refs;
+  }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** out) override {
+    if (iid == __uuidof(IUnknown) || iid == __uuidof(IMMNotificationClient)) {
+      *out = static_cast<IMMNotificationClient*>(this);
+      AddRef();
+      return S_OK;
+    }
+    *out = nullptr;
+    return E_NOINTERFACE;
+  }
+
+  HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR) override {
+    session_->refresh();
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR) override {
+    session_->refresh();
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR, DWORD) override {
+    session_->refresh();
+    return S_OK;
+  }
+  /* The list does not change; -1 already follows the default device. */
+  HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow, ERole, LPCWSTR) override {
+    return S_OK;
+  }
+  HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) override {
+    return S_OK;
+  }
+
+ private:
+  LONG refs_ = 1;
+  HostSession* session_;
+};
+
+}  // namespace
+
+struct HostSession::HotplugWatch {
+  bool comInitialized = false;
+  IMMDeviceEnumerator* enumerator = nullptr;
+  EndpointListener* listener = nullptr;
+};
+
+void HostSession::startHotplugWatch() {
+  auto watch = std::make_unique<HotplugWatch>();
+  /*
+   * Our own COM reference on this thread, so the apartment outlives
+   * PortAudio's Pa_Terminate/Pa_Initialize cycles during re-scans.
+   */
+  HRESULT hr = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  watch->comInitialized = SUCCEEDED(hr);
+
+  hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                        __uuidof(IMMDeviceEnumerator),
+                        reinterpret_cast<void**>(&watch->enumerator));
+  if (SUCCEEDED(hr)) {
+    watch->listener = new EndpointListener(this);
+    hr = watch->enumerator->RegisterEndpointNotificationCallback(watch->listener);
+    if (FAILED(hr)) {
+      watch->listener->Release();
+      watch->listener = nullptr;
+    }
+  }
+  hotplug_ = std::move(watch);
+}
+
+void HostSession::stopHotplugWatch() {
+  if (!hotplug_) return;
+  if (hotplug_->listener) {
+    hotplug_->enumerator->UnregisterEndpointNotificationCallback(hotplug_->listener);
+    hotplug_->listener->Release();
+  }
+  if (hotplug_->enumerator) hotplug_->enumerator->Release();
+  if (hotplug_->comInitialized) CoUninitialize();
+  hotplug_.reset();
+}
+
+#elif defined(__APPLE__)
+
+namespace {
+
+const AudioObjectPropertyAddress kDeviceListAddress = {
+    kAudioHardwarePropertyDevices, kAudioObjectPropertyScopeGlobal,
+    0 /* main element */};
+
+OSStatus onDeviceListChanged(AudioObjectID, UInt32, const AudioObjectPropertyAddress*,
+                             void* ctx) {
+  static_cast<HostSession*>(ctx)->refresh();
+  return noErr;
+}
+
+}  // namespace
+
+struct HostSession::HotplugWatch {};
+
+void HostSession::startHotplugWatch() {
+  if (AudioObjectAddPropertyListener(kAudioObjectSystemObject, &kDeviceListAddress,
+                                     onDeviceListChanged, this) == noErr) {
+    hotplug_ = std::make_unique<HotplugWatch>();
+  }
+}
+
+void HostSession::stopHotplugWatch() {
+  if (!hotplug_) return;
+  AudioObjectRemovePropertyListener(kAudioObjectSystemObject, &kDeviceListAddress,
+                                    onDeviceListChanged, this);
+  hotplug_.reset();
+}
+
+#elif defined(__linux__)
+
+/*
+ * ALSA creates and removes a card's nodes under /dev/snd as it comes and
+ * goes. A small thread waits on inotify for that, plus an eventfd to stop.
+ */
+struct HostSession::HotplugWatch {
+  int inotifyFd = -1;
+  int stopFd = -1;
+  std::thread thread;
+};
+
+void HostSession::startHotplugWatch() {
+  auto watch = std::make_unique<HotplugWatch>();
+  watch->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watch->inotifyFd < 0) return;
+  if (inotify_add_watch(watch->inotifyFd, "/dev/snd", IN_CREATE | IN_DELETE) < 0) {
+    close(watch->inotifyFd);
+    return;
+  }
+  watch->stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (watch->stopFd < 0) {
+    close(watch->inotifyFd);
+    return;
+  }
+
+  HotplugWatch* w = watch.get();
+  w->thread = std::thread([this, w] {
+    pollfd fds[2] = {{w->inotifyFd, POLLIN, 0}, {w->stopFd, POLLIN, 0}};
+    alignas(inotify_event) char events[4096];
+    for (;;) {
+      if (poll(fds, 2, -1) < 0) continue;  /* EINTR */
+      if (fds[1].revents) return;
+      while (read(w->inotifyFd, events, sizeof(events)) > 0) {}
+      refresh();
+    }
+  });
+  hotplug_ = std::move(watch);
+}
+
+void HostSession::stopHotplugWatch() {
+  if (!hotplug_) return;
+  const uint64_t one = 1;
+  [[maybe_unused]] ssize_t n = write(hotplug_->stopFd, &one, sizeof(one));
+  hotplug_->thread.join();
+  close(hotplug_->inotifyFd);
+  close(hotplug_->stopFd);
+  hotplug_.reset();
+}
+
+#else
+
+struct HostSession::HotplugWatch {};
+
+void HostSession::startHotplugWatch() {}
+void HostSession::stopHotplugWatch() {}
+
+#endif
+
+}  // namespace noiseguard
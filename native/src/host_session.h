@@ -0,0 +1,166 @@
+/**
+ * HostSession -- process-wide, reference-counted PortAudio session.
+ *
+ * PortAudio's Pa_Initialize/Pa_Terminate are expensive (hundreds of ms on
+ * Linux/ALSA, host API re-enumeration on Windows) and calling them while a
+ * stream is open can disturb it. This class keeps PortAudio initialized for
+ * as long as anyone holds a reference, caches the device list, and refreshes
+ * it in the background so getDevices() and start() never pay for it.
+ *
+ * Hotplug:
+ *   PortAudio only re-scans devices on (re)initialization, so the watcher
+ *   thread re-initializes it -- but only when asked: by refresh(), or by the
+ *   platform's device-change notification (IMMNotificationClient on Windows,
+ *   the CoreAudio device-list listener on macOS, inotify on /dev/snd on
+ *   Linux), and ONLY while no stream is open (see retainStreams()); a change
+ *   seen while streaming is re-scanned once the last stream closes. An idle
+ *   session therefore never cycles PortAudio. When the list differs from the
+ *   cache, the registered DeviceChangeCallback is invoked with the new list.
+ *
+ * Device identity:
+ *   PortAudio indices are only valid until the next re-initialization, and a
+ *   hotplug shifts them. DeviceInfo::id (host API + name) is what callers
+ *   should remember; findDevice() maps it back to the current index.
+ *
+ * THREADING:
+ * - All methods are thread-safe. None of them are real-time safe.
+ * - Pa_Initialize/Pa_Terminate always run on the watcher thread, so they are
+ *   paired on one thread (WASAPI ties COM initialization to that thread). The
+ *   platform notification is registered and unregistered there too.
+ * - devices() only touches the cache and never calls into PortAudio.
+ * - The DeviceChangeCallback runs on the watcher thread.
+ */
+
+#ifndef NOISEGUARD_HOST_SESSION_H
+#define NOISEGUARD_HOST_SESSION_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace noiseguard {
+
+/** Audio device info exposed to JavaScript. */
+struct DeviceInfo {
+  int index;       /* PortAudio index, valid until the next re-scan */
+  std::string id;  /* Stable: "<host API>|<name>", "#2".. on duplicates */
+  std::string name;
+  std::string hostApi;
+  int maxInputChannels;
+  int maxOutputChannels;
+  double defaultSampleRate;
+};
+
+/** Invoked on the watcher thread when the device list changes. */
+using DeviceChangeCallback =
+    std::function<void(const std::vector<DeviceInfo>& devices)>;
+
+class HostSession {
+ public:
+  /** The single process-wide session. */
+  static HostSession& instance();
+
+  HostSession(const HostSession&) = delete;
+  HostSession& operator=(const HostSession&) = delete;
+
+  /**
+   * Take a reference. The first reference initializes PortAudio, fills the
+   * device cache and starts the watcher thread.
+   * Returns empty string on success, or an error message.
+   */
+  std::string acquire();
+
+  /** Drop a reference. The last one stops the watcher and terminates PortAudio. */
+  void release();
+
+  /**
+   * Cached device list. Never calls into PortAudio while a session is held.
+   * Without a session, falls back to a one-shot initialize/enumerate/terminate.
+   */
+  std::vector<DeviceInfo> devices();
+
+  /**
+   * Current PortAudio index of the device with DeviceInfo::id id, or -1 if
+   * it is not present. Enumerates live (not the cache), so the index is
+   * good for as long as the caller holds retainStreams().
+   */
+  int findDevice(const std::string& id);
+
+  /**
+   * DeviceInfo::id of the device at PortAudio index index, or "" if there
+   * is none. The inverse of findDevice(), with the same live enumeration.
+   */
+  std::string deviceId(int index);
+
+  /**
+   * Ask the watcher to re-scan devices (re-initializing PortAudio if no
+   * stream is open). Asynchronous and coalesced with other requests and
+   * hotplug events: the change callback fires if the list differs.
+   */
+  void refresh();
+
+  /** Register (or clear, with nullptr) the device-change listener. */
+  void setDeviceChangeCallback(DeviceChangeCallback cb);
+
+  /**
+   * Bracket the lifetime of open streams. While at least one holder is
+   * active, PortAudio is never re-initialized underneath it. retainStreams()
+   * waits for an in-progress background refresh to finish.
+   */
+  void retainStreams();
+  void releaseStreams();
+
+ private:
+  /* Platform device-change notification (host_session.cpp). */
+  struct HotplugWatch;
+
+  HostSession();
+  ~HostSession();
+
+  /** Watcher thread entry point. Owns Pa_Initialize/Pa_Terminate. */
+  void watchLoop();
+
+  /** Re-scan (optionally re-initializing PortAudio) and notify. Holds apiMutex_. */
+  void rescan(bool reinitialize);
+
+  /** Register / unregister the platform notification. Watcher thread only. */
+  void startHotplugWatch();
+  void stopHotplugWatch();
+
+  /** Read the current PortAudio device list. Caller holds apiMutex_. */
+  static std::vector<DeviceInfo> enumerateLocked();
+
+  /* Serializes acquire()/release() (reference count + watcher start/stop). */
+  std::mutex lifecycleMutex_;
+  int refs_ = 0;
+
+  /* Serializes PortAudio (re)initialization against open streams. */
+  std::mutex apiMutex_;
+  bool initialized_ = false;
+  int streamHolders_ = 0;
+  bool rescanDeferred_ = false;  /* Re-scan skipped for open streams */
+
+  /* Device cache (separate lock so devices() never waits on PortAudio). */
+  std::mutex cacheMutex_;
+  bool cacheValid_ = false;
+  std::vector<DeviceInfo> devices_;
+  DeviceChangeCallback changeCallback_;
+
+  /* Watcher thread + its wakeup / startup handshake. */
+  std::thread watcher_;
+  std::mutex watchMutex_;
+  std::condition_variable watchCv_;
+  bool watchStop_ = false;
+  bool refreshRequested_ = false;
+  bool startupDone_ = false;
+  std::string startupError_;
+  std::unique_ptr<HotplugWatch> hotplug_;  /* Watcher thread only */
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_HOST_SESSION_H
@@ -0,0 +1,102 @@
+/**
+ * Small platform helpers for the background file writers (TapRecorder,
+ * FrameCaptureWriter) and the task executor's file I/O. Not for real-time
+ * threads.
+ */
+
+#ifndef NOISEGUARD_IO_UTIL_H
+#define NOISEGUARD_IO_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace noiseguard {
+
+/** Push a stdio stream's data all the way to the device. */
+inline void syncFile(FILE* f) {
+  std::fflush(f);
+#ifdef _WIN32
+  _commit(_fileno(f));
+#else
+  fsync(fileno(f));
+#endif
+}
+
+/** Run the calling (writer) thread below normal priority. Best effort. */
+inline void lowerCurrentThreadPriority() {
+#ifdef _WIN32
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__linux__)
+  /* On Linux, nice values are per thread; who = 0 is the calling thread. */
+  setpriority(PRIO_PROCESS, 0, 10);
+#endif
+}
+
+/**
+ * Read up to bytes at offset through f's descriptor, bypassing (and not
+ * moving) the stdio position, so several threads may read one file at
+ * once. Returns the bytes read (short only at end of file), or -1.
+ */
+inline int64_t readAt(FILE* f, void* data, size_t bytes, uint64_t offset) {
+  size_t done = 0;
+  while (done < bytes) {
+    char* p = static_cast<char*>(data) + done;
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(offset + done);
+    ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+    DWORD got = 0;
+    DWORD want = static_cast<DWORD>(bytes - done < 0x40000000u ? bytes - done : 0x40000000u);
+    HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+    if (!ReadFile(h, p, want, &got, &ov)) {
+      if (GetLastError() == ERROR_HANDLE_EOF) break;
+      return -1;
+    }
+#else
+    ssize_t got = pread(fileno(f), p, bytes - done, static_cast<off_t>(offset + done));
+    if (got < 0) return -1;
+#endif
+    if (got == 0) break;
+    done += static_cast<size_t>(got);
+  }
+  return static_cast<int64_t>(done);
+}
+
+/** Write bytes at offset through f's descriptor (see readAt()). Returns bytes or -1. */
+inline int64_t writeAt(FILE* f, const void* data, size_t bytes, uint64_t offset) {
+  size_t done = 0;
+  while (done < bytes) {
+    const char* p = static_cast<const char*>(data) + done;
+#ifdef _WIN32
+    OVERLAPPED ov = {};
+    ov.Offset = static_cast<DWORD>(offset + done);
+    ov.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+    DWORD put = 0;
+    DWORD want = static_cast<DWORD>(bytes - done < 0x40000000u ? bytes - done : 0x40000000u);
+    HANDLE h = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+    if (!WriteFile(h, p, want, &put, &ov)) return -1;
+#else
+    ssize_t put = pwrite(fileno(f), p, bytes - done, static_cast<off_t>(offset + done));
+    if (put < 0) return -1;
+#endif
+    if (put == 0) return -1;
+    done += static_cast<size_t>(put);
+  }
+  return static_cast<int64_t>(done);
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_IO_UTIL_H
@@ -0,0 +1,321 @@
+/**
+ * LatencyTuner implementation.
+ *
+ * Search strategy (per device + direction):
+ *   for framesPerBuffer in kCandidateFrames (largest first):
+ *     for latencyFactor in kLatencyFactors (largest first):
+ *       probe for kProbeMs; stop lowering latency at the first failure
+ *     stop lowering the buffer size once no latency works at this size
+ *   best = stable probe with the lowest effective latency
+ *
+ * A probe is stable when, after a short warm-up, it produced no xrun flags,
+ * delivered (almost) all expected callbacks, and the 99th percentile
+ * callback interval stayed within kJitterBudgetMs of the nominal period.
+ */
+
+#include "latency_tuner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "audio.h"
+#include "host_session.h"
+#include "pa_util.h"
+
+namespace noiseguard {
+
+/* Candidate callback sizes, largest (safest) first. 480 = engine default. */
+static constexpr unsigned long kCandidateFrames[] = {480, 256, 128, 64};
+
+/* Suggested latency as a fraction of the device's defaultLow latency. */
+static constexpr double kLatencyFactors[] = {1.0, 0.5, 0.25};
+
+/* Probe duration and the initial period whose glitches are ignored. */
+static constexpr int kProbeMs = 1500;
+static constexpr int kWarmupMs = 250;
+
+/* Allowed 99th-percentile lateness of a callback beyond its nominal period. */
+static constexpr double kJitterBudgetMs = 4.0;
+
+/* Minimum fraction of expected callbacks that must actually arrive. */
+static constexpr double kMinCallbackRatio = 0.85;
+
+/* ───────────────────── Cache ───────────────────── */
+
+namespace {
+
+std::mutex g_cacheMutex;
+std::map<std::string, LatencyProfile> g_cache;
+std::string g_cachePath;
+
+/* Caller holds g_cacheMutex. */
+void saveCacheLocked() {
+  if (g_cachePath.empty()) return;
+  std::ofstream out(g_cachePath, std::ios::trunc);
+  if (!out) return;
+  for (const auto& kv : g_cache) {
+    out << kv.first << '\t' << kv.second.framesPerBuffer << '\t'
+        << kv.second.suggestedLatency << '\t' << kv.second.streamLatency << '\n';
+  }
+}
+
+}  // namespace
+
+std::string LatencyTuner::setCacheFile(const std::string& path) {
+  std::lock_guard<std::mutex> lock(g_cacheMutex);
+  g_cachePath = path;
+
+  std::ifstream in(path);
+  if (!in) return "";  /* No cache yet: created on first store(). */
+
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t t1 = line.find('\t');
+    if (t1 == std::string::npos) continue;
+    std::istringstream fields(line.substr(t1 + 1));
+    LatencyProfile p;
+    if (fields >> p.framesPerBuffer >> p.suggestedLatency >> p.streamLatency &&
+        p.framesPerBuffer > 0) {
+      g_cache[line.substr(0, t1)] = p;
+    }
+  }
+  return "";
+}
+
+bool LatencyTuner::lookup(const std::string& key, LatencyProfile& out) {
+  std::lock_guard<std::mutex> lock(g_cacheMutex);
+  auto it = g_cache.find(key);
+  if (it == g_cache.end()) return false;
+  out = it->second;
+  return true;
+}
+
+void LatencyTuner::store(const std::string& key, const LatencyProfile& profile) {
+  std::lock_guard<std::mutex> lock(g_cacheMutex);
+  g_cache[key] = profile;
+  saveCacheLocked();
+}
+
+std::string LatencyTuner::deviceKey(int deviceIndex, bool input) {
+  std::string id = HostSession::instance().deviceId(deviceIndex);
+  if (id.empty()) return "";
+  return (input ? "in|" : "out|") + id;
+}
+
+void LatencyTuner::applyCached(AudioConfig& config) {
+  LatencyProfile p;
+
+  int inputIdx = config.inputDeviceIndex;
+  if (inputIdx < 0) inputIdx = Pa_GetDefaultInputDevice();
+  if (inputIdx >= 0 && lookup(deviceKey(inputIdx, true), p)) {
+    config.framesPerBuffer = p.framesPerBuffer;
+    config.inputLatency = p.suggestedLatency;
+  }
+
+  if (config.outputDeviceIndex == -2) return;  /* Output disabled. */
+  int outputIdx = config.outputDeviceIndex;
+  if (outputIdx < 0) outputIdx = Pa_GetDefaultOutputDevice();
+  if (outputIdx >= 0 && lookup(deviceKey(outputIdx, false), p)) {
+    config.outputFramesPerBuffer = p.framesPerBuffer;
+    config.outputLatency = p.suggestedLatency;
+  }
+}
+
+/* ───────────────────── Probing ───────────────────── */
+
+namespace {
+
+/*
+ * Probe callback state. Written only by the PortAudio callback thread while
+ * the stream runs; read by the tuner after Pa_StopStream() has returned.
+ * The interval buffer is sized before the stream starts (no allocations in
+ * the callback).
+ */
+struct ProbeState {
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point last;
+  bool haveLast = false;
+  uint32_t callbacks = 0;
+  uint32_t xruns = 0;
+  std::vector<float> intervalsMs;
+  size_t intervalCount = 0;
+};
+
+int probeCallback(const void* /*input*/, void* output, unsigned long frameCount,
+                  const PaStreamCallbackTimeInfo* /*timeInfo*/,
+                  PaStreamCallbackFlags statusFlags, void* userData) {
+  auto* st = static_cast<ProbeState*>(userData);
+  if (output) memset(output, 0, frameCount * sizeof(float));
+
+  auto now = std::chrono::steady_clock::now();
+  if (now - st->start < std::chrono::milliseconds(kWarmupMs)) {
+    return paContinue;  /* Startup glitches are normal; ignore them. */
+  }
+
+  st->callbacks++;
+  if (statusFlags & (paInputUnderflow | paInputOverflow |
+                     paOutputUnderflow | paOutputOverflow)) {
+    st->xruns++;
+  }
+  if (st->haveLast && st->intervalCount < st->intervalsMs.size()) {
+    st->intervalsMs[st->intervalCount++] =
+        std::chrono::duration<float, std::milli>(now - st->last).count();
+  }
+  st->last = now;
+  st->haveLast = true;
+  return paContinue;
+}
+
+LatencyProbe runProbe(int device, bool input, double sampleRate,
+                      unsigned long frames, double suggestedLatency,
+                      bool tryExclusiveMode) {
+  LatencyProbe probe;
+  probe.framesPerBuffer = frames;
+  probe.suggestedLatency = suggestedLatency;
+  probe.nominalMs = 1000.0 * static_cast<double>(frames) / sampleRate;
+
+  PaStreamParameters params;
+  params.device = device;
+  params.channelCount = 1;
+  params.sampleFormat = paFloat32;
+  params.suggestedLatency = suggestedLatency;
+  params.hostApiSpecificStreamInfo = nullptr;
+
+#ifdef _WIN32
+  PaWasapiStreamInfo wasapiInfo;
+  if (tryExclusiveMode && hasWasapiHostApi()) {
+    fillWasapiExclusive(wasapiInfo);
+    params.hostApiSpecificStreamInfo = &wasapiInfo;
+  }
+#else
+  (void)tryExclusiveMode;
+#endif
+
+  ProbeState st;
+  double expected = (kProbeMs - kWarmupMs) / probe.nominalMs;
+  st.intervalsMs.resize(static_cast<size_t>(expected * 2.0) + 16);
+
+  PaStream* stream = nullptr;
+  PaError err = Pa_OpenStream(&stream, input ? &params : nullptr,
+                              input ? nullptr : &params, sampleRate, frames,
+                              paClipOff, probeCallback, &st);
+#ifdef _WIN32
+  if (err != paNoError && params.hostApiSpecificStreamInfo) {
+    params.hostApiSpecificStreamInfo = nullptr;
+    err = Pa_OpenStream(&stream, input ? &params : nullptr,
+                        input ? nullptr : &params, sampleRate, frames,
+                        paClipOff, probeCallback, &st);
+  }
+#endif
+  if (err != paNoError) return probe;
+  probe.opened = true;
+
+  if (const PaStreamInfo* info = Pa_GetStreamInfo(stream)) {
+    probe.streamLatency = input ? info->inputLatency : info->outputLatency;
+  }
+
+  st.start = std::chrono::steady_clock::now();
+  if (Pa_StartStream(stream) == paNoError) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kProbeMs));
+    Pa_StopStream(stream);
+  }
+  Pa_CloseStream(stream);
+
+  probe.callbacks = st.callbacks;
+  probe.xruns = st.xruns;
+  if (st.intervalCount > 0) {
+    std::vector<float> sorted(st.intervalsMs.begin(),
+                              st.intervalsMs.begin() + st.intervalCount);
+    size_t p99 = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+    std::nth_element(sorted.begin(), sorted.begin() + p99, sorted.end());
+    probe.p99IntervalMs = sorted[p99];
+  }
+
+  probe.stable = probe.xruns == 0 &&
+                 probe.callbacks >= expected * kMinCallbackRatio &&
+                 probe.p99IntervalMs <= probe.nominalMs + kJitterBudgetMs;
+  return probe;
+}
+
+/* What a listener actually experiences: host latency + one callback period. */
+double effectiveLatency(const LatencyProbe& p) {
+  return std::max(p.streamLatency, p.suggestedLatency) + p.nominalMs / 1000.0;
+}
+
+}  // namespace
+
+CalibrationReport LatencyTuner::calibrate(int deviceIndex, bool input,
+                                          double sampleRate,
+                                          bool tryExclusiveMode,
+                                          const std::string& deviceId) {
+  CalibrationReport report;
+
+  HostSession& session = HostSession::instance();
+  report.error = session.acquire();
+  if (!report.error.empty()) return report;
+  session.retainStreams();
+
+  int device = deviceId.empty() ? deviceIndex : session.findDevice(deviceId);
+  if (!deviceId.empty() && device < 0) {
+    report.error = "Device not found: " + deviceId;
+    session.releaseStreams();
+    session.release();
+    return report;
+  }
+  if (device < 0) {
+    device = input ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice();
+  }
+  const PaDeviceInfo* info = (device >= 0) ? Pa_GetDeviceInfo(device) : nullptr;
+  if (!info) {
+    report.error = input ? "No input device available" : "No output device available";
+    session.releaseStreams();
+    session.release();
+    return report;
+  }
+
+  report.deviceKey = deviceKey(device, input);
+  double defaultLatency = input ? info->defaultLowInputLatency
+                                : info->defaultLowOutputLatency;
+
+  const LatencyProbe* best = nullptr;
+  for (unsigned long frames : kCandidateFrames) {
+    bool anyStable = false;
+    for (double factor : kLatencyFactors) {
+      /* Never ask for less latency than one callback period. */
+      double suggested = std::max(defaultLatency * factor,
+                                  static_cast<double>(frames) / sampleRate);
+      report.probes.push_back(runProbe(device, input, sampleRate, frames,
+                                       suggested, tryExclusiveMode));
+      if (!report.probes.back().stable) break;
+      anyStable = true;
+    }
+    if (!anyStable) break;
+  }
+
+  for (const auto& p : report.probes) {
+    if (p.stable && (!best || effectiveLatency(p) < effectiveLatency(*best))) {
+      best = &p;
+    }
+  }
+
+  session.releaseStreams();
+  session.release();
+
+  if (!best) {
+    report.error = "No stable buffer configuration found for device";
+    return report;
+  }
+
+  report.best.framesPerBuffer = best->framesPerBuffer;
+  report.best.suggestedLatency = best->suggestedLatency;
+  report.best.streamLatency = best->streamLatency;
+  store(report.deviceKey, report.best);
+  return report;
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,100 @@
+/**
+ * LatencyTuner -- finds the lowest stable buffer size / suggested latency
+ * per audio device and caches it.
+ *
+ * AudioConfig defaults (480-frame buffers, PortAudio's defaultLow latency)
+ * are a safe one-size-fits-all choice. Many devices run glitch-free with much
+ * less. calibrate() opens the device repeatedly with decreasing settings
+ * while counting xruns and measuring callback interval jitter, and keeps
+ * the lowest setting that stayed clean.
+ *
+ * Results are cached per direction + host API + device name (device indices
+ * are not stable across hotplug), optionally persisted to a small TSV file,
+ * and applied automatically by AudioEngine::start() when
+ * AudioConfig::useCalibratedLatency is set.
+ *
+ * THREADING:
+ * - calibrate() blocks for several seconds. Call it from a worker thread and
+ *   never while an AudioEngine is using the same device.
+ * - Cache functions are thread-safe. Nothing here is real-time safe.
+ */
+
+#ifndef NOISEGUARD_LATENCY_TUNER_H
+#define NOISEGUARD_LATENCY_TUNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace noiseguard {
+
+struct AudioConfig;
+
+/** A stable setting for one device + direction. */
+struct LatencyProfile {
+  unsigned long framesPerBuffer = 0;  /* Callback size passed to Pa_OpenStream */
+  double suggestedLatency = 0.0;      /* Seconds, passed to Pa_OpenStream */
+  double streamLatency = 0.0;         /* Seconds, as reported by PortAudio */
+};
+
+/** Outcome of a single probe run. */
+struct LatencyProbe {
+  unsigned long framesPerBuffer = 0;
+  double suggestedLatency = 0.0;
+  double streamLatency = 0.0;
+  uint32_t callbacks = 0;
+  uint32_t xruns = 0;
+  double p99IntervalMs = 0.0;  /* 99th percentile callback interval */
+  double nominalMs = 0.0;      /* framesPerBuffer / sampleRate */
+  bool opened = false;
+  bool stable = false;
+};
+
+/** Full calibration result for one device + direction. */
+struct CalibrationReport {
+  std::string error;      /* Empty on success. */
+  std::string deviceKey;  /* Cache key the result was stored under. */
+  LatencyProfile best;
+  std::vector<LatencyProbe> probes;
+};
+
+class LatencyTuner {
+ public:
+  /**
+   * Probe one device (input or output) and store the best stable profile in
+   * the cache. deviceIndex -1 = default device for that direction; a
+   * non-empty deviceId (DeviceInfo::id) overrides the index.
+   */
+  static CalibrationReport calibrate(int deviceIndex, bool input,
+                                     double sampleRate, bool tryExclusiveMode,
+                                     const std::string& deviceId = "");
+
+  /**
+   * Cache key for a device: "in|<DeviceInfo::id>" or "out|...", so twin
+   * devices ("...#2") are tuned separately. Requires a HostSession held.
+   */
+  static std::string deviceKey(int deviceIndex, bool input);
+
+  /** Look up a cached profile. Returns false if the device was never tuned. */
+  static bool lookup(const std::string& key, LatencyProfile& out);
+
+  /** Store a profile (and persist it if a cache file is set). */
+  static void store(const std::string& key, const LatencyProfile& profile);
+
+  /**
+   * Use path as the persistent cache: load existing entries now, rewrite the
+   * file on every store(). Returns empty string on success, or an error.
+   */
+  static std::string setCacheFile(const std::string& path);
+
+  /**
+   * Fill config's buffer sizes / latencies from the cache for its devices.
+   * Requires PortAudio to be initialized and stable (HostSession held with
+   * streams retained). Fields for untuned devices are left unchanged.
+   */
+  static void applyCached(AudioConfig& config);
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_LATENCY_TUNER_H
@@ -0,0 +1,265 @@
+/**
+ * Offline file pipeline implementation.
+ */
+
+#include "offline_pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "resampler.h"
+
+namespace noiseguard {
+
+namespace {
+
+/* The chain's rate. */
+static constexpr uint32_t kChainRate = 48000;
+
+struct Block {
+  std::vector<float> samples;
+  bool last = false;  /* End of stream */
+};
+
+/** Blocking FIFO of block pointers with a fixed capacity (never full in use). */
+class BlockQueue {
+ public:
+  explicit BlockQueue(size_t capacity) : slots_(capacity) {}
+
+  void push(Block* block) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slots_[(head_ + count_) % slots_.size()] = block;
+      count_++;
+    }
+    cv_.notify_one();
+  }
+
+  /** Next block, or nullptr once aborted. */
+  Block* pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return count_ > 0 || aborted_; });
+    if (aborted_) return nullptr;
+    Block* block = slots_[head_];
+    head_ = (head_ + 1) % slots_.size();
+    count_--;
+    return block;
+  }
+
+  void abort() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      aborted_ = true;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<Block*> slots_;
+  size_t head_ = 0;
+  size_t count_ = 0;
+  bool aborted_ = false;
+};
+
+/** Blocks circulating between two stages: producer takes from free, consumer from full. */
+struct Link {
+  explicit Link(size_t blocks, size_t blockSamples)
+      : pool(blocks), free(blocks), full(blocks) {
+    for (Block& b : pool) {
+      b.samples.reserve(blockSamples + kRNNoiseFrameSize);
+      free.push(&b);
+    }
+  }
+
+  std::vector<Block> pool;
+  BlockQueue free;
+  BlockQueue full;
+};
+
+struct Pipeline {
+  Pipeline(size_t blocks, size_t blockSamples)
+      : decoded(blocks, blockSamples), denoised(blocks, blockSamples) {}
+
+  Link decoded;   /* decode -> DSP */
+  Link denoised;  /* DSP -> encode */
+
+  std::mutex mutex;
+  std::string error;
+
+  void fail(const std::string& message) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error.empty()) error = message;
+    }
+    for (Link* link : {&decoded, &denoised}) {
+      link->free.abort();
+      link->full.abort();
+    }
+  }
+};
+
+double since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/** Read, downmix and resample to 48 kHz into blocks of about blockSamples. */
+void decodeStage(Pipeline& pipe, AudioFileReader& reader, Resampler& toChain,
+                 size_t blockSamples, uint64_t& frames, double& busy) {
+  /* Input frames that resample to about one block. */
+  const size_t chunk = std::max<size_t>(
+      1, static_cast<size_t>(uint64_t{blockSamples} * reader.sampleRate() / kChainRate));
+  std::vector<float> input(chunk);
+  for (bool last = false; !last;) {
+    Block* block = pipe.decoded.free.pop();
+    if (!block) return;
+    auto t0 = std::chrono::steady_clock::now();
+    block->samples.clear();
+    size_t n = reader.read(input.data(), chunk);
+    if (!reader.error().empty()) {
+      pipe.fail(reader.error());
+      return;
+    }
+    frames += n;
+    toChain.process(input.data(), n, block->samples);
+    last = n < chunk;
+    if (last) toChain.flush(block->samples);
+    block->last = last;
+    busy += since(t0);
+    pipe.decoded.full.push(block);
+  }
+}
+
+/** Run 480-sample frames through the chain; frames may straddle blocks. */
+void dspStage(Pipeline& pipe, RNNoiseWrapper& chain, size_t blockSamples, double& busy) {
+  float frame[kRNNoiseFrameSize];
+  size_t fill = 0;
+  Block* out = nullptr;
+  for (bool last = false; !last;) {
+    Block* in = pipe.decoded.full.pop();
+    if (!in) return;
+    if (!out && !(out = pipe.denoised.free.pop())) return;
+    auto t0 = std::chrono::steady_clock::now();
+    last = in->last;
+
+    const float* src = in->samples.data();
+    size_t left = in->samples.size();
+    while (left > 0 || (last && fill > 0)) {
+      size_t m = std::min(kRNNoiseFrameSize - fill, left);
+      std::memcpy(frame + fill, src, m * sizeof(float));
+      fill += m;
+      src += m;
+      left -= m;
+      size_t keep = fill;
+      if (fill < kRNNoiseFrameSize) {
+        if (!(last && left == 0)) break;
+        std::fill(frame + fill, frame + kRNNoiseFrameSize, 0.0f);  /* Final partial frame */
+      }
+      chain.processFrame(frame);
+      out->samples.insert(out->samples.end(), frame, frame + keep);
+      fill = 0;
+
+      if (out->samples.size() >= blockSamples && (left > 0 || !last)) {
+        out->last = false;
+        busy += since(t0);
+        pipe.denoised.full.push(out);
+        if (!(out = pipe.denoised.free.pop())) return;
+        t0 = std::chrono::steady_clock::now();
+        out->samples.clear();
+      }
+    }
+    in->samples.clear();
+    pipe.decoded.free.push(in);
+    busy += since(t0);
+  }
+  out->last = true;
+  pipe.denoised.full.push(out);
+}
+
+}  // namespace
+
+std::string denoiseFile(const std::string& inPath, const std::string& outPath,
+                        const FileDenoiseConfig& config, FileDenoiseStats* stats) {
+  auto t0 = std::chrono::steady_clock::now();
+
+  AudioFileReader reader;
+  std::string err = reader.open(inPath);
+  if (!err.empty()) return err;
+
+  uint32_t outRate = config.outputRate ? config.outputRate : reader.sampleRate();
+  if (!config.outputRate && config.encoding == AudioFileEncoding::kOpus &&
+      !opusSupportsRate(outRate)) {
+    outRate = kChainRate;
+  }
+  Resampler toChain, fromChain;
+  err = toChain.init(reader.sampleRate(), kChainRate);
+  if (err.empty()) err = fromChain.init(kChainRate, outRate);
+  if (!err.empty()) return err;
+
+  RNNoiseWrapper chain;
+  if (!chain.init()) return "RNNoise initialization failed";
+  if (!chain.applyParams(config.params)) return "Invalid chain parameters";
+
+  AudioFileWriter writer;
+  err = writer.open(outPath, config.encoding, outRate);
+  if (!err.empty()) return err;
+
+  const size_t blockSamples = std::max(config.blockSamples, kRNNoiseFrameSize);
+  Pipeline pipe(std::max<size_t>(config.queueBlocks, 2), blockSamples);
+
+  uint64_t frames = 0;
+  double decodeBusy = 0.0, dspBusy = 0.0, encodeBusy = 0.0;
+  std::thread decoder([&] {
+    decodeStage(pipe, reader, toChain, blockSamples, frames, decodeBusy);
+  });
+  std::thread dsp([&] { dspStage(pipe, chain, blockSamples, dspBusy); });
+
+  /* Encode stage, on this thread. */
+  std::vector<float> resampled;
+  for (bool last = false; !last;) {
+    Block* block = pipe.denoised.full.pop();
+    if (!block) break;
+    auto e0 = std::chrono::steady_clock::now();
+    last = block->last;
+    const float* samples = block->samples.data();
+    size_t count = block->samples.size();
+    if (!fromChain.passthrough()) {
+      resampled.clear();
+      fromChain.process(samples, count, resampled);
+      if (last) fromChain.flush(resampled);
+      samples = resampled.data();
+      count = resampled.size();
+    }
+    err = writer.write(samples, count);
+    block->samples.clear();
+    pipe.denoised.free.push(block);
+    encodeBusy += since(e0);
+    if (!err.empty()) pipe.fail(err);
+  }
+
+  decoder.join();
+  dsp.join();
+  std::string closeErr = writer.close();
+  err = pipe.error.empty() ? closeErr : pipe.error;
+
+  if (stats) {
+    stats->inputRate = reader.sampleRate();
+    stats->inputChannels = reader.channels();
+    stats->outputSamples = writer.samplesWritten();
+    stats->inputFrames = frames;
+    stats->seconds = since(t0);
+    stats->decodeSeconds = decodeBusy;
+    stats->dspSeconds = dspBusy;
+    stats->encodeSeconds = encodeBusy;
+  }
+  return err;
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,63 @@
+/**
+ * Offline file pipeline -- decode, resample, denoise and encode a recording
+ * as overlapping stages on separate threads:
+ *
+ *   decode thread           DSP thread               calling thread
+ *   AudioFileReader  -->    RNNoiseWrapper    -->    [Resampler back]
+ *   Resampler -> 48 kHz     (480-sample frames)      AudioFileWriter
+ *              \__ queue __/                   \__ queue __/
+ *
+ * Each link is a fixed pool of queueBlocks blocks of ~blockSamples that
+ * circulate between its two stages: a stage that runs ahead waits for a
+ * block to come back, so memory stays constant however long the file is,
+ * and decoding, DSP and encoding proceed in parallel on different cores.
+ *
+ * Output is aligned with the input (frame-aligned processing, no latency;
+ * the last partial frame is zero-padded) and has the same duration. Input
+ * and output formats: see audio_file.h.
+ *
+ * NOT real-time code.
+ */
+
+#ifndef NOISEGUARD_OFFLINE_PIPELINE_H
+#define NOISEGUARD_OFFLINE_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "audio_file.h"
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+struct FileDenoiseConfig {
+  AudioFileEncoding encoding = AudioFileEncoding::kPcm16;
+  uint32_t outputRate = 0;       /* 0 = the input's rate (kOpus: 48 kHz if Opus can't) */
+  ChainParams params = RNNoiseWrapper::defaultParams();
+  size_t blockSamples = 4800;    /* Per queue block at 48 kHz (100 ms) */
+  size_t queueBlocks = 8;        /* Blocks per link */
+};
+
+struct FileDenoiseStats {
+  uint32_t inputRate = 0;
+  uint16_t inputChannels = 0;
+  uint64_t inputFrames = 0;
+  uint64_t outputSamples = 0;
+  double seconds = 0.0;          /* Wall time */
+  double decodeSeconds = 0.0;    /* Busy time per stage (overlapping) */
+  double dspSeconds = 0.0;
+  double encodeSeconds = 0.0;
+};
+
+/**
+ * Denoise inPath into outPath. Returns empty string on success, or an
+ * error message (outPath may then be incomplete).
+ */
+std::string denoiseFile(const std::string& inPath, const std::string& outPath,
+                        const FileDenoiseConfig& config,
+                        FileDenoiseStats* stats = nullptr);
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_OFFLINE_PIPELINE_H
@@ -0,0 +1,59 @@
+/**
+ * Internal PortAudio helpers shared by AudioEngine and LatencyTuner.
+ *
+ * Includes portaudio.h, so only include this from .cpp files -- public
+ * headers forward-declare the PortAudio types they need instead.
+ */
+
+#ifndef NOISEGUARD_PA_UTIL_H
+#define NOISEGUARD_PA_UTIL_H
+
+#include <cstring>
+
+#include "portaudio.h"
+
+#ifdef _WIN32
+#include "pa_win_wasapi.h"
+#endif
+
+namespace noiseguard {
+
+/**
+ * Suggested latency for a device/direction: the requested value if > 0,
+ * otherwise PortAudio's defaultLow latency for that device.
+ */
+inline double resolveSuggestedLatency(int device, bool input, double requested) {
+  if (requested > 0.0) return requested;
+  const PaDeviceInfo* info = Pa_GetDeviceInfo(device);
+  if (!info) return 0.0;
+  return input ? info->defaultLowInputLatency : info->defaultLowOutputLatency;
+}
+
+#ifdef _WIN32
+/** True if the WASAPI host API is compiled in and available. */
+inline bool hasWasapiHostApi() {
+  for (PaHostApiIndex i = 0; i < Pa_GetHostApiCount(); i++) {
+    const PaHostApiInfo* api = Pa_GetHostApiInfo(i);
+    if (api && api->type == paWASAPI) return true;
+  }
+  return false;
+}
+
+/**
+ * Fill WASAPI stream info requesting exclusive mode + pro-audio thread priority.
+ * Attach it via PaStreamParameters::hostApiSpecificStreamInfo; callers retry
+ * without it when the device is busy (exclusive mode locks the device).
+ */
+inline void fillWasapiExclusive(PaWasapiStreamInfo& info) {
+  memset(&info, 0, sizeof(info));
+  info.size = sizeof(PaWasapiStreamInfo);
+  info.hostApiType = paWASAPI;
+  info.version = 1;
+  info.flags = paWinWasapiExclusive | paWinWasapiThreadPriority;
+  info.threadPriority = eThreadPriorityProAudio;
+}
+#endif
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_PA_UTIL_H
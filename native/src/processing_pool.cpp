@@ -0,0 +1,138 @@
+/**
+ * ProcessingPool implementation.
+ */
+
+#include "processing_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "rt_check.h"
+#include "trace.h"
+
+namespace noiseguard {
+
+/*
+ * Upper bound on worker threads. Half the cores (at least one, at most
+ * four) leaves room for PortAudio's callback threads and the UI.
+ */
+static const size_t kMaxWorkers = std::clamp<size_t>(
+    std::thread::hardware_concurrency() / 2, 1, 4);
+
+/*
+ * Idle sleep when no attached engine had a full frame. A 480-sample frame
+ * arrives every 10ms, so this polls ~20 times per frame period (the same
+ * cadence the per-engine processing threads used).
+ */
+static constexpr auto kIdleSleep = std::chrono::microseconds(500);
+
+ProcessingPool& ProcessingPool::instance() {
+  static ProcessingPool pool;
+  return pool;
+}
+
+ProcessingPool::~ProcessingPool() {
+  /* Engines detach in stop(); this only catches leaks at process exit. */
+  for (auto& w : workers_) {
+    w->stop.store(true, std::memory_order_release);
+    if (w->thread.joinable()) w->thread.join();
+  }
+}
+
+void ProcessingPool::workerLoop(Worker* w) {
+  Tracer::nameThread("processing_worker");
+  while (!w->stop.load(std::memory_order_acquire)) {
+    bool busy = false;
+    {
+      /*
+       * The whole sweep is real-time: it runs every attached engine's task
+       * back to back, so anything blocking here delays all of them. Only
+       * the idle sleep below is outside the scope.
+       */
+      RtScope rtScope("processing_sweep");
+      /*
+       * seq_cst on the epoch bump and the list load, paired with publish():
+       * either this sweep sees the new list, or publish() sees it running.
+       */
+      w->epoch.fetch_add(1, std::memory_order_seq_cst);
+      const EntryList* entries = w->entries.load(std::memory_order_seq_cst);
+      for (const Entry& e : *entries) {
+        busy |= e.task(e.ctx);
+      }
+      w->epoch.fetch_add(1, std::memory_order_release);
+    }
+    if (!busy) std::this_thread::sleep_for(kIdleSleep);
+  }
+}
+
+void ProcessingPool::publish(Worker* w, std::unique_ptr<const EntryList> next) {
+  w->entries.store(next.get(), std::memory_order_seq_cst);
+
+  /* A sweep in progress may still hold the old list: wait for it to end. */
+  const uint64_t epoch = w->epoch.load(std::memory_order_seq_cst);
+  if (epoch & 1) {
+    while (w->epoch.load(std::memory_order_acquire) == epoch) {
+      std::this_thread::yield();
+    }
+  }
+  w->owned = std::move(next);
+}
+
+void ProcessingPool::attach(void* ctx, Task task) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  /* Least-loaded existing worker; a new one if all are busy and we may. */
+  Worker* target = nullptr;
+  size_t load = 0;
+  for (auto& w : workers_) {
+    if (!target || w->owned->size() < load) {
+      target = w.get();
+      load = w->owned->size();
+    }
+  }
+
+  if (!target || (load > 0 && workers_.size() < kMaxWorkers)) {
+    workers_.push_back(std::make_unique<Worker>());
+    target = workers_.back().get();
+    target->owned = std::make_unique<const EntryList>(EntryList{{ctx, task}});
+    target->entries.store(target->owned.get(), std::memory_order_release);
+    target->thread = std::thread(&ProcessingPool::workerLoop, target);
+    return;
+  }
+
+  auto next = std::make_unique<EntryList>(*target->owned);
+  next->push_back({ctx, task});
+  publish(target, std::move(next));
+}
+
+void ProcessingPool::detach(void* ctx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto it = workers_.begin(); it != workers_.end(); ++it) {
+    Worker* w = it->get();
+    const EntryList& current = *w->owned;
+    auto e = std::find_if(current.begin(), current.end(),
+                          [ctx](const Entry& x) { return x.ctx == ctx; });
+    if (e == current.end()) continue;
+
+    auto next = std::make_unique<EntryList>(current);
+    next->erase(next->begin() + (e - current.begin()));
+    const bool empty = next->empty();
+    /* Waits out an in-flight sweep, and with it any call to ctx. */
+    publish(w, std::move(next));
+
+    if (empty) {
+      w->stop.store(true, std::memory_order_release);
+      w->thread.join();
+      workers_.erase(it);
+    }
+    return;
+  }
+}
+
+size_t ProcessingPool::workerCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return workers_.size();
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,100 @@
+/**
+ * ProcessingPool -- process-wide worker threads shared by all AudioEngines.
+ *
+ * Each running engine used to own a processing thread that mostly slept
+ * (one 10ms frame takes well under 1ms). With several engines that is a
+ * thread per pipeline doing almost nothing. The pool instead runs a few
+ * workers, each sweeping the engines attached to it:
+ *
+ *   worker: for each attached task: task(ctx)  -> true if it did work
+ *           no task did work -> short sleep
+ *
+ * Engines are spread over at most kMaxWorkers threads (least-loaded first).
+ * A worker is started by the first task assigned to it and joined as soon
+ * as its last task detaches, so an idle process has no pool threads.
+ *
+ * A worker never locks. Its task list is immutable once published through
+ * an atomic pointer; attach()/detach() build a new list, swap it in and
+ * wait for the worker's sweep epoch to pass before freeing the old one, so
+ * a sweep in flight keeps reading valid memory and changing the set of
+ * engines never blocks the audio of the others.
+ *
+ * THREADING:
+ * - attach()/detach() are thread-safe and NOT real-time safe.
+ * - detach() returns only once the task can no longer be running or be
+ *   called again, so the caller may free ctx immediately afterwards.
+ * - Tasks run on a pool worker and must not block: they share the thread
+ *   with other engines' tasks. The whole sweep runs in an RtScope
+ *   (rt_check.h), so an instrumented build reports a lock, allocation or
+ *   blocking call by any task or by the sweep itself.
+ */
+
+#ifndef NOISEGUARD_PROCESSING_POOL_H
+#define NOISEGUARD_PROCESSING_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace noiseguard {
+
+class ProcessingPool {
+ public:
+  /** Processes pending work for ctx. Returns true if anything was done. */
+  using Task = bool (*)(void* ctx);
+
+  /** The single process-wide pool. */
+  static ProcessingPool& instance();
+
+  ProcessingPool(const ProcessingPool&) = delete;
+  ProcessingPool& operator=(const ProcessingPool&) = delete;
+
+  /** Start calling task(ctx) on a pool worker. */
+  void attach(void* ctx, Task task);
+
+  /** Stop calling task(ctx). Blocks until any in-flight call has returned. */
+  void detach(void* ctx);
+
+  /** Number of live worker threads. */
+  size_t workerCount();
+
+ private:
+  struct Entry {
+    void* ctx;
+    Task task;
+  };
+
+  using EntryList = std::vector<Entry>;
+
+  struct Worker {
+    std::thread thread;
+    /* The list the worker sweeps; replaced whole, never modified. */
+    std::atomic<const EntryList*> entries{nullptr};
+    /* Owns *entries (control side, under the pool's mutex_). */
+    std::unique_ptr<const EntryList> owned;
+    /* Sweep epoch: odd while a sweep runs, bumped again when it ends. */
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<bool> stop{false};
+  };
+
+  ProcessingPool() = default;
+  ~ProcessingPool();
+
+  static void workerLoop(Worker* w);
+
+  /*
+   * Make next w's task list and free the previous one once no sweep can
+   * still be reading it (or running one of its tasks). Caller holds mutex_.
+   */
+  static void publish(Worker* w, std::unique_ptr<const EntryList> next);
+
+  /* Guards workers_ and each worker's owned list. Never taken by a worker. */
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_PROCESSING_POOL_H
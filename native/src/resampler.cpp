@@ -0,0 +1,111 @@
+/**
+ * Resampler implementation.
+ */
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace noiseguard {
+
+/* Passband edge as a fraction of the lower Nyquist rate. */
+static constexpr double kCutoff = 0.95;
+
+static constexpr double kPi = 3.14159265358979323846;
+
+std::string Resampler::init(uint32_t inRate, uint32_t outRate) {
+  if (inRate == 0 || outRate == 0) return "Invalid sample rate";
+  uint32_t g = std::gcd(inRate, outRate);
+  up_ = outRate / g;
+  down_ = inRate / g;
+  if (up_ > kMaxResamplerPhases) {
+    return "Unsupported sample rate conversion " + std::to_string(inRate) + " -> " +
+           std::to_string(outRate) + " Hz";
+  }
+
+  /* Cutoff in cycles per input sample (x2): below both Nyquist rates. */
+  const double cutoff = kCutoff * std::min(1.0, static_cast<double>(up_) / down_);
+  const size_t half = static_cast<size_t>(std::ceil(kResamplerZeroCrossings / cutoff));
+  taps_ = passthrough() ? 0 : 2 * half;
+
+  /*
+   * Phase p holds the weights of inputs n - (half - 1) .. n + half for an
+   * output at input time n + p / L. Each phase is normalized to unity DC gain.
+   */
+  table_.assign(up_ * taps_, 0.0f);
+  for (uint32_t p = 0; p < up_ && taps_; p++) {
+    double sum = 0.0;
+    std::vector<double> w(taps_);
+    for (size_t i = 0; i < taps_; i++) {
+      double d = static_cast<double>(i) - static_cast<double>(half - 1) -
+                 static_cast<double>(p) / up_;
+      double x = cutoff * d;
+      double sinc = x == 0.0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+      double r = d / static_cast<double>(half);
+      double blackman = std::fabs(r) >= 1.0
+                            ? 0.0
+                            : 0.42 + 0.5 * std::cos(kPi * r) + 0.08 * std::cos(2.0 * kPi * r);
+      w[i] = sinc * blackman;
+      sum += w[i];
+    }
+    for (size_t i = 0; i < taps_; i++) {
+      table_[p * taps_ + i] = static_cast<float>(w[i] / sum);
+    }
+  }
+  reset();
+  return "";
+}
+
+void Resampler::reset() {
+  const size_t history = taps_ ? taps_ / 2 - 1 : 0;
+  buf_.assign(history, 0.0f);
+  base_ = -static_cast<int64_t>(history);
+  inputs_ = 0;
+  outputs_ = 0;
+}
+
+void Resampler::process(const float* in, size_t count, std::vector<float>& out) {
+  if (passthrough()) {
+    out.insert(out.end(), in, in + count);
+    return;
+  }
+  buf_.insert(buf_.end(), in, in + count);
+  inputs_ += count;
+  produce(out, UINT64_MAX);
+}
+
+void Resampler::flush(std::vector<float>& out) {
+  if (!passthrough()) {
+    /* Silence past the end covers every remaining output's window. */
+    buf_.insert(buf_.end(), taps_ / 2, 0.0f);
+    produce(out, (inputs_ * up_ + down_ - 1) / down_);
+  }
+  reset();
+}
+
+void Resampler::produce(std::vector<float>& out, uint64_t limit) {
+  const int64_t half = static_cast<int64_t>(taps_ / 2);
+  const int64_t end = base_ + static_cast<int64_t>(buf_.size());
+  for (; outputs_ < limit; outputs_++) {
+    const int64_t n = static_cast<int64_t>(outputs_ * down_ / up_);
+    if (n + half >= end) break;
+    const uint32_t p = static_cast<uint32_t>(outputs_ * down_ % up_);
+    const float* x = buf_.data() + (n - (half - 1) - base_);
+    const float* h = table_.data() + p * taps_;
+    float y = 0.0f;
+    for (size_t i = 0; i < taps_; i++) y += x[i] * h[i];
+    out.push_back(y);
+  }
+
+  /* Drop the input no future output reaches. */
+  const int64_t keep = static_cast<int64_t>(outputs_ * down_ / up_) - (half - 1);
+  if (keep > base_) {
+    const size_t drop = static_cast<size_t>(std::min<int64_t>(keep - base_, end - base_));
+    buf_.erase(buf_.begin(), buf_.begin() + static_cast<std::ptrdiff_t>(drop));
+    base_ += static_cast<int64_t>(drop);
+  }
+}
+
+}  // namespace noiseguard
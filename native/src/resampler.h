@@ -0,0 +1,70 @@
+/**
+ * Resampler -- streaming windowed-sinc sample rate conversion.
+ *
+ * Converts mono float audio between any two rates whose ratio reduces to
+ * out/in = L/M with L <= kMaxResamplerPhases (every common rate pair to or
+ * from 48 kHz: 8, 11.025, 16, 22.05, 32, 44.1, 88.2, 96, 192 kHz, ...).
+ * Output sample j lies at input time j * M / L and is a Blackman-windowed
+ * sinc interpolation of the 2 * kResamplerZeroCrossings (more when
+ * downsampling) surrounding input samples, from a precomputed table of L
+ * phases. The cutoff sits just below the lower Nyquist rate, so
+ * downsampling is anti-aliased.
+ *
+ * Output is aligned with the input (no delay): the first output sample is
+ * input time 0, and flush() emits the remaining ceil(inputs * L / M)
+ * outputs, treating samples past the end as silence.
+ *
+ * THREADING: not thread-safe. NOT real-time code (process() appends to a
+ * std::vector; it reuses capacity, so it stops allocating once warm).
+ */
+
+#ifndef NOISEGUARD_RESAMPLER_H
+#define NOISEGUARD_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace noiseguard {
+
+/* Largest L (output phases per input period) with a precomputed table. */
+static constexpr uint32_t kMaxResamplerPhases = 8192;
+
+/* Filter half-length in zero crossings of the cutoff frequency. */
+static constexpr uint32_t kResamplerZeroCrossings = 16;
+
+class Resampler {
+ public:
+  /** Set up inRate -> outRate. Returns empty string on success, or an error. */
+  std::string init(uint32_t inRate, uint32_t outRate);
+
+  /** Feed count input samples; append the outputs now available to out. */
+  void process(const float* in, size_t count, std::vector<float>& out);
+
+  /** End of input: append the remaining outputs to out, then reset(). */
+  void flush(std::vector<float>& out);
+
+  /** Start a new stream with the same rates. */
+  void reset();
+
+  bool passthrough() const { return up_ == down_; }
+
+ private:
+  void produce(std::vector<float>& out, uint64_t limit);
+
+  uint32_t up_ = 1;    /* L */
+  uint32_t down_ = 1;  /* M */
+  size_t taps_ = 0;    /* Per phase (even) */
+  std::vector<float> table_;  /* [phase][tap] */
+
+  /* Input history: buf_[i] is input sample base_ + i (negative = silence). */
+  std::vector<float> buf_;
+  int64_t base_ = 0;
+  uint64_t inputs_ = 0;   /* Samples fed since reset() */
+  uint64_t outputs_ = 0;  /* Samples produced since reset() */
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_RESAMPLER_H
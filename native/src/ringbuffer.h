@@ -1,5 +1,15 @@
 /**
- * Lock-free Single-Producer Single-Consumer (SPSC) ring buffer for real-time audio.
+ * Lock-free Single-Producer Single-Consumer (SPSC) ring buffers for real-time audio.
+ *
+ *   RingBuffer          float samples, capacity chosen at run time (storage
+ *                       may be caller-owned, e.g. carved from a SessionArena).
+ *   FixedRing<T, N>     any trivially copyable T, N fixed at compile time so
+ *                       the index mask folds into a constant. Storage is
+ *                       inline. Besides bulk write()/read() it hands out its
+ *                       slots in place (writeSlot()/commitWrite(),
+ *                       readSlot()/commitRead()), so large elements -- a
+ *                       whole frame with its metadata -- are filled and
+ *                       consumed without an extra copy.
  *
  * RULES FOR REAL-TIME AUDIO:
  * - No allocations in the audio callback or processing thread after construction.
@@ -11,9 +21,11 @@
 #ifndef NOISEGUARD_RINGBUFFER_H
 #define NOISEGUARD_RINGBUFFER_H
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <type_traits>
 
 namespace noiseguard {
 
@@ -29,11 +41,25 @@ class RingBuffer {
  public:
   /** capacity will be rounded up to next power of 2. No allocations after this. */
   explicit RingBuffer(size_t capacity)
-      : capacity_(nextPowerOf2(capacity)), mask_(capacity_ - 1) {
+      : capacity_(nextPowerOf2(capacity)), mask_(capacity_ - 1), owned_(true) {
     buffer_ = new float[capacity_];
   }
 
-  ~RingBuffer() { delete[] buffer_; }
+  /**
+   * Use caller-owned storage of storageBytes(capacity) bytes (e.g. carved
+   * from a SessionArena next to the ring itself). It must outlive the ring.
+   */
+  RingBuffer(size_t capacity, float* storage)
+      : capacity_(nextPowerOf2(capacity)), mask_(capacity_ - 1), owned_(false) {
+    buffer_ = storage;
+  }
+
+  ~RingBuffer() {
+    if (owned_) delete[] buffer_;
+  }
+
+  /** Storage a ring of this capacity needs. */
+  static size_t storageBytes(size_t capacity) { return nextPowerOf2(capacity) * sizeof(float); }
 
   RingBuffer(const RingBuffer&) = delete;
   RingBuffer& operator=(const RingBuffer&) = delete;
@@ -83,11 +109,106 @@ class RingBuffer {
  private:
   const size_t capacity_;
   const size_t mask_;
+  const bool owned_;
   float* buffer_;
   std::atomic<size_t> read_idx_{0};
   std::atomic<size_t> write_idx_{0};
 };
 
+template <typename T, size_t Capacity>
+class FixedRing {
+  static_assert((Capacity & (Capacity - 1)) == 0 && Capacity >= 2,
+                "FixedRing capacity must be a power of 2");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "FixedRing element must be trivially copyable");
+
+ public:
+  FixedRing() = default;
+
+  FixedRing(const FixedRing&) = delete;
+  FixedRing& operator=(const FixedRing&) = delete;
+
+  /*
+   * Indices run free and are masked on access, so all Capacity slots are
+   * usable (w - r is the fill even across wraparound).
+   */
+
+  /** Elements available to read. */
+  size_t available_read() const {
+    return write_idx_.load(std::memory_order_acquire) -
+           read_idx_.load(std::memory_order_acquire);
+  }
+
+  /** Slots available to write. */
+  size_t available_write() const { return Capacity - available_read(); }
+
+  /** Write up to count elements. Returns number actually written. */
+  size_t write(const T* src, size_t count) {
+    size_t w = write_idx_.load(std::memory_order_relaxed);
+    size_t r = read_idx_.load(std::memory_order_acquire);
+    size_t free = Capacity - (w - r);
+    if (count > free) count = free;
+    if (count == 0) return 0;
+    size_t first = std::min(count, Capacity - (w & kMask));
+    std::memcpy(slots_ + (w & kMask), src, first * sizeof(T));
+    std::memcpy(slots_, src + first, (count - first) * sizeof(T));
+    write_idx_.store(w + count, std::memory_order_release);
+    return count;
+  }
+
+  /** Read up to count elements. Returns number actually read. */
+  size_t read(T* dst, size_t count) {
+    size_t r = read_idx_.load(std::memory_order_relaxed);
+    size_t w = write_idx_.load(std::memory_order_acquire);
+    if (count > w - r) count = w - r;
+    if (count == 0) return 0;
+    size_t first = std::min(count, Capacity - (r & kMask));
+    std::memcpy(dst, slots_ + (r & kMask), first * sizeof(T));
+    std::memcpy(dst + first, slots_, (count - first) * sizeof(T));
+    read_idx_.store(r + count, std::memory_order_release);
+    return count;
+  }
+
+  /**
+   * Producer: the next free slot, or nullptr if the ring is full. The same
+   * slot is returned until commitWrite() publishes it.
+   */
+  T* writeSlot() {
+    size_t w = write_idx_.load(std::memory_order_relaxed);
+    if (w - read_idx_.load(std::memory_order_acquire) == Capacity) return nullptr;
+    return &slots_[w & kMask];
+  }
+
+  /** Producer: publish the slot from writeSlot(). */
+  void commitWrite() {
+    write_idx_.store(write_idx_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  /**
+   * Consumer: the oldest element, in place, or nullptr if the ring is
+   * empty. It stays the consumer's until commitRead().
+   */
+  T* readSlot() {
+    size_t r = read_idx_.load(std::memory_order_relaxed);
+    if (write_idx_.load(std::memory_order_acquire) == r) return nullptr;
+    return &slots_[r & kMask];
+  }
+
+  /** Consumer: release the slot from readSlot() to the producer. */
+  void commitRead() {
+    read_idx_.store(read_idx_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  static constexpr size_t capacity() { return Capacity; }
+
+ private:
+  static constexpr size_t kMask = Capacity - 1;
+
+  T slots_[Capacity];
+  alignas(64) std::atomic<size_t> read_idx_{0};
+  alignas(64) std::atomic<size_t> write_idx_{0};
+};
+
 }  // namespace noiseguard
 
 #endif  // NOISEGUARD_RINGBUFFER_H
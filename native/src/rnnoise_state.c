@@ -0,0 +1,129 @@
+/**
+ * RNNoise state snapshot (see rnnoise_state.h). Built as part of the
+ * rnnoise library target, with its private include directory.
+ */
+
+#include "rnnoise_state.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rnnoise.h"
+#include "rnn.h"
+#include "rnn_data.h"
+
+/* Sanity bound for ng_rnnoise_layout_ok(): the built-in model has 168 GRU floats. */
+static const size_t kMaxGruFloats = 65536;
+
+/* RNNState is the last member, so it ends exactly at rnnoise_get_size(). */
+static size_t rnnOffset(void) {
+  return (size_t)rnnoise_get_size() - sizeof(RNNState);
+}
+
+static const RNNState* rnnOf(const struct DenoiseState* st) {
+  return (const RNNState*)((const char*)st + rnnOffset());
+}
+
+/* Where an in-place state's GRU blocks start (16-aligned for SIMD loads). */
+static size_t gruOffset(void) {
+  return ((size_t)rnnoise_get_size() + 15) & ~(size_t)15;
+}
+
+static size_t gruFloats(const RNNModel* model) {
+  return (size_t)(model->vad_gru_size + model->noise_gru_size + model->denoise_gru_size);
+}
+
+/* Copy one GRU block to dst, free the original and repoint it. Returns the next dst. */
+static float* adoptGru(float** state, int size, float* dst) {
+  memcpy(dst, *state, sizeof(float) * (size_t)size);
+  free(*state);
+  *state = dst;
+  return dst + size;
+}
+
+size_t ng_rnnoise_state_bytes(const struct DenoiseState* st) {
+  return rnnOffset() + sizeof(float) * gruFloats(rnnOf(st)->model);
+}
+
+void ng_rnnoise_state_save(const struct DenoiseState* st, void* out) {
+  const RNNState* rnn = rnnOf(st);
+  char* p = (char*)out;
+  memcpy(p, st, rnnOffset());
+  p += rnnOffset();
+  memcpy(p, rnn->vad_gru_state, sizeof(float) * rnn->model->vad_gru_size);
+  p += sizeof(float) * rnn->model->vad_gru_size;
+  memcpy(p, rnn->noise_gru_state, sizeof(float) * rnn->model->noise_gru_size);
+  p += sizeof(float) * rnn->model->noise_gru_size;
+  memcpy(p, rnn->denoise_gru_state, sizeof(float) * rnn->model->denoise_gru_size);
+}
+
+void ng_rnnoise_state_load(struct DenoiseState* st, const void* in) {
+  const RNNState* rnn = rnnOf(st);
+  const char* p = (const char*)in;
+  memcpy(st, p, rnnOffset());
+  p += rnnOffset();
+  memcpy(rnn->vad_gru_state, p, sizeof(float) * rnn->model->vad_gru_size);
+  p += sizeof(float) * rnn->model->vad_gru_size;
+  memcpy(rnn->noise_gru_state, p, sizeof(float) * rnn->model->noise_gru_size);
+  p += sizeof(float) * rnn->model->noise_gru_size;
+  memcpy(rnn->denoise_gru_state, p, sizeof(float) * rnn->model->denoise_gru_size);
+}
+
+/* A GRU block of a live state: set, outside the state itself. */
+static int gruOutside(const float* gru, const DenoiseState* st) {
+  const char* p = (const char*)gru;
+  return p && (p < (const char*)st || p >= (const char*)st + rnnoise_get_size());
+}
+
+int ng_rnnoise_layout_ok(void) {
+  /*
+   * If RNNState is not where rnnOffset() says, these bytes are zeroed
+   * DSP state or unrelated fields: the model pointer would be NULL or
+   * differ between two fresh states, and is only dereferenced once it
+   * passed both tests.
+   */
+  DenoiseState* a = rnnoise_create(NULL);
+  DenoiseState* b = rnnoise_create(NULL);
+  int ok = 0;
+  if (a && b && (size_t)rnnoise_get_size() >= sizeof(RNNState)) {
+    const RNNState* ra = rnnOf(a);
+    const RNNState* rb = rnnOf(b);
+    ok = ra->model != NULL && ra->model == rb->model &&
+         gruOutside(ra->vad_gru_state, a) && gruOutside(ra->noise_gru_state, a) &&
+         gruOutside(ra->denoise_gru_state, a) &&
+         ra->vad_gru_state != rb->vad_gru_state &&
+         ra->vad_gru_state != ra->noise_gru_state &&
+         ra->noise_gru_state != ra->denoise_gru_state &&
+         ra->model->vad_gru_size > 0 && ra->model->noise_gru_size > 0 &&
+         ra->model->denoise_gru_size > 0 && gruFloats(ra->model) <= kMaxGruFloats;
+  }
+  if (a) rnnoise_destroy(a);
+  if (b) rnnoise_destroy(b);
+  return ok;
+}
+
+size_t ng_rnnoise_arena_bytes(void) {
+  DenoiseState* probe;
+  size_t bytes;
+  if (!ng_rnnoise_layout_ok()) return 0;
+
+  /* The model is only reachable through a state: measure a throwaway one. */
+  probe = rnnoise_create(NULL);
+  bytes = gruOffset() + sizeof(float) * gruFloats(rnnOf(probe)->model);
+  rnnoise_destroy(probe);
+  return bytes;
+}
+
+struct DenoiseState* ng_rnnoise_init_in(void* mem) {
+  DenoiseState* st = (DenoiseState*)mem;
+  RNNState* rnn;
+  float* gru = (float*)((char*)mem + gruOffset());
+
+  /* Let RNNoise initialize everything, then move its GRU blocks into mem. */
+  rnnoise_init(st, NULL);
+  rnn = (RNNState*)((char*)st + rnnOffset());
+  gru = adoptGru(&rnn->vad_gru_state, rnn->model->vad_gru_size, gru);
+  gru = adoptGru(&rnn->noise_gru_state, rnn->model->noise_gru_size, gru);
+  adoptGru(&rnn->denoise_gru_state, rnn->model->denoise_gru_size, gru);
+  return st;
+}
@@ -0,0 +1,76 @@
+/**
+ * RNNoise state snapshot -- copy a DenoiseState's complete contents out
+ * and back in.
+ *
+ * DenoiseState is opaque in rnnoise.h, and its recurrent (GRU) state lives
+ * in separate blocks that rnnoise_init() allocates and the state points
+ * to, so a plain memcpy of rnnoise_get_size() bytes would copy pointers,
+ * not state. rnnoise_state.c is compiled INTO the rnnoise library (it needs
+ * the library's private rnn.h / rnn_data.h) and flattens a state into:
+ *
+ *   [ DenoiseState up to its RNNState | vad GRU | noise GRU | denoise GRU ]
+ *
+ * Restoring copies the same bytes back, keeping the target's own model
+ * and GRU block pointers. A snapshot only restores into a state of the
+ * same RNNoise build and model (same ng_rnnoise_state_bytes()).
+ *
+ * ng_rnnoise_init_in() uses the same layout to build a live state inside
+ * caller-owned memory (e.g. a SessionArena), GRU blocks included:
+ *
+ *   [ DenoiseState | pad | vad GRU | noise GRU | denoise GRU ]
+ *
+ * Such a state needs no rnnoise_destroy() -- the caller owns the bytes --
+ * and must never be passed to it.
+ *
+ * Relies on RNNState being DenoiseState's last member (true for the
+ * xiph 0.1 code base the Mumble fork tracks, at the commit pinned in
+ * native/rnnoise.lock). ng_rnnoise_layout_ok() verifies that on a live
+ * state; the build runs it (tools/rnnoise_layout_check.c), and
+ * ng_rnnoise_arena_bytes() returns 0 when it fails.
+ */
+
+#ifndef NOISEGUARD_RNNOISE_STATE_H
+#define NOISEGUARD_RNNOISE_STATE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct DenoiseState;
+
+/** Bytes of a snapshot of st (depends on the build and model only). */
+size_t ng_rnnoise_state_bytes(const struct DenoiseState* st);
+
+/** Write ng_rnnoise_state_bytes(st) bytes to out. */
+void ng_rnnoise_state_save(const struct DenoiseState* st, void* out);
+
+/** Overwrite st with a snapshot taken by ng_rnnoise_state_save(). */
+void ng_rnnoise_state_load(struct DenoiseState* st, const void* in);
+
+/**
+ * 1 if this RNNoise build has the layout the functions here assume, else 0.
+ * Probes two fresh states; NOT real-time safe.
+ */
+int ng_rnnoise_layout_ok(void);
+
+/**
+ * Bytes ng_rnnoise_init_in() needs for a state of the built-in model, or
+ * 0 if ng_rnnoise_layout_ok() fails (then use none of the functions here).
+ */
+size_t ng_rnnoise_arena_bytes(void);
+
+/**
+ * Initialize a state of the built-in model in mem (ng_rnnoise_arena_bytes()
+ * bytes, aligned for a pointer), as rnnoise_create(NULL) would, but with
+ * its GRU blocks in mem too. NOT real-time safe (rnnoise_init() allocates
+ * transiently). Returns the state, which lives at mem.
+ */
+struct DenoiseState* ng_rnnoise_init_in(void* mem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NOISEGUARD_RNNOISE_STATE_H */
@@ -1,9 +1,12 @@
 /**
  * Production-grade RNNoise wrapper with multi-stage post-processing.
  *
- * Processing chain (per 10ms frame):
+ * Processing chain (per 10ms frame, standard layout):
  *   RNNoise (×2 passes) → HPF 80Hz → LPF 8kHz → Adaptive Noise Gate
- *   → Spectral Floor Clamp → Soft Silence Injection
+ *   → Spectral Floor Clamp → Soft Silence Injection → [Peak Limiter]
+ *
+ * Everything after RNNoise is built from stage types (BlendStage, HpfStage,
+ * ...) composed with Pipeline<> into one kernel per layout × stage mask.
  *
  * Design goals:
  *   - Keyboard / fan / environmental noise: gated to true silence.
@@ -19,7 +22,15 @@
 #include <cmath>
 #include <cstring>
 
+#include "audio_tap.h"
+#include "dsp_pipeline.h"
+#include "frame_capture.h"
 #include "rnnoise.h"
+#include "rnnoise_state.h"
+#include "sample_convert.h"
+#include "session_arena.h"
+#include "state_blob.h"
+#include "trace.h"
 
 namespace noiseguard {
 
@@ -111,7 +122,7 @@ static constexpr float kSpectralClampMult = 2.0f;
 
 /*
  * Gate gain threshold for applying the spectral clamp.
- * Clamp is active only when smoothGain_ < this value.
+ * Clamp is active only when the smoothed gate gain is below this value.
  * 0.3 = only clamp during the closing/closed phase, never during speech.
  */
 static constexpr float kClampGateThreshold = 0.3f;
@@ -122,8 +133,9 @@ static constexpr float kClampGateThreshold = 0.3f;
  * Comfort noise amplitude: -60 dBFS = 0.001.
  * Just enough to prevent the "dead channel" / pressure-drop feeling
  * in headphones. Inaudible in speakers.
+ * Pre-scaled to the int16 domain the chain runs in.
  */
-static constexpr float kSoftSilenceLevel = 0.001f;
+static constexpr float kSoftSilenceLevel = 0.001f * kInt16Scale;
 
 /*
  * 1-pole lowpass shaping coefficient for comfort noise.
@@ -138,11 +150,41 @@ static constexpr float kNoiseShapeCoeff = 0.7f;
  */
 static constexpr float kSoftSilenceGateThresh = 0.1f;
 
+/* ── Peak Limiter ────────────────────────────────────────────────────────── */
+
+/*
+ * Limiter ceiling: -0.5 dBFS, pre-scaled to the int16 domain.
+ * Catches the rare overshoot from the filters or a hot mic before the
+ * output stream clips it.
+ */
+static constexpr float kLimiterCeiling = 0.944f * kInt16Scale;
+
+/*
+ * Limiter release per frame. Gain reduction is instant (per-frame peak);
+ * recovery moves 10% of the way back to unity each frame (~250ms to settle).
+ */
+static constexpr float kLimiterRelease = 0.10f;
+
+/* ── Stage Selection ─────────────────────────────────────────────────────── */
+
+static constexpr uint32_t stageBit(PostStage s) {
+  return 1u << static_cast<uint32_t>(s);
+}
+
+static constexpr uint32_t kStageMaskCount = 1u << kPostStageCount;
+
+/* Default chain = the original fixed pipeline (limiter off). */
+static constexpr uint32_t kDefaultStageMask =
+    (kStageMaskCount - 1) & ~stageBit(PostStage::kLimiter);
+
+/* Selector layout: low 16 bits = stage mask, high bits = layout index. */
+static constexpr uint32_t kLayoutShift = 16;
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  LIFECYCLE
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-RNNoiseWrapper::RNNoiseWrapper() = default;
+RNNoiseWrapper::RNNoiseWrapper() : chainSelector_(kDefaultStageMask) {}
 
 RNNoiseWrapper::~RNNoiseWrapper() { destroy(); }
 
@@ -151,14 +193,57 @@ bool RNNoiseWrapper::init() {
 
   state_  = rnnoise_create(nullptr);
   state2_ = rnnoise_create(nullptr);
+  resetChain();
+
+  return state_ != nullptr && state2_ != nullptr;
+}
+
+/*
+ * Arena bytes of one built-in-model state; measured once (it probes a
+ * state). 0 = this RNNoise build's layout is not supported
+ * (ng_rnnoise_layout_ok()): no arena states and no snapshots.
+ */
+static size_t stateFootprint() {
+  static const size_t bytes = arenaFootprint(ng_rnnoise_arena_bytes());
+  return bytes;
+}
+
+bool RNNoiseWrapper::init(SessionArena& arena) {
+  if (stateBytes() == 0) return false;
+  void* memory = arena.allocate(stateBytes());
+  return memory && init(memory);
+}
+
+bool RNNoiseWrapper::init(void* memory) {
+  if (state_) destroy();
+  if (stateFootprint() == 0) return false;
+
+  /* [ state | pad | state2 | pad ], each on its own cache lines. */
+  char* base = static_cast<char*>(memory);
+  state_  = ng_rnnoise_init_in(base);
+  state2_ = ng_rnnoise_init_in(base + stateFootprint());
+  arenaStates_ = true;
+  resetChain();
+
+  return true;
+}
 
-  smoothGain_ = 1.0f;
-  holdCounter_ = 0;
-  noiseFloorEstimate_ = 0.0f;
-  calibrationFrames_ = 0;
-  noiseState_ = 0x12345678;
-  prevNoise_ = 0.0f;
+size_t RNNoiseWrapper::stateBytes() {
+  return 2 * stateFootprint();
+}
 
+void RNNoiseWrapper::destroy() {
+  if (!arenaStates_) {
+    if (state_)  rnnoise_destroy(state_);
+    if (state2_) rnnoise_destroy(state2_);
+  }
+  state_ = state2_ = nullptr;
+  arenaStates_ = false;
+}
+
+/* Fresh post chain and metrics for a new run (both init() variants). */
+void RNNoiseWrapper::resetChain() {
+  post_ = PostChainState{};
   initFilters();
 
   metrics_.framesProcessed.store(0, std::memory_order_relaxed);
@@ -167,13 +252,6 @@ bool RNNoiseWrapper::init() {
   metrics_.vadProbability.store(0.0f, std::memory_order_relaxed);
   metrics_.currentGain.store(1.0f, std::memory_order_relaxed);
   metrics_.noiseFloor.store(0.0f, std::memory_order_relaxed);
-
-  return state_ != nullptr && state2_ != nullptr;
-}
-
-void RNNoiseWrapper::destroy() {
-  if (state_)  { rnnoise_destroy(state_);  state_  = nullptr; }
-  if (state2_) { rnnoise_destroy(state2_); state2_ = nullptr; }
 }
 
 /*
@@ -190,12 +268,12 @@ void RNNoiseWrapper::initFilters() {
    *   w0    = 2π × 80 / 48000 = 0.01047
    *   alpha = sin(w0) / (2 × Q) = 0.00741
    */
-  hpf_.b0 =  0.992631f;
-  hpf_.b1 = -1.985261f;
-  hpf_.b2 =  0.992631f;
-  hpf_.a1 = -1.985199f;
-  hpf_.a2 =  0.985323f;
-  hpf_.reset();
+  post_.hpf.b0 =  0.992631f;
+  post_.hpf.b1 = -1.985261f;
+  post_.hpf.b2 =  0.992631f;
+  post_.hpf.a1 = -1.985199f;
+  post_.hpf.a2 =  0.985323f;
+  post_.hpf.reset();
 
   /*
    * LOW-PASS at 8000 Hz (2nd order Butterworth).
@@ -208,104 +286,91 @@ void RNNoiseWrapper::initFilters() {
    *   w0    = 2π × 8000 / 48000 = π/3
    *   alpha = sin(w0) / (2 × Q) = 0.6124
    */
-  lpf_.b0 = 0.155029f;
-  lpf_.b1 = 0.310059f;
-  lpf_.b2 = 0.155029f;
-  lpf_.a1 = -0.620209f;
-  lpf_.a2 =  0.240326f;
-  lpf_.reset();
+  post_.lpf.b0 = 0.155029f;
+  post_.lpf.b1 = 0.310059f;
+  post_.lpf.b2 = 0.155029f;
+  post_.lpf.a1 = -0.620209f;
+  post_.lpf.a2 =  0.240326f;
+  post_.lpf.reset();
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- *  CORE PROCESSING PIPELINE
+ *  HELPERS
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-float RNNoiseWrapper::processFrame(float* frame) {
-  if (!state_ || !state2_) return 0.0f;
-
-  float level = suppressionLevel_.load(std::memory_order_relaxed);
+namespace {
 
-  /* Fast path: suppression fully off → passthrough. */
-  if (level <= 0.0f) {
-    float rms = computeRms(frame, kRNNoiseFrameSize);
-    metrics_.inputRms.store(rms, std::memory_order_relaxed);
-    metrics_.outputRms.store(rms, std::memory_order_relaxed);
-    metrics_.vadProbability.store(0.0f, std::memory_order_relaxed);
-    metrics_.currentGain.store(1.0f, std::memory_order_relaxed);
-    metrics_.framesProcessed.fetch_add(1, std::memory_order_relaxed);
-    return 0.0f;
+NOISEGUARD_FORCE_INLINE float computeRms(const float* buf, size_t len) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < len; i++) {
+    sum += buf[i] * buf[i];
   }
+  return std::sqrt(sum / static_cast<float>(len));
+}
 
-  /* ── 1. Measure input RMS (raw mic level) ── */
-  float inputRms = computeRms(frame, kRNNoiseFrameSize);
-  metrics_.inputRms.store(inputRms, std::memory_order_relaxed);
+/**
+ * LFSR-based comfort noise with 1-pole lowpass shaping.
+ * The Xorshift32 LFSR generates white noise; the 1-pole filter
+ * rolls off high frequencies to produce a warmer, less fatiguing sound.
+ * Final amplitude is kSoftSilenceLevel (~-60 dBFS, int16 domain).
+ */
+NOISEGUARD_FORCE_INLINE float comfortNoiseSample(PostChainState& s) {
+  s.noiseState ^= s.noiseState << 13;
+  s.noiseState ^= s.noiseState >> 17;
+  s.noiseState ^= s.noiseState << 5;
 
-  /* ── 2. Save original for blending at partial suppression ── */
-  float original[kRNNoiseFrameSize];
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    original[i] = frame[i];
-    frame[i] *= 32767.0f;   /* RNNoise expects int16 range. */
-  }
+  float white = static_cast<float>(static_cast<int32_t>(s.noiseState)) /
+                2147483648.0f;
 
-  /* ── 3. Double-pass RNNoise ── */
-  float vad1 = rnnoise_process_frame(state_,  frame, frame);
-  float vad2 = rnnoise_process_frame(state2_, frame, frame);
-  float vad = std::max(vad1, vad2);
-  metrics_.vadProbability.store(vad, std::memory_order_relaxed);
+  float shaped = kNoiseShapeCoeff * s.prevNoise
+               + (1.0f - kNoiseShapeCoeff) * white;
+  s.prevNoise = shaped;
 
-  /* Convert back to [-1.0, 1.0] float range. */
-  constexpr float kInvScale = 1.0f / 32767.0f;
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    frame[i] *= kInvScale;
-  }
+  return shaped * kSoftSilenceLevel;
+}
+
+/**
+ * Per-frame inputs shared by every stage. frame is in the int16 domain.
+ * original is the pre-RNNoise copy; only filled when the blend stage runs.
+ */
+struct FrameContext {
+  float* frame;
+  const float* original;
+  float level;         /* Suppression level (0, 1] */
+  float vad;           /* max(VAD pass 1, VAD pass 2) */
+  float vadThreshold;  /* Snapshot of vadThreshold_ for this frame */
+  AudioMetrics& metrics;
+};
 
-  /* ── 4. Blend with original based on suppression level ── */
-  if (level < 1.0f) {
-    float dry = 1.0f - level;
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  BLEND + FILTER STAGES
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+/* Mix the dry signal back in at partial suppression. */
+struct BlendStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState&, FrameContext& c) {
+    float dry = 1.0f - c.level;
     for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-      frame[i] = frame[i] * level + original[i] * dry;
+      c.frame[i] = c.frame[i] * c.level + c.original[i] * dry;
     }
   }
+};
 
-  /* ── 5. Biquad filters: HPF (80 Hz) then LPF (8 kHz) ── */
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    frame[i] = hpf_.process(frame[i]);
-    frame[i] = lpf_.process(frame[i]);
+struct HpfStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      c.frame[i] = s.hpf.process(c.frame[i]);
+    }
   }
+};
 
-  /* ── 6. Post-filter RMS (used for adaptive gate threshold) ── */
-  float postRms = computeRms(frame, kRNNoiseFrameSize);
-
-  /* ── 7. Update adaptive noise floor ── */
-  updateNoiseFloor(postRms, vad);
-
-  /* ── 8. Gate decision + hold timer ── */
-  float targetGain = computeGateTarget(vad, postRms);
-
-  /* ── 9. Asymmetric gain smoothing (fast close, slow open) ── */
-  float coeff = (targetGain < smoothGain_) ? kGateCloseCoeff : kGateOpenCoeff;
-  smoothGain_ += coeff * (targetGain - smoothGain_);
-  smoothGain_ = std::clamp(smoothGain_, kMinGateGain, 1.0f);
-  metrics_.currentGain.store(smoothGain_, std::memory_order_relaxed);
-
-  /* ── 10. Apply gate gain ── */
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    frame[i] *= smoothGain_;
+struct LpfStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      c.frame[i] = s.lpf.process(c.frame[i]);
+    }
   }
-
-  /* ── 11. Spectral floor clamp (when VAD low + gate closing) ── */
-  spectralClamp(frame, vad);
-
-  /* ── 12. Soft silence (inject comfort noise when gate closed) ── */
-  applySoftSilence(frame);
-
-  /* ── 13. Output RMS + metrics ── */
-  float outputRms = computeRms(frame, kRNNoiseFrameSize);
-  metrics_.outputRms.store(outputRms, std::memory_order_relaxed);
-  metrics_.framesProcessed.fetch_add(1, std::memory_order_relaxed);
-
-  return vad;
-}
+};
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  ADAPTIVE NOISE FLOOR
@@ -316,37 +381,36 @@ float RNNoiseWrapper::processFrame(float* frame) {
  *  gradual environmental changes (fan turning on/off, etc.).
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-void RNNoiseWrapper::updateNoiseFloor(float postRms, float vad) {
-  float vadThresh = vadThreshold_.load(std::memory_order_relaxed);
-
+NOISEGUARD_FORCE_INLINE void updateNoiseFloor(PostChainState& s,
+                                              FrameContext& c, float postRms) {
   /*
    * Only learn from frames that are very likely pure noise.
    * Use half the user's VAD threshold to be conservative: we don't
    * want speech leaking into the floor estimate.
    */
-  bool isNoise = (vad < vadThresh * 0.5f);
+  bool isNoise = (c.vad < c.vadThreshold * 0.5f);
 
   if (!isNoise) {
-    metrics_.noiseFloor.store(noiseFloorEstimate_, std::memory_order_relaxed);
+    c.metrics.noiseFloor.store(s.noiseFloorEstimate, std::memory_order_relaxed);
     return;
   }
 
   float alpha;
-  if (calibrationFrames_ < kCalibrationPeriod) {
+  if (s.calibrationFrames < kCalibrationPeriod) {
     alpha = kCalibrationAlpha;
-    calibrationFrames_++;
+    s.calibrationFrames++;
   } else {
     alpha = kTrackingAlpha;
   }
 
-  if (noiseFloorEstimate_ <= 0.0f) {
-    noiseFloorEstimate_ = postRms;
+  if (s.noiseFloorEstimate <= 0.0f) {
+    s.noiseFloorEstimate = postRms;
   } else {
-    noiseFloorEstimate_ += alpha * (postRms - noiseFloorEstimate_);
+    s.noiseFloorEstimate += alpha * (postRms - s.noiseFloorEstimate);
   }
 
-  noiseFloorEstimate_ = std::max(noiseFloorEstimate_, kAbsoluteMinFloor);
-  metrics_.noiseFloor.store(noiseFloorEstimate_, std::memory_order_relaxed);
+  s.noiseFloorEstimate = std::max(s.noiseFloorEstimate, kAbsoluteMinFloor);
+  c.metrics.noiseFloor.store(s.noiseFloorEstimate, std::memory_order_relaxed);
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
@@ -361,37 +425,40 @@ void RNNoiseWrapper::updateNoiseFloor(float postRms, float vad) {
  *    (a) VAD >= threshold, OR
  *    (b) VAD is in the hysteresis band AND energy is well above the
  *        learned noise floor (catches breathy/quiet speech).
+ *
+ *  The gate measures the frame as it arrives at the stage: post-filter in
+ *  the standard layout, pre-filter in the filters-last layout.
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-float RNNoiseWrapper::computeGateTarget(float vad, float postRms) {
-  float vadThresh = vadThreshold_.load(std::memory_order_relaxed);
-
+NOISEGUARD_FORCE_INLINE float computeGateTarget(PostChainState& s,
+                                                const FrameContext& c,
+                                                float postRms) {
   /*
    * Dynamic gate threshold from the learned noise floor.
    * Before calibration completes, use a safe fallback.
    */
-  float gateThresh = (noiseFloorEstimate_ > kAbsoluteMinFloor)
-      ? noiseFloorEstimate_ * kFloorMultiplier
+  float gateThresh = (s.noiseFloorEstimate > kAbsoluteMinFloor)
+      ? s.noiseFloorEstimate * kFloorMultiplier
       : kFallbackThreshold;
 
   /* Condition (a): strong VAD confidence. */
-  bool speechByVad = (vad >= vadThresh);
+  bool speechByVad = (c.vad >= c.vadThreshold);
 
   /*
    * Condition (b): moderate VAD + energy clearly above noise floor.
    * This catches quiet or breathy speech that has a VAD just below
    * the threshold but is obviously not noise based on energy.
    */
-  bool speechByEnergy = (vad >= vadThresh - kVadHysteresis)
+  bool speechByEnergy = (c.vad >= c.vadThreshold - kVadHysteresis)
                      && (postRms > gateThresh * 2.0f);
 
   if (speechByVad || speechByEnergy) {
-    holdCounter_ = kHoldFrames;
+    s.holdCounter = kHoldFrames;
     return 1.0f;
   }
 
-  if (holdCounter_ > 0) {
-    holdCounter_--;
+  if (s.holdCounter > 0) {
+    s.holdCounter--;
     return 1.0f;
   }
 
@@ -408,6 +475,26 @@ float RNNoiseWrapper::computeGateTarget(float vad, float postRms) {
   return std::clamp(ratio, kMinGateGain, 0.5f);
 }
 
+struct GateStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    /* Frame RMS in normalized units (used for the adaptive threshold). */
+    float postRms = computeRms(c.frame, kRNNoiseFrameSize) * kInvInt16Scale;
+
+    updateNoiseFloor(s, c, postRms);
+    float targetGain = computeGateTarget(s, c, postRms);
+
+    /* Asymmetric gain smoothing (fast close, slow open). */
+    float coeff = (targetGain < s.smoothGain) ? kGateCloseCoeff : kGateOpenCoeff;
+    s.smoothGain += coeff * (targetGain - s.smoothGain);
+    s.smoothGain = std::clamp(s.smoothGain, kMinGateGain, 1.0f);
+    c.metrics.currentGain.store(s.smoothGain, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      c.frame[i] *= s.smoothGain;
+    }
+  }
+};
+
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SPECTRAL FLOOR CLAMP
  *
@@ -419,22 +506,23 @@ float RNNoiseWrapper::computeGateTarget(float vad, float postRms) {
  *  never touches speech harmonics.
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-void RNNoiseWrapper::spectralClamp(float* frame, float vad) {
-  float vadThresh = vadThreshold_.load(std::memory_order_relaxed);
-
-  if (vad >= vadThresh || smoothGain_ > kClampGateThreshold) return;
+struct ClampStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    if (c.vad >= c.vadThreshold || s.smoothGain > kClampGateThreshold) return;
 
-  float clampThresh = std::max(
-      noiseFloorEstimate_ * kSpectralClampMult,
-      kAbsoluteMinFloor * 3.0f
-  );
+    /* Threshold is in normalized units; frame is in int16 domain. */
+    float clampThresh = std::max(
+        s.noiseFloorEstimate * kSpectralClampMult,
+        kAbsoluteMinFloor * 3.0f
+    ) * kInt16Scale;
 
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    if (std::abs(frame[i]) < clampThresh) {
-      frame[i] = 0.0f;
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      if (std::abs(c.frame[i]) < clampThresh) {
+        c.frame[i] = 0.0f;
+      }
     }
   }
-}
+};
 
 /* ═══════════════════════════════════════════════════════════════════════════
  *  SOFT SILENCE
@@ -446,16 +534,224 @@ void RNNoiseWrapper::spectralClamp(float* frame, float vad) {
  *    - Some conferencing apps detecting "no audio" and muting the channel.
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-void RNNoiseWrapper::applySoftSilence(float* frame) {
-  if (!comfortNoiseEnabled_.load(std::memory_order_relaxed)) return;
-  if (smoothGain_ >= kSoftSilenceGateThresh) return;
+struct SoftSilenceStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    if (s.smoothGain >= kSoftSilenceGateThresh) return;
 
-  /* Scale comfort noise proportionally: more as gate approaches zero. */
-  float scale = (kSoftSilenceGateThresh - smoothGain_) / kSoftSilenceGateThresh;
+    /* Scale comfort noise proportionally: more as gate approaches zero. */
+    float scale = (kSoftSilenceGateThresh - s.smoothGain) / kSoftSilenceGateThresh;
 
-  for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
-    frame[i] += comfortNoiseSample() * scale;
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      c.frame[i] += comfortNoiseSample(s) * scale;
+    }
   }
+};
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  PEAK LIMITER
+ *
+ *  Per-frame peak detection with instant gain reduction and exponential
+ *  release. The gain is ramped linearly across the frame to avoid zipper
+ *  noise; a final hard clip at the ceiling covers the first samples of a
+ *  frame whose ramp has not reached the new gain yet.
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+struct LimiterStage {
+  static NOISEGUARD_FORCE_INLINE void process(PostChainState& s, FrameContext& c) {
+    float peak = 0.0f;
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      peak = std::max(peak, std::abs(c.frame[i]));
+    }
+
+    float target = (peak > kLimiterCeiling) ? kLimiterCeiling / peak : 1.0f;
+    float start = s.limiterGain;
+    float end = (target < start) ? target
+                                 : start + kLimiterRelease * (target - start);
+    if (start >= 1.0f && end >= 1.0f) return;  /* Idle: nothing to do. */
+
+    float step = (end - start) / static_cast<float>(kRNNoiseFrameSize);
+    for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+      float g = start + step * static_cast<float>(i + 1);
+      c.frame[i] = std::clamp(c.frame[i] * g, -kLimiterCeiling, kLimiterCeiling);
+    }
+    s.limiterGain = end;
+  }
+};
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  STAGE COMPOSITION
+ *
+ *  Each layout is a fixed stage order; bit i of the mask enables
+ *  PostStage(i). All 2^kPostStageCount masks of every layout are
+ *  instantiated up front, so selection is a single table lookup per frame.
+ *  To add a layout: declare it here, list its order in kLayoutOrder and
+ *  add its table to kKernels.
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+template <uint32_t Mask, PostStage S, typename Stage>
+using When = Optional<(Mask & stageBit(S)) != 0, Stage>;
+
+/* RNNoise → blend → HPF → LPF → gate → clamp → soft silence → limiter. */
+template <uint32_t M>
+using StandardChain = Pipeline<
+    When<M, PostStage::kBlend, BlendStage>,
+    When<M, PostStage::kHpf, HpfStage>,
+    When<M, PostStage::kLpf, LpfStage>,
+    When<M, PostStage::kGate, GateStage>,
+    When<M, PostStage::kClamp, ClampStage>,
+    When<M, PostStage::kSoftSilence, SoftSilenceStage>,
+    When<M, PostStage::kLimiter, LimiterStage>>;
+
+/*
+ * RNNoise → blend → gate → clamp → soft silence → HPF → LPF → limiter.
+ * The filters smooth the clamp's hard zeroing and shape the comfort noise.
+ */
+template <uint32_t M>
+using FiltersLastChain = Pipeline<
+    When<M, PostStage::kBlend, BlendStage>,
+    When<M, PostStage::kGate, GateStage>,
+    When<M, PostStage::kClamp, ClampStage>,
+    When<M, PostStage::kSoftSilence, SoftSilenceStage>,
+    When<M, PostStage::kHpf, HpfStage>,
+    When<M, PostStage::kLpf, LpfStage>,
+    When<M, PostStage::kLimiter, LimiterStage>>;
+
+constexpr size_t kLayoutCount = 2;
+
+constexpr PostStage kLayoutOrder[kLayoutCount][kPostStageCount] = {
+    {PostStage::kBlend, PostStage::kHpf, PostStage::kLpf, PostStage::kGate,
+     PostStage::kClamp, PostStage::kSoftSilence, PostStage::kLimiter},
+    {PostStage::kBlend, PostStage::kGate, PostStage::kClamp,
+     PostStage::kSoftSilence, PostStage::kHpf, PostStage::kLpf,
+     PostStage::kLimiter},
+};
+
+using MaskSequence = std::make_index_sequence<kStageMaskCount>;
+
+constexpr std::array<StageKernel<PostChainState, FrameContext>, kStageMaskCount>
+    kKernels[kLayoutCount] = {
+        makeKernelTable<StandardChain, PostChainState, FrameContext>(MaskSequence{}),
+        makeKernelTable<FiltersLastChain, PostChainState, FrameContext>(MaskSequence{}),
+};
+
+}  // namespace
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ *  CORE PROCESSING PIPELINE
+ * ═══════════════════════════════════════════════════════════════════════════ */
+
+float RNNoiseWrapper::processFrame(float* frame) {
+  if (!state_ || !state2_) return 0.0f;
+  const ChainParams p = params();
+  FrameCaptureWriter* capture = capture_.load(std::memory_order_seq_cst);
+  if (capture) capture->beginFrame(p, CaptureEntry::kNormalized, frame);
+
+  float vad = 0.0f;
+  if (!passthrough(frame, 1.0f, p)) {
+    /* Normalized [-1, 1] -> RNNoise int16 domain, process, and back. */
+    scaleSamples(frame, kRNNoiseFrameSize, kInt16Scale);
+    vad = processScaled(frame, p);
+    scaleSamples(frame, kRNNoiseFrameSize, kInvInt16Scale);
+  }
+
+  if (capture) capture->endFrame(frame, vad);
+  return vad;
+}
+
+float RNNoiseWrapper::processFrameScaled(float* frame) {
+  if (!state_ || !state2_) return 0.0f;
+  const ChainParams p = params();
+  FrameCaptureWriter* capture = capture_.load(std::memory_order_seq_cst);
+  if (capture) capture->beginFrame(p, CaptureEntry::kScaled, frame);
+
+  float vad = 0.0f;
+  if (!passthrough(frame, kInvInt16Scale, p)) vad = processScaled(frame, p);
+
+  if (capture) capture->endFrame(frame, vad);
+  return vad;
+}
+
+bool RNNoiseWrapper::passthrough(const float* frame, float toNormalized,
+                                 const ChainParams& p) {
+  /* Fast path: suppression fully off → passthrough. */
+  if (p.level > 0.0f) return false;
+
+  /* Bypassed: the "RNNoise output" is the input, keeping taps aligned. */
+  if (TapRecorder* tap = tap_.load(std::memory_order_seq_cst)) {
+    tap->write(TapPoint::kPostRNNoise, frame, kRNNoiseFrameSize, toNormalized);
+  }
+
+  float rms = computeRms(frame, kRNNoiseFrameSize) * toNormalized;
+  metrics_.inputRms.store(rms, std::memory_order_relaxed);
+  metrics_.outputRms.store(rms, std::memory_order_relaxed);
+  metrics_.vadProbability.store(0.0f, std::memory_order_relaxed);
+  metrics_.currentGain.store(1.0f, std::memory_order_relaxed);
+  metrics_.framesProcessed.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+/*
+ * The whole chain runs in RNNoise's int16-range domain. Filters and gate
+ * gain are scale-invariant; level comparisons (noise floor, gate threshold)
+ * stay in normalized units by scaling the per-frame RMS values, and the only
+ * per-sample constants (clamp threshold, comfort noise, limiter ceiling)
+ * are pre-scaled.
+ */
+float RNNoiseWrapper::processScaled(float* frame, const ChainParams& p) {
+  float level = p.level;
+
+  /* ── 1. Pick the kernel: runtime flags fold into the stage mask ── */
+  uint32_t layout = p.chainSelector >> kLayoutShift;
+  uint32_t mask = p.chainSelector & (kStageMaskCount - 1);
+  if (level >= 1.0f) mask &= ~stageBit(PostStage::kBlend);
+  if (!p.comfortNoise) {
+    mask &= ~stageBit(PostStage::kSoftSilence);
+  }
+  if (!(mask & stageBit(PostStage::kGate))) {
+    /* No gate: report (and let clamp / soft silence see) an open gate. */
+    post_.smoothGain = 1.0f;
+    metrics_.currentGain.store(1.0f, std::memory_order_relaxed);
+  }
+
+  /* ── 2. Measure input RMS (raw mic level, normalized) ── */
+  float inputRms = computeRms(frame, kRNNoiseFrameSize) * kInvInt16Scale;
+  metrics_.inputRms.store(inputRms, std::memory_order_relaxed);
+
+  /* ── 3. Save original for blending at partial suppression ── */
+  float original[kRNNoiseFrameSize];
+  if (mask & stageBit(PostStage::kBlend)) {
+    std::memcpy(original, frame, sizeof(original));
+  }
+
+  /* ── 4. Double-pass RNNoise ── */
+  float vad1, vad2;
+  {
+    TraceSpan traceSpan("rnnoise_pass1");
+    vad1 = rnnoise_process_frame(state_,  frame, frame);
+  }
+  {
+    TraceSpan traceSpan("rnnoise_pass2");
+    vad2 = rnnoise_process_frame(state2_, frame, frame);
+  }
+  float vad = std::max(vad1, vad2);
+  metrics_.vadProbability.store(vad, std::memory_order_relaxed);
+  if (TapRecorder* tap = tap_.load(std::memory_order_seq_cst)) {
+    tap->write(TapPoint::kPostRNNoise, frame, kRNNoiseFrameSize, kInvInt16Scale);
+  }
+
+  /* ── 5. Post chain (blend, filters, gate, clamp, soft silence, limiter) ── */
+  FrameContext ctx{frame, original, level, vad, p.vadThreshold, metrics_};
+  {
+    TraceSpan traceSpan("post_chain");
+    kKernels[layout][mask](post_, ctx);
+  }
+
+  /* ── 6. Output RMS + metrics ── */
+  float outputRms = computeRms(frame, kRNNoiseFrameSize) * kInvInt16Scale;
+  metrics_.outputRms.store(outputRms, std::memory_order_relaxed);
+  metrics_.framesProcessed.fetch_add(1, std::memory_order_relaxed);
+
+  return vad;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
@@ -484,37 +780,175 @@ void RNNoiseWrapper::setComfortNoise(bool enabled) {
   comfortNoiseEnabled_.store(enabled, std::memory_order_relaxed);
 }
 
+bool RNNoiseWrapper::setPostChain(const std::vector<PostStage>& stages) {
+  uint32_t mask = 0;
+  for (PostStage s : stages) {
+    if (static_cast<size_t>(s) >= kPostStageCount) return false;
+    if (mask & stageBit(s)) return false;  /* Listed twice. */
+    mask |= stageBit(s);
+  }
+
+  /* Supported iff stages is a subsequence of some layout's order. */
+  for (uint32_t layout = 0; layout < kLayoutCount; layout++) {
+    size_t matched = 0;
+    for (PostStage s : kLayoutOrder[layout]) {
+      if (matched < stages.size() && stages[matched] == s) matched++;
+    }
+    if (matched == stages.size()) {
+      chainSelector_.store(mask | (layout << kLayoutShift),
+                           std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+ChainParams RNNoiseWrapper::params() const {
+  ChainParams p;
+  p.level = suppressionLevel_.load(std::memory_order_relaxed);
+  p.vadThreshold = vadThreshold_.load(std::memory_order_relaxed);
+  p.comfortNoise = comfortNoiseEnabled_.load(std::memory_order_relaxed);
+  p.chainSelector = chainSelector_.load(std::memory_order_relaxed);
+  return p;
+}
+
+ChainParams RNNoiseWrapper::defaultParams() {
+  ChainParams p;
+  p.chainSelector = kDefaultStageMask;
+  return p;
+}
+
+bool RNNoiseWrapper::applyParams(const ChainParams& p) {
+  uint32_t layout = p.chainSelector >> kLayoutShift;
+  if (layout >= kLayoutCount ||
+      (p.chainSelector & ((1u << kLayoutShift) - kStageMaskCount)) != 0) {
+    return false;
+  }
+  setSuppressionLevel(p.level);
+  setVadThreshold(p.vadThreshold);
+  setComfortNoise(p.comfortNoise);
+  chainSelector_.store(p.chainSelector, std::memory_order_relaxed);
+  return true;
+}
+
+std::vector<PostStage> RNNoiseWrapper::postChain() const {
+  uint32_t selector = chainSelector_.load(std::memory_order_relaxed);
+  uint32_t mask = selector & (kStageMaskCount - 1);
+  std::vector<PostStage> stages;
+  for (PostStage s : kLayoutOrder[selector >> kLayoutShift]) {
+    if (mask & stageBit(s)) stages.push_back(s);
+  }
+  return stages;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
- *  HELPERS
+ *  STATE SERIALIZATION (format in rnnoise_wrapper.h)
  * ═══════════════════════════════════════════════════════════════════════════ */
 
-float RNNoiseWrapper::computeRms(const float* buf, size_t len) {
-  float sum = 0.0f;
-  for (size_t i = 0; i < len; i++) {
-    sum += buf[i] * buf[i];
-  }
-  return std::sqrt(sum / static_cast<float>(len));
+static constexpr char kStateMagic[4] = {'N', 'G', 'S', 'T'};
+static constexpr uint32_t kStateVersion = 1;
+static constexpr char kUnsupportedLayout[] =
+    "this RNNoise build's state layout is not supported (see rnnoise_state.h)";
+
+static void writeBiquad(StateWriter& w, const BiquadState& b) {
+  w.f32(b.x1); w.f32(b.x2); w.f32(b.y1); w.f32(b.y2);
 }
 
-/**
- * LFSR-based comfort noise with 1-pole lowpass shaping.
- * The Xorshift32 LFSR generates white noise; the 1-pole filter
- * rolls off high frequencies to produce a warmer, less fatiguing sound.
- * Final amplitude is kSoftSilenceLevel (~-60 dBFS).
- */
-float RNNoiseWrapper::comfortNoiseSample() {
-  noiseState_ ^= noiseState_ << 13;
-  noiseState_ ^= noiseState_ >> 17;
-  noiseState_ ^= noiseState_ << 5;
+static void readBiquad(StateReader& r, BiquadState& b) {
+  b.x1 = r.f32(); b.x2 = r.f32(); b.y1 = r.f32(); b.y2 = r.f32();
+}
 
-  float white = static_cast<float>(static_cast<int32_t>(noiseState_)) /
-                2147483648.0f;
+size_t RNNoiseWrapper::stateSize() const {
+  if (!state_ || stateFootprint() == 0) return 0;
+  /* Header, params, post chain, frame counter, then both RNNoise states. */
+  return 3 * 4 + 4 * 4 + (2 * 4) + (4 + 8) + 2 * 4 * 4 + 3 * 4 + 8 +
+         2 * ng_rnnoise_state_bytes(state_);
+}
 
-  float shaped = kNoiseShapeCoeff * prevNoise_
-               + (1.0f - kNoiseShapeCoeff) * white;
-  prevNoise_ = shaped;
+std::string RNNoiseWrapper::saveState(std::vector<uint8_t>& out) const {
+  if (!state_ || !state2_) return "RNNoise is not initialized";
+  if (stateFootprint() == 0) return kUnsupportedLayout;
+  const size_t rnnoiseBytes = ng_rnnoise_state_bytes(state_);
+  out.clear();
+  out.reserve(stateSize());
+
+  StateWriter w(out);
+  w.bytes(kStateMagic, sizeof(kStateMagic));
+  w.u32(kStateVersion);
+  w.u32(static_cast<uint32_t>(rnnoiseBytes));
+
+  const ChainParams p = params();
+  w.f32(p.level);
+  w.f32(p.vadThreshold);
+  w.u32(p.comfortNoise ? 1 : 0);
+  w.u32(p.chainSelector);
+
+  w.f32(post_.smoothGain);
+  w.i32(post_.holdCounter);
+  w.f32(post_.noiseFloorEstimate);
+  w.u64(post_.calibrationFrames);
+  writeBiquad(w, post_.hpf);
+  writeBiquad(w, post_.lpf);
+  w.u32(post_.noiseState);
+  w.f32(post_.prevNoise);
+  w.f32(post_.limiterGain);
+  w.u64(metrics_.framesProcessed.load(std::memory_order_relaxed));
+
+  ng_rnnoise_state_save(state_, w.extend(rnnoiseBytes));
+  ng_rnnoise_state_save(state2_, w.extend(rnnoiseBytes));
+  return "";
+}
 
-  return shaped * kSoftSilenceLevel;
+std::string RNNoiseWrapper::loadState(const uint8_t* data, size_t size) {
+  if (!state_ || !state2_) return "RNNoise is not initialized";
+  if (stateFootprint() == 0) return kUnsupportedLayout;
+
+  StateReader r(data, size);
+  char magic[4];
+  r.bytes(magic, sizeof(magic));
+  if (!r.ok() || std::memcmp(magic, kStateMagic, sizeof(magic)) != 0) {
+    return "not a NoiseGuard state blob";
+  }
+  uint32_t version = r.u32();
+  if (version != kStateVersion) {
+    return "unsupported state version " + std::to_string(version);
+  }
+  const size_t rnnoiseBytes = r.u32();
+  if (r.ok() && rnnoiseBytes != ng_rnnoise_state_bytes(state_)) {
+    return "state was saved by a different RNNoise build or model";
+  }
+
+  ChainParams p;
+  p.level = r.f32();
+  p.vadThreshold = r.f32();
+  p.comfortNoise = r.u32() != 0;
+  p.chainSelector = r.u32();
+
+  /* Start from the current state so the filter coefficients carry over. */
+  PostChainState post = post_;
+  post.smoothGain = r.f32();
+  post.holdCounter = r.i32();
+  post.noiseFloorEstimate = r.f32();
+  post.calibrationFrames = r.u64();
+  readBiquad(r, post.hpf);
+  readBiquad(r, post.lpf);
+  post.noiseState = r.u32();
+  post.prevNoise = r.f32();
+  post.limiterGain = r.f32();
+  uint64_t frames = r.u64();
+
+  const uint8_t* pass1 = r.take(rnnoiseBytes);
+  const uint8_t* pass2 = r.take(rnnoiseBytes);
+  if (!r.ok() || r.remaining() != 0) return "state blob has the wrong size";
+  if (!applyParams(p)) return "state blob has an invalid post chain";
+
+  post_ = post;
+  ng_rnnoise_state_load(state_, pass1);
+  ng_rnnoise_state_load(state2_, pass2);
+  metrics_.framesProcessed.store(frames, std::memory_order_relaxed);
+  metrics_.noiseFloor.store(post.noiseFloorEstimate, std::memory_order_relaxed);
+  metrics_.currentGain.store(post.smoothGain, std::memory_order_relaxed);
+  return "";
 }
 
 }  // namespace noiseguard
@@ -12,12 +12,34 @@
  *      threshold to exact zero when VAD is low.
  *   5. Soft silence: injects shaped comfort noise at -60 dBFS when the
  *      gate is closed, preventing ear fatigue and channel "dead air".
- *   6. Real-time metrics (input/output RMS, VAD, gate gain, noise floor).
+ *   6. Optional peak limiter (off by default).
+ *   7. Real-time metrics (input/output RMS, VAD, gate gain, noise floor).
+ *
+ * Stages 2-6 (plus the dry/wet blend) are types composed at compile time
+ * into fully inlined per-frame kernels (see dsp_pipeline.h). Every
+ * supported order x enabled-stage combination is pre-instantiated; the
+ * processing thread picks one kernel per frame, so dropping or reordering
+ * stages costs no virtual calls or per-stage branches.
  *
  * REAL-TIME RULES:
  * - processFrame() does NO allocations -- pure arithmetic, fixed loops.
- * - setSuppressionLevel() / setVadThreshold() are lock-free (atomic store).
+ * - setSuppressionLevel() / setVadThreshold() / setPostChain() are lock-free
+ *   (atomic store).
  * - init() and destroy() are NOT real-time safe.
+ *
+ * STATE BLOB (saveState() / loadState(); little-endian, version 1):
+ *
+ *   "NGST"  u32 version  u32 rnnoiseBytes
+ *   params  f32 level  f32 vadThreshold  u32 comfortNoise  u32 chainSelector
+ *   gate    f32 smoothGain  i32 holdCounter
+ *   floor   f32 noiseFloorEstimate  u64 calibrationFrames
+ *   filters f32 hpf{x1 x2 y1 y2}  f32 lpf{x1 x2 y1 y2}
+ *   noise   u32 lfsr  f32 prevNoise  f32 limiterGain
+ *   u64 framesProcessed
+ *   u8 rnnoise[2][rnnoiseBytes]    -- both passes (rnnoise_state.h)
+ *
+ * Filter coefficients are constants and not stored. A blob only loads
+ * into the same RNNoise build and model (rnnoiseBytes must match).
  */
 
 #ifndef NOISEGUARD_RNNOISE_WRAPPER_H
@@ -26,6 +48,8 @@
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <string>
+#include <vector>
 
 /* Forward-declare RNNoise opaque type. */
 struct DenoiseState;
@@ -70,6 +94,63 @@ struct BiquadState {
   }
 };
 
+/**
+ * Post-RNNoise stages. Values double as bit positions in a stage mask.
+ * kBlend = dry/wet mix at partial suppression; kSoftSilence = comfort noise.
+ */
+enum class PostStage : uint8_t {
+  kBlend = 0,
+  kHpf,
+  kLpf,
+  kGate,
+  kClamp,
+  kSoftSilence,
+  kLimiter,
+};
+
+static constexpr size_t kPostStageCount = 7;
+
+/**
+ * State carried by the post-RNNoise stages between frames.
+ * Processing thread only -- NOT atomic.
+ */
+struct PostChainState {
+  /* ── Gate ── */
+  float smoothGain = 1.0f;
+  int holdCounter = 0;
+
+  /* ── Adaptive noise floor ── */
+  float noiseFloorEstimate = 0.0f;
+  uint64_t calibrationFrames = 0;
+
+  /* ── Biquad filters ── */
+  BiquadState hpf;   /* High-pass at 80 Hz */
+  BiquadState lpf;   /* Low-pass at 8 kHz */
+
+  /* ── LFSR + shaping state for comfort noise ── */
+  uint32_t noiseState = 0x12345678;
+  float prevNoise = 0.0f;
+
+  /* ── Limiter envelope (gain applied at the end of the last frame) ── */
+  float limiterGain = 1.0f;
+};
+
+/**
+ * The user parameters one frame runs with. Loaded once at the start of
+ * each frame, so a setter racing with processing takes effect on a whole
+ * frame -- and a capture can record exactly what each frame used.
+ */
+struct ChainParams {
+  float level = 1.0f;           /* Suppression level [0, 1] */
+  float vadThreshold = 0.65f;   /* Gate threshold [0, 1] */
+  bool comfortNoise = true;     /* Soft silence injection */
+  uint32_t chainSelector = 0;   /* Post-chain stage mask | (layout << 16) */
+};
+
+class TapRecorder;
+class FrameCaptureWriter;
+class SessionArena;
+
 class RNNoiseWrapper {
  public:
   RNNoiseWrapper();
@@ -81,13 +162,31 @@ class RNNoiseWrapper {
   /** Initialize RNNoise states, filters, and gate state. */
   bool init();
 
-  /** Destroy RNNoise states. */
+  /**
+   * Same as init(), but both RNNoise states (GRU blocks included) are
+   * carved from arena instead of the heap. They stay valid until destroy()
+   * and the arena must not be reset before that.
+   */
+  bool init(SessionArena& arena);
+
+  /**
+   * Same as init(), with both RNNoise states built in memory: stateBytes()
+   * bytes, kArenaAlign-aligned, e.g. part of a slot the caller carved.
+   * Calling it again on the same memory starts over in place.
+   */
+  bool init(void* memory);
+
+  /** Bytes the arena variants of init() place the two RNNoise states in. */
+  static size_t stateBytes();
+
+  /** Destroy RNNoise states (arena states are just dropped). */
   void destroy();
 
   /**
-   * Process a single frame IN-PLACE. frame must point to kRNNoiseFrameSize floats.
+   * Process a single frame IN-PLACE. frame must point to kRNNoiseFrameSize
+   * floats in normalized [-1.0, 1.0] range.
    *
-   * Full pipeline (all real-time safe):
+   * Full pipeline (all real-time safe, run in RNNoise's int16 domain):
    *   1.  Measure input RMS
    *   2.  Double-pass RNNoise (primary + residual suppression)
    *   3.  Blend with original based on suppression level
@@ -100,12 +199,22 @@ class RNNoiseWrapper {
    *   10. Apply gate gain
    *   11. Spectral floor clamp (force residuals to zero when VAD low)
    *   12. Soft silence injection (shaped -60 dBFS noise when gate closed)
-   *   13. Measure output RMS, update metrics
+   *   13. Peak limiter (if enabled)
+   *   14. Measure output RMS, update metrics
+   *
+   * Steps 3-13 run as the kernel selected by setPostChain().
    *
    * Returns the RNNoise VAD probability [0.0, 1.0].
    */
   float processFrame(float* frame);
 
+  /**
+   * Same as processFrame(), but frame is already in RNNoise's int16-range
+   * float domain (e.g. straight from an int16/int24 capture) and is left in
+   * that domain. Skips both normalize/denormalize passes.
+   */
+  float processFrameScaled(float* frame);
+
   /** Set suppression level [0.0 = bypass, 1.0 = full]. Thread-safe. */
   void setSuppressionLevel(float level);
   float getSuppressionLevel() const;
@@ -117,6 +226,67 @@ class RNNoiseWrapper {
   /** Enable/disable soft silence injection during gated silence. */
   void setComfortNoise(bool enabled);
 
+  /**
+   * Select which post-RNNoise stages run, and in what order. stages lists
+   * the enabled stages; omitted stages are dropped. The order must match
+   * one of the pre-instantiated layouts:
+   *   standard:     blend, hpf, lpf, gate, clamp, softSilence, limiter
+   *   filters last: blend, gate, clamp, softSilence, hpf, lpf, limiter
+   * (any subsequence of either). Returns false, leaving the chain unchanged,
+   * if the order is not supported. Thread-safe; takes effect next frame.
+   */
+  bool setPostChain(const std::vector<PostStage>& stages);
+
+  /** The currently selected post-RNNoise stages, in processing order. */
+  std::vector<PostStage> postChain() const;
+
+  /**
+   * Record each frame's raw RNNoise output (before the post chain) at tap's
+   * kPostRNNoise point; nullptr to stop. The caller keeps tap alive until
+   * processing can no longer observe it (see AudioEngine::stopRecording()).
+   */
+  void setTap(TapRecorder* tap) { tap_.store(tap, std::memory_order_seq_cst); }
+
+  /**
+   * Record every frame (input, output, parameters) to capture; nullptr to
+   * stop. Attach right after init() so the capture starts from a fresh
+   * chain and replays bit-exactly. Same lifetime rule as setTap().
+   */
+  void setCapture(FrameCaptureWriter* capture) {
+    capture_.store(capture, std::memory_order_seq_cst);
+  }
+
+  /** Snapshot of the current parameters. */
+  ChainParams params() const;
+
+  /** The parameters a new wrapper starts with. */
+  static ChainParams defaultParams();
+
+  /**
+   * Set all parameters at once, e.g. from a capture during replay.
+   * Returns false (changing nothing) if the chain selector is invalid.
+   */
+  bool applyParams(const ChainParams& params);
+
+  /**
+   * Serialize the complete processing state -- both RNNoise states, filter
+   * histories, gate / hold / noise floor, the comfort-noise LFSR and the
+   * parameters -- into out (replaced). A wrapper that loads it continues
+   * with bit-identical output, on this or another thread or host. Call
+   * from the processing thread, or while nothing processes. NOT real-time
+   * safe (allocates). Returns empty string on success, or an error message.
+   */
+  std::string saveState(std::vector<uint8_t>& out) const;
+
+  /**
+   * Replace the processing state with a saveState() blob. init() first.
+   * On error the wrapper is left unchanged. Same threading as saveState().
+   */
+  std::string loadState(const uint8_t* data, size_t size);
+
+  /** Bytes saveState() produces (0 before init()). */
+  size_t stateSize() const;
+
   bool isInitialized() const { return state_ != nullptr; }
 
   /** Access real-time metrics (lock-free atomic reads). */
@@ -126,40 +296,31 @@ class RNNoiseWrapper {
   /* ── RNNoise instances (double-pass) ── */
   DenoiseState* state_ = nullptr;
   DenoiseState* state2_ = nullptr;
+  bool arenaStates_ = false;  /* Carved by init(SessionArena&), not rnnoise_create() */
 
   /* ── User-configurable parameters (atomic for lock-free UI access) ── */
   std::atomic<float> suppressionLevel_{1.0f};
   std::atomic<float> vadThreshold_{0.65f};
   std::atomic<bool> comfortNoiseEnabled_{true};
 
-  /* ── Gate state (processing thread only -- NOT atomic) ── */
-  float smoothGain_ = 1.0f;
-  int holdCounter_ = 0;
+  /* ── Post-chain selection: stage mask | (layout index << 16) ── */
+  std::atomic<uint32_t> chainSelector_;
 
-  /* ── Adaptive noise floor (processing thread only) ── */
-  float noiseFloorEstimate_ = 0.0f;
-  uint64_t calibrationFrames_ = 0;
+  /* ── QA recording tap and frame capture (optional) ── */
+  std::atomic<TapRecorder*> tap_{nullptr};
+  std::atomic<FrameCaptureWriter*> capture_{nullptr};
 
-  /* ── Biquad filters (processing thread only) ── */
-  BiquadState hpf_;   /* High-pass at 80 Hz */
-  BiquadState lpf_;   /* Low-pass at 8 kHz */
-
-  /* ── LFSR + shaping state for comfort noise ── */
-  uint32_t noiseState_ = 0x12345678;
-  float prevNoise_ = 0.0f;
+  /* ── Post-chain state (processing thread only) ── */
+  PostChainState post_;
 
   /* ── Metrics ── */
   AudioMetrics metrics_;
 
   /* ── Helper functions (all real-time safe) ── */
+  bool passthrough(const float* frame, float toNormalized, const ChainParams& p);
+  float processScaled(float* frame, const ChainParams& p);
   void initFilters();
-  void updateNoiseFloor(float postRms, float vad);
-  float computeGateTarget(float vad, float postRms);
-  void spectralClamp(float* frame, float vad);
-  void applySoftSilence(float* frame);
-  float comfortNoiseSample();
-
-  static float computeRms(const float* buf, size_t len);
+  void resetChain();
 };
 
 }  // namespace noiseguard
@@ -0,0 +1,347 @@
+/**
+ * RtScope bookkeeping and the libc interposers behind it.
+ *
+ * Each interposer checks the calling thread's scope depth, reports if it is
+ * inside an RtScope, and forwards to the real function: the allocator via
+ * glibc's exported __libc_* entry points, everything else via
+ * dlsym(RTLD_NEXT) (resolved at load time, so never from inside a scope).
+ * Reports are written with raw syscalls and a pre-warmed backtrace(), so
+ * reporting does not itself trip the checks.
+ */
+
+#include "rt_check.h"
+
+#ifdef NOISEGUARD_RT_CHECK
+
+#include <atomic>
+#include <cstdio>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#define NOISEGUARD_RT_INTERPOSE 1
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdarg>
+#include <ctime>
+#endif
+
+namespace noiseguard {
+
+/* Distinct stacks reported in full; later hits are only counted. */
+static constexpr size_t kMaxReportedSites = 256;
+
+/* Frames hashed to tell call sites apart (operator new alone is one site). */
+static constexpr int kSiteFrames = 8;
+
+/* Stack frames printed per report. */
+static constexpr int kReportFrames = 24;
+
+namespace {
+
+thread_local int t_depth = 0;
+thread_local const char* t_scope = nullptr;
+thread_local bool t_reporting = false;
+
+std::atomic<uint64_t> g_violations{0};
+std::atomic<uint64_t> g_scopes{0};
+std::atomic<uint64_t> g_reportedSites[kMaxReportedSites];
+
+/** Claim site for a full report. False if it was reported before (or the table is full). */
+bool firstReport(uint64_t site) {
+  for (auto& slot : g_reportedSites) {
+    uint64_t cur = slot.load(std::memory_order_acquire);
+    if (cur == site) return false;
+    if (cur == 0) {
+      if (slot.compare_exchange_strong(cur, site, std::memory_order_acq_rel)) return true;
+      if (cur == site) return false;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+RtScope::RtScope(const char* name) : outer_(t_scope) {
+  t_scope = name;
+  t_depth++;
+  g_scopes.fetch_add(1, std::memory_order_relaxed);
+}
+
+RtScope::~RtScope() {
+  t_depth--;
+  t_scope = outer_;
+}
+
+uint64_t rtViolationCount() { return g_violations.load(std::memory_order_relaxed); }
+uint64_t rtScopeCount() { return g_scopes.load(std::memory_order_relaxed); }
+
+#ifdef NOISEGUARD_RT_INTERPOSE
+
+bool rtCheckActive() { return true; }
+
+namespace {
+
+void rawWrite(const char* s, size_t n) {
+  while (n > 0) {
+    long w = syscall(SYS_write, 2, s, n);
+    if (w <= 0) return;
+    s += w;
+    n -= static_cast<size_t>(w);
+  }
+}
+
+/** FNV-1a over the innermost frames; never 0 (0 marks a free table slot). */
+uint64_t siteHash(void* const* frames, int depth) {
+  uint64_t h = 1469598103934665603ull;
+  for (int i = 0; i < depth && i < kSiteFrames; i++) {
+    h ^= reinterpret_cast<uintptr_t>(frames[i]);
+    h *= 1099511628211ull;
+  }
+  return h ? h : 1;
+}
+
+/** Called by every interposer. */
+void check(const char* what) {
+  if (t_depth == 0 || t_reporting) return;
+  t_reporting = true;
+  g_violations.fetch_add(1, std::memory_order_relaxed);
+  void* frames[kReportFrames];
+  int depth = backtrace(frames, kReportFrames);
+  if (firstReport(siteHash(frames, depth))) {
+    char line[256];
+    int n = std::snprintf(line, sizeof(line),
+                          "[rt-check] %s() on a real-time thread (in %s)\n", what,
+                          t_scope ? t_scope : "?");
+    rawWrite(line, static_cast<size_t>(n > 0 ? n : 0));
+    backtrace_symbols_fd(frames, depth, 2);
+  }
+  t_reporting = false;
+}
+
+template <typename Fn>
+Fn resolve(const char* name) {
+  return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+/* Real functions, resolved at load time (see init below). */
+struct RealFns {
+  int (*mutexLock)(pthread_mutex_t*);
+  int (*mutexTrylock)(pthread_mutex_t*);
+  int (*mutexUnlock)(pthread_mutex_t*);
+  int (*condWait)(pthread_cond_t*, pthread_mutex_t*);
+  int (*condTimedwait)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+  int (*condSignal)(pthread_cond_t*);
+  int (*condBroadcast)(pthread_cond_t*);
+  void* (*alignedAlloc)(size_t, size_t);
+  int (*posixMemalign)(void**, size_t, size_t);
+  ssize_t (*read)(int, void*, size_t);
+  ssize_t (*write)(int, const void*, size_t);
+  int (*open)(const char*, int, ...);
+  int (*close)(int);
+  int (*fsync)(int);
+  int (*nanosleep)(const struct timespec*, struct timespec*);
+  int (*clockNanosleep)(clockid_t, int, const struct timespec*, struct timespec*);
+  int (*usleep)(useconds_t);
+  int (*poll)(struct pollfd*, nfds_t, int);
+  int (*select)(int, fd_set*, fd_set*, fd_set*, struct timeval*);
+  int (*schedYield)();
+};
+
+RealFns g_real;
+
+/** The real function, resolved now if a call arrives before init (other constructors). */
+template <typename Fn>
+Fn real(Fn& slot, const char* name) {
+  if (!slot) slot = resolve<Fn>(name);
+  return slot;
+}
+
+__attribute__((constructor(101))) void initRtCheck() {
+  real(g_real.mutexLock, "pthread_mutex_lock");
+  real(g_real.mutexTrylock, "pthread_mutex_trylock");
+  real(g_real.mutexUnlock, "pthread_mutex_unlock");
+  real(g_real.condWait, "pthread_cond_wait");
+  real(g_real.condTimedwait, "pthread_cond_timedwait");
+  real(g_real.condSignal, "pthread_cond_signal");
+  real(g_real.condBroadcast, "pthread_cond_broadcast");
+  real(g_real.alignedAlloc, "aligned_alloc");
+  real(g_real.posixMemalign, "posix_memalign");
+  real(g_real.read, "read");
+  real(g_real.write, "write");
+  real(g_real.open, "open");
+  real(g_real.close, "close");
+  real(g_real.fsync, "fsync");
+  real(g_real.nanosleep, "nanosleep");
+  real(g_real.clockNanosleep, "clock_nanosleep");
+  real(g_real.usleep, "usleep");
+  real(g_real.poll, "poll");
+  real(g_real.select, "select");
+  real(g_real.schedYield, "sched_yield");
+
+  /* backtrace() loads libgcc_s on first use; do it now, not mid-report. */
+  void* warm[2];
+  backtrace(warm, 2);
+}
+
+}  // namespace
+
+}  // namespace noiseguard
+
+/* ═══ Interposers ═══ */
+
+using noiseguard::check;
+using noiseguard::g_real;
+using noiseguard::real;
+
+extern "C" {
+
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void __libc_free(void*);
+
+void* malloc(size_t n) {
+  check("malloc");
+  return __libc_malloc(n);
+}
+
+void* calloc(size_t n, size_t size) {
+  check("calloc");
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t n) {
+  check("realloc");
+  return __libc_realloc(p, n);
+}
+
+void free(void* p) {
+  if (p) check("free");
+  __libc_free(p);
+}
+
+void* aligned_alloc(size_t alignment, size_t n) {
+  check("aligned_alloc");
+  return real(g_real.alignedAlloc, "aligned_alloc")(alignment, n);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t n) {
+  check("posix_memalign");
+  return real(g_real.posixMemalign, "posix_memalign")(out, alignment, n);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* m) {
+  check("pthread_mutex_lock");
+  return real(g_real.mutexLock, "pthread_mutex_lock")(m);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* m) {
+  check("pthread_mutex_trylock");
+  return real(g_real.mutexTrylock, "pthread_mutex_trylock")(m);
+}
+
+int pthread_mutex_unlock(pthread_mutex_t* m) {
+  check("pthread_mutex_unlock");
+  return real(g_real.mutexUnlock, "pthread_mutex_unlock")(m);
+}
+
+int pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m) {
+  check("pthread_cond_wait");
+  return real(g_real.condWait, "pthread_cond_wait")(c, m);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t) {
+  check("pthread_cond_timedwait");
+  return real(g_real.condTimedwait, "pthread_cond_timedwait")(c, m, t);
+}
+
+int pthread_cond_signal(pthread_cond_t* c) {
+  check("pthread_cond_signal");
+  return real(g_real.condSignal, "pthread_cond_signal")(c);
+}
+
+int pthread_cond_broadcast(pthread_cond_t* c) {
+  check("pthread_cond_broadcast");
+  return real(g_real.condBroadcast, "pthread_cond_broadcast")(c);
+}
+
+ssize_t read(int fd, void* buf, size_t n) {
+  check("read");
+  return real(g_real.read, "read")(fd, buf, n);
+}
+
+ssize_t write(int fd, const void* buf, size_t n) {
+  check("write");
+  return real(g_real.write, "write")(fd, buf, n);
+}
+
+int open(const char* path, int flags, ...) {
+  check("open");
+  mode_t mode = 0;
+  if (flags & O_CREAT) {
+    va_list args;
+    va_start(args, flags);
+    mode = static_cast<mode_t>(va_arg(args, int));
+    va_end(args);
+  }
+  return real(g_real.open, "open")(path, flags, mode);
+}
+
+int close(int fd) {
+  check("close");
+  return real(g_real.close, "close")(fd);
+}
+
+int fsync(int fd) {
+  check("fsync");
+  return real(g_real.fsync, "fsync")(fd);
+}
+
+int nanosleep(const struct timespec* req, struct timespec* rem) {
+  check("nanosleep");
+  return real(g_real.nanosleep, "nanosleep")(req, rem);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const struct timespec* req,
+                    struct timespec* rem) {
+  check("clock_nanosleep");
+  return real(g_real.clockNanosleep, "clock_nanosleep")(clock, flags, req, rem);
+}
+
+int usleep(useconds_t us) {
+  check("usleep");
+  return real(g_real.usleep, "usleep")(us);
+}
+
+int poll(struct pollfd* fds, nfds_t n, int timeout) {
+  check("poll");
+  return real(g_real.poll, "poll")(fds, n, timeout);
+}
+
+int select(int n, fd_set* r, fd_set* w, fd_set* e, struct timeval* timeout) {
+  check("select");
+  return real(g_real.select, "select")(n, r, w, e, timeout);
+}
+
+int sched_yield() {
+  check("sched_yield");
+  return real(g_real.schedYield, "sched_yield")();
+}
+
+}  // extern "C"
+
+#else  // !NOISEGUARD_RT_INTERPOSE
+
+bool rtCheckActive() { return false; }
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_RT_INTERPOSE
+
+#endif  // NOISEGUARD_RT_CHECK
@@ -0,0 +1,67 @@
+/**
+ * Real-time-safety checker for instrumented builds.
+ *
+ * audio.h promises that the PortAudio callbacks and the processing path
+ * make no allocations, take no locks and make no blocking system calls.
+ * Code that makes that promise opens an RtScope; in a build with
+ * NOISEGUARD_RT_CHECK defined, every call into the allocator, pthread
+ * mutexes / condition variables or a blocking syscall made while the
+ * calling thread is inside a scope is a violation, reported once per call
+ * site on stderr with a stack trace and counted.
+ *
+ * The checks work by interposing the libc functions (rt_check.cpp), which
+ * only takes effect where our definitions win symbol resolution: an
+ * executable that links rt_check.cpp on Linux/glibc, such as
+ * tools/ng_rtcheck. Elsewhere scopes are tracked but nothing is checked.
+ *
+ * Without NOISEGUARD_RT_CHECK (all normal builds) RtScope is an empty
+ * object and costs nothing.
+ */
+
+#ifndef NOISEGUARD_RT_CHECK_H
+#define NOISEGUARD_RT_CHECK_H
+
+#include <cstdint>
+
+namespace noiseguard {
+
+#ifdef NOISEGUARD_RT_CHECK
+
+/** Marks the calling thread real-time until destroyed. Nests. */
+class RtScope {
+ public:
+  explicit RtScope(const char* name);
+  ~RtScope();
+
+  RtScope(const RtScope&) = delete;
+  RtScope& operator=(const RtScope&) = delete;
+
+ private:
+  const char* outer_;
+};
+
+/** Violations so far (every offending call, not just the reported ones). */
+uint64_t rtViolationCount();
+
+/** Scopes entered so far, to tell "clean" from "never checked". */
+uint64_t rtScopeCount();
+
+/** True if this build can actually detect violations (interposition active). */
+bool rtCheckActive();
+
+#else
+
+class RtScope {
+ public:
+  explicit RtScope(const char* /*name*/) {}
+};
+
+inline uint64_t rtViolationCount() { return 0; }
+inline uint64_t rtScopeCount() { return 0; }
+inline bool rtCheckActive() { return false; }
+
+#endif  // NOISEGUARD_RT_CHECK
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_RT_CHECK_H
@@ -0,0 +1,97 @@
+/**
+ * Sample format conversion into RNNoise's native domain.
+ *
+ * RNNoise works on floats in int16 range ([-32768, 32767]), not [-1, 1].
+ * When the capture stream delivers integers we convert straight into that
+ * domain: int16 needs only an int->float widen, packed int24 a widen and a
+ * 1/256 scale. No normalize-then-rescale round trip.
+ *
+ * All functions are REAL-TIME SAFE: no allocations, no branches per sample
+ * beyond the loop, safe to call from PortAudio callbacks.
+ */
+
+#ifndef NOISEGUARD_SAMPLE_CONVERT_H
+#define NOISEGUARD_SAMPLE_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISEGUARD_HAVE_SSE2 1
+#endif
+
+namespace noiseguard {
+
+/* Scale between normalized [-1, 1] floats and RNNoise's int16-range floats. */
+static constexpr float kInt16Scale = 32767.0f;
+static constexpr float kInvInt16Scale = 1.0f / 32767.0f;
+
+/** int16 PCM -> int16-range float. */
+inline void int16ToScaledFloat(const int16_t* src, float* dst, size_t count) {
+  size_t i = 0;
+#ifdef NOISEGUARD_HAVE_SSE2
+  /* 8 samples per iteration: sign-extend via unpack + arithmetic shift. */
+  for (; i + 8 <= count; i += 8) {
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(lo));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(hi));
+  }
+#endif
+  for (; i < count; i++) {
+    dst[i] = static_cast<float>(src[i]);
+  }
+}
+
+/** Packed little-endian int24 PCM (PortAudio paInt24) -> int16-range float. */
+inline void int24ToScaledFloat(const uint8_t* src, float* dst, size_t count) {
+  constexpr float k24To16 = 1.0f / 256.0f;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* p = src + 3 * i;
+    /* Assemble into the top 24 bits so the shift sign-extends. */
+    int32_t v = static_cast<int32_t>(
+        (static_cast<uint32_t>(p[0]) << 8) |
+        (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+    dst[i] = static_cast<float>(v) * k24To16;
+  }
+}
+
+/** In-place multiply (domain change between normalized and int16-range). */
+inline void scaleSamples(float* buf, size_t count, float gain) {
+  size_t i = 0;
+#ifdef NOISEGUARD_HAVE_SSE2
+  __m128 g = _mm_set1_ps(gain);
+  const size_t vecEnd = count & ~static_cast<size_t>(3);
+  for (; i < vecEnd; i += 4) {
+    _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+  }
+#endif
+  for (; i < count; i++) {
+    buf[i] *= gain;
+  }
+}
+
+/** Normalized float -> int16 PCM, rounded and saturated. */
+inline void normalizedToInt16(const float* src, int16_t* dst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float v = src[i] * kInt16Scale;
+    v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+    dst[i] = static_cast<int16_t>(v < 0.0f ? v - 0.5f : v + 0.5f);
+  }
+}
+
+/** int16-range float -> int16 PCM, rounded and saturated. */
+inline void scaledToInt16(const float* src, int16_t* dst, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    float v = src[i];
+    v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+    dst[i] = static_cast<int16_t>(v < 0.0f ? v - 0.5f : v + 0.5f);
+  }
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SAMPLE_CONVERT_H
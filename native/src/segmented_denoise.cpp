@@ -0,0 +1,320 @@
+/**
+ * Segmented offline denoising implementation.
+ */
+
+#include "segmented_denoise.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_util.h"
+#include "state_blob.h"
+
+namespace noiseguard {
+
+namespace {
+
+static constexpr char kCheckpointMagic[4] = {'N', 'G', 'S', 'G'};
+static constexpr uint32_t kCheckpointVersion = 1;
+
+/* Frames read and processed per step (1 s). */
+static constexpr size_t kBlockFrames = 100;
+
+static constexpr double kPi = 3.14159265358979323846;
+
+uint64_t roundUpFrames(uint64_t n) {
+  return (n + kRNNoiseFrameSize - 1) / kRNNoiseFrameSize * kRNNoiseFrameSize;
+}
+
+/** Shared state of one denoiseSegmented() run. */
+struct Job {
+  uint64_t samples = 0;
+  uint64_t segment = 0;    /* Samples per segment (frame multiple) */
+  uint64_t warmup = 0;     /* Frame multiple */
+  uint64_t crossfade = 0;  /* Checkpoint record width */
+  size_t segmentCount = 0;
+  ChainParams params;
+  SegmentIo io;
+
+  std::mutex mutex;  /* Guards everything below */
+  std::vector<uint8_t> done;
+  std::vector<std::vector<float>> heads;  /* First fade samples of segment k */
+  std::vector<std::vector<float>> tails;  /* Samples past the end of segment k */
+  FILE* checkpoint = nullptr;
+  std::string error;
+  std::atomic<bool> failed{false};
+
+  uint64_t start(size_t k) const { return k * segment; }
+  uint64_t end(size_t k) const { return std::min(samples, (k + 1) * segment); }
+
+  /** Crossfade length at the boundary in front of segment k (k > 0). */
+  uint64_t fadeBefore(size_t k) const {
+    return k == 0 ? 0 : std::min(crossfade, end(k) - start(k));
+  }
+
+  /** Samples segment k runs past its end (the next segment's fade). */
+  uint64_t fadeAfter(size_t k) const {
+    return k + 1 < segmentCount ? fadeBefore(k + 1) : 0;
+  }
+
+  void fail(const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error.empty()) error = message;
+    failed.store(true, std::memory_order_relaxed);
+  }
+};
+
+/** Copy the part of [from, from + n) that falls inside [lo, hi) into dst (indexed from lo). */
+void copyRange(const float* src, uint64_t from, uint64_t n, uint64_t lo, uint64_t hi,
+               float* dst) {
+  uint64_t a = std::max(from, lo), b = std::min(from + n, hi);
+  if (a < b) std::memcpy(dst + (a - lo), src + (a - from), (b - a) * sizeof(float));
+}
+
+/** Crossfade the boundary in front of segment k into the output. Caller holds the lock. */
+bool writeBoundary(Job& job, size_t k) {
+  const uint64_t n = job.fadeBefore(k);
+  std::vector<float> mixed(n);
+  const float* from = job.tails[k - 1].data();
+  const float* to = job.heads[k].data();
+  for (uint64_t i = 0; i < n; i++) {
+    /* Raised cosine: both chains carry the same signal, so gains sum to 1. */
+    float w = static_cast<float>(0.5 - 0.5 * std::cos(kPi * (static_cast<double>(i) + 0.5) /
+                                                        static_cast<double>(n)));
+    mixed[i] = from[i] * (1.0f - w) + to[i] * w;
+  }
+  return job.io.write(job.io.user, job.start(k), mixed.data(), mixed.size());
+}
+
+void writeCheckpointHeader(const Job& job, std::vector<uint8_t>& out) {
+  StateWriter w(out);
+  w.bytes(kCheckpointMagic, sizeof(kCheckpointMagic));
+  w.u32(kCheckpointVersion);
+  w.u64(job.samples);
+  w.u64(job.segment);
+  w.u64(job.warmup);
+  w.u64(job.crossfade);
+  w.f32(job.params.level);
+  w.f32(job.params.vadThreshold);
+  w.u32(job.params.comfortNoise ? 1 : 0);
+  w.u32(job.params.chainSelector);
+}
+
+void writeCheckpointRecord(const Job& job, size_t k, std::vector<uint8_t>& out) {
+  StateWriter w(out);
+  w.u64(k);
+  /* Fixed width: shorter heads / tails (first, last segment) are zero-padded. */
+  for (const std::vector<float>* edge : {&job.heads[k], &job.tails[k]}) {
+    std::vector<float> padded(job.crossfade, 0.0f);
+    std::copy(edge->begin(), edge->end(), padded.begin());
+    w.bytes(padded.data(), padded.size() * sizeof(float));
+  }
+}
+
+/**
+ * Load finished segments from an existing checkpoint and leave
+ * job.checkpoint open for appending. A missing file starts a new one; a
+ * checkpoint of a different job is an error.
+ */
+std::string openCheckpoint(Job& job, const std::string& path) {
+  std::vector<uint8_t> header;
+  writeCheckpointHeader(job, header);
+
+  std::vector<uint8_t> file;
+  if (FILE* f = std::fopen(path.c_str(), "rb")) {
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) file.insert(file.end(), buf, buf + n);
+    std::fclose(f);
+  }
+
+  size_t valid = 0;
+  if (!file.empty()) {
+    if (file.size() < header.size() ||
+        std::memcmp(file.data(), header.data(), header.size()) != 0) {
+      return "Checkpoint " + path + " belongs to a different job";
+    }
+    const size_t recordBytes = sizeof(uint64_t) + 2 * job.crossfade * sizeof(float);
+    StateReader r(file.data() + header.size(), file.size() - header.size());
+    valid = header.size();
+    while (r.remaining() >= recordBytes) {
+      uint64_t k = r.u64();
+      if (k >= job.segmentCount) return "Checkpoint " + path + " is corrupt";
+      job.heads[k].resize(job.fadeBefore(k));
+      job.tails[k].resize(job.fadeAfter(k));
+      const uint8_t* head = r.take(job.crossfade * sizeof(float));
+      const uint8_t* tail = r.take(job.crossfade * sizeof(float));
+      std::copy_n(reinterpret_cast<const float*>(head), job.heads[k].size(), job.heads[k].begin());
+      std::copy_n(reinterpret_cast<const float*>(tail), job.tails[k].size(), job.tails[k].begin());
+      job.done[k] = 1;
+      valid += recordBytes;
+    }
+  }
+
+  if (valid == file.size() && valid > 0) {
+    job.checkpoint = std::fopen(path.c_str(), "ab");
+  } else {
+    /* New, or a torn last record: rewrite the intact part. */
+    job.checkpoint = std::fopen(path.c_str(), "wb");
+    if (job.checkpoint) {
+      std::vector<uint8_t> intact = valid ? std::vector<uint8_t>(file.begin(), file.begin() + valid)
+                                          : header;
+      std::fwrite(intact.data(), 1, intact.size(), job.checkpoint);
+      syncFile(job.checkpoint);
+    }
+  }
+  return job.checkpoint ? "" : "Cannot open checkpoint " + path;
+}
+
+/** Process segment k: warm up, write its body, record its head and tail. */
+std::string runSegment(Job& job, size_t k) {
+  RNNoiseWrapper chain;
+  if (!chain.init()) return "RNNoise initialization failed";
+  chain.applyParams(job.params);
+
+  const uint64_t segStart = job.start(k), segEnd = job.end(k);
+  const uint64_t headEnd = segStart + job.fadeBefore(k);
+  const uint64_t tailEnd = segEnd + job.fadeAfter(k);
+  const uint64_t runStart = segStart - std::min(segStart, job.warmup);
+  /* Whole frames only: a zero-padded frame would change the kept samples. */
+  const uint64_t runEnd = std::min(job.samples, roundUpFrames(tailEnd));
+
+  std::vector<float> head(headEnd - segStart), tail(tailEnd - segEnd);
+  std::vector<float> block(kBlockFrames * kRNNoiseFrameSize);
+  for (uint64_t pos = runStart; pos < runEnd; pos += block.size()) {
+    if (job.failed.load(std::memory_order_relaxed)) return "";
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(block.size(), runEnd - pos));
+    if (!job.io.read(job.io.user, pos, block.data(), n)) {
+      return "Read failed at sample " + std::to_string(pos);
+    }
+    std::fill(block.begin() + static_cast<std::ptrdiff_t>(n), block.end(), 0.0f);
+    for (size_t f = 0; f < n; f += kRNNoiseFrameSize) chain.processFrame(block.data() + f);
+
+    copyRange(block.data(), pos, n, segStart, headEnd, head.data());
+    copyRange(block.data(), pos, n, segEnd, tailEnd, tail.data());
+    uint64_t a = std::max(pos, headEnd), b = std::min(pos + n, segEnd);
+    if (a < b && !job.io.write(job.io.user, a, block.data() + (a - pos),
+                               static_cast<size_t>(b - a))) {
+      return "Write failed at sample " + std::to_string(a);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(job.mutex);
+  job.heads[k] = std::move(head);
+  job.tails[k] = std::move(tail);
+  if (job.checkpoint) {
+    /* The body must be durable before the record claims it is done. */
+    if (job.io.sync && !job.io.sync(job.io.user)) return "Sync failed";
+    std::vector<uint8_t> record;
+    writeCheckpointRecord(job, k, record);
+    if (std::fwrite(record.data(), 1, record.size(), job.checkpoint) != record.size()) {
+      return "Checkpoint write failed";
+    }
+    syncFile(job.checkpoint);
+  }
+  job.done[k] = 1;
+  if (k > 0 && job.done[k - 1] && !writeBoundary(job, k)) return "Write failed";
+  if (k + 1 < job.segmentCount && job.done[k + 1] && !writeBoundary(job, k + 1)) {
+    return "Write failed";
+  }
+  return "";
+}
+
+struct MemoryIo {
+  const float* in;
+  float* out;
+};
+
+}  // namespace
+
+std::string denoiseSegmented(uint64_t samples, const SegmentIo& io,
+                             const SegmentConfig& config, SegmentStats* stats) {
+  auto t0 = std::chrono::steady_clock::now();
+  if (!io.read || !io.write) return "SegmentIo needs read and write";
+
+  Job job;
+  job.samples = samples;
+  job.segment = roundUpFrames(config.segmentSamples ? config.segmentSamples : samples);
+  job.segment = std::max<uint64_t>(job.segment, kRNNoiseFrameSize);
+  job.warmup = roundUpFrames(config.warmupSamples);
+  job.crossfade = std::min<uint64_t>(config.crossfadeSamples, job.segment - 1);
+  job.segmentCount = static_cast<size_t>((samples + job.segment - 1) / job.segment);
+  job.params = config.params;
+  job.io = io;
+  job.done.assign(job.segmentCount, 0);
+  job.heads.resize(job.segmentCount);
+  job.tails.resize(job.segmentCount);
+
+  if (!config.checkpointPath.empty()) {
+    std::string err = openCheckpoint(job, config.checkpointPath);
+    if (!err.empty()) return err;
+  }
+
+  std::vector<size_t> pending;
+  for (size_t k = 0; k < job.segmentCount; k++) {
+    if (!job.done[k]) pending.push_back(k);
+  }
+  /* Boundaries between segments finished earlier (possibly never written). */
+  for (size_t k = 1; k < job.segmentCount; k++) {
+    if (job.done[k - 1] && job.done[k] && !writeBoundary(job, k)) {
+      job.error = "Write failed";
+    }
+  }
+
+  size_t workers = config.workers ? config.workers
+                                  : std::max(1u, std::thread::hardware_concurrency());
+  workers = std::max<size_t>(1, std::min(workers, pending.size()));
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i; !job.failed.load(std::memory_order_relaxed) &&
+                   (i = next.fetch_add(1, std::memory_order_relaxed)) < pending.size();) {
+      std::string err = runSegment(job, pending[i]);
+      if (!err.empty()) job.fail(err);
+    }
+  };
+  if (job.error.empty()) {
+    std::vector<std::thread> pool;
+    for (size_t w = 1; w < workers; w++) pool.emplace_back(work);
+    work();
+    for (auto& t : pool) t.join();
+  }
+
+  if (job.checkpoint) std::fclose(job.checkpoint);
+  if (stats) {
+    stats->segments = job.segmentCount;
+    stats->resumed = job.segmentCount - pending.size();
+    stats->workers = pending.empty() ? 0 : workers;
+    stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  }
+  return job.error;
+}
+
+std::string denoiseSegmented(const float* in, float* out, size_t samples,
+                             const SegmentConfig& config, SegmentStats* stats) {
+  MemoryIo mem{in, out};
+  SegmentIo io;
+  io.read = [](void* user, uint64_t offset, float* dst, size_t count) {
+    std::memcpy(dst, static_cast<MemoryIo*>(user)->in + offset, count * sizeof(float));
+    return true;
+  };
+  io.write = [](void* user, uint64_t offset, const float* src, size_t count) {
+    std::memcpy(static_cast<MemoryIo*>(user)->out + offset, src, count * sizeof(float));
+    return true;
+  };
+  io.user = &mem;
+
+  SegmentConfig memoryConfig = config;
+  memoryConfig.checkpointPath.clear();
+  return denoiseSegmented(samples, io, memoryConfig, stats);
+}
+
+}  // namespace noiseguard
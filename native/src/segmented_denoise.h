@@ -0,0 +1,93 @@
+/**
+ * Segmented offline denoising -- long recordings on all cores.
+ *
+ * RNNoise state is sequential, so one chain has to see a file from start
+ * to end. This splits the file into segments and runs them in parallel,
+ * each on its own chain that is first primed on the preceding warm-up
+ * samples (output discarded), so that by the segment start its state has
+ * converged towards what a serial pass would have:
+ *
+ *   input    |-------- seg 0 --------|-------- seg 1 --------|-- seg 2 --
+ *   chain 1                     [warm-up]-------- seg 1 --------[xf]
+ *   output   ...seg 0 body...[xf]  seg 1 body  [xf]  seg 2 body...
+ *
+ * At each boundary the previous chain runs on for crossfadeSamples and the
+ * two outputs are crossfaded (raised cosine), hiding the small difference
+ * between them. Segment starts and warm-ups fall on the serial frame grid
+ * (multiples of kRNNoiseFrameSize), so output sample n always comes from
+ * input frame n / 480 -- no latency, the last partial frame zero-padded.
+ * With one segment the result IS the serial output.
+ *
+ * Checkpointing: with SegmentConfig::checkpointPath set, each finished
+ * segment (after its samples are written and SegmentIo::sync ran) appends
+ * a record with its boundary samples to the checkpoint file. Re-running
+ * the same job with the same checkpoint skips finished segments, so a
+ * crashed multi-hour job resumes where it stopped. Checkpoint format
+ * (little-endian, version 1):
+ *
+ *   header  "NGSG"  u32 version  u64 samples  u64 segmentSamples
+ *           u64 warmupSamples  u64 crossfadeSamples
+ *           f32 level  f32 vadThreshold  u32 comfortNoise  u32 chainSelector
+ *   record  u64 segment  f32 head[crossfade]  f32 tail[crossfade]
+ *
+ * A torn last record (crash while appending) is ignored. NOT real-time code.
+ */
+
+#ifndef NOISEGUARD_SEGMENTED_DENOISE_H
+#define NOISEGUARD_SEGMENTED_DENOISE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "rnnoise_wrapper.h"
+
+namespace noiseguard {
+
+/**
+ * Random-access sample I/O, called concurrently from the worker threads.
+ * Samples are normalized mono floats.
+ */
+struct SegmentIo {
+  /* Read count input samples starting at offset (count never runs past the end). */
+  bool (*read)(void* user, uint64_t offset, float* dst, size_t count) = nullptr;
+  /* Write count output samples at offset. Ranges never overlap. */
+  bool (*write)(void* user, uint64_t offset, const float* src, size_t count) = nullptr;
+  /* Make all writes so far durable (before a checkpoint record). Optional. */
+  bool (*sync)(void* user) = nullptr;
+  void* user = nullptr;
+};
+
+struct SegmentConfig {
+  size_t workers = 0;              /* 0 = one per hardware thread */
+  size_t segmentSamples = 30 * 48000;  /* 0 = one segment (serial) */
+  size_t warmupSamples = 3 * 48000;    /* Priming before each segment */
+  size_t crossfadeSamples = 480;   /* Boundary crossfade, < segmentSamples */
+  ChainParams params = RNNoiseWrapper::defaultParams();  /* For every segment */
+  std::string checkpointPath;      /* Empty = no checkpoint */
+};
+
+struct SegmentStats {
+  size_t segments = 0;
+  size_t resumed = 0;     /* Finished in an earlier run (from the checkpoint) */
+  size_t workers = 0;     /* Threads actually used */
+  double seconds = 0.0;   /* Wall time of this run */
+};
+
+/**
+ * Denoise samples input samples through io. Segment and warm-up lengths
+ * are rounded up to whole frames. Returns empty string on success, or an
+ * error message (finished segments stay recorded in the checkpoint).
+ */
+std::string denoiseSegmented(uint64_t samples, const SegmentIo& io,
+                             const SegmentConfig& config,
+                             SegmentStats* stats = nullptr);
+
+/** Same, for whole buffers in memory (no checkpoint). */
+std::string denoiseSegmented(const float* in, float* out, size_t samples,
+                             const SegmentConfig& config,
+                             SegmentStats* stats = nullptr);
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SEGMENTED_DENOISE_H
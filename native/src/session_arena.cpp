@@ -0,0 +1,99 @@
+/**
+ * SessionArena implementation: the platform-specific block reservation.
+ */
+
+#include "session_arena.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace noiseguard {
+
+/* Huge blocks are a whole number of 2 MiB pages. */
+static constexpr size_t kHugePageSize = 2u << 20;
+
+std::string SessionArena::reserve(size_t bytes, bool hugePages) {
+  release();
+  if (bytes == 0) return "Arena size must be > 0";
+
+  if (hugePages) {
+    const size_t size = (bytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+#if defined(_WIN32)
+    SIZE_T large = GetLargePageMinimum();
+    if (large > 0) {
+      size_t largeSize = (size + large - 1) / large * large;
+      void* p = VirtualAlloc(nullptr, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                             PAGE_READWRITE);
+      if (p) {
+        base_ = p;
+        capacity_ = largeSize;
+        huge_ = true;
+        backing_ = Backing::kMapped;
+        return "";
+      }
+    }
+    /* No SeLockMemoryPrivilege: ordinary pages, still one block. */
+    void* p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (p) {
+      base_ = p;
+      capacity_ = size;
+      backing_ = Backing::kMapped;
+      return "";
+    }
+#elif defined(__linux__)
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      huge_ = true;
+    } else {
+      /* No reserved hugetlbfs pages: ask for transparent huge pages instead. */
+      p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p != MAP_FAILED) madvise(p, size, MADV_HUGEPAGE);
+    }
+    if (p != MAP_FAILED) {
+      base_ = p;
+      capacity_ = size;
+      backing_ = Backing::kMapped;
+      return "";
+    }
+#endif
+    /* Otherwise fall through to the heap. */
+  }
+
+  const size_t size = arenaFootprint(bytes);
+  base_ = ::operator new(size, std::align_val_t{kArenaAlign}, std::nothrow);
+  if (!base_) return "Cannot allocate session arena";
+  capacity_ = size;
+  backing_ = Backing::kHeap;
+  return "";
+}
+
+void SessionArena::release() {
+  switch (backing_) {
+    case Backing::kHeap:
+      ::operator delete(base_, std::align_val_t{kArenaAlign});
+      break;
+    case Backing::kMapped:
+#if defined(_WIN32)
+      VirtualFree(base_, 0, MEM_RELEASE);
+#elif defined(__linux__)
+      munmap(base_, capacity_);
+#endif
+      break;
+    case Backing::kNone:
+      break;
+  }
+  base_ = nullptr;
+  capacity_ = 0;
+  used_ = 0;
+  huge_ = false;
+  backing_ = Backing::kNone;
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,109 @@
+/**
+ * SessionArena -- one contiguous, cache-aligned block for per-session state.
+ *
+ * A session used to be a scatter of heap blocks (ring storage, chain
+ * objects, bookkeeping). An arena is reserved once, at a size known when
+ * the session (or shard) is created, and objects are carved from it with a
+ * bump pointer:
+ *
+ *   [ obj A | pad | obj B | pad | ring storage ... ]   each start 64-aligned
+ *
+ * Carving is O(1) and never touches the heap; reset() releases everything
+ * at once. Objects with destructors must be destroyed by their owner before
+ * reset() (the arena only owns the bytes).
+ *
+ * With hugePages the block is backed by 2 MiB pages where the OS allows it
+ * (Linux: MAP_HUGETLB, else transparent huge pages via madvise; Windows:
+ * MEM_LARGE_PAGES with the lock-memory privilege), so thousands of sessions
+ * share a handful of TLB entries. Falls back to normal pages silently;
+ * hugePages() is true only when huge pages were reserved explicitly.
+ *
+ * RNNoise's DenoiseStates can be carved here too, GRU blocks included:
+ * ng_rnnoise_init_in() (rnnoise_state.h) builds one in place of
+ * ng_rnnoise_arena_bytes(), and RNNoiseWrapper::init(SessionArena&) takes
+ * both of its passes that way.
+ *
+ * rewind() keeps a prefix alive: carve the long-lived objects, note
+ * used(), and later rewind to that mark to drop only what came after.
+ *
+ * THREADING: not thread-safe. reserve()/release() are NOT real-time safe;
+ * allocate() is.
+ */
+
+#ifndef NOISEGUARD_SESSION_ARENA_H
+#define NOISEGUARD_SESSION_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace noiseguard {
+
+/* Alignment of every carved object: one cache line, no false sharing. */
+static constexpr size_t kArenaAlign = 64;
+
+/** Bytes needed to carve an object of `bytes` at kArenaAlign. */
+constexpr size_t arenaFootprint(size_t bytes) {
+  return (bytes + kArenaAlign - 1) & ~(kArenaAlign - 1);
+}
+
+class SessionArena {
+ public:
+  SessionArena() = default;
+  ~SessionArena() { release(); }
+
+  SessionArena(const SessionArena&) = delete;
+  SessionArena& operator=(const SessionArena&) = delete;
+
+  /**
+   * Reserve a block of at least bytes (huge blocks round up to 2 MiB). Replaces
+   * any previous block. Returns empty string on success, or an error message.
+   */
+  std::string reserve(size_t bytes, bool hugePages = false);
+
+  /** Give the block back to the OS. */
+  void release();
+
+  /** Carve bytes at align (a power of 2, at most the page size). nullptr when full. */
+  void* allocate(size_t bytes, size_t align = kArenaAlign) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(base_);
+    uintptr_t p = (base + used_ + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (!base_ || p + bytes > base + capacity_) return nullptr;
+    used_ = p + bytes - base;
+    return reinterpret_cast<void*>(p);
+  }
+
+  /** Construct a T in the arena. nullptr when full. Destroy with ~T() before reset(). */
+  template <typename T, typename... Args>
+  T* create(Args&&... args) {
+    void* p = allocate(sizeof(T), alignof(T) > kArenaAlign ? alignof(T) : kArenaAlign);
+    return p ? new (p) T(std::forward<Args>(args)...) : nullptr;
+  }
+
+  /** Forget every carved object (O(1)); the block stays mapped. */
+  void reset() { used_ = 0; }
+
+  /** Forget the objects carved since used() was mark (O(1)). */
+  void rewind(size_t mark) {
+    if (mark < used_) used_ = mark;
+  }
+
+  size_t used() const { return used_; }
+  size_t capacity() const { return capacity_; }
+  bool hugePages() const { return huge_; }
+
+ private:
+  enum class Backing : uint8_t { kNone, kHeap, kMapped };
+
+  void* base_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  bool huge_ = false;
+  Backing backing_ = Backing::kNone;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SESSION_ARENA_H
@@ -0,0 +1,549 @@
+/**
+ * ShardedRuntime implementation.
+ *
+ * Ownership word: each session carries state = (owner shard << 32) | jobs
+ * queued or running. submit() increments it with one fetch_add, reading the
+ * owner in the same operation, so while any job is in flight the owner cannot
+ * change and a session's jobs all sit in one FIFO. Migration is a CAS from
+ * (old << 32 | 0) to (new << 32 | 1): it only succeeds on an idle session,
+ * and the 1 is the kMigrate job that moves the state, queued on the new
+ * owner under its queue lock -- so ahead of any job submitted after the CAS.
+ */
+
+#include "shard_runtime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "session_arena.h"
+#include "trace.h"
+
+namespace noiseguard {
+
+struct ShardedRuntime::Session {
+  uint64_t key = 0;
+  std::atomic<uint64_t> state{0};
+  DenoiseSession* dsp = nullptr;     /* Constructed and destroyed on the owner shard */
+  std::atomic<uint64_t> samples{0};  /* Written by the owner shard */
+  uint64_t lastSamples = 0;          /* Control thread: rebalance() baseline */
+  uint32_t home = 0;                 /* Shard whose arena holds the header slot */
+  int32_t slot = -1;                 /* Header slot, or -1 = heap */
+  uint32_t stateHome = 0;            /* Shard whose arena holds *dsp (owner's thread) */
+  int32_t stateSlot = -1;            /* State slot, or -1 = heap */
+};
+
+/*
+ * Header slot stride: each header on its own cache lines. State slots
+ * (stateStride_) hold [ DenoiseSession | pad | its RNNoise states ].
+ */
+static constexpr size_t kHeaderStride = arenaFootprint(sizeof(ShardedRuntime::Session));
+static constexpr size_t kSessionBytes = arenaFootprint(sizeof(DenoiseSession));
+
+struct ShardedRuntime::Job {
+  enum class Kind : uint8_t { kProcess, kOpen, kClose, kMigrate };
+  Kind kind = Kind::kProcess;
+  Session* session = nullptr;
+  float* samples = nullptr;
+  size_t count = 0;
+  Completion done = nullptr;
+  void* user = nullptr;
+  std::promise<std::string>* reply = nullptr;  /* kOpen / kMigrate: result */
+};
+
+struct alignas(64) ShardedRuntime::Shard {
+  int wantCpu = -1;             /* Set before the thread starts */
+  std::atomic<int> cpu{-1};     /* CPU actually pinned to */
+  std::thread thread;
+
+  std::mutex mutex;  /* Guards queue and stop */
+  std::condition_variable wake;
+  std::deque<Job> queue;
+  bool stop = false;
+
+  /* Session slots: arena = [headers x slots][session states x slots]. */
+  SessionArena arena;
+  char* headers = nullptr;
+  char* states = nullptr;
+  std::mutex slotMutex;  /* Guards the free lists (frees may run on another shard) */
+  std::vector<int32_t> freeSlots;   /* Header slots */
+  std::vector<int32_t> freeStates;  /* State slots */
+
+  /* Written by the shard thread (sessions also by rebalance()), read by stats(). */
+  std::atomic<uint32_t> sessions{0};
+  std::atomic<uint64_t> jobs{0};
+  std::atomic<uint64_t> samples{0};
+  std::atomic<uint64_t> busyNs{0};
+};
+
+namespace {
+
+static constexpr uint64_t kInflightMask = 0xffffffffull;
+
+inline uint32_t ownerOf(uint64_t state) { return static_cast<uint32_t>(state >> 32); }
+
+/* splitmix64 finalizer: spreads both session keys and ring points. */
+uint64_t mixHash(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+/* Salted so small shard/node numbers never coincide with small session keys. */
+uint64_t ringPointHash(uint32_t shard, uint64_t node) {
+  return mixHash(mixHash(0x5ca1ab1e00000000ull | shard) ^ node);
+}
+
+/** Pin the calling thread to one CPU. Returns the CPU, or -1 if unsupported / failed. */
+int pinToCpu(size_t cpu) {
+#if defined(_WIN32)
+  if (cpu >= 64) return -1;  /* Processor groups beyond the first are not used */
+  return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << cpu) != 0
+             ? static_cast<int>(cpu) : -1;
+#elif defined(__linux__)
+  if (cpu >= CPU_SETSIZE) return -1;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0
+             ? static_cast<int>(cpu) : -1;
+#else
+  (void)cpu;
+  return -1;
+#endif
+}
+
+}  // namespace
+
+ShardedRuntime::ShardedRuntime() = default;
+
+ShardedRuntime::~ShardedRuntime() { stop(); }
+
+/* ═══ Lifecycle ═══ */
+
+std::string ShardedRuntime::start(const ShardConfig& config) {
+  if (!shards_.empty()) return "Runtime already running";
+  size_t n = config.shards ? config.shards : std::thread::hardware_concurrency();
+  if (n == 0) n = 1;
+  if (n > kMaxShards) return "Too many shards (max 256)";
+  if (!(config.rebalanceSkew >= 1.0)) return "rebalanceSkew must be >= 1";
+  if (config.sessionsPerShard > 0x7fffffff) return "sessionsPerShard is too large";
+  skew_ = config.rebalanceSkew;
+  slotCount_ = config.sessionsPerShard;
+  stateStride_ = kSessionBytes + DenoiseSession::stateBytes();
+
+  ring_.clear();
+  for (uint32_t s = 0; s < n; s++) {
+    for (uint64_t v = 0; v < kVirtualNodes; v++) {
+      ring_.push_back({ringPointHash(s, v), s});
+    }
+  }
+  std::sort(ring_.begin(), ring_.end(),
+            [](const RingPoint& a, const RingPoint& b) { return a.hash < b.hash; });
+
+  for (uint32_t s = 0; s < n; s++) {
+    auto shard = std::make_unique<Shard>();
+    /* Pin before the thread touches any session memory (first-touch NUMA). */
+    if (config.pinThreads) shard->wantCpu = static_cast<int>(s);
+
+    /*
+     * Reserved here, first written by the shard itself (headers excepted),
+     * so the OS places the state pages on the shard's node.
+     */
+    if (slotCount_ > 0) {
+      std::string err = shard->arena.reserve(slotCount_ * (kHeaderStride + stateStride_),
+                                             config.hugePages);
+      if (!err.empty()) {
+        shards_.clear();
+        return err;
+      }
+      shard->headers = static_cast<char*>(shard->arena.allocate(slotCount_ * kHeaderStride));
+      shard->states = static_cast<char*>(shard->arena.allocate(slotCount_ * stateStride_));
+      shard->freeSlots.reserve(slotCount_);
+      shard->freeStates.reserve(slotCount_);
+      for (size_t i = slotCount_; i-- > 0;) {
+        shard->freeSlots.push_back(static_cast<int32_t>(i));
+        shard->freeStates.push_back(static_cast<int32_t>(i));
+      }
+    }
+    shards_.push_back(std::move(shard));
+  }
+  for (auto& shard : shards_) {
+    shard->thread = std::thread(&ShardedRuntime::shardLoop, this, shard.get());
+  }
+  lastBusyMs_.assign(n, 0.0);
+  return "";
+}
+
+void ShardedRuntime::stop() {
+  if (shards_.empty()) return;
+
+  /* Sessions are destroyed on their own shard, behind their queued jobs. */
+  std::vector<Session*> open;
+  for (auto& kv : sessions_) open.push_back(kv.second);
+  for (Session* s : open) close(s);
+
+  for (auto& shard : shards_) {
+    {
+      std::lock_guard<std::mutex> lock(shard->mutex);
+      shard->stop = true;
+    }
+    shard->wake.notify_one();
+  }
+  for (auto& shard : shards_) shard->thread.join();
+  shards_.clear();
+  ring_.clear();
+  lastBusyMs_.clear();
+}
+
+/* ═══ Shard thread ═══ */
+
+void ShardedRuntime::shardLoop(Shard* shard) {
+  Tracer::nameThread("shard");
+  if (shard->wantCpu >= 0) {
+    shard->cpu.store(pinToCpu(static_cast<size_t>(shard->wantCpu)), std::memory_order_relaxed);
+  }
+
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(shard->mutex);
+      shard->wake.wait(lock, [shard] { return shard->stop || !shard->queue.empty(); });
+      if (shard->queue.empty()) return;  /* Stopping and drained */
+      job = shard->queue.front();
+      shard->queue.pop_front();
+    }
+
+    Session* s = job.session;
+    switch (job.kind) {
+      case Job::Kind::kOpen: {
+        /* Constructed by the owner: first touch puts it on this core's node. */
+        s->stateHome = s->home;
+        std::string err;
+        s->dsp = allocState(s->stateHome, &s->stateSlot, &err);
+        if (err.empty()) shard->sessions.fetch_add(1, std::memory_order_relaxed);
+        s->state.fetch_sub(1, std::memory_order_acq_rel);
+        job.reply->set_value(err);
+        break;
+      }
+
+      case Job::Kind::kMigrate: {
+        std::string err = moveState(s, ownerOf(s->state.load(std::memory_order_acquire)));
+        s->state.fetch_sub(1, std::memory_order_acq_rel);
+        job.reply->set_value(err);
+        break;
+      }
+
+      case Job::Kind::kClose:
+        shard->sessions.fetch_sub(1, std::memory_order_relaxed);
+        freeSession(s);
+        break;
+
+      case Job::Kind::kProcess: {
+        TraceSpan traceSpan("shard_job");
+        auto t0 = std::chrono::steady_clock::now();
+        s->dsp->process(job.samples, job.count);
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+        shard->busyNs.fetch_add(ns, std::memory_order_relaxed);
+        shard->jobs.fetch_add(1, std::memory_order_relaxed);
+        shard->samples.fetch_add(job.count, std::memory_order_relaxed);
+        s->samples.fetch_add(job.count, std::memory_order_relaxed);
+        /* Unpin before the callback: it may submit the session's next job. */
+        s->state.fetch_sub(1, std::memory_order_acq_rel);
+        if (job.done) job.done(job.user, job.samples, job.count);
+        break;
+      }
+    }
+  }
+}
+
+void ShardedRuntime::enqueue(Session* session, const Job& job) {
+  /* One RMW: pins the owner and tells us who it is. */
+  uint64_t state = session->state.fetch_add(1, std::memory_order_acq_rel);
+  Shard* shard = shards_[ownerOf(state)].get();
+  {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->queue.push_back(job);
+  }
+  shard->wake.notify_one();
+}
+
+/* ═══ Sessions ═══ */
+
+ShardedRuntime::Session* ShardedRuntime::open(uint64_t key, std::string* error) {
+  auto fail = [error](const std::string& msg) -> Session* {
+    if (error) *error = msg;
+    return nullptr;
+  };
+  if (shards_.empty()) return fail("Runtime not running");
+  if (sessions_.count(key)) return fail("Session key already open");
+
+  const uint32_t owner = ringOwner(key);
+  Session* session = allocSession(owner);
+  session->key = key;
+  session->state.store(static_cast<uint64_t>(owner) << 32, std::memory_order_relaxed);
+
+  std::promise<std::string> opened;
+  std::future<std::string> result = opened.get_future();
+  Job job;
+  job.kind = Job::Kind::kOpen;
+  job.session = session;
+  job.reply = &opened;
+  enqueue(session, job);
+
+  std::string err = result.get();
+  if (!err.empty()) {
+    freeSession(session);
+    return fail(err);
+  }
+  sessions_[key] = session;
+  return session;
+}
+
+ShardedRuntime::Session* ShardedRuntime::allocSession(uint32_t shard) {
+  Shard& home = *shards_[shard];
+  int32_t slot = -1;
+  {
+    std::lock_guard<std::mutex> lock(home.slotMutex);
+    if (!home.freeSlots.empty()) {
+      slot = home.freeSlots.back();
+      home.freeSlots.pop_back();
+    }
+  }
+  Session* s = slot >= 0
+      ? new (home.headers + static_cast<size_t>(slot) * kHeaderStride) Session()
+      : new Session();
+  s->home = shard;
+  s->slot = slot;
+  return s;
+}
+
+void ShardedRuntime::freeSession(Session* s) {
+  if (s->dsp) freeState(s->dsp, s->stateHome, s->stateSlot);
+  if (s->slot < 0) {
+    delete s;
+    return;
+  }
+  Shard& home = *shards_[s->home];
+  const int32_t slot = s->slot;
+  s->~Session();
+  std::lock_guard<std::mutex> lock(home.slotMutex);
+  home.freeSlots.push_back(slot);
+}
+
+DenoiseSession* ShardedRuntime::allocState(uint32_t shard, int32_t* slot, std::string* err) {
+  Shard& home = *shards_[shard];
+  *slot = -1;
+  {
+    std::lock_guard<std::mutex> lock(home.slotMutex);
+    if (!home.freeStates.empty()) {
+      *slot = home.freeStates.back();
+      home.freeStates.pop_back();
+    }
+  }
+  if (*slot < 0) {
+    auto* dsp = new DenoiseSession();
+    *err = dsp->init();
+    return dsp;
+  }
+  char* base = home.states + static_cast<size_t>(*slot) * stateStride_;
+  auto* dsp = new (base) DenoiseSession();
+  *err = dsp->init(base + kSessionBytes);
+  return dsp;
+}
+
+void ShardedRuntime::freeState(DenoiseSession* dsp, uint32_t shard, int32_t slot) {
+  if (slot < 0) {
+    delete dsp;
+    return;
+  }
+  dsp->~DenoiseSession();
+  Shard& home = *shards_[shard];
+  std::lock_guard<std::mutex> lock(home.slotMutex);
+  home.freeStates.push_back(slot);
+}
+
+std::string ShardedRuntime::moveState(Session* s, uint32_t shard) {
+  if (s->stateHome == shard) return "";  /* Still here: an earlier move failed */
+
+  std::vector<uint8_t> blob;
+  std::string err = s->dsp->saveState(blob);
+  if (!err.empty()) return err;
+
+  int32_t slot;
+  DenoiseSession* moved = allocState(shard, &slot, &err);
+  if (err.empty()) err = moved->loadState(blob.data(), blob.size());
+  if (!err.empty()) {
+    freeState(moved, shard, slot);
+    return err;
+  }
+
+  freeState(s->dsp, s->stateHome, s->stateSlot);
+  s->dsp = moved;
+  s->stateHome = shard;
+  s->stateSlot = slot;
+  return "";
+}
+
+void ShardedRuntime::close(Session* session) {
+  if (!session) return;
+  sessions_.erase(session->key);
+  Job job;
+  job.kind = Job::Kind::kClose;
+  job.session = session;
+  enqueue(session, job);
+}
+
+void ShardedRuntime::submit(Session* session, float* samples, size_t count,
+                            Completion done, void* user) {
+  Job job;
+  job.session = session;
+  job.samples = samples;
+  job.count = count;
+  job.done = done;
+  job.user = user;
+  enqueue(session, job);
+}
+
+RNNoiseWrapper& ShardedRuntime::chain(Session* session) { return session->dsp->chain(); }
+
+size_t ShardedRuntime::shardOf(const Session* session) const {
+  return ownerOf(session->state.load(std::memory_order_acquire));
+}
+
+/* ═══ Placement ═══ */
+
+uint32_t ShardedRuntime::ringOwner(uint64_t key) const {
+  uint64_t h = mixHash(key);
+  auto it = std::lower_bound(ring_.begin(), ring_.end(), h,
+                             [](const RingPoint& p, uint64_t v) { return p.hash < v; });
+  if (it == ring_.end()) it = ring_.begin();
+  return it->shard;
+}
+
+size_t ShardedRuntime::rebalance() {
+  const size_t n = shards_.size();
+  if (n < 2) return 0;
+
+  /* Busy time per shard since the last call. */
+  std::vector<double> busy(n);
+  double total = 0.0;
+  size_t hot = 0, cold = 0;
+  for (size_t i = 0; i < n; i++) {
+    double ms = static_cast<double>(shards_[i]->busyNs.load(std::memory_order_relaxed)) / 1e6;
+    busy[i] = ms - lastBusyMs_[i];
+    lastBusyMs_[i] = ms;
+    total += busy[i];
+    if (busy[i] > busy[hot]) hot = i;
+    if (busy[i] < busy[cold]) cold = i;
+  }
+  const double mean = total / static_cast<double>(n);
+
+  /* Samples per ring point since the last call (the arc ending at it). */
+  std::vector<uint64_t> pointLoad(ring_.size(), 0);
+  uint64_t hotSamples = 0;
+  for (auto& kv : sessions_) {
+    Session* s = kv.second;
+    uint64_t now = s->samples.load(std::memory_order_relaxed);
+    uint64_t delta = now - s->lastSamples;
+    s->lastSamples = now;
+    uint64_t h = mixHash(s->key);
+    auto it = std::lower_bound(ring_.begin(), ring_.end(), h,
+                               [](const RingPoint& p, uint64_t v) { return p.hash < v; });
+    size_t point = it == ring_.end() ? 0 : static_cast<size_t>(it - ring_.begin());
+    pointLoad[point] += delta;
+    if (ring_[point].shard == hot) hotSamples += delta;
+  }
+
+  /* Hand the hot shard's arcs to the cold one, largest first, up to half the gap. */
+  if (mean > 0.0 && busy[hot] > mean * skew_ && hot != cold && hotSamples > 0) {
+    const double need = static_cast<double>(hotSamples) *
+                        (busy[hot] - busy[cold]) / (2.0 * busy[hot]);
+    std::vector<size_t> points;
+    for (size_t p = 0; p < ring_.size(); p++) {
+      if (ring_[p].shard == hot && pointLoad[p] > 0) points.push_back(p);
+    }
+    std::sort(points.begin(), points.end(),
+              [&](size_t a, size_t b) { return pointLoad[a] > pointLoad[b]; });
+    double moved = 0.0;
+    for (size_t p : points) {
+      double load = static_cast<double>(pointLoad[p]);
+      if (moved + load > need) continue;
+      ring_[p].shard = static_cast<uint32_t>(cold);
+      moved += load;
+    }
+  }
+
+  /*
+   * Move every idle session whose owner differs from the ring (incl. earlier
+   * deferrals), then wait until the new owners have rebuilt their states.
+   */
+  std::deque<std::promise<std::string>> moves;
+  for (auto& kv : sessions_) {
+    Session* s = kv.second;
+    uint32_t target = ringOwner(s->key);
+    uint64_t state = s->state.load(std::memory_order_acquire);
+    if (ownerOf(state) == target || (state & kInflightMask) != 0) continue;
+
+    /* Under the target's queue lock: a submit after the CAS queues behind the move. */
+    Shard& dest = *shards_[target];
+    {
+      std::lock_guard<std::mutex> lock(dest.mutex);
+      uint64_t next = (static_cast<uint64_t>(target) << 32) | 1;
+      if (!s->state.compare_exchange_strong(state, next, std::memory_order_acq_rel)) continue;
+      moves.emplace_back();
+      Job job;
+      job.kind = Job::Kind::kMigrate;
+      job.session = s;
+      job.reply = &moves.back();
+      dest.queue.push_back(job);
+    }
+    dest.wake.notify_one();
+    shards_[ownerOf(state)]->sessions.fetch_sub(1, std::memory_order_relaxed);
+    dest.sessions.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /* A failed move leaves the state where it was; the owner still changed. */
+  for (auto& move : moves) move.get_future().get();
+  return moves.size();
+}
+
+ShardStats ShardedRuntime::stats(size_t shard) const {
+  ShardStats st;
+  if (shard >= shards_.size()) return st;
+  Shard& s = *shards_[shard];
+  st.sessions = s.sessions.load(std::memory_order_relaxed);
+  st.jobs = s.jobs.load(std::memory_order_relaxed);
+  st.samples = s.samples.load(std::memory_order_relaxed);
+  st.busyMs = static_cast<double>(s.busyNs.load(std::memory_order_relaxed)) / 1e6;
+  st.cpu = s.cpu.load(std::memory_order_relaxed);
+  st.arenaBytes = s.arena.capacity();
+  st.hugePages = s.arena.hugePages();
+  {
+    std::lock_guard<std::mutex> lock(s.slotMutex);
+    st.freeSlots = static_cast<uint32_t>(s.freeSlots.size());
+    st.freeStateSlots = static_cast<uint32_t>(s.freeStates.size());
+  }
+  std::lock_guard<std::mutex> lock(s.mutex);
+  st.queued = s.queue.size();
+  return st;
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,192 @@
+/**
+ * ShardedRuntime -- thread-per-core host for many DenoiseSessions.
+ *
+ * For multi-tenant denoising (hundreds of independent streams in one
+ * process), each core runs one shard thread that owns a subset of the
+ * sessions. A session's state is created, processed and destroyed only on
+ * its owner shard, so its RNNoise state, delay line and post-chain filters
+ * stay in that core's caches and are never touched by another core.
+ *
+ *   submit(session, buf) --> owner shard's queue --> shard thread:
+ *                            session.process(buf) --> done(user, buf)
+ *
+ * Placement: sessions map to shards by consistent hashing of their key
+ * over a ring of virtual nodes (kVirtualNodes per shard). rebalance()
+ * measures per-shard busy time since the last call and, when the hottest
+ * shard exceeds the mean by ShardConfig::rebalanceSkew, hands ring arcs from it
+ * to the coldest shard. Only sessions on moved arcs change owner, and each
+ * one only while it has no job queued (it retries on a later rebalance).
+ * The new owner then rebuilds the session's DenoiseSession in its own arena
+ * from a saveState() blob and frees the old one, so a migrated session's
+ * state lives (and is first touched) on the core that processes it.
+ *
+ * Memory: each shard reserves one SessionArena (optionally on huge pages)
+ * with ShardConfig::sessionsPerShard fixed slots each of small session
+ * headers (owner word, counters; touched by submitting threads) and of
+ * session states (touched only by the owner): a DenoiseSession followed by
+ * its two RNNoise states, GRU blocks included, so all of a session's DSP
+ * state is one contiguous block. Opening and closing a
+ * session pops / pushes slot indices: O(1), no heap. A full shard falls
+ * back to the heap. Shard threads are pinned to one CPU each (Linux,
+ * Windows) and construct their sessions themselves, so first touch puts
+ * the state on the shard's NUMA node. A session's header stays in its home
+ * shard's slot for life (the handle points at it); its state slot follows
+ * the owner on migration.
+ *
+ * THREADING:
+ * - start()/stop()/open()/close()/rebalance() from one control thread.
+ * - submit() from any thread. A session's jobs run in submit order.
+ * - Completions run on the owner shard thread and must not block.
+ * NOT real-time code: submit() takes the shard's queue lock.
+ */
+
+#ifndef NOISEGUARD_SHARD_RUNTIME_H
+#define NOISEGUARD_SHARD_RUNTIME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "denoise_session.h"
+
+namespace noiseguard {
+
+/* Upper bound on shards (one per core). */
+static constexpr size_t kMaxShards = 256;
+
+/* Ring points per shard: enough for an even spread, cheap to search. */
+static constexpr size_t kVirtualNodes = 64;
+
+struct ShardConfig {
+  size_t shards = 0;            /* 0 = one per hardware thread */
+  bool pinThreads = true;       /* Pin shard i to CPU i (no-op where unsupported) */
+  double rebalanceSkew = 1.25;  /* Hottest / mean busy time that triggers moves */
+  size_t sessionsPerShard = 256;  /* Arena slots per shard; more spill to the heap */
+  bool hugePages = false;       /* Back the shard arenas with huge pages if possible */
+};
+
+struct ShardStats {
+  uint32_t sessions = 0;
+  uint64_t jobs = 0;         /* Completed since start() */
+  uint64_t samples = 0;
+  double busyMs = 0.0;       /* Time spent processing since start() */
+  size_t queued = 0;         /* Jobs waiting right now */
+  int cpu = -1;              /* Pinned CPU, or -1 */
+  size_t arenaBytes = 0;     /* Reserved for session slots */
+  bool hugePages = false;    /* Arena got explicit huge pages */
+  uint32_t freeSlots = 0;    /* Header slots not in use */
+  uint32_t freeStateSlots = 0;  /* DenoiseSession slots not in use */
+};
+
+class ShardedRuntime {
+ public:
+  struct Session;
+
+  /** Called on the shard thread when a job's samples have been denoised in place. */
+  using Completion = void (*)(void* user, float* samples, size_t count);
+
+  ShardedRuntime();
+  ~ShardedRuntime();
+
+  ShardedRuntime(const ShardedRuntime&) = delete;
+  ShardedRuntime& operator=(const ShardedRuntime&) = delete;
+
+  /** Launch the shard threads. Returns empty string on success, or an error message. */
+  std::string start(const ShardConfig& config);
+
+  /** Finish queued jobs, destroy every open session and join the shards. */
+  void stop();
+
+  /**
+   * Create a session for key on its owner shard. Blocks until it exists.
+   * Returns nullptr (and sets *error) if the key is in use or init fails.
+   */
+  Session* open(uint64_t key, std::string* error = nullptr);
+
+  /** Destroy the session after its queued jobs. The handle is invalid afterwards. */
+  void close(Session* session);
+
+  /**
+   * Denoise count samples in place on the owner shard (output delayed by
+   * DenoiseSession::kLatency, as for DenoiseSession::process()), then call
+   * done(user, samples, count). The buffer must stay valid until then.
+   */
+  void submit(Session* session, float* samples, size_t count,
+              Completion done, void* user);
+
+  /**
+   * Move ring arcs from the hottest to the coldest shard if the busy time
+   * since the last call is skewed. Returns the number of sessions moved,
+   * once each one's state has been rebuilt on its new shard.
+   */
+  size_t rebalance();
+
+  /**
+   * Chain settings of a session (lock-free setters, any thread). The
+   * reference is valid until the next rebalance(), which may move the
+   * session's state; fetch it again afterwards.
+   */
+  RNNoiseWrapper& chain(Session* session);
+
+  /** Shard that currently owns a session. */
+  size_t shardOf(const Session* session) const;
+
+  size_t shardCount() const { return shards_.size(); }
+  ShardStats stats(size_t shard) const;
+
+ private:
+  struct Job;
+  struct Shard;
+  struct RingPoint {
+    uint64_t hash;
+    uint32_t shard;
+  };
+
+  void shardLoop(Shard* shard);
+
+  /** A session header from shard's arena (heap if full). Control thread. */
+  Session* allocSession(uint32_t shard);
+
+  /** Destroy a session (and its DenoiseSession) and return its slots. Any thread. */
+  void freeSession(Session* session);
+
+  /**
+   * A DenoiseSession constructed and initialized in a free state slot of
+   * shard's arena, RNNoise states included (heap if full; *slot = -1).
+   * Call on that shard's thread (first touch). On an init error *err is
+   * set and the session must still go to freeState().
+   */
+  DenoiseSession* allocState(uint32_t shard, int32_t* slot, std::string* err);
+
+  /** Destroy a DenoiseSession from allocState() and return its slot. Any thread. */
+  void freeState(DenoiseSession* dsp, uint32_t shard, int32_t slot);
+
+  /**
+   * Rebuild session's state in shard's arena (saveState / loadState) and
+   * free the old one. On the new owner's thread. On error the state stays.
+   */
+  std::string moveState(Session* session, uint32_t shard);
+
+  /** Queue a job on the shard that owns session (pins the owner until it runs). */
+  void enqueue(Session* session, const Job& job);
+
+  /** Owner of a key on the current ring. Control thread. */
+  uint32_t ringOwner(uint64_t key) const;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::vector<RingPoint> ring_;  /* Sorted by hash */
+  double skew_ = 1.25;
+  size_t slotCount_ = 0;  /* Arena slots per shard */
+  size_t stateStride_ = 0;  /* Bytes per state slot (depends on the RNNoise build) */
+
+  /* Control thread only. */
+  std::unordered_map<uint64_t, Session*> sessions_;
+  std::vector<double> lastBusyMs_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SHARD_RUNTIME_H
@@ -0,0 +1,130 @@
+/**
+ * SharedRingWriter -- producer side of an SPSC ring living in memory owned by
+ * JavaScript (a SharedArrayBuffer), so JS in the engine's own process (e.g.
+ * a worker_threads Worker, or an AudioWorklet where the addon is loaded in
+ * the renderer) can read processed frames directly, without IPC or copies
+ * through an event loop. A SharedArrayBuffer cannot cross a process
+ * boundary: the Electron app's engine lives in the main process, so its
+ * renderer does not consume this ring. native/lib/shared_ring_worklet.js
+ * is the JS reader (and AudioWorklet processor); scripts/
+ * shared-ring-smoke.js drains it from a worker_threads Worker.
+ *
+ * Same semantics as RingBuffer: power-of-2 capacity, free-running indices,
+ * one slot kept empty, producer owns the write index, consumer the read
+ * index. The layout is fixed so both sides can address it:
+ *
+ *   Int32 header (kHeaderInts slots, 128 bytes)
+ *     [kWriteIndex]  samples ever written (uint32, wraps)   -- producer
+ *     [kCapacity]    capacity in samples, power of 2        -- set by creator
+ *     [kDropped]     samples dropped because ring was full  -- producer
+ *     [kReadIndex]   samples ever read (uint32, wraps)      -- consumer
+ *   Float32 data     capacity samples, normalized [-1, 1]
+ *
+ * The two indices sit on separate 64-byte lines so producer and consumer
+ * never share a cache line. The write index is stored last (release), after
+ * the samples, which is what JS Atomics.load() pairs with.
+ *
+ * WAKEUPS: the write index doubles as the Atomics.wait() word. V8 keeps its
+ * waiter list internally, so a native store cannot notify JS waiters; a
+ * waiting consumer must use a timeout, or -- like an AudioWorklet, clocked
+ * by its audio device -- never wait and just load the index each quantum.
+ *
+ * REAL-TIME SAFE: write() does no allocation, no locks, no syscalls.
+ */
+
+#ifndef NOISEGUARD_SHARED_RING_H
+#define NOISEGUARD_SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace noiseguard {
+
+/*
+ * JS Atomics operate on plain Int32Array slots; we access the same memory
+ * through std::atomic, which requires it to be lock-free and layout
+ * compatible with uint32_t.
+ */
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "std::atomic<uint32_t> must alias an Int32Array slot");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared ring indices must be lock-free");
+
+class SharedRingWriter {
+ public:
+  /* Int32 slot indices in the header (see layout above). */
+  static constexpr size_t kWriteIndex = 0;
+  static constexpr size_t kCapacity = 1;
+  static constexpr size_t kDropped = 2;
+  static constexpr size_t kReadIndex = 16;
+  static constexpr size_t kHeaderInts = 32;
+  static constexpr size_t kHeaderBytes = kHeaderInts * sizeof(uint32_t);
+
+  /** Bytes needed for a ring of capacity samples. */
+  static constexpr size_t bytesFor(size_t capacity) {
+    return kHeaderBytes + capacity * sizeof(float);
+  }
+
+  SharedRingWriter() = default;
+
+  SharedRingWriter(const SharedRingWriter&) = delete;
+  SharedRingWriter& operator=(const SharedRingWriter&) = delete;
+
+  /**
+   * Bind to memory laid out as above, with the capacity slot already set.
+   * The memory must stay valid until unbound. Returns empty string on
+   * success, or an error message.
+   */
+  std::string bind(void* memory, size_t bytes) {
+    if (!memory || bytes < kHeaderBytes) return "Shared ring is smaller than its header";
+    if (reinterpret_cast<uintptr_t>(memory) % alignof(std::atomic<uint32_t>) != 0) {
+      return "Shared ring is misaligned";
+    }
+    auto* header = static_cast<std::atomic<uint32_t>*>(memory);
+    size_t capacity = header[kCapacity].load(std::memory_order_relaxed);
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+      return "Shared ring capacity must be a power of 2";
+    }
+    if (bytesFor(capacity) > bytes) return "Shared ring is smaller than its capacity";
+
+    header_ = header;
+    data_ = reinterpret_cast<float*>(static_cast<uint8_t*>(memory) + kHeaderBytes);
+    capacity_ = static_cast<uint32_t>(capacity);
+    mask_ = capacity_ - 1;
+    return "";
+  }
+
+  /**
+   * Append count samples. All-or-nothing: when the reader has fallen behind
+   * the samples are counted in kDropped instead, so the reader never sees a
+   * torn frame. Returns true if written.
+   */
+  bool write(const float* src, size_t count) {
+    uint32_t w = header_[kWriteIndex].load(std::memory_order_relaxed);
+    uint32_t r = header_[kReadIndex].load(std::memory_order_acquire);
+    uint32_t used = w - r;  /* Free-running, wraps mod 2^32 */
+    if (used > mask_ || count > mask_ - used) {
+      header_[kDropped].fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      data_[(w + i) & mask_] = src[i];
+    }
+    header_[kWriteIndex].store(w + static_cast<uint32_t>(count), std::memory_order_release);
+    return true;
+  }
+
+  uint32_t capacity() const { return capacity_; }
+
+ private:
+  std::atomic<uint32_t>* header_ = nullptr;
+  float* data_ = nullptr;
+  uint32_t capacity_ = 0;
+  uint32_t mask_ = 0;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SHARED_RING_H
@@ -0,0 +1,357 @@
+/**
+ * Synthetic signal generators.
+ *
+ * Every generator produces unit RMS (speech: at a vowel's peak; keyboard:
+ * over a click), scaled by the spec's level. Oscillators run on 32-bit
+ * fixed-point phase accumulators and a shared sine table, so output depends
+ * only on the sample position and the seed.
+ */
+
+#include "signal_gen.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace noiseguard {
+
+static constexpr double kGenSampleRate = 48000.0;
+static constexpr double kPi = 3.14159265358979323846;
+
+/* Sine table: 4096 steps per cycle (+1 guard entry for interpolation). */
+static constexpr int kSineBits = 12;
+static constexpr size_t kSineSize = size_t{1} << kSineBits;
+
+/* Speech: harmonics up to 4 kHz, at most this many. */
+static constexpr size_t kMaxHarmonics = 48;
+static constexpr double kVoiceBandwidthHz = 4000.0;
+
+/* Harmonic amplitudes / pitch are refreshed every 10 ms. */
+static constexpr uint64_t kControlInterval = 480;
+
+/*
+ * Measured RMS of a raw key-press click (over its first 10 ms) and of
+ * Kellet pink noise from uniform [-1, 1) white, to normalize to unit RMS.
+ */
+static constexpr float kClickRms = 0.2f;
+static constexpr float kPinkRms = 0.195f;
+
+/* Relative amplitudes of the mains harmonics (odd ones dominate). */
+static constexpr float kHumHarmonics[] = {1.0f, 0.45f, 0.35f, 0.12f, 0.2f, 0.06f, 0.1f};
+
+namespace {
+
+struct SineTable {
+  float v[kSineSize + 1];
+  SineTable() {
+    for (size_t i = 0; i <= kSineSize; i++) {
+      v[i] = static_cast<float>(std::sin(2.0 * kPi * static_cast<double>(i) / kSineSize));
+    }
+  }
+};
+
+/* Built at load time: no guard check per sample, nothing to do in render(). */
+const SineTable kSine;
+
+const float kHumNorm = [] {
+  double power = 0.0;
+  for (float a : kHumHarmonics) power += 0.5 * a * a;
+  return static_cast<float>(1.0 / std::sqrt(power));
+}();
+
+/** sin(2*pi * phase / 2^32), linearly interpolated. */
+inline float sine(uint32_t phase) {
+  const float* t = kSine.v;
+  uint32_t i = phase >> (32 - kSineBits);
+  float frac = static_cast<float>(phase & ((1u << (32 - kSineBits)) - 1)) *
+               (1.0f / static_cast<float>(1u << (32 - kSineBits)));
+  return t[i] + (t[i + 1] - t[i]) * frac;
+}
+
+inline uint32_t phaseIncrement(double hz) {
+  return static_cast<uint32_t>(hz / kGenSampleRate * 4294967296.0);
+}
+
+inline uint32_t samplesFor(double seconds) {
+  return static_cast<uint32_t>(seconds * kGenSampleRate);
+}
+
+/* Vowel formant resonance weight: 1 at the formant, falling off with bw. */
+inline float resonance(double f, double formant, double bw) {
+  double d = (f - formant) / bw;
+  return static_cast<float>(1.0 / (1.0 + d * d));
+}
+
+}  // namespace
+
+/* ═══ Kinds ═══ */
+
+static const char* const kSignalKindNames[kSignalKindCount] = {
+    "silence", "speech", "keyboard", "fan", "hum", "white",
+};
+
+const char* signalKindName(SignalKind kind) {
+  return kSignalKindNames[static_cast<size_t>(kind)];
+}
+
+bool parseSignalKind(const std::string& name, SignalKind& kind) {
+  for (size_t i = 0; i < kSignalKindCount; i++) {
+    if (name == kSignalKindNames[i]) {
+      kind = static_cast<SignalKind>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+float defaultSignalLevelDb(SignalKind kind) {
+  switch (kind) {
+    case SignalKind::kSpeech:   return -20.0f;
+    case SignalKind::kKeyboard: return -30.0f;
+    case SignalKind::kFan:      return -45.0f;
+    case SignalKind::kHum:      return -50.0f;
+    case SignalKind::kWhite:    return -45.0f;
+    case SignalKind::kSilence:  break;
+  }
+  return -100.0f;
+}
+
+/* ═══ Generator ═══ */
+
+void SignalGenerator::Resonator::tune(float hz, float r) {
+  a1 = -2.0f * r * static_cast<float>(std::cos(2.0 * kPi * hz / kGenSampleRate));
+  a2 = r * r;
+  gain = 1.0f - r;
+}
+
+float SignalGenerator::Resonator::process(float x) {
+  float y = gain * x - a1 * y1 - a2 * y2;
+  y2 = y1;
+  y1 = y;
+  return y;
+}
+
+SignalGenerator::SignalGenerator(const SignalSpec& spec)
+    : spec_(spec),
+      /* xorshift32 has no zero state; mix the seed so 1, 2, 3 diverge fast. */
+      rng_((spec.seed * 0x9E3779B9u) ^ 0x6D2B79F5u) {
+  if (rng_ == 0) rng_ = 0x6D2B79F5u;
+  float level = std::isnan(spec_.levelDb) ? defaultSignalLevelDb(spec_.kind) : spec_.levelDb;
+  gain_ = spec_.kind == SignalKind::kSilence
+              ? 0.0f
+              : static_cast<float>(std::pow(10.0, level / 20.0));
+
+  harmonicAmp_.assign(kMaxHarmonics, 0.0f);
+
+  /* Per-seed character of the steady sources. */
+  bladeInc_ = phaseIncrement(uniformRange(80.0f, 160.0f));
+  wobbleInc_ = phaseIncrement(uniformRange(0.2f, 0.5f));
+  phaseInc_ = phaseIncrement(spec_.humHz);
+
+  /* Speech and typing both open with a short pause. */
+  segmentLeft_ = samplesFor(uniformRange(0.1f, 0.5f));
+  nextClick_ = samplesFor(uniformRange(0.1f, 0.5f));
+}
+
+uint32_t SignalGenerator::nextRandom() {
+  rng_ ^= rng_ << 13;
+  rng_ ^= rng_ >> 17;
+  rng_ ^= rng_ << 5;
+  return rng_;
+}
+
+float SignalGenerator::uniform() {
+  return static_cast<float>(static_cast<int32_t>(nextRandom())) * (1.0f / 2147483648.0f);
+}
+
+float SignalGenerator::uniformRange(float lo, float hi) {
+  return lo + (hi - lo) * (0.5f + 0.5f * uniform());
+}
+
+void SignalGenerator::render(float* out, size_t count) {
+  std::memset(out, 0, count * sizeof(float));
+  add(out, count);
+}
+
+void SignalGenerator::add(float* out, size_t count) {
+  switch (spec_.kind) {
+    case SignalKind::kSilence:
+      pos_ += count;
+      return;
+    case SignalKind::kSpeech:
+      /* Speech schedules on the sample position: advance it per sample. */
+      for (size_t i = 0; i < count; i++, pos_++) out[i] += gain_ * speechSample();
+      return;
+    case SignalKind::kKeyboard:
+      for (size_t i = 0; i < count; i++) out[i] += gain_ * keyboardSample();
+      break;
+    case SignalKind::kFan:
+      for (size_t i = 0; i < count; i++) out[i] += gain_ * fanSample();
+      break;
+    case SignalKind::kHum:
+      for (size_t i = 0; i < count; i++) out[i] += gain_ * humSample();
+      break;
+    case SignalKind::kWhite: {
+      const float toUnitRms = static_cast<float>(std::sqrt(3.0));
+      for (size_t i = 0; i < count; i++) out[i] += gain_ * toUnitRms * uniform();
+      break;
+    }
+  }
+  pos_ += count;
+}
+
+/* ═══ Speech ═══ */
+
+void SignalGenerator::startSyllable() {
+  voiced_ = true;
+  syllableLen_ = segmentLeft_ = samplesFor(uniformRange(0.10f, 0.26f));
+  /* Pitch accent around the spurt's declining base pitch. */
+  spurtF0_ *= 0.97f;
+  syllableF0_ = spurtF0_ * uniformRange(0.9f, 1.12f);
+  formant1_ = uniformRange(300.0f, 800.0f);
+  formant2_ = uniformRange(900.0f, 2300.0f);
+
+  /* About half the syllables open with a consonant (noise burst). */
+  consonantLeft_ = uniform() > 0.0f ? samplesFor(uniformRange(0.02f, 0.06f)) : 0;
+  consonant_.tune(uniformRange(2500.0f, 6000.0f), 0.9f);
+  updateHarmonics();
+}
+
+void SignalGenerator::updateHarmonics() {
+  /* Pitch: 10 % fall across the syllable, 5 Hz / 2 % vibrato. */
+  double progress = syllableLen_
+                        ? 1.0 - static_cast<double>(segmentLeft_) / syllableLen_
+                        : 0.0;
+  double vibrato = 1.0 + 0.02 * std::sin(2.0 * kPi * 5.0 * static_cast<double>(pos_) /
+                                         kGenSampleRate);
+  double f0 = syllableF0_ * (1.0 - 0.1 * progress) * vibrato;
+  phaseInc_ = phaseIncrement(f0);
+
+  /* 1/h tilt shaped by two formants, normalized to unit RMS. */
+  double power = 0.0;
+  for (size_t h = 1; h <= kMaxHarmonics; h++) {
+    double f = f0 * static_cast<double>(h);
+    float a = 0.0f;
+    if (f < kVoiceBandwidthHz) {
+      a = (0.2f + resonance(f, formant1_, 90.0) + 0.7f * resonance(f, formant2_, 120.0)) /
+          static_cast<float>(h);
+    }
+    harmonicAmp_[h - 1] = a;
+    power += 0.5 * a * a;
+  }
+  float norm = static_cast<float>(1.0 / std::sqrt(power));
+  for (float& a : harmonicAmp_) a *= norm;
+}
+
+float SignalGenerator::speechSample() {
+  while (segmentLeft_ == 0) {
+    if (voiced_) {
+      /* Syllable over: short gap inside a spurt, or a pause after it. */
+      voiced_ = false;
+      syllablesLeft_ = syllablesLeft_ ? syllablesLeft_ - 1 : 0;
+      segmentLeft_ = syllablesLeft_ ? samplesFor(uniformRange(0.02f, 0.08f))
+                                    : samplesFor(uniformRange(0.3f, 1.5f));
+    } else {
+      if (syllablesLeft_ == 0) {
+        syllablesLeft_ = 3 + nextRandom() % 10;
+        spurtF0_ = uniformRange(90.0f, 220.0f);
+      }
+      startSyllable();
+    }
+  }
+  segmentLeft_--;
+  if (!voiced_) return 0.0f;
+
+  if (pos_ % kControlInterval == 0) updateHarmonics();
+
+  /* Half-sine syllable envelope. */
+  uint32_t elapsed = syllableLen_ - segmentLeft_ - 1;
+  float env = sine(static_cast<uint32_t>(2147483648.0 * elapsed / syllableLen_));
+
+  float voice = 0.0f;
+  uint32_t hp = phase_;
+  for (size_t h = 0; h < kMaxHarmonics; h++, hp += phase_) {
+    if (harmonicAmp_[h] == 0.0f) break;
+    voice += harmonicAmp_[h] * sine(hp);
+  }
+  phase_ += phaseInc_;
+
+  float s = env * voice;
+  if (consonantLeft_) {
+    consonantLeft_--;
+    s += 2.0f * consonant_.process(uniform());
+  }
+  return s;
+}
+
+/* ═══ Keyboard, fan, hum ═══ */
+
+float SignalGenerator::keyboardSample() {
+  if (nextClick_ == 0) {
+    /* Key press, then a softer release 60-110 ms later. */
+    clickBody_.tune(uniformRange(1500.0f, 4500.0f), 0.992f);
+    clickThump_.tune(uniformRange(120.0f, 300.0f), 0.995f);
+    clickEnv_ = releasePending_ ? 0.5f : 1.0f;
+    clickDecay_ = static_cast<float>(std::exp(-1.0 / (kGenSampleRate * 0.0015)));
+
+    if (!releasePending_) {
+      releasePending_ = true;
+      nextClick_ = samplesFor(uniformRange(0.06f, 0.11f));
+    } else {
+      releasePending_ = false;
+      if (keysLeft_ > 0) {
+        keysLeft_--;
+        nextClick_ = samplesFor(uniformRange(0.04f, 0.2f));
+      } else {
+        keysLeft_ = 5 + nextRandom() % 36;
+        nextClick_ = samplesFor(uniformRange(0.5f, 3.0f));
+      }
+    }
+  }
+  nextClick_--;
+
+  float x = clickEnv_ * uniform();
+  clickEnv_ *= clickDecay_;
+  return (clickBody_.process(x) + 0.5f * clickThump_.process(x)) * (1.0f / kClickRms);
+}
+
+float SignalGenerator::fanSample() {
+  /* Paul Kellet's pink filter (-3 dB/octave to within 0.05 dB). */
+  float w = uniform();
+  float* b = pink_;
+  b[0] = 0.99886f * b[0] + w * 0.0555179f;
+  b[1] = 0.99332f * b[1] + w * 0.0750759f;
+  b[2] = 0.96900f * b[2] + w * 0.1538520f;
+  b[3] = 0.86650f * b[3] + w * 0.3104856f;
+  b[4] = 0.55000f * b[4] + w * 0.5329522f;
+  b[5] = -0.7616f * b[5] - w * 0.0168980f;
+  float pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * 0.5362f;
+  b[6] = w * 0.115926f;
+  pink *= 0.11f / kPinkRms;
+
+  /* Blade-pass tone and its octave, and a slow wobble of the whole fan. */
+  float blade = 0.15f * sine(bladePhase_) + 0.07f * sine(bladePhase_ * 2);
+  bladePhase_ += bladeInc_;
+  float wobble = 1.0f + 0.1f * sine(wobblePhase_);
+  wobblePhase_ += wobbleInc_;
+  return wobble * (pink + blade);
+}
+
+float SignalGenerator::humSample() {
+  float s = 0.0f;
+  uint32_t hp = phase_;
+  for (float a : kHumHarmonics) {
+    s += a * sine(hp);
+    hp += phase_;
+  }
+  phase_ += phaseInc_;
+  return kHumNorm * s;
+}
+
+/* ═══ Mix ═══ */
+
+void SignalMix::render(float* out, size_t count) {
+  std::memset(out, 0, count * sizeof(float));
+  for (SignalGenerator& g : generators_) g.add(out, count);
+}
+
+}  // namespace noiseguard
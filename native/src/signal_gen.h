@@ -0,0 +1,150 @@
+/**
+ * Synthetic test signals for load tests and benchmarks.
+ *
+ * Deterministic generators for the sounds the chain has to handle -- not
+ * just white noise -- so headless runs exercise the gate, hold and clamp
+ * paths the way a real room does:
+ *
+ *   kSpeech    harmonic "talk spurts": syllables with a moving pitch and
+ *              vowel formants, consonant noise at some onsets, and pauses
+ *              (gate open/close, hold timer, onset handling)
+ *   kKeyboard  typing bursts of resonant clicks (transients under low VAD)
+ *   kFan       pink noise with a blade-pass tone and slow wobble
+ *              (noise-floor learning, clamp)
+ *   kHum       mains hum with harmonics (HPF, clamp)
+ *   kWhite     uniform white noise
+ *   kSilence   digital zero (gate fully closed, comfort noise)
+ *
+ * The same spec and seed give the same samples on every run, independent
+ * of how the output is chunked: render(a) + render(b) == render(a + b).
+ * Output is normalized float, mono, 48 kHz. Components are summed by
+ * SignalMix.
+ *
+ * THREADING: not thread-safe; one thread per generator. render()/add() do
+ * no allocations or syscalls, so a generator may stand in for a capture
+ * device inside an audio callback.
+ */
+
+#ifndef NOISEGUARD_SIGNAL_GEN_H
+#define NOISEGUARD_SIGNAL_GEN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace noiseguard {
+
+enum class SignalKind : uint8_t {
+  kSilence = 0,
+  kSpeech,
+  kKeyboard,
+  kFan,
+  kHum,
+  kWhite,
+};
+
+static constexpr size_t kSignalKindCount = 6;
+
+/** JS / command-line names: "silence", "speech", "keyboard", "fan", "hum", "white". */
+const char* signalKindName(SignalKind kind);
+bool parseSignalKind(const std::string& name, SignalKind& kind);
+
+/** The kind's typical level in dBFS (used when SignalSpec::levelDb is NaN). */
+float defaultSignalLevelDb(SignalKind kind);
+
+struct SignalSpec {
+  SignalKind kind = SignalKind::kSilence;
+  /*
+   * RMS in dBFS. For speech: while a vowel sounds; for keyboard: of a click.
+   * NaN = the kind's typical level.
+   */
+  float levelDb = std::numeric_limits<float>::quiet_NaN();
+  uint32_t seed = 1;       /* Different seeds give different, equally valid signals */
+  float humHz = 50.0f;     /* kHum: mains frequency (50 or 60) */
+};
+
+class SignalGenerator {
+ public:
+  explicit SignalGenerator(const SignalSpec& spec);
+
+  /** Overwrite out[0, count) with the next count samples. */
+  void render(float* out, size_t count);
+
+  /** Add the next count samples to out[0, count). */
+  void add(float* out, size_t count);
+
+  const SignalSpec& spec() const { return spec_; }
+
+  /** Samples generated so far. */
+  uint64_t position() const { return pos_; }
+
+ private:
+  /* Two-pole resonator (keyboard clicks, consonants). */
+  struct Resonator {
+    float a1 = 0.0f, a2 = 0.0f, gain = 0.0f;
+    float y1 = 0.0f, y2 = 0.0f;
+    void tune(float hz, float r);
+    float process(float x);
+  };
+
+  uint32_t nextRandom();
+  float uniform();                  /* [-1, 1) */
+  float uniformRange(float lo, float hi);
+
+  float speechSample();
+  float keyboardSample();
+  float fanSample();
+  float humSample();
+  void startSyllable();
+  void updateHarmonics();
+
+  SignalSpec spec_;
+  float gain_ = 0.0f;
+  uint32_t rng_;
+  uint64_t pos_ = 0;
+
+  /* ── Speech ── */
+  uint32_t segmentLeft_ = 0;    /* Samples left in the current syllable / gap / pause */
+  uint32_t syllableLen_ = 0;
+  uint32_t syllablesLeft_ = 0;  /* In the current talk spurt */
+  bool voiced_ = false;
+  uint32_t consonantLeft_ = 0;
+  float spurtF0_ = 120.0f, syllableF0_ = 120.0f;
+  float formant1_ = 500.0f, formant2_ = 1500.0f;
+  uint32_t phase_ = 0;          /* Fundamental phase, 2^32 = one cycle */
+  uint32_t phaseInc_ = 0;
+  std::vector<float> harmonicAmp_;
+  Resonator consonant_;
+
+  /* ── Keyboard ── */
+  uint32_t nextClick_ = 0;      /* Samples until the next click */
+  uint32_t keysLeft_ = 0;       /* In the current typing burst */
+  bool releasePending_ = false;
+  float clickEnv_ = 0.0f, clickDecay_ = 0.0f;
+  Resonator clickBody_, clickThump_;
+
+  /* ── Fan (pink noise filter state, Kellet) + hum ── */
+  float pink_[7] = {};
+  float lowpass_ = 0.0f;
+  uint32_t bladePhase_ = 0, bladeInc_ = 0;
+  uint32_t wobblePhase_ = 0, wobbleInc_ = 0;
+};
+
+/** Sum of several generators, e.g. speech over fan noise plus hum. */
+class SignalMix {
+ public:
+  void add(const SignalSpec& spec) { generators_.emplace_back(spec); }
+  bool empty() const { return generators_.empty(); }
+
+  /** Overwrite out[0, count) with the next count samples of the sum. */
+  void render(float* out, size_t count);
+
+ private:
+  std::vector<SignalGenerator> generators_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_SIGNAL_GEN_H
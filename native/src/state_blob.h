@@ -0,0 +1,84 @@
+/**
+ * Byte writer / reader for the versioned state blobs (RNNoiseWrapper,
+ * DenoiseSession). Values are stored in host byte order, which is
+ * little-endian on every supported platform.
+ *
+ * The reader never reads past its end: once a read runs short it stays
+ * failed (ok() == false) and returns zeros, so parsers check ok() once at
+ * the end instead of after every field.
+ */
+
+#ifndef NOISEGUARD_STATE_BLOB_H
+#define NOISEGUARD_STATE_BLOB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace noiseguard {
+
+class StateWriter {
+ public:
+  explicit StateWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+  void bytes(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    out_.insert(out_.end(), p, p + size);
+  }
+
+  /** Reserve size bytes and return where they start (filled by the caller). */
+  uint8_t* extend(size_t size) {
+    out_.resize(out_.size() + size);
+    return out_.data() + out_.size() - size;
+  }
+
+  void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+  void u64(uint64_t v) { bytes(&v, sizeof(v)); }
+  void i32(int32_t v) { bytes(&v, sizeof(v)); }
+  void f32(float v) { bytes(&v, sizeof(v)); }
+
+ private:
+  std::vector<uint8_t>& out_;
+};
+
+class StateReader {
+ public:
+  StateReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+  void bytes(void* out, size_t size) {
+    if (const uint8_t* p = take(size)) {
+      std::memcpy(out, p, size);
+    } else {
+      std::memset(out, 0, size);
+    }
+  }
+
+  /** Skip size bytes and return where they start, or nullptr if short. */
+  const uint8_t* take(size_t size) {
+    if (!ok_ || static_cast<size_t>(end_ - p_) < size) {
+      ok_ = false;
+      return nullptr;
+    }
+    const uint8_t* p = p_;
+    p_ += size;
+    return p;
+  }
+
+  uint32_t u32() { uint32_t v; bytes(&v, sizeof(v)); return v; }
+  uint64_t u64() { uint64_t v; bytes(&v, sizeof(v)); return v; }
+  int32_t i32() { int32_t v; bytes(&v, sizeof(v)); return v; }
+  float f32() { float v; bytes(&v, sizeof(v)); return v; }
+
+  bool ok() const { return ok_; }
+  size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+ private:
+  const uint8_t* p_;
+  const uint8_t* end_;
+  bool ok_ = true;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_STATE_BLOB_H
@@ -0,0 +1,142 @@
+/**
+ * StreamSession implementation.
+ */
+
+#include "stream_session.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "sample_convert.h"
+
+namespace noiseguard {
+
+/*
+ * Samples decoded per DenoiseSession::process() call. Large enough to
+ * amortize the call, small enough to stay in L1 (16 KB of floats).
+ */
+static constexpr size_t kScratchSamples = 4096;
+
+StreamSession::StreamSession(PcmFormat format, size_t maxQueuedBytes)
+    : format_(format),
+      bytesPerSample_(format == PcmFormat::kS16LE ? sizeof(int16_t) : sizeof(float)),
+      maxQueuedBytes_(maxQueuedBytes),
+      scratch_(kScratchSamples),
+      ints_(kScratchSamples) {}
+
+std::string StreamSession::init() { return session_.init(); }
+
+bool StreamSession::push(const uint8_t* data, size_t len) {
+  if (len > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.emplace_back(data, data + len);
+    queued_.fetch_add(len, std::memory_order_acq_rel);
+  }
+  return writable();
+}
+
+void StreamSession::drain(std::vector<uint8_t>& out) {
+  std::vector<uint8_t> chunk;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (queue_.empty()) break;
+      chunk = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    processBytes(chunk.data(), chunk.size(), out);
+    /* Release capacity only once the chunk has been consumed. */
+    queued_.fetch_sub(chunk.size(), std::memory_order_acq_rel);
+  }
+  flushScratch(out);
+}
+
+void StreamSession::finish(std::vector<uint8_t>& out) {
+  drain(out);
+  partialLen_ = 0;
+
+  float tail[DenoiseSession::kLatency];
+  if (format_ == PcmFormat::kS16LE) {
+    session_.flushScaled(tail);
+  } else {
+    session_.flush(tail);
+  }
+  encode(tail, DenoiseSession::kLatency, out);
+}
+
+void StreamSession::processBytes(const uint8_t* data, size_t len,
+                                 std::vector<uint8_t>& out) {
+  /* Complete a sample split across the previous chunk boundary. */
+  if (partialLen_ > 0) {
+    size_t need = std::min(bytesPerSample_ - partialLen_, len);
+    std::memcpy(partial_ + partialLen_, data, need);
+    partialLen_ += need;
+    data += need;
+    len -= need;
+    if (partialLen_ < bytesPerSample_) return;
+
+    if (format_ == PcmFormat::kS16LE) {
+      int16_t v;
+      std::memcpy(&v, partial_, sizeof(v));
+      scratch_[scratchLen_++] = static_cast<float>(v);
+    } else {
+      std::memcpy(&scratch_[scratchLen_++], partial_, sizeof(float));
+    }
+    partialLen_ = 0;
+    if (scratchLen_ == kScratchSamples) flushScratch(out);
+  }
+
+  /* Whole samples, decoded in blocks. memcpy handles unaligned chunks. */
+  size_t samples = len / bytesPerSample_;
+  while (samples > 0) {
+    size_t n = std::min(samples, kScratchSamples - scratchLen_);
+    float* dst = scratch_.data() + scratchLen_;
+    if (format_ == PcmFormat::kS16LE) {
+      std::memcpy(ints_.data(), data, n * sizeof(int16_t));
+      int16ToScaledFloat(ints_.data(), dst, n);
+    } else {
+      std::memcpy(dst, data, n * sizeof(float));
+    }
+    data += n * bytesPerSample_;
+    len -= n * bytesPerSample_;
+    samples -= n;
+    scratchLen_ += n;
+    if (scratchLen_ == kScratchSamples) flushScratch(out);
+  }
+
+  /* Keep a trailing partial sample for the next chunk. */
+  std::memcpy(partial_, data, len);
+  partialLen_ = len;
+}
+
+void StreamSession::flushScratch(std::vector<uint8_t>& out) {
+  if (scratchLen_ == 0) return;
+  /* s16 stays in RNNoise's int16-range domain end to end: no rescaling. */
+  if (format_ == PcmFormat::kS16LE) {
+    session_.processScaled(scratch_.data(), scratchLen_);
+  } else {
+    session_.process(scratch_.data(), scratchLen_);
+  }
+  encode(scratch_.data(), scratchLen_, out);
+  scratchLen_ = 0;
+}
+
+void StreamSession::encode(const float* samples, size_t count,
+                           std::vector<uint8_t>& out) {
+  size_t offset = out.size();
+  out.resize(offset + count * bytesPerSample_);
+  if (format_ == PcmFormat::kS16LE) {
+    /* Through the aligned staging buffer, in blocks. */
+    for (size_t done = 0; done < count;) {
+      size_t n = std::min(count - done, ints_.size());
+      scaledToInt16(samples + done, ints_.data(), n);
+      std::memcpy(out.data() + offset + done * sizeof(int16_t), ints_.data(),
+                  n * sizeof(int16_t));
+      done += n;
+    }
+  } else {
+    std::memcpy(out.data() + offset, samples, count * sizeof(float));
+  }
+}
+
+}  // namespace noiseguard
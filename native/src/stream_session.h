@@ -0,0 +1,104 @@
+/**
+ * StreamSession -- byte-stream front end for DenoiseSession.
+ *
+ * Accepts raw PCM chunks of any size (sample boundaries may fall anywhere,
+ * frames need not be complete), queues them in a bounded queue, and turns
+ * them into denoised PCM of the same format on a consumer thread:
+ *
+ *   producer (JS thread)            consumer (libuv worker)
+ *   push(chunk) --> [queue, capped at maxQueuedBytes] --> drain(out)
+ *        ^                                                  |
+ *        +-- returns false once the queue is over its cap ---+
+ *            (producer waits until the consumer drains)
+ *
+ * Output is delayed by DenoiseSession::kLatency samples; finish() emits the
+ * tail. Formats: s16le and f32le, mono, 48 kHz (little-endian host).
+ *
+ * THREADING: push()/queuedBytes()/writable() from any one producer thread,
+ * drain()/finish() from one consumer at a time. Not real-time code.
+ */
+
+#ifndef NOISEGUARD_STREAM_SESSION_H
+#define NOISEGUARD_STREAM_SESSION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "denoise_session.h"
+
+namespace noiseguard {
+
+enum class PcmFormat : uint8_t {
+  kS16LE,  /* Signed 16-bit little-endian */
+  kF32LE,  /* 32-bit float little-endian, normalized [-1, 1] */
+};
+
+class StreamSession {
+ public:
+  StreamSession(PcmFormat format, size_t maxQueuedBytes);
+
+  StreamSession(const StreamSession&) = delete;
+  StreamSession& operator=(const StreamSession&) = delete;
+
+  /** Create the RNNoise state. Returns empty string on success, or an error. */
+  std::string init();
+
+  /**
+   * Copy a chunk into the queue. Always accepted; returns false when the
+   * queue is now at or over capacity and the producer should pause.
+   */
+  bool push(const uint8_t* data, size_t len);
+
+  /** True while the queue is below capacity. */
+  bool writable() const { return queuedBytes() < maxQueuedBytes_; }
+
+  size_t queuedBytes() const { return queued_.load(std::memory_order_acquire); }
+
+  /** Consumer: denoise everything queued, appending PCM to out. */
+  void drain(std::vector<uint8_t>& out);
+
+  /**
+   * Consumer, end of stream: emit the delay-line tail. A trailing partial
+   * sample (odd byte count) is dropped.
+   */
+  void finish(std::vector<uint8_t>& out);
+
+  DenoiseSession& session() { return session_; }
+
+ private:
+  /* Decode -> denoise -> encode one chunk. */
+  void processBytes(const uint8_t* data, size_t len, std::vector<uint8_t>& out);
+
+  /* Denoise the decoded samples in scratch_[0, scratchLen_) and encode them. */
+  void flushScratch(std::vector<uint8_t>& out);
+
+  /* Append samples to out in format_ (int16-range for s16, else normalized). */
+  void encode(const float* samples, size_t count, std::vector<uint8_t>& out);
+
+  const PcmFormat format_;
+  const size_t bytesPerSample_;
+  const size_t maxQueuedBytes_;
+
+  DenoiseSession session_;
+
+  /* Producer -> consumer queue. */
+  std::mutex mutex_;
+  std::deque<std::vector<uint8_t>> queue_;
+  std::atomic<size_t> queued_{0};
+
+  /* Consumer-only state. */
+  uint8_t partial_[sizeof(float)] = {};  /* Bytes of a sample split across chunks */
+  size_t partialLen_ = 0;
+  std::vector<float> scratch_;           /* Decoded samples awaiting processing */
+  size_t scratchLen_ = 0;
+  std::vector<int16_t> ints_;            /* Aligned int16 staging */
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_STREAM_SESSION_H
@@ -0,0 +1,311 @@
+/**
+ * TaskExecutor implementation.
+ *
+ * Task state word: kScheduledBit is set by the wake() that queues the task
+ * and cleared by the worker when a step leaves it idle; kNotifiedBit is set
+ * by every wake() and cleared (with an acquire RMW) just before each step.
+ * Because wake() always does an RMW on the word, either it precedes that
+ * clear -- and the step sees everything the waker wrote before waking -- or
+ * it follows it, and the worker's final CAS to idle fails and the step runs
+ * again.
+ *
+ * io_uring backend: user_data is a slot index into the in-flight table. A
+ * short transfer that is not end of file (rare on regular files) is
+ * resubmitted for the remainder from the same slot; TaskIo::result
+ * accumulates the bytes done until the request completes.
+ */
+
+#include "task_executor.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include "io_util.h"
+
+namespace noiseguard {
+
+std::string TaskExecutor::start(const ExecutorConfig& config) {
+  if (!workers_.empty()) return "Executor already running";
+  size_t n = config.workers ? config.workers : std::thread::hardware_concurrency();
+  if (n == 0) n = 1;
+  stopping_ = false;
+  ioStopping_ = false;
+
+  backend_ = IoBackend::kThreads;
+  fixed_ = false;
+  if (config.ioBackend != IoBackend::kThreads) {
+    std::string err = uring_.init(std::max(1u, config.ioDepth));
+    if (err.empty()) {
+      backend_ = IoBackend::kUring;
+    } else if (config.ioBackend == IoBackend::kUring) {
+      return err;
+    }
+  }
+
+  /* Page-aligned buffers, so fixed requests pin whole pages. */
+  ioBufferBytes_ = (config.ioBufferBytes + 4095) / 4096 * 4096;
+  freeIoBuffers_.clear();
+  ioPool_.clear();
+  if (config.ioBuffers > 0 && ioBufferBytes_ > 0) {
+    ioPool_.resize(config.ioBuffers * ioBufferBytes_ + 4096);
+    std::vector<void*> data(config.ioBuffers);
+    std::vector<size_t> bytes(config.ioBuffers, ioBufferBytes_);
+    for (size_t i = 0; i < config.ioBuffers; i++) {
+      data[i] = ioBuffer(static_cast<int>(i));
+      freeIoBuffers_.push_back(static_cast<int>(config.ioBuffers - 1 - i));
+    }
+    /* Unregistered buffers still work, as plain (non-fixed) requests. */
+    fixed_ = backend_ == IoBackend::kUring &&
+             uring_.registerBuffers(data.data(), bytes.data(),
+                                    static_cast<unsigned>(config.ioBuffers)).empty();
+  }
+
+  for (size_t i = 0; i < n; i++) workers_.emplace_back(&TaskExecutor::workerLoop, this);
+  if (backend_ == IoBackend::kUring) {
+    ioThreads_.emplace_back(&TaskExecutor::uringLoop, this);
+  } else {
+    for (size_t i = 0; i < config.ioThreads; i++) {
+      ioThreads_.emplace_back(&TaskExecutor::ioLoop, this);
+    }
+  }
+  return "";
+}
+
+void TaskExecutor::stop() {
+  if (workers_.empty()) return;
+  {
+    std::lock_guard<std::mutex> lock(ioMutex_);
+    ioStopping_ = true;
+  }
+  ioCv_.notify_all();
+  for (auto& t : ioThreads_) t.join();
+  ioThreads_.clear();
+
+  {
+    std::lock_guard<std::mutex> lock(runMutex_);
+    stopping_ = true;
+  }
+  runCv_.notify_all();
+  for (auto& t : workers_) t.join();
+  workers_.clear();
+  head_ = tail_ = nullptr;
+  runnable_ = 0;
+  uring_.close();
+}
+
+/* ═══ Scheduling ═══ */
+
+void TaskExecutor::push(Task* task) {
+  task->next_ = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(runMutex_);
+    if (tail_) {
+      tail_->next_ = task;
+    } else {
+      head_ = task;
+    }
+    tail_ = task;
+    runnable_++;
+  }
+  runCv_.notify_one();
+}
+
+void TaskExecutor::spawn(Task& task) {
+  task.executor_ = this;
+  task.state_.store(Task::kScheduledBit | Task::kNotifiedBit, std::memory_order_release);
+  push(&task);
+}
+
+void TaskExecutor::wake(Task& task) {
+  uint32_t s = task.state_.load(std::memory_order_relaxed);
+  for (;;) {
+    if (s & Task::kDoneBit) return;
+    const uint32_t next = s | Task::kScheduledBit | Task::kNotifiedBit;
+    if (task.state_.compare_exchange_weak(s, next, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed)) {
+      break;
+    }
+  }
+  if (!(s & Task::kScheduledBit)) {
+    wakes_.fetch_add(1, std::memory_order_relaxed);
+    push(&task);
+  }
+}
+
+void TaskExecutor::wait(Task& task) {
+  std::unique_lock<std::mutex> lock(doneMutex_);
+  doneCv_.wait(lock, [&] { return task.done(); });
+}
+
+void TaskExecutor::workerLoop() {
+  for (;;) {
+    Task* task;
+    {
+      std::unique_lock<std::mutex> lock(runMutex_);
+      runCv_.wait(lock, [this] { return stopping_ || head_ != nullptr; });
+      if (stopping_) return;
+      task = head_;
+      head_ = task->next_;
+      if (!head_) tail_ = nullptr;
+      runnable_--;
+    }
+
+    task->state_.fetch_and(~Task::kNotifiedBit, std::memory_order_acq_rel);
+    TaskStatus status = task->step_(*task, task->ctx_);
+    steps_.fetch_add(1, std::memory_order_relaxed);
+
+    if (status == TaskStatus::kDone) {
+      {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        task->state_.store(Task::kDoneBit, std::memory_order_release);
+      }
+      doneCv_.notify_all();
+      continue;
+    }
+    if (status == TaskStatus::kPending) {
+      uint32_t expected = Task::kScheduledBit;
+      if (task->state_.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        continue;  /* Idle until the next wake() */
+      }
+    }
+    push(task);  /* Yielded, or woken while running */
+  }
+}
+
+/* ═══ File I/O ═══ */
+
+void TaskExecutor::submitIo(Task& task, TaskIo& io) {
+  io.done.store(false, std::memory_order_relaxed);
+  io.result = 0;
+  ioRequests_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(ioMutex_);
+    ioQueue_.push_back({&task, &io});
+  }
+  ioCv_.notify_one();
+}
+
+void TaskExecutor::ioLoop() {
+  lowerCurrentThreadPriority();
+  for (;;) {
+    IoJob job;
+    {
+      std::unique_lock<std::mutex> lock(ioMutex_);
+      ioCv_.wait(lock, [this] { return ioStopping_ || !ioQueue_.empty(); });
+      if (ioQueue_.empty()) return;  /* Stopping and drained */
+      job = ioQueue_.front();
+      ioQueue_.pop_front();
+    }
+    TaskIo& io = *job.io;
+    ioSyscalls_.fetch_add(1, std::memory_order_relaxed);
+    completeIo(job, io.write ? writeAt(io.file, io.data, io.bytes, io.offset)
+                             : readAt(io.file, io.data, io.bytes, io.offset));
+  }
+}
+
+void TaskExecutor::uringLoop() {
+  lowerCurrentThreadPriority();
+  std::vector<IoJob> slots(uring_.entries());
+  std::vector<uint32_t> freeSlots;
+  for (uint32_t i = static_cast<uint32_t>(slots.size()); i-- > 0;) freeSlots.push_back(i);
+  size_t inflight = 0;
+
+  auto queue = [&](uint32_t slot) {
+    TaskIo& io = *slots[slot].io;
+    const size_t done = static_cast<size_t>(io.result);
+    const size_t left = std::min<size_t>(io.bytes - done, 0x7ffff000u);
+    /* Room is guaranteed: one SQ entry per slot. */
+    uring_.push(io.write, fileno(io.file), static_cast<uint8_t*>(io.data) + done,
+                static_cast<unsigned>(left), io.offset + done, fixed_ ? io.buffer : -1, slot);
+  };
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(ioMutex_);
+      if (inflight == 0) {
+        ioCv_.wait(lock, [this] { return ioStopping_ || !ioQueue_.empty(); });
+        if (ioQueue_.empty()) return;  /* Stopping and drained */
+      }
+      while (!ioQueue_.empty() && !freeSlots.empty()) {
+        const uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        slots[slot] = ioQueue_.front();
+        ioQueue_.pop_front();
+        queue(slot);
+        inflight++;
+      }
+    }
+
+    /* One syscall submits the batch and waits for the first completion. */
+    ioSyscalls_.fetch_add(1, std::memory_order_relaxed);
+    int r = uring_.submit(1);
+    if (r < 0 && r != -EAGAIN && r != -EBUSY) {
+      /* The ring is unusable: fail what was queued behind it. */
+      uint64_t user;
+      int res;
+      while (uring_.pop(user, res)) {}
+      for (uint32_t i = 0; i < slots.size(); i++) {
+        if (std::find(freeSlots.begin(), freeSlots.end(), i) != freeSlots.end()) continue;
+        completeIo(slots[i], -1);
+        freeSlots.push_back(i);
+      }
+      inflight = 0;
+      continue;
+    }
+
+    uint64_t user;
+    int res;
+    while (uring_.pop(user, res)) {
+      const uint32_t slot = static_cast<uint32_t>(user);
+      TaskIo& io = *slots[slot].io;
+      if (res > 0 && static_cast<size_t>(io.result) + static_cast<size_t>(res) < io.bytes) {
+        io.result += res;
+        queue(slot);  /* Short transfer: continue from where it stopped */
+        continue;
+      }
+      completeIo(slots[slot], res < 0 ? -1 : io.result + res);
+      freeSlots.push_back(slot);
+      inflight--;
+    }
+  }
+}
+
+void TaskExecutor::completeIo(const IoJob& job, int64_t result) {
+  job.io->result = result;
+  job.io->done.store(true, std::memory_order_release);
+  wake(*job.task);
+}
+
+void* TaskExecutor::acquireIoBuffer(size_t bytes, int* index) {
+  if (bytes > ioBufferBytes_) return nullptr;
+  std::lock_guard<std::mutex> lock(ioMutex_);
+  if (freeIoBuffers_.empty()) return nullptr;
+  *index = freeIoBuffers_.back();
+  freeIoBuffers_.pop_back();
+  return ioBuffer(*index);
+}
+
+void TaskExecutor::releaseIoBuffer(int index) {
+  if (index < 0) return;
+  std::lock_guard<std::mutex> lock(ioMutex_);
+  freeIoBuffers_.push_back(index);
+}
+
+uint8_t* TaskExecutor::ioBuffer(int index) {
+  uintptr_t base = reinterpret_cast<uintptr_t>(ioPool_.data());
+  base = (base + 4095) & ~uintptr_t{4095};
+  return reinterpret_cast<uint8_t*>(base) + static_cast<size_t>(index) * ioBufferBytes_;
+}
+
+ExecutorStats TaskExecutor::stats() {
+  ExecutorStats st;
+  st.steps = steps_.load(std::memory_order_relaxed);
+  st.wakes = wakes_.load(std::memory_order_relaxed);
+  st.ioRequests = ioRequests_.load(std::memory_order_relaxed);
+  st.ioSyscalls = ioSyscalls_.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(runMutex_);
+  st.runnable = runnable_;
+  return st;
+}
+
+}  // namespace noiseguard
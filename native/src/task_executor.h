@@ -0,0 +1,292 @@
+/**
+ * TaskExecutor -- a few threads driving many resumable pipeline tasks.
+ *
+ * Offline files, server streams and file taps are all "read a block ->
+ * process frames -> write a block" loops that spend most of their life
+ * waiting: for input, for the consumer to make room, or for the disk. As a
+ * thread each, thousands of mostly idle sessions cost thousands of stacks
+ * and scheduler entries. Here each pipeline is a Task: a step function that
+ * does whatever work is ready and then suspends, so a waiting task is just
+ * its own state and occupies no thread or queue slot:
+ *
+ *   step(task) --> kPending  suspended until something wake()s it
+ *              --> kYield    requeued behind the other runnable tasks
+ *              --> kDone     finished; wait() returns
+ *
+ * The suspension points are the awaitables a coroutine would co_await:
+ *
+ *   TaskChannel  bounded SPSC sample ring between two tasks (or a task and
+ *                a plain thread). write() wakes the reader, read() wakes the
+ *                writer, so a task that finds the ring empty (or full)
+ *                returns kPending and is resumed when that changes: this is
+ *                the backpressure between stages.
+ *   TaskIo       positional file read / write run off the task's worker;
+ *                completion wakes the task. Backends (ExecutorConfig):
+ *                io_uring -- one I/O thread keeps up to ioDepth requests in
+ *                flight and submits / reaps them in batches, one syscall
+ *                per batch, optionally into registered (pinned) buffers
+ *                from acquireIoBuffer(); or a small pool of blocking
+ *                pread()/pwrite() threads, the fallback wherever io_uring
+ *                is missing or refused (kAuto picks).
+ *
+ * A step is written as a state machine over those (see denoise_tasks.h):
+ * check what has completed, advance, start the next wait, return kPending.
+ * Tasks are stackless, so a step must return rather than block.
+ *
+ * Wakeups are never lost: wake() always performs a read-modify-write on the
+ * task's state word, and a wake that lands while the step is running makes
+ * the worker run it again before the task goes idle.
+ *
+ * THREADING:
+ * - start()/stop() from one control thread. spawn()/wake()/submitIo()/wait()
+ *   from any thread, including inside steps.
+ * - A task's step never runs on two workers at once. spawn() it before any
+ *   other thread can wake it (e.g. before starting the thread feeding it).
+ * - Task, TaskChannel and TaskIo memory is caller-owned; it must outlive
+ *   the task (wait() for kDone) and anything that may still wake it.
+ * NOT real-time code: the run queue and the I/O queue take locks.
+ */
+
+#ifndef NOISEGUARD_TASK_EXECUTOR_H
+#define NOISEGUARD_TASK_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ringbuffer.h"
+#include "uring_queue.h"
+
+namespace noiseguard {
+
+class TaskExecutor;
+
+enum class TaskStatus : uint8_t {
+  kPending,  /* Suspended until woken */
+  kYield,    /* Still runnable; let other tasks go first */
+  kDone,
+};
+
+class Task {
+ public:
+  using Step = TaskStatus (*)(Task& task, void* ctx);
+
+  Task(Step step, void* ctx) : step_(step), ctx_(ctx) {}
+
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+
+  bool done() const { return (state_.load(std::memory_order_acquire) & kDoneBit) != 0; }
+
+  /** Executor the task was spawned on (for waking peers from a step). */
+  TaskExecutor* executor() const { return executor_; }
+
+ private:
+  friend class TaskExecutor;
+
+  /* State word bits. */
+  static constexpr uint32_t kScheduledBit = 1;  /* In the run queue or running */
+  static constexpr uint32_t kNotifiedBit = 2;   /* Woken since the step started */
+  static constexpr uint32_t kDoneBit = 4;
+
+  Step step_;
+  void* ctx_;
+  TaskExecutor* executor_ = nullptr;
+  std::atomic<uint32_t> state_{0};
+  Task* next_ = nullptr;  /* Run queue link */
+};
+
+/** A positional read or write. Fields below `done` are valid once it is set. */
+struct TaskIo {
+  FILE* file = nullptr;  /* Used only for its descriptor; no stdio buffering */
+  void* data = nullptr;
+  size_t bytes = 0;
+  uint64_t offset = 0;
+  bool write = false;
+  int buffer = -1;       /* Index from TaskExecutor::acquireIoBuffer(), or -1 */
+
+  std::atomic<bool> done{false};
+  int64_t result = 0;  /* Bytes transferred (short read = end of file), or -1 */
+};
+
+enum class IoBackend : uint8_t {
+  kAuto,     /* io_uring if the kernel allows it, else kThreads */
+  kThreads,  /* Blocking pread()/pwrite() threads */
+  kUring,    /* io_uring or fail start() */
+};
+
+struct ExecutorConfig {
+  size_t workers = 0;    /* 0 = one per hardware thread */
+  IoBackend ioBackend = IoBackend::kAuto;
+  size_t ioThreads = 2;  /* kThreads: blocking I/O threads (0 = no file I/O) */
+  unsigned ioDepth = 64; /* io_uring: requests in flight */
+  size_t ioBuffers = 0;  /* Pool for acquireIoBuffer(), registered with io_uring */
+  size_t ioBufferBytes = 0;
+};
+
+struct ExecutorStats {
+  uint64_t steps = 0;      /* Step calls */
+  uint64_t wakes = 0;      /* wake() calls that made an idle task runnable */
+  uint64_t ioRequests = 0;
+  uint64_t ioSyscalls = 0; /* io_uring_enter() calls, or pread()/pwrite() requests */
+  size_t runnable = 0;     /* Tasks in the run queue right now */
+};
+
+class TaskExecutor {
+ public:
+  TaskExecutor() = default;
+  ~TaskExecutor() { stop(); }
+
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+  /** Launch the workers and I/O threads. Returns empty string on success, or an error. */
+  std::string start(const ExecutorConfig& config);
+
+  /**
+   * Join the threads. Tasks still suspended are abandoned (never stepped
+   * again); queued I/O is completed first.
+   */
+  void stop();
+
+  /** Make task runnable for the first time. */
+  void spawn(Task& task);
+
+  /** Resume a suspended task (no-op if it is runnable or done). Any thread. */
+  void wake(Task& task);
+
+  /** Run io on the I/O backend, then set io.done and wake task. */
+  void submitIo(Task& task, TaskIo& io);
+
+  /**
+   * A pooled buffer of ExecutorConfig::ioBufferBytes (registered with
+   * io_uring when possible) for TaskIo::data, or nullptr if bytes is larger
+   * or the pool is empty. Sets *index for TaskIo::buffer. Any thread.
+   */
+  void* acquireIoBuffer(size_t bytes, int* index);
+  void releaseIoBuffer(int index);
+
+  /** Backend in use (never kAuto once started). */
+  IoBackend ioBackend() const { return backend_; }
+  /** Pool buffers are registered with the kernel. */
+  bool fixedBuffers() const { return fixed_; }
+
+  /** Block until task has returned kDone. */
+  void wait(Task& task);
+
+  size_t workerCount() const { return workers_.size(); }
+  ExecutorStats stats();
+
+ private:
+  struct IoJob {
+    Task* task;
+    TaskIo* io;
+  };
+
+  void push(Task* task);
+  void workerLoop();
+  void ioLoop();
+  void uringLoop();
+
+  /** Mark io finished and resume its task. */
+  void completeIo(const IoJob& job, int64_t result);
+
+  /** Pool buffer index (page-aligned). */
+  uint8_t* ioBuffer(int index);
+
+  std::vector<std::thread> workers_;
+  std::vector<std::thread> ioThreads_;
+
+  std::mutex runMutex_;  /* Guards the run queue and stopping_ */
+  std::condition_variable runCv_;
+  Task* head_ = nullptr;
+  Task* tail_ = nullptr;
+  size_t runnable_ = 0;
+  bool stopping_ = false;
+
+  std::mutex ioMutex_;  /* Guards ioQueue_ and ioStopping_ */
+  std::condition_variable ioCv_;
+  std::deque<IoJob> ioQueue_;
+  bool ioStopping_ = false;
+
+  IoBackend backend_ = IoBackend::kThreads;
+  UringQueue uring_;
+  bool fixed_ = false;
+  size_t ioBufferBytes_ = 0;
+  std::vector<uint8_t> ioPool_;
+  std::vector<int> freeIoBuffers_;  /* Guarded by ioMutex_ */
+
+  std::mutex doneMutex_;
+  std::condition_variable doneCv_;
+
+  std::atomic<uint64_t> steps_{0};
+  std::atomic<uint64_t> wakes_{0};
+  std::atomic<uint64_t> ioRequests_{0};
+  std::atomic<uint64_t> ioSyscalls_{0};
+};
+
+/**
+ * Bounded sample ring whose ends are tasks. Either end may instead be a
+ * plain thread that polls (e.g. a network thread feeding a session): bind
+ * only the task side. close() marks end of stream for the reader.
+ */
+class TaskChannel {
+ public:
+  /** capacity is rounded up to a power of 2 (one slot stays empty). */
+  explicit TaskChannel(size_t capacity) : ring_(capacity) {}
+
+  TaskChannel(const TaskChannel&) = delete;
+  TaskChannel& operator=(const TaskChannel&) = delete;
+
+  /** Task to wake when samples arrive / the channel closes. */
+  void bindReader(Task* task) { reader_ = task; }
+  /** Task to wake when room frees up. */
+  void bindWriter(Task* task) { writer_ = task; }
+
+  /** Producer: append up to count samples. Returns the number written. */
+  size_t write(const float* src, size_t count) {
+    size_t n = ring_.write(src, count);
+    if (n > 0) notify(reader_);
+    return n;
+  }
+
+  /** Producer: no more samples will be written. */
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    notify(reader_);
+  }
+
+  /** Consumer: take up to count samples. Returns the number read. */
+  size_t read(float* dst, size_t count) {
+    size_t n = ring_.read(dst, count);
+    if (n > 0) notify(writer_);
+    return n;
+  }
+
+  size_t readable() const { return ring_.available_read(); }
+  size_t writable() const { return ring_.available_write(); }
+
+  /** Closed by the producer. Check before readable(): then nothing more can arrive. */
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+ private:
+  static void notify(Task* task) {
+    if (task && task->executor()) task->executor()->wake(*task);
+  }
+
+  RingBuffer ring_;
+  Task* reader_ = nullptr;
+  Task* writer_ = nullptr;
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_TASK_EXECUTOR_H
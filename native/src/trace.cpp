@@ -0,0 +1,445 @@
+/**
+ * Tracer implementation: per-thread slots, and the Chrome JSON / Perfetto
+ * protobuf exporters.
+ *
+ * Slot protocol (writer = the thread that claimed the slot):
+ *   writer:  busy = 1; if (!enabled || generation changed) drop;
+ *            events[written % capacity] = e; written++; busy = 0
+ *   control: stop(): enabled = 0, wait until every busy == 0
+ *            start(): generation++, wait busy == 0, reset slots, enabled = 1
+ * All of these are seq_cst, so a writer either sees the change or is seen
+ * as busy. Claims are a CAS on the slot's taken flag.
+ */
+
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace noiseguard {
+
+/* Process id used in exports (one process per trace). */
+static constexpr int kTracePid = 1;
+
+/* Perfetto track uuids: process, thread slot i, counter k. */
+static constexpr uint64_t kProcessTrack = 1;
+static constexpr uint64_t kThreadTrackBase = 100;
+static constexpr uint64_t kCounterTrackBase = 1000;
+
+struct alignas(64) Tracer::ThreadSlot {
+  std::atomic<bool> taken{false};
+  std::atomic<bool> busy{false};
+  std::atomic<uint64_t> written{0};
+  std::atomic<const char*> name{nullptr};
+  std::unique_ptr<TraceEvent[]> events;
+};
+
+Tracer Tracer::instance_;
+
+namespace {
+
+struct ThreadTraceState {
+  uint32_t generation = 0;  /* 0 = never claimed (generations start at 1) */
+  void* slot = nullptr;     /* Tracer::ThreadSlot, or nullptr if none was free */
+  const char* name = nullptr;
+};
+
+thread_local ThreadTraceState t_trace;
+
+uint64_t nowNs() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+}  // namespace
+
+/* ═══ Recording ═══ */
+
+void Tracer::nameThread(const char* name) { t_trace.name = name; }
+
+Tracer::ThreadSlot* Tracer::slot(const char* defaultName) {
+  uint32_t gen = generation_.load(std::memory_order_seq_cst);
+  if (t_trace.generation == gen) return static_cast<ThreadSlot*>(t_trace.slot);
+
+  ThreadSlot* claimed = nullptr;
+  for (size_t i = 0; i < kMaxTraceThreads; i++) {
+    bool expected = false;
+    if (slots_[i].taken.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+      claimed = &slots_[i];
+      claimed->name.store(t_trace.name ? t_trace.name : defaultName,
+                          std::memory_order_relaxed);
+      break;
+    }
+  }
+  if (!claimed) untraced_.fetch_add(1, std::memory_order_relaxed);
+  t_trace.generation = gen;
+  t_trace.slot = claimed;
+  return claimed;
+}
+
+void Tracer::record(TracePhase phase, const char* name, float value) {
+  if (!enabled_.load(std::memory_order_relaxed)) return;
+  ThreadSlot* s = slot(name);
+  if (!s) return;
+
+  s->busy.store(true, std::memory_order_seq_cst);
+  if (enabled_.load(std::memory_order_seq_cst) &&
+      generation_.load(std::memory_order_seq_cst) == t_trace.generation) {
+    uint64_t n = s->written.load(std::memory_order_relaxed);
+    TraceEvent& e = s->events[n & (capacity_ - 1)];
+    e.timeNs = nowNs();
+    e.name = name;
+    e.value = value;
+    e.phase = phase;
+    s->written.store(n + 1, std::memory_order_release);
+  }
+  s->busy.store(false, std::memory_order_release);
+}
+
+/* ═══ Control ═══ */
+
+std::string Tracer::start(size_t eventsPerThread) {
+  if (enabled_.load()) return "Tracing is already running";
+  if (!slots_) {
+    size_t cap = 1;
+    while (cap < std::max<size_t>(eventsPerThread, 2)) cap <<= 1;
+    auto slots = std::make_unique<ThreadSlot[]>(kMaxTraceThreads);
+    for (size_t i = 0; i < kMaxTraceThreads; i++) {
+      slots[i].events = std::make_unique<TraceEvent[]>(cap);
+    }
+    capacity_ = cap;
+    slots_ = slots.release();
+  }
+
+  generation_.fetch_add(1, std::memory_order_seq_cst);
+  for (size_t i = 0; i < kMaxTraceThreads; i++) {
+    while (slots_[i].busy.load(std::memory_order_seq_cst)) std::this_thread::yield();
+    slots_[i].written.store(0, std::memory_order_relaxed);
+    slots_[i].name.store(nullptr, std::memory_order_relaxed);
+    slots_[i].taken.store(false, std::memory_order_seq_cst);
+  }
+  untraced_.store(0, std::memory_order_relaxed);
+  startNs_ = nowNs();
+  enabled_.store(true, std::memory_order_seq_cst);
+  return "";
+}
+
+void Tracer::stop() {
+  enabled_.store(false, std::memory_order_seq_cst);
+  if (!slots_) return;
+  for (size_t i = 0; i < kMaxTraceThreads; i++) {
+    while (slots_[i].busy.load(std::memory_order_seq_cst)) std::this_thread::yield();
+  }
+}
+
+TraceStats Tracer::stats() const {
+  TraceStats st;
+  st.enabled = enabled_.load(std::memory_order_relaxed);
+  st.untraced = untraced_.load(std::memory_order_relaxed);
+  if (!slots_) return st;
+  for (size_t i = 0; i < kMaxTraceThreads; i++) {
+    if (!slots_[i].taken.load(std::memory_order_relaxed)) continue;
+    uint64_t n = slots_[i].written.load(std::memory_order_acquire);
+    st.threads++;
+    st.events += n;
+    if (n > capacity_) st.overwritten += n - capacity_;
+  }
+  return st;
+}
+
+/* ═══ Export ═══ */
+
+namespace {
+
+/**
+ * Drop span ends whose begin was overwritten, and close spans still open
+ * at the end of the trace at lastNs, so viewers never mis-nest.
+ */
+void balanceSpans(std::vector<TraceEvent>& events, uint64_t lastNs) {
+  std::vector<TraceEvent> out;
+  out.reserve(events.size());
+  std::vector<const char*> open;
+  for (const TraceEvent& e : events) {
+    if (e.phase == TracePhase::kBegin) {
+      open.push_back(e.name);
+    } else if (e.phase == TracePhase::kEnd) {
+      if (open.empty()) continue;
+      open.pop_back();
+    }
+    out.push_back(e);
+  }
+  while (!open.empty()) {
+    TraceEvent e;
+    e.timeNs = lastNs;
+    e.name = open.back();
+    e.phase = TracePhase::kEnd;
+    out.push_back(e);
+    open.pop_back();
+  }
+  events.swap(out);
+}
+
+std::string jsonEscape(const char* s) {
+  std::string out;
+  for (; s && *s; s++) {
+    unsigned char c = static_cast<unsigned char>(*s);
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out;
+}
+
+/* ── Minimal protobuf encoder (the few wire types a Perfetto trace needs) ── */
+
+class ProtoWriter {
+ public:
+  void varint(uint32_t field, uint64_t v) {
+    key(field, 0);
+    raw(v);
+  }
+  void float64(uint32_t field, double v) {
+    key(field, 1);
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    for (int i = 0; i < 8; i++) buf_.push_back(static_cast<char>(bits >> (8 * i)));
+  }
+  void bytes(uint32_t field, const std::string& s) {
+    key(field, 2);
+    raw(s.size());
+    buf_ += s;
+  }
+  void string(uint32_t field, const char* s) { bytes(field, s ? s : ""); }
+  void message(uint32_t field, const ProtoWriter& m) { bytes(field, m.buf_); }
+  const std::string& data() const { return buf_; }
+
+ private:
+  void key(uint32_t field, uint32_t wireType) { raw((static_cast<uint64_t>(field) << 3) | wireType); }
+  void raw(uint64_t v) {
+    while (v >= 0x80) {
+      buf_.push_back(static_cast<char>((v & 0x7f) | 0x80));
+      v >>= 7;
+    }
+    buf_.push_back(static_cast<char>(v));
+  }
+
+  std::string buf_;
+};
+
+/* Field numbers from perfetto/trace/trace_packet.proto and friends. */
+namespace pf {
+constexpr uint32_t kTracePacket = 1;           /* Trace.packet */
+constexpr uint32_t kTimestamp = 8;             /* TracePacket */
+constexpr uint32_t kSequenceId = 10;
+constexpr uint32_t kTrackEvent = 11;
+constexpr uint32_t kSequenceFlags = 13;
+constexpr uint32_t kTrackDescriptor = 60;
+constexpr uint32_t kUuid = 1;                  /* TrackDescriptor */
+constexpr uint32_t kTrackName = 2;
+constexpr uint32_t kProcess = 3;
+constexpr uint32_t kThread = 4;
+constexpr uint32_t kParentUuid = 5;
+constexpr uint32_t kCounter = 8;
+constexpr uint32_t kPid = 1;                   /* Process/ThreadDescriptor */
+constexpr uint32_t kTid = 2;
+constexpr uint32_t kThreadName = 5;
+constexpr uint32_t kProcessName = 6;
+constexpr uint32_t kDebugAnnotation = 4;       /* TrackEvent */
+constexpr uint32_t kType = 9;
+constexpr uint32_t kTrackUuid = 11;
+constexpr uint32_t kEventName = 23;
+constexpr uint32_t kDoubleCounterValue = 44;
+constexpr uint32_t kAnnotationDouble = 5;      /* DebugAnnotation */
+constexpr uint32_t kAnnotationName = 10;
+constexpr uint64_t kSliceBegin = 1;            /* TrackEvent.Type */
+constexpr uint64_t kSliceEnd = 2;
+constexpr uint64_t kInstant = 3;
+constexpr uint64_t kCounterType = 4;
+constexpr uint64_t kIncrementalStateCleared = 1;
+constexpr uint32_t kTrustedSequence = 1;       /* Our only packet sequence */
+}  // namespace pf
+
+}  // namespace
+
+/** One thread's surviving events, oldest first, with spans balanced. */
+struct Tracer::ThreadEvents {
+  uint32_t tid = 0;
+  const char* name = nullptr;
+  std::vector<TraceEvent> events;
+};
+
+std::vector<Tracer::ThreadEvents> Tracer::snapshot() const {
+  std::vector<ThreadEvents> threads;
+  uint64_t lastNs = startNs_;
+  for (size_t i = 0; i < kMaxTraceThreads; i++) {
+    const ThreadSlot& s = slots_[i];
+    if (!s.taken.load(std::memory_order_acquire)) continue;
+    uint64_t n = s.written.load(std::memory_order_acquire);
+    uint64_t first = n > capacity_ ? n - capacity_ : 0;
+
+    ThreadEvents t;
+    t.tid = static_cast<uint32_t>(i + 1);
+    t.name = s.name.load(std::memory_order_relaxed);
+    if (!t.name) t.name = "thread";
+    t.events.reserve(static_cast<size_t>(n - first));
+    for (uint64_t k = first; k < n; k++) {
+      t.events.push_back(s.events[k & (capacity_ - 1)]);
+    }
+    if (!t.events.empty()) lastNs = std::max(lastNs, t.events.back().timeNs);
+    threads.push_back(std::move(t));
+  }
+  for (ThreadEvents& t : threads) balanceSpans(t.events, lastNs);
+  return threads;
+}
+
+std::string Tracer::exportChromeJson(const std::string& path) const {
+  if (enabled_.load()) return "Stop tracing before exporting";
+  if (!slots_) return "Nothing has been traced";
+  std::vector<ThreadEvents> threads = snapshot();
+
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return "Cannot open " + path;
+
+  std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  std::fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,"
+               "\"args\":{\"name\":\"noiseguard\"}}", kTracePid);
+  for (const ThreadEvents& t : threads) {
+    std::fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+                 "\"args\":{\"name\":\"%s\"}}", kTracePid, t.tid, jsonEscape(t.name).c_str());
+    for (const TraceEvent& e : t.events) {
+      double us = static_cast<double>(e.timeNs - startNs_) / 1000.0;
+      std::string name = jsonEscape(e.name);
+      switch (e.phase) {
+        case TracePhase::kBegin:
+        case TracePhase::kEnd:
+          std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%u}",
+                       name.c_str(), e.phase == TracePhase::kBegin ? 'B' : 'E', us,
+                       kTracePid, t.tid);
+          break;
+        case TracePhase::kInstant:
+          std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%d,"
+                       "\"tid\":%u,\"args\":{\"value\":%.9g}}",
+                       name.c_str(), us, kTracePid, t.tid, e.value);
+          break;
+        case TracePhase::kCounter:
+          std::fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%d,"
+                       "\"args\":{\"value\":%.9g}}",
+                       name.c_str(), us, kTracePid, e.value);
+          break;
+      }
+    }
+  }
+  std::fprintf(f, "\n]}\n");
+  if (std::fclose(f) != 0) return "Failed writing " + path;
+  return "";
+}
+
+std::string Tracer::exportPerfetto(const std::string& path) const {
+  if (enabled_.load()) return "Stop tracing before exporting";
+  if (!slots_) return "Nothing has been traced";
+  std::vector<ThreadEvents> threads = snapshot();
+
+  ProtoWriter trace;
+  bool first = true;
+  auto packet = [&](ProtoWriter& p) {
+    p.varint(pf::kSequenceId, pf::kTrustedSequence);
+    if (first) p.varint(pf::kSequenceFlags, pf::kIncrementalStateCleared);
+    first = false;
+    trace.message(pf::kTracePacket, p);
+  };
+
+  {
+    ProtoWriter proc, desc, p;
+    proc.varint(pf::kPid, kTracePid);
+    proc.string(pf::kProcessName, "noiseguard");
+    desc.varint(pf::kUuid, kProcessTrack);
+    desc.message(pf::kProcess, proc);
+    p.message(pf::kTrackDescriptor, desc);
+    packet(p);
+  }
+
+  /* Counters are process-wide tracks, one per name. */
+  std::map<std::string, uint64_t> counters;
+  for (const ThreadEvents& t : threads) {
+    for (const TraceEvent& e : t.events) {
+      if (e.phase != TracePhase::kCounter || counters.count(e.name)) continue;
+      uint64_t uuid = kCounterTrackBase + counters.size();
+      counters[e.name] = uuid;
+      ProtoWriter desc, p;
+      desc.varint(pf::kUuid, uuid);
+      desc.varint(pf::kParentUuid, kProcessTrack);
+      desc.string(pf::kTrackName, e.name);
+      desc.message(pf::kCounter, ProtoWriter());
+      p.message(pf::kTrackDescriptor, desc);
+      packet(p);
+    }
+  }
+
+  for (const ThreadEvents& t : threads) {
+    const uint64_t track = kThreadTrackBase + t.tid;
+    ProtoWriter thread, desc, p;
+    thread.varint(pf::kPid, kTracePid);
+    thread.varint(pf::kTid, t.tid);
+    thread.string(pf::kThreadName, t.name);
+    desc.varint(pf::kUuid, track);
+    desc.varint(pf::kParentUuid, kProcessTrack);
+    desc.message(pf::kThread, thread);
+    p.message(pf::kTrackDescriptor, desc);
+    packet(p);
+
+    for (const TraceEvent& e : t.events) {
+      ProtoWriter ev, pkt;
+      switch (e.phase) {
+        case TracePhase::kBegin:
+          ev.varint(pf::kType, pf::kSliceBegin);
+          ev.varint(pf::kTrackUuid, track);
+          ev.string(pf::kEventName, e.name);
+          break;
+        case TracePhase::kEnd:
+          ev.varint(pf::kType, pf::kSliceEnd);
+          ev.varint(pf::kTrackUuid, track);
+          break;
+        case TracePhase::kInstant: {
+          ProtoWriter arg;
+          arg.string(pf::kAnnotationName, "value");
+          arg.float64(pf::kAnnotationDouble, e.value);
+          ev.varint(pf::kType, pf::kInstant);
+          ev.varint(pf::kTrackUuid, track);
+          ev.string(pf::kEventName, e.name);
+          ev.message(pf::kDebugAnnotation, arg);
+          break;
+        }
+        case TracePhase::kCounter:
+          ev.varint(pf::kType, pf::kCounterType);
+          ev.varint(pf::kTrackUuid, counters[e.name]);
+          ev.float64(pf::kDoubleCounterValue, e.value);
+          break;
+      }
+      pkt.varint(pf::kTimestamp, e.timeNs - startNs_);
+      pkt.message(pf::kTrackEvent, ev);
+      packet(pkt);
+    }
+  }
+
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return "Cannot open " + path;
+  bool ok = std::fwrite(trace.data().data(), 1, trace.data().size(), f) == trace.data().size();
+  if (std::fclose(f) != 0) ok = false;
+  if (!ok) return "Failed writing " + path;
+  return "";
+}
+
+}  // namespace noiseguard
@@ -0,0 +1,168 @@
+/**
+ * Tracer -- optional timeline of what the engine's threads did, for a trace
+ * viewer (chrome://tracing, ui.perfetto.dev).
+ *
+ * When a frame misses its deadline the per-frame metrics say that it
+ * happened, not why. A trace shows every thread on one time axis: callback
+ * entry/exit, ring fill levels, the RNNoise passes and post chain of each
+ * frame, device restarts and control-thread parameter changes.
+ *
+ *   Tracer::instance().start();  ...run...  stop();  exportChromeJson(path)
+ *
+ * Recording goes to per-thread buffers: a thread claims one of
+ * kMaxTraceThreads slots on its first event of a trace and from then on is
+ * the only writer of that slot's circular event array (newest events win, so a
+ * trace stopped right after a glitch holds the run-up to it). No locks, no
+ * allocations, no syscalls on the recording path; with tracing off each
+ * call site costs one relaxed atomic load. (Loaded as a Node addon, a
+ * thread's first event may have the loader allocate its thread_local block.)
+ *
+ * Event names are NOT copied: pass string literals (or strings that outlive
+ * the Tracer).
+ *
+ * THREADING:
+ * - TraceSpan / traceCounter() / traceInstant() from any thread. REAL-TIME SAFE.
+ * - start()/stop()/export*() from one control thread. NOT real-time safe.
+ */
+
+#ifndef NOISEGUARD_TRACE_H
+#define NOISEGUARD_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace noiseguard {
+
+/*
+ * Threads that can record per trace (further threads are not traced). Device
+ * restarts bring new callback threads, so this leaves room for a few.
+ */
+static constexpr size_t kMaxTraceThreads = 32;
+
+/* Default events kept per thread (power of 2): 16384 x 24 bytes = 384 KiB. */
+static constexpr size_t kDefaultTraceEvents = 16384;
+
+enum class TracePhase : uint8_t {
+  kBegin,    /* Span start (TraceSpan) */
+  kEnd,      /* Span end */
+  kInstant,  /* Point event, optional value */
+  kCounter,  /* Sampled value, drawn as a track */
+};
+
+struct TraceEvent {
+  uint64_t timeNs = 0;  /* Steady clock */
+  const char* name = nullptr;
+  float value = 0.0f;
+  TracePhase phase = TracePhase::kInstant;
+};
+
+struct TraceStats {
+  bool enabled = false;
+  uint64_t events = 0;      /* Recorded since start(), all threads */
+  uint64_t overwritten = 0; /* Oldest events lost to the circular buffers */
+  uint32_t threads = 0;     /* Slots claimed */
+  uint32_t untraced = 0;    /* Threads that found no free slot */
+};
+
+class Tracer {
+ public:
+  static Tracer& instance() { return instance_; }
+
+  Tracer(const Tracer&) = delete;
+  Tracer& operator=(const Tracer&) = delete;
+
+  /**
+   * Clear the buffers and start recording. The first start() allocates
+   * kMaxTraceThreads x eventsPerThread events (rounded up to a power of 2);
+   * later calls reuse them and ignore eventsPerThread.
+   * Returns empty string on success, or an error message.
+   */
+  std::string start(size_t eventsPerThread = kDefaultTraceEvents);
+
+  /** Stop recording. Blocks until no thread is mid-event. The buffers stay for export. */
+  void stop();
+
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * Write the recorded events as Chrome trace-event JSON (chrome://tracing,
+   * ui.perfetto.dev). Only while stopped.
+   * Returns empty string on success, or an error message.
+   */
+  std::string exportChromeJson(const std::string& path) const;
+
+  /** Same as a Perfetto protobuf trace (ui.perfetto.dev, trace_processor). */
+  std::string exportPerfetto(const std::string& path) const;
+
+  TraceStats stats() const;
+
+  /**
+   * Name the calling thread's track in this and later traces (otherwise it
+   * is named after its first event). Any thread; the name is not copied.
+   */
+  static void nameThread(const char* name);
+
+  /** Recording path behind TraceSpan etc.; drops the event unless tracing. */
+  void record(TracePhase phase, const char* name, float value);
+
+ private:
+  struct ThreadSlot;
+  struct ThreadEvents;
+
+  Tracer() = default;
+
+  /** The calling thread's slot for this trace, claimed on first use; nullptr if none is free. */
+  ThreadSlot* slot(const char* defaultName);
+
+  /** Every claimed slot's surviving events, oldest first, spans balanced. Only while stopped. */
+  std::vector<ThreadEvents> snapshot() const;
+
+  /* A plain static: no initialization guard on the hot path. */
+  static Tracer instance_;
+
+  std::atomic<bool> enabled_{false};
+  std::atomic<uint32_t> generation_{0};  /* Bumped by start(); invalidates claims */
+  ThreadSlot* slots_ = nullptr;          /* Allocated by the first start(), never freed */
+  size_t capacity_ = 0;                  /* Events per slot, power of 2 */
+  uint64_t startNs_ = 0;
+  std::atomic<uint32_t> untraced_{0};
+};
+
+/** Fast check for call sites that compute a value before recording it. */
+inline bool traceEnabled() { return Tracer::instance().enabled(); }
+
+inline void traceCounter(const char* name, float value) {
+  Tracer& t = Tracer::instance();
+  if (t.enabled()) t.record(TracePhase::kCounter, name, value);
+}
+
+inline void traceInstant(const char* name, float value = 0.0f) {
+  Tracer& t = Tracer::instance();
+  if (t.enabled()) t.record(TracePhase::kInstant, name, value);
+}
+
+/** Records a span from construction to destruction (on the same thread). */
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name)
+      : name_(Tracer::instance().enabled() ? name : nullptr) {
+    if (name_) Tracer::instance().record(TracePhase::kBegin, name_, 0.0f);
+  }
+  ~TraceSpan() {
+    /* Dropped if tracing stopped meanwhile; exports close open spans. */
+    if (name_) Tracer::instance().record(TracePhase::kEnd, name_, 0.0f);
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* name_;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_TRACE_H
@@ -0,0 +1,203 @@
+/**
+ * UringQueue implementation.
+ *
+ * Ring indices are shared with the kernel: our tail stores (SQ) and head
+ * stores (CQ) are releases, the kernel's tail (CQ) / head (SQ) loads are
+ * acquires, as io_uring(7) prescribes.
+ */
+
+#include "uring_queue.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define NOISEGUARD_HAVE_URING 1
+#endif
+#endif
+
+#ifdef NOISEGUARD_HAVE_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#endif
+
+namespace noiseguard {
+
+#ifdef NOISEGUARD_HAVE_URING
+
+namespace {
+
+int sysSetup(unsigned entries, io_uring_params* p) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sysEnter(int fd, unsigned submit, unsigned complete, unsigned flags) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, fd, submit, complete, flags, nullptr, 0));
+}
+
+int sysRegister(int fd, unsigned op, const void* arg, unsigned count) {
+  return static_cast<int>(syscall(__NR_io_uring_register, fd, op, arg, count));
+}
+
+template <typename T>
+T* at(void* base, unsigned offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+bool UringQueue::available() { return true; }
+
+std::string UringQueue::init(unsigned entries) {
+  close();
+  io_uring_params p;
+  std::memset(&p, 0, sizeof(p));
+  int fd = sysSetup(entries, &p);
+  if (fd < 0) return std::string("io_uring_setup failed: ") + std::strerror(errno);
+  fd_ = fd;
+  entries_ = p.sq_entries;
+
+  sqMapBytes_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cqMapBytes_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single) sqMapBytes_ = cqMapBytes_ = std::max(sqMapBytes_, cqMapBytes_);
+
+  sqMap_ = mmap(nullptr, sqMapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                fd, IORING_OFF_SQ_RING);
+  if (sqMap_ == MAP_FAILED) {
+    sqMap_ = nullptr;
+    close();
+    return "io_uring ring mmap failed";
+  }
+  if (single) {
+    cqMap_ = sqMap_;
+  } else {
+    cqMap_ = mmap(nullptr, cqMapBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  fd, IORING_OFF_CQ_RING);
+    if (cqMap_ == MAP_FAILED) {
+      cqMap_ = nullptr;
+      close();
+      return "io_uring ring mmap failed";
+    }
+  }
+  sqesBytes_ = p.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqesBytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               fd, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    close();
+    return "io_uring ring mmap failed";
+  }
+
+  sqHead_ = at<unsigned>(sqMap_, p.sq_off.head);
+  sqTail_ = at<unsigned>(sqMap_, p.sq_off.tail);
+  sqMask_ = *at<unsigned>(sqMap_, p.sq_off.ring_mask);
+  sqArray_ = at<unsigned>(sqMap_, p.sq_off.array);
+  cqHead_ = at<unsigned>(cqMap_, p.cq_off.head);
+  cqTail_ = at<unsigned>(cqMap_, p.cq_off.tail);
+  cqMask_ = *at<unsigned>(cqMap_, p.cq_off.ring_mask);
+  cqes_ = at<void>(cqMap_, p.cq_off.cqes);
+  return "";
+}
+
+void UringQueue::close() {
+  if (sqes_) munmap(sqes_, sqesBytes_);
+  if (cqMap_ && cqMap_ != sqMap_) munmap(cqMap_, cqMapBytes_);
+  if (sqMap_) munmap(sqMap_, sqMapBytes_);
+  if (fd_ >= 0) ::close(fd_);
+  sqes_ = sqMap_ = cqMap_ = nullptr;
+  fd_ = -1;
+  entries_ = 0;
+  pending_ = 0;
+}
+
+std::string UringQueue::registerBuffers(void* const* data, const size_t* bytes, unsigned count) {
+  if (fd_ < 0) return "io_uring not initialized";
+  std::vector<iovec> iov(count);
+  for (unsigned i = 0; i < count; i++) {
+    iov[i].iov_base = data[i];
+    iov[i].iov_len = bytes[i];
+  }
+  if (sysRegister(fd_, IORING_REGISTER_BUFFERS, iov.data(), count) < 0) {
+    return std::string("io_uring buffer registration failed: ") + std::strerror(errno);
+  }
+  return "";
+}
+
+bool UringQueue::push(bool write, int fd, void* buf, unsigned len, uint64_t offset,
+                      int bufferIndex, uint64_t user) {
+  const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+  const unsigned tail = *sqTail_ + pending_;
+  if (tail - head >= entries_) return false;
+
+  const unsigned slot = tail & sqMask_;
+  io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + slot;
+  std::memset(sqe, 0, sizeof(*sqe));
+  if (bufferIndex >= 0) {
+    sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->buf_index = static_cast<uint16_t>(bufferIndex);
+  } else {
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  }
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(buf);
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->user_data = user;
+  sqArray_[slot] = slot;
+  pending_++;
+  return true;
+}
+
+int UringQueue::submit(unsigned waitFor) {
+  const unsigned count = pending_;
+  if (count > 0) {
+    __atomic_store_n(sqTail_, *sqTail_ + count, __ATOMIC_RELEASE);
+    pending_ = 0;
+  }
+  if (count == 0 && waitFor == 0) return 0;
+  for (;;) {
+    int r = sysEnter(fd_, count, waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0);
+    if (r >= 0) return r;
+    if (errno != EINTR) return -errno;
+  }
+}
+
+bool UringQueue::pop(uint64_t& user, int& result) {
+  const unsigned head = *cqHead_;
+  if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) return false;
+  const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(cqes_) + (head & cqMask_);
+  user = cqe->user_data;
+  result = cqe->res;
+  __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+#else  /* No io_uring */
+
+bool UringQueue::available() { return false; }
+
+std::string UringQueue::init(unsigned) { return "io_uring is not available on this platform"; }
+
+void UringQueue::close() {}
+
+std::string UringQueue::registerBuffers(void* const*, const size_t*, unsigned) {
+  return "io_uring is not available on this platform";
+}
+
+bool UringQueue::push(bool, int, void*, unsigned, uint64_t, int, uint64_t) { return false; }
+
+int UringQueue::submit(unsigned) { return -1; }
+
+bool UringQueue::pop(uint64_t&, int&) { return false; }
+
+#endif
+
+}  // namespace noiseguard
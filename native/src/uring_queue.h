@@ -0,0 +1,93 @@
+/**
+ * UringQueue -- minimal Linux io_uring submission / completion queue for
+ * batched positional file reads and writes, on the raw system calls (no
+ * liburing dependency).
+ *
+ *   push(read / write, fd, buf, len, offset, user) ... push(...)
+ *   submit(wait)  -- one io_uring_enter() hands the whole batch to the
+ *                    kernel and optionally waits for a completion
+ *   pop(user, result) ... pop(...)
+ *
+ * With registerBuffers() the kernel pins the given buffers once; requests
+ * naming a registered buffer (bufferIndex >= 0) then use READ_FIXED /
+ * WRITE_FIXED and skip the per-request page mapping.
+ *
+ * available() is false on other platforms, when the kernel headers lack
+ * io_uring, or when the kernel refuses it (old kernel, seccomp, sysctl
+ * kernel.io_uring_disabled); init() then returns an error and callers fall
+ * back to pread()/pwrite() (see TaskExecutor).
+ *
+ * THREADING: one thread at a time. NOT real-time code.
+ */
+
+#ifndef NOISEGUARD_URING_QUEUE_H
+#define NOISEGUARD_URING_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace noiseguard {
+
+class UringQueue {
+ public:
+  /** Compiled with io_uring support (the kernel may still refuse it). */
+  static bool available();
+
+  UringQueue() = default;
+  ~UringQueue() { close(); }
+
+  UringQueue(const UringQueue&) = delete;
+  UringQueue& operator=(const UringQueue&) = delete;
+
+  /** Create a ring of at least entries slots. Returns empty string on success, or an error. */
+  std::string init(unsigned entries);
+  void close();
+
+  /** Pin count buffers (data[i], bytes[i]) for fixed requests. Returns empty string or an error. */
+  std::string registerBuffers(void* const* data, const size_t* bytes, unsigned count);
+
+  /**
+   * Queue one request. bufferIndex >= 0 names a registered buffer that
+   * contains [buf, buf + len). Returns false if the submission queue is full.
+   */
+  bool push(bool write, int fd, void* buf, unsigned len, uint64_t offset,
+            int bufferIndex, uint64_t user);
+
+  /**
+   * Submit everything pushed and wait for at least waitFor completions.
+   * Returns the number submitted, or -errno.
+   */
+  int submit(unsigned waitFor);
+
+  /** Take one completion: result = bytes transferred or -errno. False if none. */
+  bool pop(uint64_t& user, int& result);
+
+  unsigned entries() const { return entries_; }
+
+ private:
+  int fd_ = -1;
+  unsigned entries_ = 0;
+  unsigned pending_ = 0;  /* Pushed, not yet submitted */
+
+  /* Shared ring memory (see io_uring_setup(2)). */
+  void* sqMap_ = nullptr;
+  size_t sqMapBytes_ = 0;
+  void* cqMap_ = nullptr;
+  size_t cqMapBytes_ = 0;
+  void* sqes_ = nullptr;
+  size_t sqesBytes_ = 0;
+
+  unsigned* sqHead_ = nullptr;
+  unsigned* sqTail_ = nullptr;
+  unsigned sqMask_ = 0;
+  unsigned* sqArray_ = nullptr;
+  unsigned* cqHead_ = nullptr;
+  unsigned* cqTail_ = nullptr;
+  unsigned cqMask_ = 0;
+  void* cqes_ = nullptr;
+};
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_URING_QUEUE_H
@@ -0,0 +1,56 @@
+/**
+ * Canonical 44-byte RIFF/WAVE header, shared by the file writers
+ * (TapRecorder, FlightRecorder). Written up front with a zero size and
+ * patched once the data length is known.
+ */
+
+#ifndef NOISEGUARD_WAV_HEADER_H
+#define NOISEGUARD_WAV_HEADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace noiseguard {
+
+static constexpr size_t kWavHeaderBytes = 44;
+
+/* fmt chunk format tags. */
+static constexpr uint16_t kWavFormatPcm = 1;
+static constexpr uint16_t kWavFormatFloat = 3;
+
+/** Fill h[kWavHeaderBytes] for interleaved samples totalling dataBytes. */
+inline void fillWavHeader(uint8_t* h, uint16_t formatTag, uint16_t channels,
+                          uint32_t sampleRate, uint16_t bitsPerSample,
+                          uint64_t dataBytes) {
+  auto le16 = [](uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+  };
+  auto le32 = [](uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = static_cast<uint8_t>(v >> (8 * i));
+  };
+
+  /* RIFF sizes are 32-bit; saturate rather than wrap. */
+  uint32_t data = static_cast<uint32_t>(
+      std::min<uint64_t>(dataBytes, 0xFFFFFFFFu - (kWavHeaderBytes - 8)));
+  uint16_t blockAlign = static_cast<uint16_t>(channels * (bitsPerSample / 8));
+
+  std::memcpy(h, "RIFF", 4);
+  le32(h + 4, data + kWavHeaderBytes - 8);
+  std::memcpy(h + 8, "WAVEfmt ", 8);
+  le32(h + 16, 16);  /* fmt chunk size */
+  le16(h + 20, formatTag);
+  le16(h + 22, channels);
+  le32(h + 24, sampleRate);
+  le32(h + 28, sampleRate * blockAlign);  /* Byte rate */
+  le16(h + 32, blockAlign);
+  le16(h + 34, bitsPerSample);
+  std::memcpy(h + 36, "data", 4);
+  le32(h + 40, data);
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_WAV_HEADER_H
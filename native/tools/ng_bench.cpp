@@ -0,0 +1,526 @@
+/**
+ * ng_bench -- objective quality and real-time-factor benchmark.
+ *
+ * Mixes every clean-speech file with every noise file at each requested
+ * SNR, runs the mixtures through RNNoiseWrapper on all cores, and reports
+ * quality (SI-SNR and segmental SNR improvement, STOI-like intelligibility,
+ * speech-onset clipping) and cost (CPU per frame, real-time factor) as
+ * JSON, so tuning changes (kFloorMultiplier, kHoldFrames, ...) and
+ * performance regressions show up as numbers in CI:
+ *
+ *   ng_bench <corpus> | --synthetic SECONDS
+ *            [--snr 0,5,10,20] [--jobs N] [--json report.json]
+ *            [--suppression L] [--vad T] [--write-dir DIR]
+ *
+ *   <corpus>/clean/NAME.wav  clean speech (48 kHz; any channels, downmixed)
+ *   <corpus>/noise/NAME.wav  noise, looped/cropped to each clean file
+ *
+ *   --synthetic S  no corpus: two generated talkers against fan, keyboard,
+ *                  hum, white and an "office" mix, S seconds each
+ *                  (signal_gen.h) -- reproducible anywhere, e.g. in CI
+ *   --jobs N       worker threads (default: all cores; use 1 for the
+ *                  steadiest per-frame timing)
+ *   --json PATH    write the report to PATH instead of stdout
+ *   --write-dir    also write each processed mixture as a float WAV
+ *
+ * Mixtures are deterministic (fixed noise offsets), so two runs on the
+ * same corpus differ only in timing. Metric definitions: quality_metrics.h.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "quality_metrics.h"
+#include "rnnoise_wrapper.h"
+#include "signal_gen.h"
+#include "wav_io.h"
+
+using namespace noiseguard;
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr uint32_t kBenchSampleRate = 48000;
+
+/* Keep mixtures below full scale (the reference is scaled alongside). */
+static constexpr float kMixPeak = 0.99f;
+
+/* Chain delay search range for alignment (samples). */
+static constexpr size_t kMaxDelay = 4 * kRNNoiseFrameSize;
+
+struct Options {
+  std::string corpus;
+  double synthetic = 0.0;       /* Seconds per generated clip; 0 = use corpus */
+  std::vector<double> snrs = {0.0, 5.0, 10.0, 20.0};
+  unsigned jobs = 0;
+  std::string jsonPath;
+  std::string writeDir;
+  float suppression = 1.0f;
+  float vadThreshold = 0.65f;
+};
+
+struct Clip {
+  std::string name;
+  std::vector<float> samples;
+};
+
+struct Job {
+  size_t clean, noise, snr;
+};
+
+struct Result {
+  std::string error;
+  double seconds = 0.0;
+  double siSnrIn = 0.0, siSnrOut = 0.0;
+  double segSnrIn = 0.0, segSnrOut = 0.0;
+  double stoiIn = 0.0, stoiOut = 0.0;
+  quality::OnsetStats onsets;
+  std::vector<float> frameUs;
+  double cpuSeconds = 0.0;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_bench <corpus> | --synthetic SECONDS\n"
+      "                [--snr 0,5,10,20] [--jobs N] [--json report.json]\n"
+      "                [--suppression L] [--vad T] [--write-dir DIR]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--snr" && hasValue) {
+      opt.snrs.clear();
+      std::string list = argv[++i];
+      for (size_t pos = 0; pos <= list.size();) {
+        size_t comma = std::min(list.find(',', pos), list.size());
+        opt.snrs.push_back(std::atof(list.substr(pos, comma - pos).c_str()));
+        pos = comma + 1;
+      }
+    } else if (a == "--synthetic" && hasValue) {
+      opt.synthetic = std::atof(argv[++i]);
+    } else if (a == "--jobs" && hasValue) {
+      opt.jobs = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--json" && hasValue) {
+      opt.jsonPath = argv[++i];
+    } else if (a == "--write-dir" && hasValue) {
+      opt.writeDir = argv[++i];
+    } else if (a == "--suppression" && hasValue) {
+      opt.suppression = static_cast<float>(std::atof(argv[++i]));
+    } else if (a == "--vad" && hasValue) {
+      opt.vadThreshold = static_cast<float>(std::atof(argv[++i]));
+    } else if (!a.empty() && a[0] != '-' && opt.corpus.empty()) {
+      opt.corpus = a;
+    } else {
+      return false;
+    }
+  }
+  return (opt.corpus.empty() != (opt.synthetic <= 0.0)) && !opt.snrs.empty();
+}
+
+/** CPU time consumed by the calling thread, in seconds. */
+double threadCpuSeconds() {
+#ifdef _WIN32
+  FILETIME create, exit, kernel, user;
+  GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user);
+  auto ticks = [](const FILETIME& t) {
+    return (static_cast<uint64_t>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  return static_cast<double>(ticks(kernel) + ticks(user)) * 1e-7;
+#else
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+#endif
+}
+
+std::string loadDir(const fs::path& dir, std::vector<Clip>& clips) {
+  std::error_code ec;
+  std::vector<fs::path> paths;
+  for (const auto& entry : fs::directory_iterator(dir, ec)) {
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (entry.is_regular_file() && ext == ".wav") paths.push_back(entry.path());
+  }
+  if (ec) return "Cannot list " + dir.string();
+  if (paths.empty()) return "No .wav files in " + dir.string();
+  std::sort(paths.begin(), paths.end());
+
+  for (const auto& p : paths) {
+    WavData wav;
+    std::string err = readWav(p.string(), wav);
+    if (!err.empty()) return err;
+    if (wav.sampleRate != kBenchSampleRate) {
+      return p.string() + ": " + std::to_string(wav.sampleRate) + " Hz (need 48000)";
+    }
+    if (wav.samples.empty()) return p.string() + ": no samples";
+    clips.push_back({p.stem().string(), std::move(wav.samples)});
+  }
+  return "";
+}
+
+/** Clip of the given components, generated. */
+Clip synthesize(const std::string& name, std::initializer_list<SignalSpec> specs,
+                double seconds) {
+  SignalMix mix;
+  for (const SignalSpec& s : specs) mix.add(s);
+  Clip clip{name, std::vector<float>(static_cast<size_t>(seconds * kBenchSampleRate))};
+  mix.render(clip.samples.data(), clip.samples.size());
+  return clip;
+}
+
+/**
+ * Built-in corpus: speech covers onsets, hold and pauses of digital
+ * silence; the noises cover the floor tracker, clamp and transient paths.
+ */
+void syntheticCorpus(double seconds, std::vector<Clip>& cleans, std::vector<Clip>& noises) {
+  auto spec = [](SignalKind kind, uint32_t seed, float levelDb = NAN) {
+    SignalSpec s;
+    s.kind = kind;
+    s.seed = seed;
+    s.levelDb = levelDb;
+    return s;
+  };
+  cleans.push_back(synthesize("talker1", {spec(SignalKind::kSpeech, 1)}, seconds));
+  cleans.push_back(synthesize("talker2", {spec(SignalKind::kSpeech, 2)}, seconds));
+  noises.push_back(synthesize("fan", {spec(SignalKind::kFan, 3)}, seconds));
+  noises.push_back(synthesize("keyboard", {spec(SignalKind::kKeyboard, 4)}, seconds));
+  noises.push_back(synthesize("hum", {spec(SignalKind::kHum, 5)}, seconds));
+  noises.push_back(synthesize("white", {spec(SignalKind::kWhite, 6)}, seconds));
+  noises.push_back(synthesize("office", {spec(SignalKind::kFan, 7, -40.0f),
+                                         spec(SignalKind::kKeyboard, 8, -30.0f),
+                                         spec(SignalKind::kHum, 9, -50.0f)},
+                              seconds));
+}
+
+/** Run signal through a fresh chain, frame by frame; out gets the raw output. */
+void runChain(const Options& opt, const std::vector<float>& in, std::vector<float>& out,
+              std::vector<float>* frameUs, double* cpuSeconds) {
+  RNNoiseWrapper chain;
+  chain.init();
+  chain.setSuppressionLevel(opt.suppression);
+  chain.setVadThreshold(opt.vadThreshold);
+
+  size_t frames = (in.size() + kRNNoiseFrameSize - 1) / kRNNoiseFrameSize;
+  out.assign(frames * kRNNoiseFrameSize, 0.0f);
+  std::copy(in.begin(), in.end(), out.begin());
+  if (frameUs) frameUs->reserve(frames);
+
+  double cpu0 = threadCpuSeconds();
+  for (size_t f = 0; f < frames; f++) {
+    auto t0 = std::chrono::steady_clock::now();
+    chain.processFrame(&out[f * kRNNoiseFrameSize]);
+    auto t1 = std::chrono::steady_clock::now();
+    if (frameUs) {
+      frameUs->push_back(std::chrono::duration<float, std::micro>(t1 - t0).count());
+    }
+  }
+  if (cpuSeconds) *cpuSeconds = threadCpuSeconds() - cpu0;
+}
+
+/**
+ * The chain's input-to-output delay, measured once on a clean file (the
+ * lag maximizing the cross-correlation) and used to align every mixture.
+ */
+size_t measureDelay(const Options& opt, const std::vector<float>& clean) {
+  std::vector<float> in(clean.begin(), clean.end());
+  in.resize(in.size() + kMaxDelay, 0.0f);
+  std::vector<float> out;
+  runChain(opt, in, out, nullptr, nullptr);
+
+  /* Correlate over the loudest two seconds (or the whole clip). */
+  const size_t win = std::min<size_t>(clean.size(), 2 * kBenchSampleRate);
+  size_t bestStart = 0;
+  double bestE = -1.0;
+  for (size_t s = 0; s + win <= clean.size(); s += kBenchSampleRate / 2) {
+    double e = quality::energy(&clean[s], win);
+    if (e > bestE) bestE = e, bestStart = s;
+  }
+
+  size_t best = 0;
+  double bestCorr = -1e300;
+  for (size_t lag = 0; lag <= kMaxDelay; lag++) {
+    double c = quality::dot(&clean[bestStart], &out[bestStart + lag], win);
+    if (c > bestCorr) bestCorr = c, best = lag;
+  }
+  return best;
+}
+
+Result runJob(const Options& opt, const std::vector<Clip>& cleans,
+              const std::vector<Clip>& noises, const Job& job, size_t delay) {
+  Result r;
+  const std::vector<float>& c0 = cleans[job.clean].samples;
+  const std::vector<float>& n0 = noises[job.noise].samples;
+  const size_t len = c0.size();
+  r.seconds = static_cast<double>(len) / kBenchSampleRate;
+
+  /* Deterministic noise excerpt, looped if shorter than the speech. */
+  std::vector<float> noise(len);
+  size_t offset = (job.clean * 7919 + job.snr * 104729) % n0.size();
+  for (size_t i = 0; i < len; i++) noise[i] = n0[(offset + i) % n0.size()];
+
+  double ec = quality::energy(c0.data(), len);
+  double en = quality::energy(noise.data(), len);
+  if (ec <= 0.0 || en <= 0.0) {
+    r.error = "silent clean or noise file";
+    return r;
+  }
+  float g = static_cast<float>(std::sqrt(ec / (en * std::pow(10.0, opt.snrs[job.snr] / 10.0))));
+
+  std::vector<float> clean(c0), mix(len);
+  float peak = 0.0f;
+  for (size_t i = 0; i < len; i++) {
+    mix[i] = clean[i] + g * noise[i];
+    peak = std::max(peak, std::fabs(mix[i]));
+  }
+  if (peak > kMixPeak) {
+    float s = kMixPeak / peak;
+    for (size_t i = 0; i < len; i++) {
+      clean[i] *= s;
+      mix[i] *= s;
+    }
+  }
+
+  std::vector<float> in(mix);
+  in.resize(len + delay, 0.0f);
+  std::vector<float> raw;
+  runChain(opt, in, raw, &r.frameUs, &r.cpuSeconds);
+  std::vector<float> out(raw.begin() + static_cast<std::ptrdiff_t>(delay),
+                         raw.begin() + static_cast<std::ptrdiff_t>(delay + len));
+
+  std::vector<bool> active = quality::activeFrames(clean);
+  r.siSnrIn = quality::siSnr(clean, mix);
+  r.siSnrOut = quality::siSnr(clean, out);
+  r.segSnrIn = quality::segmentalSnr(clean, mix, active);
+  r.segSnrOut = quality::segmentalSnr(clean, out, active);
+  r.stoiIn = quality::stoiLike(clean, mix);
+  r.stoiOut = quality::stoiLike(clean, out);
+  r.onsets = quality::onsetClipping(clean, out, active);
+
+  if (!opt.writeDir.empty()) {
+    char snr[32];
+    std::snprintf(snr, sizeof(snr), "%g", opt.snrs[job.snr]);
+    std::string base = opt.writeDir + "/" + cleans[job.clean].name + "__" +
+                       noises[job.noise].name + "__" + snr + "dB";
+    std::string err = writeWav(base + ".in.wav", mix.data(), len, kBenchSampleRate);
+    if (err.empty()) err = writeWav(base + ".out.wav", out.data(), len, kBenchSampleRate);
+    r.error = err;
+  }
+  return r;
+}
+
+/* ─── Reporting ─── */
+
+std::string jsonString(const std::string& s) {
+  std::string out = "\"";
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      out += '\\';
+      out += ch;
+    } else if (static_cast<unsigned char>(ch) < 0x20) {
+      char esc[8];
+      std::snprintf(esc, sizeof(esc), "\\u%04x", ch);
+      out += esc;
+    } else {
+      out += ch;
+    }
+  }
+  return out + "\"";
+}
+
+float percentile(std::vector<float> v, double p) {
+  if (v.empty()) return 0.0f;
+  size_t k = static_cast<size_t>(p * static_cast<double>(v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+  return v[k];
+}
+
+/* Mean quality / cost over a set of results. */
+struct Aggregate {
+  size_t mixtures = 0;
+  double seconds = 0.0, cpuSeconds = 0.0;
+  double siSnrImprovement = 0.0, segSnrImprovement = 0.0;
+  double stoiIn = 0.0, stoiOut = 0.0, onsetGainDb = 0.0;
+  size_t onsets = 0, clippedOnsets = 0;
+  std::vector<float> frameUs;
+
+  void add(const Result& r) {
+    mixtures++;
+    seconds += r.seconds;
+    cpuSeconds += r.cpuSeconds;
+    siSnrImprovement += r.siSnrOut - r.siSnrIn;
+    segSnrImprovement += r.segSnrOut - r.segSnrIn;
+    stoiIn += r.stoiIn;
+    stoiOut += r.stoiOut;
+    onsetGainDb += r.onsets.meanGainDb * static_cast<double>(r.onsets.onsets);
+    onsets += r.onsets.onsets;
+    clippedOnsets += r.onsets.clipped;
+    frameUs.insert(frameUs.end(), r.frameUs.begin(), r.frameUs.end());
+  }
+
+  void print(FILE* f) const {
+    double n = mixtures ? static_cast<double>(mixtures) : 1.0;
+    double frames = static_cast<double>(std::max<size_t>(frameUs.size(), 1));
+    std::fprintf(f,
+        "{\"mixtures\":%zu,\"seconds\":%.2f,\"siSnrImprovement\":%.3f,"
+        "\"segSnrImprovement\":%.3f,\"stoiIn\":%.4f,\"stoiOut\":%.4f,"
+        "\"onsets\":%zu,\"clippedOnsets\":%zu,\"onsetGainDb\":%.2f,"
+        "\"cpuUsPerFrame\":%.2f,\"frameUs\":{\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f},"
+        "\"realtimeFactor\":%.1f}",
+        mixtures, seconds, siSnrImprovement / n, segSnrImprovement / n,
+        stoiIn / n, stoiOut / n, onsets, clippedOnsets,
+        onsets ? onsetGainDb / static_cast<double>(onsets) : 0.0,
+        1e6 * cpuSeconds / frames, percentile(frameUs, 0.50), percentile(frameUs, 0.99),
+        frameUs.empty() ? 0.0f : *std::max_element(frameUs.begin(), frameUs.end()),
+        cpuSeconds > 0.0 ? seconds / cpuSeconds : 0.0);
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+
+  std::vector<Clip> cleans, noises;
+  std::string err;
+  if (opt.synthetic > 0.0) {
+    syntheticCorpus(opt.synthetic, cleans, noises);
+    char label[48];
+    std::snprintf(label, sizeof(label), "synthetic:%gs", opt.synthetic);
+    opt.corpus = label;
+  } else {
+    err = loadDir(fs::path(opt.corpus) / "clean", cleans);
+    if (err.empty()) err = loadDir(fs::path(opt.corpus) / "noise", noises);
+  }
+  if (err.empty() && !opt.writeDir.empty()) {
+    std::error_code ec;
+    fs::create_directories(opt.writeDir, ec);
+    if (ec) err = "Cannot create " + opt.writeDir;
+  }
+  if (err.empty() && !RNNoiseWrapper().init()) err = "RNNoise initialization failed";
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_bench: %s\n", err.c_str());
+    return 2;
+  }
+
+  const size_t delay = measureDelay(opt, cleans[0].samples);
+
+  std::vector<Job> jobs;
+  for (size_t c = 0; c < cleans.size(); c++) {
+    for (size_t n = 0; n < noises.size(); n++) {
+      for (size_t s = 0; s < opt.snrs.size(); s++) jobs.push_back({c, n, s});
+    }
+  }
+
+  unsigned workers = opt.jobs ? opt.jobs : std::max(1u, std::thread::hardware_concurrency());
+  workers = static_cast<unsigned>(std::min<size_t>(workers, jobs.size()));
+  std::fprintf(stderr, "ng_bench: %zu mixtures on %u threads, chain delay %zu samples\n",
+               jobs.size(), workers, delay);
+
+  std::vector<Result> results(jobs.size());
+  std::atomic<size_t> next{0};
+  auto wall0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (unsigned w = 0; w < workers; w++) {
+    pool.emplace_back([&] {
+      for (size_t i; (i = next.fetch_add(1)) < jobs.size();) {
+        results[i] = runJob(opt, cleans, noises, jobs[i], delay);
+      }
+    });
+  }
+  for (auto& t : pool) t.join();
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  FILE* out = stdout;
+  if (!opt.jsonPath.empty()) {
+    out = std::fopen(opt.jsonPath.c_str(), "w");
+    if (!out) {
+      std::fprintf(stderr, "ng_bench: cannot open %s\n", opt.jsonPath.c_str());
+      return 2;
+    }
+  }
+
+  std::fprintf(out,
+      "{\"config\":{\"corpus\":%s,\"cleanFiles\":%zu,\"noiseFiles\":%zu,"
+      "\"suppression\":%.3f,\"vadThreshold\":%.3f,\"threads\":%u,"
+      "\"chainDelaySamples\":%zu,\"wallSeconds\":%.3f},\n\"mixtures\":[\n",
+      jsonString(opt.corpus).c_str(), cleans.size(), noises.size(),
+      opt.suppression, opt.vadThreshold, workers, delay, wall);
+
+  Aggregate overall;
+  std::vector<Aggregate> bySnr(opt.snrs.size());
+  int failures = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    const Job& j = jobs[i];
+    const Result& r = results[i];
+    std::fprintf(out, "%s{\"clean\":%s,\"noise\":%s,\"snr\":%g,",
+                 i ? ",\n" : "", jsonString(cleans[j.clean].name).c_str(),
+                 jsonString(noises[j.noise].name).c_str(), opt.snrs[j.snr]);
+    if (!r.error.empty()) {
+      std::fprintf(out, "\"error\":%s}", jsonString(r.error).c_str());
+      std::fprintf(stderr, "ng_bench: %s / %s: %s\n", cleans[j.clean].name.c_str(),
+                   noises[j.noise].name.c_str(), r.error.c_str());
+      failures++;
+      continue;
+    }
+    double frames = static_cast<double>(std::max<size_t>(r.frameUs.size(), 1));
+    std::fprintf(out,
+        "\"seconds\":%.2f,\"siSnrIn\":%.3f,\"siSnrOut\":%.3f,"
+        "\"segSnrIn\":%.3f,\"segSnrOut\":%.3f,\"stoiIn\":%.4f,\"stoiOut\":%.4f,"
+        "\"onsets\":%zu,\"clippedOnsets\":%zu,\"onsetGainDb\":%.2f,"
+        "\"cpuUsPerFrame\":%.2f,\"frameUsP99\":%.2f}",
+        r.seconds, r.siSnrIn, r.siSnrOut, r.segSnrIn, r.segSnrOut, r.stoiIn, r.stoiOut,
+        r.onsets.onsets, r.onsets.clipped, r.onsets.meanGainDb,
+        1e6 * r.cpuSeconds / frames, percentile(r.frameUs, 0.99));
+    overall.add(r);
+    bySnr[j.snr].add(r);
+  }
+
+  std::fprintf(out, "\n],\n\"bySnr\":[\n");
+  for (size_t s = 0; s < opt.snrs.size(); s++) {
+    std::fprintf(out, "%s{\"snr\":%g,\"summary\":", s ? ",\n" : "", opt.snrs[s]);
+    bySnr[s].print(out);
+    std::fprintf(out, "}");
+  }
+  std::fprintf(out, "\n],\n\"summary\":");
+  overall.print(out);
+  std::fprintf(out, "}\n");
+  if (out != stdout) std::fclose(out);
+
+  /* Human-readable digest. */
+  std::fprintf(stderr, "   SNR   dSI-SNR  dsegSNR  STOI in->out  clipped onsets\n");
+  for (size_t s = 0; s < opt.snrs.size(); s++) {
+    const Aggregate& a = bySnr[s];
+    double n = a.mixtures ? static_cast<double>(a.mixtures) : 1.0;
+    std::fprintf(stderr, "%6g %9.2f %8.2f   %.3f->%.3f   %zu/%zu\n", opt.snrs[s],
+                 a.siSnrImprovement / n, a.segSnrImprovement / n, a.stoiIn / n,
+                 a.stoiOut / n, a.clippedOnsets, a.onsets);
+  }
+  double frames = static_cast<double>(std::max<size_t>(overall.frameUs.size(), 1));
+  std::fprintf(stderr, "CPU %.1f us/frame, p99 %.1f us, %.0fx realtime per core (%.1f s wall)\n",
+               1e6 * overall.cpuSeconds / frames, percentile(overall.frameUs, 0.99),
+               overall.cpuSeconds > 0.0 ? overall.seconds / overall.cpuSeconds : 0.0, wall);
+  return failures ? 1 : 0;
+}
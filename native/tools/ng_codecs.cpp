@@ -0,0 +1,207 @@
+/**
+ * ng_codecs -- round-trip check of the streaming file codecs (audio_file.h).
+ *
+ * For each format, writes synthetic speech over fan noise (signal_gen.h)
+ * through AudioFileWriter in odd-sized blocks, reads it back through
+ * AudioFileReader in other odd-sized blocks and compares:
+ *
+ *   pcm16, flac  bit-exact against the 16-bit quantized input
+ *   float        bit-exact
+ *   opus         same length (pre-skip and end trimming applied) and an
+ *                SNR of at least kOpusMinSnrDb (catches misalignment)
+ *
+ * A second, 100-sample file per format checks that a stream shorter than
+ * one block / packet keeps its exact length.
+ *
+ *   ng_codecs [--format pcm16|float|flac|opus|all] [--seconds S]
+ *
+ * Prints one JSON line per format. Exit status: 0 = all round trips
+ * matched, 1 = a mismatch, 2 = error. `cmake --build ... --target
+ * codeccheck` runs it once per format.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "audio_file.h"
+#include "signal_gen.h"
+
+using namespace noiseguard;
+
+namespace {
+
+static constexpr uint32_t kSampleRate = 48000;
+
+/* Opus at kOpusBitrate keeps speech + fan well above this waveform SNR. */
+static constexpr double kOpusMinSnrDb = 12.0;
+
+/* Deliberately unaligned to packet / FLAC block / read chunk sizes. */
+static constexpr size_t kWriteBlock = 1237;
+static constexpr size_t kReadBlock = 3001;
+
+static constexpr size_t kShortSamples = 100;
+
+struct Format {
+  const char* name;
+  AudioFileEncoding encoding;
+  const char* extension;
+};
+
+static const Format kFormats[] = {
+    {"pcm16", AudioFileEncoding::kPcm16, ".wav"},
+    {"float", AudioFileEncoding::kFloat32, ".wav"},
+    {"flac", AudioFileEncoding::kFlac, ".flac"},
+    {"opus", AudioFileEncoding::kOpus, ".opus"},
+};
+
+struct Options {
+  std::string format = "all";
+  double seconds = 5.0;
+};
+
+void usage() {
+  std::fprintf(stderr, "usage: ng_codecs [--format pcm16|float|flac|opus|all] [--seconds S]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--format" && hasValue) {
+      opt.format = argv[++i];
+    } else if (a == "--seconds" && hasValue) {
+      opt.seconds = std::atof(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  if (opt.seconds <= 0.0) return false;
+  if (opt.format == "all") return true;
+  for (const Format& f : kFormats) {
+    if (opt.format == f.name) return true;
+  }
+  return false;
+}
+
+std::vector<float> synthesize(size_t samples) {
+  SignalMix mix;
+  SignalSpec speech;
+  speech.kind = SignalKind::kSpeech;
+  mix.add(speech);
+  SignalSpec fan;
+  fan.kind = SignalKind::kFan;
+  mix.add(fan);
+  std::vector<float> out(samples);
+  mix.render(out.data(), out.size());
+  return out;
+}
+
+/** What the format stores for v: the writer's 16-bit quantization, read back. */
+float expected(const Format& f, float v) {
+  if (f.encoding == AudioFileEncoding::kFloat32 || f.encoding == AudioFileEncoding::kOpus) {
+    return v;
+  }
+  float q = static_cast<float>(std::lrint(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+  return q / 32768.0f;
+}
+
+struct Result {
+  size_t samples = 0;
+  uint64_t bytes = 0;
+  size_t mismatches = 0;
+  double maxError = 0.0;
+  double snrDb = 0.0;
+};
+
+/** Write input to path as f, read it back. Returns empty string or an error. */
+std::string roundTrip(const Format& f, const std::string& path, const std::vector<float>& input,
+                      Result& r) {
+  AudioFileWriter writer;
+  std::string err = writer.open(path, f.encoding, kSampleRate);
+  for (size_t i = 0; err.empty() && i < input.size(); i += kWriteBlock) {
+    err = writer.write(input.data() + i, std::min(kWriteBlock, input.size() - i));
+  }
+  std::string closeErr = writer.close();
+  if (err.empty()) err = closeErr;
+  if (!err.empty()) return err;
+  r.bytes = std::filesystem::file_size(path);
+
+  AudioFileReader reader;
+  err = reader.open(path);
+  if (!err.empty()) return err;
+  if (reader.sampleRate() != kSampleRate || reader.channels() != 1) {
+    return "header mismatch: " + std::to_string(reader.sampleRate()) + " Hz, " +
+           std::to_string(reader.channels()) + " channels";
+  }
+  std::vector<float> output;
+  std::vector<float> block(kReadBlock);
+  for (size_t n; (n = reader.read(block.data(), block.size())) > 0;) {
+    output.insert(output.end(), block.begin(), block.begin() + static_cast<std::ptrdiff_t>(n));
+  }
+  if (!reader.error().empty()) return reader.error();
+  r.samples = output.size();
+
+  double signal = 0.0, noise = 0.0;
+  for (size_t i = 0; i < std::min(input.size(), output.size()); i++) {
+    const double want = expected(f, input[i]);
+    const double diff = output[i] - want;
+    if (diff != 0.0) r.mismatches++;
+    r.maxError = std::max(r.maxError, std::fabs(diff));
+    signal += want * want;
+    noise += diff * diff;
+  }
+  r.snrDb = noise > 0.0 ? 10.0 * std::log10(signal / noise) : INFINITY;
+  return "";
+}
+
+/** Check one format. Returns 0 (pass), 1 (mismatch) or 2 (error), as the exit status. */
+int check(const Format& f, size_t samples) {
+  const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+  const std::string path = (std::filesystem::temp_directory_path() /
+                            ("ng_codecs_" + std::to_string(stamp) + f.extension)).string();
+
+  const std::vector<float> input = synthesize(samples);
+  const std::vector<float> shortInput(input.begin(), input.begin() + kShortSamples);
+  Result full, brief;
+  std::string err = roundTrip(f, path, input, full);
+  if (err.empty()) err = roundTrip(f, path, shortInput, brief);
+  std::error_code ignored;
+  std::filesystem::remove(path, ignored);
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_codecs: %s: %s\n", f.name, err.c_str());
+    return 2;
+  }
+
+  const bool lossy = f.encoding == AudioFileEncoding::kOpus;
+  const bool ok = full.samples == input.size() && brief.samples == shortInput.size() &&
+                  (lossy ? full.snrDb >= kOpusMinSnrDb : full.mismatches == 0 && brief.mismatches == 0);
+  std::printf("{\"format\":\"%s\",\"samples\":%zu,\"decoded\":%zu,\"shortDecoded\":%zu,"
+              "\"bytes\":%llu,\"mismatches\":%zu,\"maxError\":%.6g,\"snrDb\":%.1f,\"ok\":%s}\n",
+              f.name, input.size(), full.samples, brief.samples,
+              static_cast<unsigned long long>(full.bytes), full.mismatches, full.maxError,
+              std::isinf(full.snrDb) ? 999.0 : full.snrDb, ok ? "true" : "false");
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  const size_t samples = static_cast<size_t>(opt.seconds * kSampleRate);
+  int status = 0;
+  for (const Format& f : kFormats) {
+    if (opt.format != "all" && opt.format != f.name) continue;
+    status = std::max(status, check(f, std::max(samples, kShortSamples)));
+  }
+  return status;
+}
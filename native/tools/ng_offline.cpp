@@ -0,0 +1,329 @@
+/**
+ * ng_offline -- denoise a long recording on all cores (segmented_denoise.h).
+ *
+ *   ng_offline <in.wav> <out.wav> | --synthetic SECONDS [out.wav]
+ *              [--workers N] [--segment-s S] [--warmup-s S] [--crossfade-ms MS]
+ *              [--checkpoint PATH] [--compare] [--suppression L] [--vad T]
+ *   ng_offline --stream <in> <out> [--format pcm16|float|flac|opus] [--rate HZ]
+ *              [--suppression L] [--vad T]
+ *
+ *   --workers N        threads (default: all cores)
+ *   --segment-s S      segment length (default 30; 0 = serial)
+ *   --warmup-s S       priming before each segment (default 3)
+ *   --crossfade-ms MS  boundary crossfade (default 10)
+ *   --checkpoint PATH  record finished segments; re-running the same
+ *                      command after a crash resumes from PATH
+ *   --compare          also run serially and with 1, 2, 4, ... workers in
+ *                      memory; report the difference from the serial output
+ *                      and the speedup per worker count
+ *   --synthetic S      no input file: S seconds of generated speech over
+ *                      fan and keyboard noise (signal_gen.h)
+ *
+ * Output is a mono 32-bit float WAV at 48 kHz, aligned with the input (no
+ * latency). Prints a JSON report on stdout.
+ *
+ * --stream instead runs the constant-memory file pipeline
+ * (offline_pipeline.h): WAV, FLAC or Ogg/Opus at any rate / channel count
+ * in, decode, resample, DSP and encode on separate threads, output at
+ * --rate (default: the input's; for Opus 48 kHz unless the input's rate is
+ * one Opus supports) as 16-bit PCM WAV (default), float WAV, 16-bit FLAC
+ * or Ogg/Opus.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_util.h"
+#include "offline_pipeline.h"
+#include "segmented_denoise.h"
+#include "signal_gen.h"
+#include "wav_io.h"
+
+using namespace noiseguard;
+
+namespace {
+
+static constexpr uint32_t kSampleRate = 48000;
+
+struct Options {
+  std::string inputPath;
+  std::string outputPath;
+  double synthetic = 0.0;
+  size_t workers = 0;
+  double segmentSeconds = 30.0;
+  double warmupSeconds = 3.0;
+  double crossfadeMs = 10.0;
+  std::string checkpointPath;
+  bool compare = false;
+  float suppression = 1.0f;
+  float vadThreshold = 0.65f;
+  bool stream = false;
+  AudioFileEncoding encoding = AudioFileEncoding::kPcm16;
+  uint32_t rate = 0;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_offline <in.wav> <out.wav> | --synthetic SECONDS [out.wav]\n"
+      "                  [--workers N] [--segment-s S] [--warmup-s S] [--crossfade-ms MS]\n"
+      "                  [--checkpoint PATH] [--compare] [--suppression L] [--vad T]\n"
+      "       ng_offline --stream <in> <out> [--format pcm16|float|flac|opus] [--rate HZ]\n"
+      "                  [--suppression L] [--vad T]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--synthetic" && hasValue) {
+      opt.synthetic = std::atof(argv[++i]);
+    } else if (a == "--workers" && hasValue) {
+      opt.workers = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--segment-s" && hasValue) {
+      opt.segmentSeconds = std::max(0.0, std::atof(argv[++i]));
+    } else if (a == "--warmup-s" && hasValue) {
+      opt.warmupSeconds = std::max(0.0, std::atof(argv[++i]));
+    } else if (a == "--crossfade-ms" && hasValue) {
+      opt.crossfadeMs = std::max(0.0, std::atof(argv[++i]));
+    } else if (a == "--checkpoint" && hasValue) {
+      opt.checkpointPath = argv[++i];
+    } else if (a == "--compare") {
+      opt.compare = true;
+    } else if (a == "--stream") {
+      opt.stream = true;
+    } else if (a == "--format" && hasValue) {
+      std::string f = argv[++i];
+      if (f == "pcm16") {
+        opt.encoding = AudioFileEncoding::kPcm16;
+      } else if (f == "float") {
+        opt.encoding = AudioFileEncoding::kFloat32;
+      } else if (f == "flac") {
+        opt.encoding = AudioFileEncoding::kFlac;
+      } else if (f == "opus") {
+        opt.encoding = AudioFileEncoding::kOpus;
+      } else {
+        return false;
+      }
+    } else if (a == "--rate" && hasValue) {
+      opt.rate = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (a == "--suppression" && hasValue) {
+      opt.suppression = static_cast<float>(std::atof(argv[++i]));
+    } else if (a == "--vad" && hasValue) {
+      opt.vadThreshold = static_cast<float>(std::atof(argv[++i]));
+    } else if (!a.empty() && a[0] != '-') {
+      paths.push_back(a);
+    } else {
+      return false;
+    }
+  }
+  if (opt.stream && (opt.synthetic > 0.0 || opt.compare || !opt.checkpointPath.empty())) {
+    return false;
+  }
+  if (opt.synthetic > 0.0) {
+    if (paths.size() > 1) return false;
+    if (!paths.empty()) opt.outputPath = paths[0];
+  } else {
+    if (paths.size() != 2) return false;
+    opt.inputPath = paths[0];
+    opt.outputPath = paths[1];
+  }
+  return opt.checkpointPath.empty() || !opt.outputPath.empty();
+}
+
+int runStream(const Options& opt) {
+  FileDenoiseConfig config;
+  config.encoding = opt.encoding;
+  config.outputRate = opt.rate;
+  config.params.level = std::clamp(opt.suppression, 0.0f, 1.0f);
+  config.params.vadThreshold = std::clamp(opt.vadThreshold, 0.0f, 1.0f);
+  FileDenoiseStats stats;
+  std::string err = denoiseFile(opt.inputPath, opt.outputPath, config, &stats);
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_offline: %s\n", err.c_str());
+    return 2;
+  }
+  const double audioSeconds = static_cast<double>(stats.inputFrames) / stats.inputRate;
+  std::printf("{\"seconds\":%.3f,\"inputRate\":%u,\"inputChannels\":%u,"
+              "\"outputSamples\":%llu,\"wallSeconds\":%.3f,\"realtimeFactor\":%.1f,"
+              "\"busySeconds\":{\"decode\":%.3f,\"dsp\":%.3f,\"encode\":%.3f}}\n",
+              audioSeconds, stats.inputRate, stats.inputChannels,
+              static_cast<unsigned long long>(stats.outputSamples), stats.seconds,
+              stats.seconds > 0.0 ? audioSeconds / stats.seconds : 0.0,
+              stats.decodeSeconds, stats.dspSeconds, stats.encodeSeconds);
+  return 0;
+}
+
+bool seekTo(FILE* f, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(f, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(f, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+/** Output straight into a float WAV, so finished segments survive a crash. */
+struct FileIo {
+  const float* input = nullptr;
+  FILE* out = nullptr;
+  std::mutex mutex;
+};
+
+SegmentIo fileIo(FileIo& file) {
+  SegmentIo io;
+  io.read = [](void* user, uint64_t offset, float* dst, size_t count) {
+    std::copy_n(static_cast<FileIo*>(user)->input + offset, count, dst);
+    return true;
+  };
+  io.write = [](void* user, uint64_t offset, const float* src, size_t count) {
+    auto* f = static_cast<FileIo*>(user);
+    std::lock_guard<std::mutex> lock(f->mutex);
+    return seekTo(f->out, kWavHeaderBytes + offset * sizeof(float)) &&
+           std::fwrite(src, sizeof(float), count, f->out) == count;
+  };
+  io.sync = [](void* user) {
+    auto* f = static_cast<FileIo*>(user);
+    std::lock_guard<std::mutex> lock(f->mutex);
+    syncFile(f->out);
+    return std::ferror(f->out) == 0;
+  };
+  io.user = &file;
+  return io;
+}
+
+/** Open out.wav for writing at any offset; keep its samples when resuming. */
+FILE* openOutput(const std::string& path, size_t samples, bool resume) {
+  FILE* f = resume ? std::fopen(path.c_str(), "r+b") : nullptr;
+  if (f) return f;
+  f = std::fopen(path.c_str(), "w+b");
+  if (!f) return nullptr;
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, kWavFormatFloat, 1, kSampleRate, 32, uint64_t{samples} * sizeof(float));
+  std::fwrite(header, 1, sizeof(header), f);
+  return f;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (opt.stream) return runStream(opt);
+
+  std::vector<float> input;
+  if (opt.synthetic > 0.0) {
+    SignalMix mix;
+    SignalSpec speech;
+    speech.kind = SignalKind::kSpeech;
+    SignalSpec fan;
+    fan.kind = SignalKind::kFan;
+    fan.seed = 2;
+    SignalSpec keyboard;
+    keyboard.kind = SignalKind::kKeyboard;
+    keyboard.seed = 3;
+    mix.add(speech);
+    mix.add(fan);
+    mix.add(keyboard);
+    input.resize(static_cast<size_t>(opt.synthetic * kSampleRate));
+    mix.render(input.data(), input.size());
+  } else {
+    WavData wav;
+    std::string err = readWav(opt.inputPath, wav);
+    if (err.empty() && wav.sampleRate != kSampleRate) err = "Input must be 48 kHz";
+    if (!err.empty()) {
+      std::fprintf(stderr, "ng_offline: %s\n", err.c_str());
+      return 2;
+    }
+    input = std::move(wav.samples);
+  }
+
+  SegmentConfig config;
+  config.workers = opt.workers;
+  config.segmentSamples = static_cast<size_t>(opt.segmentSeconds * kSampleRate);
+  config.warmupSamples = static_cast<size_t>(opt.warmupSeconds * kSampleRate);
+  config.crossfadeSamples = static_cast<size_t>(opt.crossfadeMs * kSampleRate / 1000.0);
+  config.params.level = std::clamp(opt.suppression, 0.0f, 1.0f);
+  config.params.vadThreshold = std::clamp(opt.vadThreshold, 0.0f, 1.0f);
+  config.checkpointPath = opt.checkpointPath;
+
+  SegmentStats stats;
+  std::vector<float> output;
+  std::string err;
+  if (!opt.outputPath.empty()) {
+    FileIo file;
+    file.input = input.data();
+    file.out = openOutput(opt.outputPath, input.size(), !opt.checkpointPath.empty());
+    if (!file.out) {
+      std::fprintf(stderr, "ng_offline: cannot open %s\n", opt.outputPath.c_str());
+      return 2;
+    }
+    err = denoiseSegmented(input.size(), fileIo(file), config, &stats);
+    if (std::fclose(file.out) != 0 && err.empty()) err = "Failed writing " + opt.outputPath;
+  } else {
+    output.resize(input.size());
+    err = denoiseSegmented(input.data(), output.data(), input.size(), config, &stats);
+  }
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_offline: %s\n", err.c_str());
+    return 2;
+  }
+
+  const double audioSeconds = static_cast<double>(input.size()) / kSampleRate;
+  std::printf("{\"seconds\":%.3f,\"segments\":%zu,\"resumed\":%zu,\"workers\":%zu,"
+              "\"wallSeconds\":%.3f,\"realtimeFactor\":%.1f",
+              audioSeconds, stats.segments, stats.resumed, stats.workers, stats.seconds,
+              stats.seconds > 0.0 ? audioSeconds / stats.seconds : 0.0);
+
+  if (opt.compare) {
+    SegmentConfig serialConfig = config;
+    serialConfig.segmentSamples = 0;
+    serialConfig.checkpointPath.clear();
+    std::vector<float> serial(input.size()), segmented(input.size());
+    SegmentStats serialStats;
+    denoiseSegmented(input.data(), serial.data(), input.size(), serialConfig, &serialStats);
+
+    size_t maxWorkers = opt.workers ? opt.workers
+                                    : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts;
+    for (size_t n = 1; n < maxWorkers; n *= 2) counts.push_back(n);
+    counts.push_back(maxWorkers);
+
+    std::printf(",\n\"serialSeconds\":%.3f,\"scaling\":[\n", serialStats.seconds);
+    for (size_t i = 0; i < counts.size(); i++) {
+      SegmentConfig c = config;
+      c.workers = counts[i];
+      c.checkpointPath.clear();
+      SegmentStats s;
+      denoiseSegmented(input.data(), segmented.data(), input.size(), c, &s);
+
+      /* Difference from the serial output, relative to its energy. */
+      double diffSq = 0.0, refSq = 0.0, maxAbs = 0.0;
+      for (size_t n = 0; n < input.size(); n++) {
+        double d = static_cast<double>(segmented[n]) - serial[n];
+        diffSq += d * d;
+        refSq += static_cast<double>(serial[n]) * serial[n];
+        maxAbs = std::max(maxAbs, std::fabs(d));
+      }
+      double diffDb = (diffSq > 0.0 && refSq > 0.0) ? 10.0 * std::log10(diffSq / refSq) : -INFINITY;
+      std::printf("%s{\"workers\":%zu,\"wallSeconds\":%.3f,\"speedup\":%.2f,"
+                  "\"efficiency\":%.3f,\"diffDb\":%s,\"maxAbsDiff\":%.6g}",
+                  i ? ",\n" : "", s.workers, s.seconds,
+                  s.seconds > 0.0 ? serialStats.seconds / s.seconds : 0.0,
+                  s.seconds > 0.0 ? serialStats.seconds / s.seconds / static_cast<double>(s.workers)
+                                  : 0.0,
+                  std::isinf(diffDb) ? "null" : std::to_string(diffDb).c_str(), maxAbs);
+    }
+    std::printf("\n]");
+  }
+  std::printf("}\n");
+  return 0;
+}
@@ -0,0 +1,289 @@
+/**
+ * ng_replay -- replay a frame capture through this build of the chain.
+ *
+ * Feeds every captured frame, with the parameters it originally ran with,
+ * through a freshly initialized RNNoiseWrapper as fast as possible, then
+ * reports how the output compares with the recorded output and how long
+ * each frame took:
+ *
+ *   ng_replay capture.ngcp [--json] [--output out.f32] [--repeat N]
+ *                          [--restore-every N]
+ *
+ *   --json             machine-readable report on stdout
+ *   --output           write the replayed output as raw f32le (normalized)
+ *   --repeat N         replay N times for steadier timing (diffs from the first)
+ *   --restore-every N  every N frames, move the chain's state into a fresh
+ *                      wrapper (saveState / loadState); must stay bit-exact
+ *
+ * Exit status: 0 = bit-exact, 1 = output differs, 2 = error.
+ *
+ * Captures come from AudioEngine::startCapture() (addon: startCapture(path)).
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "frame_capture.h"
+#include "rnnoise_wrapper.h"
+#include "sample_convert.h"
+
+using namespace noiseguard;
+
+namespace {
+
+struct Options {
+  std::string capturePath;
+  std::string outputPath;
+  bool json = false;
+  int repeat = 1;
+  int restoreEvery = 0;
+};
+
+struct Report {
+  uint64_t frames = 0;
+  uint64_t paramChanges = 0;
+  uint64_t scaledFrames = 0;
+  uint64_t restores = 0;
+  bool truncated = false;
+  bool ended = false;           /* kEnd seen (capture closed cleanly) */
+
+  uint64_t differingFrames = 0;
+  int64_t firstDifferingFrame = -1;
+  uint64_t vadDiffs = 0;
+  double maxAbsDiff = 0.0;      /* Normalized units */
+  double sumSqDiff = 0.0;
+  double sumSqRef = 0.0;
+
+  std::vector<double> frameUs;  /* Per-frame processing time, all passes */
+  double totalSeconds = 0.0;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_replay <capture.ngcp> [--json] [--output out.f32] [--repeat N]\n"
+      "                 [--restore-every N]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--json") {
+      opt.json = true;
+    } else if (a == "--output" && i + 1 < argc) {
+      opt.outputPath = argv[++i];
+    } else if (a == "--repeat" && i + 1 < argc) {
+      opt.repeat = std::max(1, std::atoi(argv[++i]));
+    } else if (a == "--restore-every" && i + 1 < argc) {
+      opt.restoreEvery = std::max(0, std::atoi(argv[++i]));
+    } else if (!a.empty() && a[0] != '-' && opt.capturePath.empty()) {
+      opt.capturePath = a;
+    } else {
+      return false;
+    }
+  }
+  return !opt.capturePath.empty();
+}
+
+/**
+ * One pass over the capture. Diffs and the output file only on the first
+ * pass; timing on every pass. Returns an error message or "".
+ */
+std::string replayPass(const Options& opt, bool first, Report& r, FILE* out) {
+  FrameCaptureReader reader;
+  std::string err = reader.open(opt.capturePath);
+  if (!err.empty()) return err;
+
+  auto chain = std::make_unique<RNNoiseWrapper>();
+  if (!chain->init()) return "RNNoise initialization failed";
+  std::vector<uint8_t> state;
+
+  auto rec = std::make_unique<CaptureRecord>();
+  float frame[kRNNoiseFrameSize];
+  uint64_t expected = 0;
+
+  while (reader.next(*rec)) {
+    switch (rec->kind) {
+      case CaptureRecordKind::kParams:
+        if (!chain->applyParams(rec->params)) {
+          return "Invalid parameters at frame " + std::to_string(rec->frameIndex);
+        }
+        if (first) r.paramChanges++;
+        break;
+
+      case CaptureRecordKind::kFrame: {
+        if (rec->frameIndex != expected) {
+          return "Frame " + std::to_string(expected) + " missing";
+        }
+        expected++;
+
+        const bool scaled = rec->entry == CaptureEntry::kScaled;
+        std::memcpy(frame, rec->input, sizeof(frame));
+
+        auto t0 = std::chrono::steady_clock::now();
+        float vad = scaled ? chain->processFrameScaled(frame) : chain->processFrame(frame);
+        auto t1 = std::chrono::steady_clock::now();
+        r.frameUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+
+        if (opt.restoreEvery > 0 && expected % static_cast<uint64_t>(opt.restoreEvery) == 0) {
+          /* Continue in a new wrapper, as a migrated or resumed session would. */
+          err = chain->saveState(state);
+          auto next = std::make_unique<RNNoiseWrapper>();
+          if (err.empty() && !next->init()) err = "RNNoise initialization failed";
+          if (err.empty()) err = next->loadState(state.data(), state.size());
+          if (!err.empty()) return "State restore at frame " + std::to_string(expected) + ": " + err;
+          chain = std::move(next);
+          if (first) r.restores++;
+        }
+
+        if (!first) break;
+        r.frames++;
+        if (scaled) r.scaledFrames++;
+
+        if (std::memcmp(frame, rec->output, sizeof(frame)) != 0) {
+          r.differingFrames++;
+          if (r.firstDifferingFrame < 0) {
+            r.firstDifferingFrame = static_cast<int64_t>(rec->frameIndex);
+          }
+        }
+        if (std::memcmp(&vad, &rec->vad, sizeof(vad)) != 0) r.vadDiffs++;
+
+        const double toNormalized = scaled ? kInvInt16Scale : 1.0;
+        for (size_t i = 0; i < kRNNoiseFrameSize; i++) {
+          double ref = rec->output[i] * toNormalized;
+          double d = (frame[i] - rec->output[i]) * toNormalized;
+          r.maxAbsDiff = std::max(r.maxAbsDiff, std::fabs(d));
+          r.sumSqDiff += d * d;
+          r.sumSqRef += ref * ref;
+        }
+
+        if (out) {
+          if (scaled) scaleSamples(frame, kRNNoiseFrameSize, kInvInt16Scale);
+          std::fwrite(frame, sizeof(frame), 1, out);
+        }
+        break;
+      }
+
+      case CaptureRecordKind::kEnd:
+        if (first) {
+          r.ended = true;
+          r.truncated = rec->truncated;
+        }
+        break;
+    }
+  }
+  return reader.error();
+}
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0.0;
+  size_t k = static_cast<size_t>(p * static_cast<double>(v.size() - 1));
+  std::nth_element(v.begin(), v.begin() + static_cast<std::ptrdiff_t>(k), v.end());
+  return v[k];
+}
+
+void printReport(const Options& opt, const Report& r) {
+  double sum = 0.0, maxUs = 0.0;
+  for (double us : r.frameUs) {
+    sum += us;
+    maxUs = std::max(maxUs, us);
+  }
+  double meanUs = r.frameUs.empty() ? 0.0 : sum / static_cast<double>(r.frameUs.size());
+  double p50 = percentile(r.frameUs, 0.50);
+  double p99 = percentile(r.frameUs, 0.99);
+  /* Audio time processed per wall-clock second (10 ms per frame). */
+  double realtime = sum > 0.0 ? 1e4 * static_cast<double>(r.frameUs.size()) / sum : 0.0;
+  /* Residual relative to the recorded output, in dB (-inf when exact). */
+  double diffDb = (r.sumSqDiff > 0.0 && r.sumSqRef > 0.0)
+                      ? 10.0 * std::log10(r.sumSqDiff / r.sumSqRef)
+                      : -INFINITY;
+  bool exact = r.differingFrames == 0 && r.vadDiffs == 0;
+
+  if (opt.json) {
+    std::printf(
+        "{\"capture\":\"%s\",\"frames\":%llu,\"scaledFrames\":%llu,"
+        "\"paramChanges\":%llu,\"restores\":%llu,\"complete\":%s,\"truncated\":%s,"
+        "\"bitExact\":%s,\"differingFrames\":%llu,\"firstDifferingFrame\":%lld,"
+        "\"vadDiffs\":%llu,\"maxAbsDiff\":%.9g,\"diffDb\":%s,"
+        "\"passes\":%d,\"frameUs\":{\"mean\":%.3f,\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+        "\"realtimeFactor\":%.1f,\"seconds\":%.3f}\n",
+        opt.capturePath.c_str(),
+        static_cast<unsigned long long>(r.frames),
+        static_cast<unsigned long long>(r.scaledFrames),
+        static_cast<unsigned long long>(r.paramChanges),
+        static_cast<unsigned long long>(r.restores),
+        r.ended ? "true" : "false", r.truncated ? "true" : "false",
+        exact ? "true" : "false",
+        static_cast<unsigned long long>(r.differingFrames),
+        static_cast<long long>(r.firstDifferingFrame),
+        static_cast<unsigned long long>(r.vadDiffs), r.maxAbsDiff,
+        std::isinf(diffDb) ? "null" : std::to_string(diffDb).c_str(),
+        opt.repeat, meanUs, p50, p99, maxUs, realtime, r.totalSeconds);
+    return;
+  }
+
+  std::printf("capture         %s\n", opt.capturePath.c_str());
+  std::printf("frames          %llu (%.2f s, %llu int16-range, %llu parameter changes)%s%s\n",
+              static_cast<unsigned long long>(r.frames),
+              static_cast<double>(r.frames) * kRNNoiseFrameSize / 48000.0,
+              static_cast<unsigned long long>(r.scaledFrames),
+              static_cast<unsigned long long>(r.paramChanges),
+              r.ended ? "" : "  [no end record: capture was not closed]",
+              r.truncated ? "  [truncated: writer fell behind]" : "");
+  if (r.restores > 0) {
+    std::printf("state restores  %llu\n", static_cast<unsigned long long>(r.restores));
+  }
+  if (exact) {
+    std::printf("output          bit-exact\n");
+  } else {
+    std::printf("output          DIFFERS: %llu frames (first #%lld), %llu VAD values\n",
+                static_cast<unsigned long long>(r.differingFrames),
+                static_cast<long long>(r.firstDifferingFrame),
+                static_cast<unsigned long long>(r.vadDiffs));
+    std::printf("                max |diff| %.3g, residual %.1f dB\n", r.maxAbsDiff, diffDb);
+  }
+  std::printf("time per frame  mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us (%d pass%s)\n",
+              meanUs, p50, p99, maxUs, opt.repeat, opt.repeat == 1 ? "" : "es");
+  std::printf("throughput      %.0fx realtime\n", realtime);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+
+  FILE* out = nullptr;
+  if (!opt.outputPath.empty()) {
+    out = std::fopen(opt.outputPath.c_str(), "wb");
+    if (!out) {
+      std::fprintf(stderr, "ng_replay: cannot open %s\n", opt.outputPath.c_str());
+      return 2;
+    }
+  }
+
+  Report r;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < opt.repeat; pass++) {
+    std::string err = replayPass(opt, pass == 0, r, pass == 0 ? out : nullptr);
+    if (!err.empty()) {
+      std::fprintf(stderr, "ng_replay: %s\n", err.c_str());
+      if (out) std::fclose(out);
+      return 2;
+    }
+  }
+  r.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  if (out) std::fclose(out);
+
+  printReport(opt, r);
+  return (r.differingFrames == 0 && r.vadDiffs == 0) ? 0 : 1;
+}
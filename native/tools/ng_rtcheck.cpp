@@ -0,0 +1,205 @@
+/**
+ * ng_rtcheck -- run the real AudioEngine under the real-time-safety checker.
+ *
+ * Links the engine against null_portaudio.cpp (headless devices fed with
+ * synthetic speech over fan noise) and rt_check.cpp (libc interposers), then
+ * exercises everything the processing path touches while it runs: QA taps,
+ * a shared-memory ring with a reader, a frame capture, a timing trace, and
+ * parameter / post chain changes from the control thread. Every allocation, lock or blocking
+ * syscall inside captureCallback, outputCallback or processPending is
+ * reported on stderr with a stack trace.
+ *
+ *   ng_rtcheck [--seconds N] [--format float32|int16|int24] [--no-sinks]
+ *
+ *   --seconds N   how long the engine runs (default 5)
+ *   --format      capture sample format (default float32)
+ *   --no-sinks    engine alone: no taps, shared ring, capture or trace
+ *
+ * Exit status: 0 = no violations, 1 = violations, 2 = error (including a
+ * platform where the checker cannot interpose: results would be vacuous).
+ *
+ * Linux/glibc only; build with -DNOISEGUARD_BUILD_TOOLS=ON -DNOISEGUARD_RT_CHECK=ON.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "audio.h"
+#include "rt_check.h"
+#include "shared_ring.h"
+#include "trace.h"
+
+using namespace noiseguard;
+
+namespace {
+
+/* Shared ring capacity (samples): ~170 ms, drained every 20 ms. */
+static constexpr size_t kSharedCapacity = 8192;
+
+/* Control-thread parameter change interval. */
+static constexpr int kChangeEveryMs = 250;
+
+struct Options {
+  double seconds = 5.0;
+  CaptureFormat format = CaptureFormat::kFloat32;
+  bool sinks = true;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_rtcheck [--seconds N] [--format float32|int16|int24] [--no-sinks]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--seconds" && i + 1 < argc) {
+      opt.seconds = std::atof(argv[++i]);
+      if (!(opt.seconds > 0.0)) return false;
+    } else if (a == "--format" && i + 1 < argc) {
+      std::string f = argv[++i];
+      if (f == "float32") {
+        opt.format = CaptureFormat::kFloat32;
+      } else if (f == "int16") {
+        opt.format = CaptureFormat::kInt16;
+      } else if (f == "int24") {
+        opt.format = CaptureFormat::kInt24;
+      } else {
+        return false;
+      }
+    } else if (a == "--no-sinks") {
+      opt.sinks = false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/** Consumer side of the shared ring, standing in for an AudioWorklet. */
+void drainShared(std::atomic<uint32_t>* header, std::atomic<bool>& stop) {
+  while (!stop.load(std::memory_order_acquire)) {
+    uint32_t w = header[SharedRingWriter::kWriteIndex].load(std::memory_order_acquire);
+    header[SharedRingWriter::kReadIndex].store(w, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (!rtCheckActive()) {
+    std::fprintf(stderr, "ng_rtcheck: the checker cannot interpose on this platform "
+                         "(needs Linux/glibc and NOISEGUARD_RT_CHECK)\n");
+    return 2;
+  }
+
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  fs::path dir = fs::temp_directory_path(ec) / ("ng_rtcheck_" + std::to_string(::getpid()));
+  if (opt.sinks && !fs::create_directories(dir, ec)) {
+    std::fprintf(stderr, "ng_rtcheck: cannot create %s\n", dir.string().c_str());
+    return 2;
+  }
+
+  AudioEngine engine;
+  AudioConfig config;
+  config.tryExclusiveMode = false;
+  config.useCalibratedLatency = false;
+  config.captureFormat = opt.format;
+
+  std::vector<uint32_t> sharedMemory;
+  std::atomic<bool> stopReader{false};
+  std::thread reader;
+  if (opt.sinks) {
+    std::string err = engine.startCapture((dir / "run.ngcp").string());
+    TapConfig taps;
+    taps.paths[static_cast<size_t>(TapPoint::kPreRNNoise)] = (dir / "pre.wav").string();
+    taps.paths[static_cast<size_t>(TapPoint::kPostRNNoise)] = (dir / "post.wav").string();
+    taps.paths[static_cast<size_t>(TapPoint::kFinal)] = (dir / "final.wav").string();
+    if (err.empty()) err = engine.startRecording(taps);
+
+    sharedMemory.assign(SharedRingWriter::bytesFor(kSharedCapacity) / sizeof(uint32_t), 0);
+    auto* header = reinterpret_cast<std::atomic<uint32_t>*>(sharedMemory.data());
+    header[SharedRingWriter::kCapacity].store(kSharedCapacity);
+    if (err.empty()) err = engine.attachSharedOutput(sharedMemory.data(), sharedMemory.size() * 4);
+    if (err.empty()) err = Tracer::instance().start();
+    if (!err.empty()) {
+      std::fprintf(stderr, "ng_rtcheck: %s\n", err.c_str());
+      fs::remove_all(dir, ec);
+      return 2;
+    }
+    reader = std::thread(drainShared, header, std::ref(stopReader));
+  }
+
+  std::string err = engine.start(config);
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_rtcheck: %s\n", err.c_str());
+    stopReader.store(true);
+    if (reader.joinable()) reader.join();
+    fs::remove_all(dir, ec);
+    return 2;
+  }
+
+  /* Everything the control thread can change while audio runs. */
+  const std::vector<std::vector<PostStage>> chains = {
+      {PostStage::kHpf, PostStage::kBlend, PostStage::kGate, PostStage::kLimiter},
+      {PostStage::kBlend, PostStage::kClamp, PostStage::kSoftSilence},
+      engine.postChain(),
+  };
+  auto t0 = std::chrono::steady_clock::now();
+  auto end = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(opt.seconds));
+  for (int step = 0; std::chrono::steady_clock::now() < end; step++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kChangeEveryMs));
+    engine.setSuppressionLevel((step % 4) * 0.25f + 0.25f);
+    engine.setVadThreshold(step % 2 ? 0.5f : 0.75f);
+    engine.setPostChain(chains[static_cast<size_t>(step) % chains.size()]);
+  }
+
+  engine.stop();
+  uint64_t frames = engine.metrics().framesProcessed.load();
+  if (opt.sinks) {
+    engine.detachSharedOutput();
+    engine.stopRecording();
+    stopReader.store(true);
+    reader.join();
+    Tracer::instance().stop();
+    err = Tracer::instance().exportChromeJson((dir / "trace.json").string());
+    if (err.empty()) err = Tracer::instance().exportPerfetto((dir / "trace.pftrace").string());
+    if (!err.empty()) std::fprintf(stderr, "ng_rtcheck: trace export: %s\n", err.c_str());
+    fs::remove_all(dir, ec);
+  }
+
+  uint64_t violations = rtViolationCount();
+  uint64_t scopes = rtScopeCount();
+  std::printf("frames          %llu (%.2f s of audio in %.2f s)\n",
+              static_cast<unsigned long long>(frames),
+              static_cast<double>(frames) * kRNNoiseFrameSize / 48000.0, opt.seconds);
+  const EngineMetrics& em = engine.engineMetrics();
+  std::printf("latency         %.2f ms to processed, %.2f ms to output (max %.2f)\n",
+              em.processLatencyMs.load(), em.outputLatencyMs.load(),
+              em.maxOutputLatencyMs.load());
+  std::printf("rt scopes       %llu\n", static_cast<unsigned long long>(scopes));
+  std::printf("violations      %llu%s\n", static_cast<unsigned long long>(violations),
+              violations ? "  (see stack traces above)" : "");
+  if (frames == 0 || scopes == 0) {
+    std::fprintf(stderr, "ng_rtcheck: the engine processed nothing; nothing was checked\n");
+    return 2;
+  }
+  return violations == 0 ? 0 : 1;
+}
@@ -0,0 +1,227 @@
+/**
+ * ng_shards -- stream scaling benchmark for ShardedRuntime.
+ *
+ * For 1, 2, 4, ... shards (one pinned thread per core) opens N streams per
+ * shard and has each stream push its audio through the runtime as fast as
+ * it is processed, one 10 ms frame in flight per stream. Reports how many
+ * real-time streams each shard count sustains and the scaling efficiency
+ * against one shard, as JSON:
+ *
+ *   ng_shards [--max-shards N] [--streams-per-shard N] [--seconds S]
+ *             [--rebalance-ms MS] [--no-pin] [--huge-pages]
+ *
+ *   --max-shards N        largest shard count (default: all cores, max 256)
+ *   --streams-per-shard N streams opened per shard (default 8)
+ *   --seconds S           audio per stream (default 5)
+ *   --rebalance-ms MS     call rebalance() every MS while running (0 = never)
+ *   --no-pin              leave shard threads unpinned
+ *   --huge-pages          back the shard session arenas with huge pages
+ *
+ * Every stream denoises the same synthetic speech over fan noise
+ * (signal_gen.h), so runs are comparable across machines.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shard_runtime.h"
+#include "signal_gen.h"
+
+using namespace noiseguard;
+
+namespace {
+
+static constexpr double kSampleRate = 48000.0;
+
+struct Options {
+  size_t maxShards = 0;
+  size_t streamsPerShard = 8;
+  double seconds = 5.0;
+  int rebalanceMs = 0;
+  bool pin = true;
+  bool hugePages = false;
+};
+
+/** One stream: re-submits its next frame from the completion callback. */
+struct Stream {
+  ShardedRuntime* runtime = nullptr;
+  ShardedRuntime::Session* session = nullptr;
+  const std::vector<float>* source = nullptr;
+  size_t pos = 0;
+  float frame[kRNNoiseFrameSize];
+  std::atomic<size_t>* remaining = nullptr;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_shards [--max-shards N] [--streams-per-shard N] [--seconds S]\n"
+      "                 [--rebalance-ms MS] [--no-pin] [--huge-pages]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--max-shards" && hasValue) {
+      opt.maxShards = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--streams-per-shard" && hasValue) {
+      opt.streamsPerShard = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--seconds" && hasValue) {
+      opt.seconds = std::atof(argv[++i]);
+    } else if (a == "--rebalance-ms" && hasValue) {
+      opt.rebalanceMs = std::max(0, std::atoi(argv[++i]));
+    } else if (a == "--no-pin") {
+      opt.pin = false;
+    } else if (a == "--huge-pages") {
+      opt.hugePages = true;
+    } else {
+      return false;
+    }
+  }
+  return opt.seconds > 0.0;
+}
+
+void submitNext(Stream* s) {
+  std::memcpy(s->frame, s->source->data() + s->pos, sizeof(s->frame));
+  s->pos += kRNNoiseFrameSize;
+  s->runtime->submit(s->session, s->frame, kRNNoiseFrameSize,
+                     [](void* user, float*, size_t) {
+                       auto* st = static_cast<Stream*>(user);
+                       if (st->pos + kRNNoiseFrameSize <= st->source->size()) {
+                         submitNext(st);
+                       } else {
+                         st->remaining->fetch_sub(1, std::memory_order_release);
+                       }
+                     },
+                     s);
+}
+
+struct RunResult {
+  size_t shards = 0;
+  size_t streams = 0;
+  double wallSeconds = 0.0;
+  double realtimeStreams = 0.0;  /* Audio seconds processed per wall second */
+  double maxShardShare = 0.0;    /* Busiest shard's busy time / mean */
+  size_t migrations = 0;
+  int pinned = 0;
+  int hugeShards = 0;            /* Shards whose arena got explicit huge pages */
+};
+
+RunResult runOnce(const Options& opt, size_t shards, const std::vector<float>& source,
+                  std::string& err) {
+  RunResult r;
+  ShardedRuntime runtime;
+  ShardConfig config;
+  config.shards = shards;
+  config.pinThreads = opt.pin;
+  config.sessionsPerShard = opt.streamsPerShard;
+  config.hugePages = opt.hugePages;
+  err = runtime.start(config);
+  if (!err.empty()) return r;
+
+  const size_t streamCount = shards * opt.streamsPerShard;
+  std::vector<Stream> streams(streamCount);
+  std::atomic<size_t> remaining{streamCount};
+  for (size_t i = 0; i < streamCount && err.empty(); i++) {
+    streams[i].runtime = &runtime;
+    streams[i].source = &source;
+    streams[i].remaining = &remaining;
+    streams[i].session = runtime.open(i, &err);
+  }
+  if (!err.empty()) return r;
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (Stream& s : streams) submitNext(&s);
+  auto lastRebalance = t0;
+  while (remaining.load(std::memory_order_acquire) != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    auto now = std::chrono::steady_clock::now();
+    if (opt.rebalanceMs > 0 && now - lastRebalance >= std::chrono::milliseconds(opt.rebalanceMs)) {
+      r.migrations += runtime.rebalance();
+      lastRebalance = now;
+    }
+  }
+  r.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  double busyTotal = 0.0, busyMax = 0.0;
+  for (size_t i = 0; i < shards; i++) {
+    ShardStats st = runtime.stats(i);
+    busyTotal += st.busyMs;
+    busyMax = std::max(busyMax, st.busyMs);
+    if (st.cpu >= 0) r.pinned++;
+    if (st.hugePages) r.hugeShards++;
+  }
+  runtime.stop();
+
+  const double audioSeconds = static_cast<double>(streamCount) *
+      static_cast<double>(source.size() / kRNNoiseFrameSize * kRNNoiseFrameSize) / kSampleRate;
+  r.shards = shards;
+  r.streams = streamCount;
+  r.realtimeStreams = audioSeconds / r.wallSeconds;
+  r.maxShardShare = busyTotal > 0.0 ? busyMax * static_cast<double>(shards) / busyTotal : 0.0;
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  size_t maxShards = opt.maxShards ? opt.maxShards
+                                   : std::max(1u, std::thread::hardware_concurrency());
+  maxShards = std::min(maxShards, kMaxShards);
+
+  SignalMix mix;
+  SignalSpec speech;
+  speech.kind = SignalKind::kSpeech;
+  SignalSpec fan;
+  fan.kind = SignalKind::kFan;
+  fan.seed = 2;
+  mix.add(speech);
+  mix.add(fan);
+  std::vector<float> source(static_cast<size_t>(opt.seconds * kSampleRate));
+  mix.render(source.data(), source.size());
+  if (source.size() < kRNNoiseFrameSize) {
+    std::fprintf(stderr, "ng_shards: --seconds is shorter than one frame\n");
+    return 2;
+  }
+
+  std::vector<size_t> counts;
+  for (size_t n = 1; n < maxShards; n *= 2) counts.push_back(n);
+  counts.push_back(maxShards);
+
+  std::printf("{\"config\":{\"streamsPerShard\":%zu,\"secondsPerStream\":%.3f,"
+              "\"rebalanceMs\":%d,\"pin\":%s},\n\"runs\":[\n",
+              opt.streamsPerShard, opt.seconds, opt.rebalanceMs, opt.pin ? "true" : "false");
+  double perShardBase = 0.0;
+  for (size_t i = 0; i < counts.size(); i++) {
+    std::string err;
+    RunResult r = runOnce(opt, counts[i], source, err);
+    if (!err.empty()) {
+      std::fprintf(stderr, "ng_shards: %s\n", err.c_str());
+      return 2;
+    }
+    double perShard = r.realtimeStreams / static_cast<double>(r.shards);
+    if (i == 0) perShardBase = perShard;
+    std::printf("%s{\"shards\":%zu,\"pinned\":%d,\"hugePageShards\":%d,\"streams\":%zu,\"wallSeconds\":%.3f,"
+                "\"realtimeStreams\":%.1f,\"realtimeStreamsPerShard\":%.1f,"
+                "\"scalingEfficiency\":%.3f,\"busiestShardShare\":%.3f,\"migrations\":%zu}",
+                i ? ",\n" : "", r.shards, r.pinned, r.hugeShards, r.streams, r.wallSeconds,
+                r.realtimeStreams, perShard,
+                perShardBase > 0.0 ? perShard / perShardBase : 0.0,
+                r.maxShardShare, r.migrations);
+    std::fflush(stdout);
+  }
+  std::printf("\n]}\n");
+  return 0;
+}
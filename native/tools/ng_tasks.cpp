@@ -0,0 +1,597 @@
+/**
+ * ng_tasks -- many denoise sessions on the TaskExecutor.
+ *
+ * Server mode (default): opens N StreamDenoiseTasks, of which A are active
+ * (a source task feeds them S seconds of audio as fast as the chain takes
+ * it, a sink task drains their output); the rest stay open and idle, as
+ * connected-but-silent clients would. Reports throughput, what a session
+ * costs in memory, and the CPU the idle sessions burn, as JSON:
+ *
+ *   ng_tasks [--sessions N] [--active A] [--seconds S] [--workers W] [--threads]
+ *   ng_tasks --file <in.wav> <out.wav> [--format pcm16|float] [--workers W]
+ *            [--io auto|uring|threads] [--io-depth D]
+ *   ng_tasks --batch <dir> [--files N] [--seconds S] [--workers W]
+ *            [--io auto|uring|threads|both] [--io-depth D] [--suppression L]
+ *
+ *   --sessions N   sessions opened (default 1000)
+ *   --active A     sessions that receive audio (default 16)
+ *   --seconds S    audio per active session (default 5)
+ *   --workers W    executor threads (default: all cores)
+ *   --threads      baseline instead: one thread per session (idle ones
+ *                  parked on a condition variable), same workload
+ *   --file         offline mode: denoise one mono 48 kHz PCM16 / float WAV
+ *                  with a FileDenoiseTask (other formats: ng_offline --stream)
+ *   --format F     --file output encoding (default: the input's)
+ *   --batch DIR    mass reprocessing: write N synthetic float WAVs of S
+ *                  seconds into DIR, then denoise all of them at once (one
+ *                  FileDenoiseTask each) per I/O backend; reports files/s,
+ *                  MB/s, I/O syscalls, and a hash of the outputs, which
+ *                  must match across backends. --suppression 0 skips the
+ *                  DSP (chain passthrough) to measure the I/O path alone.
+ *                  Inputs are in the page cache; drop it for cold-disk runs.
+ *   --io B         I/O backend (default auto: io_uring where the kernel
+ *                  allows it, else pread/pwrite threads; both: run each)
+ *   --io-depth D   io_uring requests in flight (default 256)
+ *
+ * Memory is the resident set growth while the sessions are open (Linux;
+ * 0 elsewhere). Idle CPU is process CPU time over half a second after the
+ * active sessions finished, with all idle sessions still open.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "audio_file.h"
+#include "denoise_tasks.h"
+#include "signal_gen.h"
+#include "task_executor.h"
+#include "wav_header.h"
+
+using namespace noiseguard;
+
+namespace {
+
+static constexpr double kSampleRate = 48000.0;
+
+/* Channel capacity per direction: four frames. */
+static constexpr size_t kChannelSamples = 4 * kRNNoiseFrameSize;
+
+struct Options {
+  size_t sessions = 1000;
+  size_t active = 16;
+  double seconds = 5.0;
+  size_t workers = 0;
+  bool threads = false;
+  std::string inPath;
+  std::string outPath;
+  std::string format;
+  std::string batchDir;
+  size_t files = 64;
+  std::string io = "auto";
+  unsigned ioDepth = 256;
+  float suppression = 1.0f;
+};
+
+void usage() {
+  std::fprintf(stderr,
+      "usage: ng_tasks [--sessions N] [--active A] [--seconds S] [--workers W] [--threads]\n"
+      "       ng_tasks --file <in.wav> <out.wav> [--format pcm16|float] [--workers W]\n"
+      "                [--io auto|uring|threads] [--io-depth D]\n"
+      "       ng_tasks --batch <dir> [--files N] [--seconds S] [--workers W]\n"
+      "                [--io auto|uring|threads|both] [--io-depth D] [--suppression L]\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& opt) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (a == "--sessions" && hasValue) {
+      opt.sessions = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--active" && hasValue) {
+      opt.active = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (a == "--seconds" && hasValue) {
+      opt.seconds = std::atof(argv[++i]);
+    } else if (a == "--workers" && hasValue) {
+      opt.workers = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--threads") {
+      opt.threads = true;
+    } else if (a == "--file" && i + 2 < argc) {
+      opt.inPath = argv[++i];
+      opt.outPath = argv[++i];
+    } else if (a == "--format" && hasValue) {
+      opt.format = argv[++i];
+      if (opt.format != "pcm16" && opt.format != "float") return false;
+    } else if (a == "--batch" && hasValue) {
+      opt.batchDir = argv[++i];
+    } else if (a == "--files" && hasValue) {
+      opt.files = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--io" && hasValue) {
+      opt.io = argv[++i];
+      if (opt.io != "auto" && opt.io != "uring" && opt.io != "threads" && opt.io != "both") {
+        return false;
+      }
+    } else if (a == "--io-depth" && hasValue) {
+      opt.ioDepth = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+    } else if (a == "--suppression" && hasValue) {
+      opt.suppression = std::clamp(static_cast<float>(std::atof(argv[++i])), 0.0f, 1.0f);
+    } else {
+      return false;
+    }
+  }
+  opt.active = std::min(opt.active, opt.sessions);
+  if (opt.io == "both" && opt.batchDir.empty()) return false;
+  return opt.seconds > 0.0;
+}
+
+IoBackend parseBackend(const std::string& name) {
+  if (name == "uring") return IoBackend::kUring;
+  if (name == "threads") return IoBackend::kThreads;
+  return IoBackend::kAuto;
+}
+
+const char* backendName(IoBackend backend) {
+  return backend == IoBackend::kUring ? "uring" : "threads";
+}
+
+/** Resident set size in bytes (Linux), else 0. */
+size_t residentBytes() {
+#ifdef __linux__
+  FILE* f = std::fopen("/proc/self/statm", "r");
+  if (!f) return 0;
+  unsigned long size = 0, resident = 0;
+  int got = std::fscanf(f, "%lu %lu", &size, &resident);
+  std::fclose(f);
+  return got == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+  return 0;
+#endif
+}
+
+double cpuSeconds() { return static_cast<double>(std::clock()) / CLOCKS_PER_SEC; }
+
+double since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+/** Writes a buffer into a channel, then closes it. */
+struct SourceTask {
+  SourceTask(TaskChannel& ch, const std::vector<float>& src)
+      : channel(ch), source(src), task(&SourceTask::step, this) {}
+
+  static TaskStatus step(Task&, void* ctx) {
+    auto* self = static_cast<SourceTask*>(ctx);
+    self->pos += self->channel.write(self->source.data() + self->pos,
+                                     self->source.size() - self->pos);
+    if (self->pos < self->source.size()) return TaskStatus::kPending;
+    self->channel.close();
+    return TaskStatus::kDone;
+  }
+
+  TaskChannel& channel;
+  const std::vector<float>& source;
+  size_t pos = 0;
+  Task task;
+};
+
+/** Drains a channel until it is closed and empty. */
+struct SinkTask {
+  explicit SinkTask(TaskChannel& ch) : channel(ch), task(&SinkTask::step, this) {}
+
+  static TaskStatus step(Task&, void* ctx) {
+    auto* self = static_cast<SinkTask*>(ctx);
+    for (;;) {
+      const bool closed = self->channel.closed();
+      size_t n = self->channel.read(self->scratch, kRNNoiseFrameSize);
+      self->samples += n;
+      if (n > 0) continue;
+      return closed ? TaskStatus::kDone : TaskStatus::kPending;
+    }
+  }
+
+  TaskChannel& channel;
+  uint64_t samples = 0;
+  float scratch[kRNNoiseFrameSize];
+  Task task;
+};
+
+struct Session {
+  Session() : in(kChannelSamples), out(kChannelSamples), dsp(in, out) {}
+
+  TaskChannel in;
+  TaskChannel out;
+  StreamDenoiseTask dsp;
+};
+
+struct RunResult {
+  size_t threads = 0;
+  double openSeconds = 0.0;
+  double wallSeconds = 0.0;
+  size_t residentGrowth = 0;
+  double idleCpuMs = 0.0;
+  uint64_t samples = 0;
+  ExecutorStats exec;
+};
+
+std::string runTasks(const Options& opt, const std::vector<float>& source, RunResult& r) {
+  TaskExecutor executor;
+  ExecutorConfig config;
+  config.workers = opt.workers;
+  config.ioThreads = 0;  /* No file I/O in server mode */
+  std::string err = executor.start(config);
+  if (!err.empty()) return err;
+  r.threads = executor.workerCount();
+
+  const size_t rss0 = residentBytes();
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::unique_ptr<Session>> sessions;
+  sessions.reserve(opt.sessions);
+  for (size_t i = 0; i < opt.sessions; i++) {
+    sessions.push_back(std::make_unique<Session>());
+    err = sessions.back()->dsp.init();
+    if (!err.empty()) return err;
+    sessions.back()->dsp.spawn(executor);
+  }
+  r.openSeconds = since(t0);
+  r.residentGrowth = residentBytes() - std::min(rss0, residentBytes());
+
+  std::vector<std::unique_ptr<SourceTask>> sources;
+  std::vector<std::unique_ptr<SinkTask>> sinks;
+  for (size_t i = 0; i < opt.active; i++) {
+    Session& s = *sessions[i];
+    sources.push_back(std::make_unique<SourceTask>(s.in, source));
+    sinks.push_back(std::make_unique<SinkTask>(s.out));
+    s.in.bindWriter(&sources.back()->task);
+    s.out.bindReader(&sinks.back()->task);
+  }
+  t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < opt.active; i++) {
+    executor.spawn(sinks[i]->task);
+    executor.spawn(sources[i]->task);
+  }
+  for (size_t i = 0; i < opt.active; i++) {
+    executor.wait(sinks[i]->task);
+    r.samples += sinks[i]->samples;
+  }
+  r.wallSeconds = since(t0);
+
+  double c0 = cpuSeconds();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  r.idleCpuMs = (cpuSeconds() - c0) * 1000.0;
+  r.exec = executor.stats();
+
+  /* Idle sessions never finish; stop the executor before freeing them. */
+  executor.stop();
+  return "";
+}
+
+std::string runThreads(const Options& opt, const std::vector<float>& source, RunResult& r) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool shutdown = false;
+  std::atomic<uint64_t> samples{0};
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  std::atomic<bool> failed{false};
+
+  const size_t rss0 = residentBytes();
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  threads.reserve(opt.sessions);
+  for (size_t i = 0; i < opt.sessions; i++) {
+    const bool active = i < opt.active;
+    threads.emplace_back([&, active] {
+      RNNoiseWrapper chain;
+      if (!chain.init() || !chain.applyParams(RNNoiseWrapper::defaultParams())) failed = true;
+      ready.fetch_add(1);
+      if (active) {
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+        float frame[kRNNoiseFrameSize];
+        for (size_t pos = 0; pos < source.size(); pos += kRNNoiseFrameSize) {
+          size_t n = std::min(kRNNoiseFrameSize, source.size() - pos);
+          std::copy_n(source.data() + pos, n, frame);
+          std::fill(frame + n, frame + kRNNoiseFrameSize, 0.0f);
+          chain.processFrame(frame);
+          samples.fetch_add(n, std::memory_order_relaxed);
+        }
+      }
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return shutdown; });
+    });
+  }
+  while (ready.load() < opt.sessions) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  r.openSeconds = since(t0);
+  r.residentGrowth = residentBytes() - std::min(rss0, residentBytes());
+  r.threads = opt.sessions;
+
+  t0 = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  const uint64_t want = static_cast<uint64_t>(opt.active) * source.size();
+  while (samples.load(std::memory_order_relaxed) < want) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  r.wallSeconds = since(t0);
+  r.samples = samples.load();
+
+  double c0 = cpuSeconds();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  r.idleCpuMs = (cpuSeconds() - c0) * 1000.0;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shutdown = true;
+  }
+  cv.notify_all();
+  for (auto& t : threads) t.join();
+  return failed ? "RNNoise initialization failed" : "";
+}
+
+int runFile(const Options& opt) {
+  AudioFileReader reader;
+  std::string err = reader.open(opt.inPath);
+  const bool pcm16 = !reader.isFloat() && reader.bitsPerSample() == 16;
+  if (err.empty() && (reader.container() != AudioContainer::kWav ||
+                      reader.channels() != 1 || reader.sampleRate() != 48000 ||
+                      !(pcm16 || reader.isFloat()) || reader.frames() == 0)) {
+    err = "--file needs a mono 48 kHz PCM16 or float WAV with a known length "
+          "(use ng_offline --stream for others): " + opt.inPath;
+  }
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_tasks: %s\n", err.c_str());
+    return 2;
+  }
+
+  FileTaskConfig config;
+  config.in = std::fopen(opt.inPath.c_str(), "rb");
+  config.out = std::fopen(opt.outPath.c_str(), "wb+");
+  if (!config.in || !config.out) {
+    std::fprintf(stderr, "ng_tasks: cannot open %s\n",
+                 config.in ? opt.outPath.c_str() : opt.inPath.c_str());
+    return 2;
+  }
+  config.inOffset = reader.dataOffset();
+  config.inEncoding = pcm16 ? AudioFileEncoding::kPcm16 : AudioFileEncoding::kFloat32;
+  config.samples = reader.frames();
+  config.outOffset = kWavHeaderBytes;
+  config.outEncoding = opt.format.empty() ? config.inEncoding
+      : opt.format == "pcm16" ? AudioFileEncoding::kPcm16 : AudioFileEncoding::kFloat32;
+  reader.close();
+
+  const bool outPcm16 = config.outEncoding == AudioFileEncoding::kPcm16;
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, outPcm16 ? kWavFormatPcm : kWavFormatFloat, 1, 48000,
+                outPcm16 ? 16 : 32, config.samples * (outPcm16 ? 2 : 4));
+  bool ok = std::fwrite(header, 1, sizeof(header), config.out) == sizeof(header) &&
+            std::fflush(config.out) == 0;
+
+  TaskExecutor executor;
+  ExecutorConfig execConfig;
+  execConfig.workers = opt.workers;
+  execConfig.ioBackend = parseBackend(opt.io);
+  execConfig.ioDepth = opt.ioDepth;
+  FileDenoiseTask task;
+  auto t0 = std::chrono::steady_clock::now();
+  if (ok) err = executor.start(execConfig);
+  if (ok && err.empty()) err = task.init(config);
+  if (ok && err.empty()) {
+    task.spawn(executor);
+    executor.wait(task.task());
+    err = task.error();
+  }
+  const double wall = since(t0);
+  ExecutorStats st = executor.stats();
+  executor.stop();
+  std::fclose(config.in);
+  ok = std::fclose(config.out) == 0 && ok;
+  if (err.empty() && !ok) err = "Failed writing " + opt.outPath;
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_tasks: %s\n", err.c_str());
+    return 1;
+  }
+
+  std::printf("{\"mode\":\"file\",\"io\":\"%s\",\"samples\":%llu,\"wallSeconds\":%.3f,"
+              "\"realtimeFactor\":%.1f,\"steps\":%llu,\"ioRequests\":%llu}\n",
+              backendName(executor.ioBackend()),
+              static_cast<unsigned long long>(config.samples), wall,
+              static_cast<double>(config.samples) / kSampleRate / std::max(wall, 1e-9),
+              static_cast<unsigned long long>(st.steps),
+              static_cast<unsigned long long>(st.ioRequests));
+  return 0;
+}
+
+struct BatchFile {
+  FILE* in = nullptr;
+  FILE* out = nullptr;
+  FileDenoiseTask task;
+};
+
+/** FNV-1a over a file's bytes. */
+uint64_t hashFile(const std::string& path) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return 0;
+  uint8_t buf[65536];
+  for (size_t n; (n = std::fread(buf, 1, sizeof(buf), f)) > 0;) {
+    for (size_t i = 0; i < n; i++) h = (h ^ buf[i]) * 0x100000001b3ull;
+  }
+  std::fclose(f);
+  return h;
+}
+
+std::string batchPath(const Options& opt, const char* stem, size_t i) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%s_%03zu.wav", stem, i);
+  return opt.batchDir + name;
+}
+
+int runBatch(const Options& opt) {
+  /* Inputs: the same synthetic mix in every file. */
+  SignalMix mix;
+  SignalSpec speech;
+  speech.kind = SignalKind::kSpeech;
+  SignalSpec fan;
+  fan.kind = SignalKind::kFan;
+  fan.seed = 2;
+  mix.add(speech);
+  mix.add(fan);
+  std::vector<float> source(static_cast<size_t>(opt.seconds * kSampleRate));
+  mix.render(source.data(), source.size());
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, kWavFormatFloat, 1, 48000, 32, source.size() * sizeof(float));
+  for (size_t i = 0; i < opt.files; i++) {
+    const std::string path = batchPath(opt, "in", i);
+    FILE* f = std::fopen(path.c_str(), "wb");
+    bool ok = f && std::fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+              std::fwrite(source.data(), sizeof(float), source.size(), f) == source.size();
+    if (!f || std::fclose(f) != 0 || !ok) {
+      std::fprintf(stderr, "ng_tasks: cannot write %s\n", path.c_str());
+      return 2;
+    }
+  }
+
+  std::vector<IoBackend> backends;
+  if (opt.io == "both") {
+    backends = {IoBackend::kThreads, IoBackend::kUring};
+  } else {
+    backends = {parseBackend(opt.io)};
+  }
+  ChainParams params = RNNoiseWrapper::defaultParams();
+  params.level = opt.suppression;
+  const uint64_t fileBytes = source.size() * sizeof(float) * 2;  /* Read + written */
+
+  std::printf("{\"config\":{\"files\":%zu,\"secondsPerFile\":%.3f,\"ioDepth\":%u,"
+              "\"suppression\":%.2f},\n\"runs\":[\n",
+              opt.files, opt.seconds, opt.ioDepth, opt.suppression);
+  for (size_t b = 0; b < backends.size(); b++) {
+    std::vector<std::unique_ptr<BatchFile>> files;
+    std::string err;
+    for (size_t i = 0; i < opt.files && err.empty(); i++) {
+      files.push_back(std::make_unique<BatchFile>());
+      BatchFile& f = *files.back();
+      f.in = std::fopen(batchPath(opt, "in", i).c_str(), "rb");
+      f.out = std::fopen(batchPath(opt, "out", i).c_str(), "wb+");
+      if (!f.in || !f.out || std::fwrite(header, 1, sizeof(header), f.out) != sizeof(header) ||
+          std::fflush(f.out) != 0) {
+        err = "cannot open batch files in " + opt.batchDir;
+        break;
+      }
+      FileTaskConfig config;
+      config.in = f.in;
+      config.inOffset = kWavHeaderBytes;
+      config.samples = source.size();
+      config.out = f.out;
+      config.outOffset = kWavHeaderBytes;
+      err = f.task.init(config, params);
+    }
+
+    TaskExecutor executor;
+    if (err.empty()) {
+      ExecutorConfig config;
+      config.workers = opt.workers;
+      config.ioBackend = backends[b];
+      config.ioDepth = opt.ioDepth;
+      config.ioBuffers = opt.files * FileDenoiseTask::kFileSlots;
+      config.ioBufferBytes = files[0]->task.blockBytes();
+      err = executor.start(config);
+    }
+    double wall = 0.0;
+    if (err.empty()) {
+      auto t0 = std::chrono::steady_clock::now();
+      for (auto& f : files) f->task.spawn(executor);
+      for (auto& f : files) {
+        executor.wait(f->task.task());
+        if (err.empty()) err = f->task.error();
+      }
+      wall = since(t0);
+    }
+    ExecutorStats st = executor.stats();
+    const IoBackend used = executor.ioBackend();
+    const bool fixed = executor.fixedBuffers();
+    executor.stop();
+    for (auto& f : files) {
+      if (f->in) std::fclose(f->in);
+      if (f->out && std::fclose(f->out) != 0 && err.empty()) err = "write failed";
+    }
+    if (!err.empty()) {
+      std::fprintf(stderr, "ng_tasks: %s\n", err.c_str());
+      return 2;
+    }
+
+    uint64_t hash = 0;
+    for (size_t i = 0; i < opt.files; i++) {
+      hash = (hash ^ hashFile(batchPath(opt, "out", i))) * 0x100000001b3ull;
+    }
+    const double bytes = static_cast<double>(fileBytes) * static_cast<double>(opt.files);
+    std::printf("%s{\"io\":\"%s\",\"fixedBuffers\":%s,\"wallSeconds\":%.3f,"
+                "\"filesPerSecond\":%.1f,\"mbPerSecond\":%.1f,\"ioRequests\":%llu,"
+                "\"ioSyscalls\":%llu,\"requestsPerSyscall\":%.1f,\"outputHash\":\"%016llx\"}",
+                b ? ",\n" : "", backendName(used), fixed ? "true" : "false", wall,
+                static_cast<double>(opt.files) / std::max(wall, 1e-9),
+                bytes / 1e6 / std::max(wall, 1e-9),
+                static_cast<unsigned long long>(st.ioRequests),
+                static_cast<unsigned long long>(st.ioSyscalls),
+                static_cast<double>(st.ioRequests) /
+                    static_cast<double>(std::max<uint64_t>(st.ioSyscalls, 1)),
+                static_cast<unsigned long long>(hash));
+  }
+  std::printf("\n]}\n");
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  if (!parseArgs(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (!opt.inPath.empty()) return runFile(opt);
+  if (!opt.batchDir.empty()) return runBatch(opt);
+
+  SignalMix mix;
+  SignalSpec speech;
+  speech.kind = SignalKind::kSpeech;
+  SignalSpec fan;
+  fan.kind = SignalKind::kFan;
+  fan.seed = 2;
+  mix.add(speech);
+  mix.add(fan);
+  std::vector<float> source(static_cast<size_t>(opt.seconds * kSampleRate));
+  mix.render(source.data(), source.size());
+
+  RunResult r;
+  std::string err = opt.threads ? runThreads(opt, source, r) : runTasks(opt, source, r);
+  if (!err.empty()) {
+    std::fprintf(stderr, "ng_tasks: %s\n", err.c_str());
+    return 2;
+  }
+
+  const double audioSeconds = static_cast<double>(r.samples) / kSampleRate;
+  std::printf("{\"mode\":\"%s\",\"sessions\":%zu,\"active\":%zu,\"threads\":%zu,"
+              "\"openSeconds\":%.3f,\"residentBytesPerSession\":%zu,"
+              "\"wallSeconds\":%.3f,\"realtimeStreams\":%.1f,\"idleCpuMs\":%.1f",
+              opt.threads ? "threads" : "tasks", opt.sessions, opt.active, r.threads,
+              r.openSeconds, r.residentGrowth / opt.sessions, r.wallSeconds,
+              audioSeconds / std::max(r.wallSeconds, 1e-9), r.idleCpuMs);
+  if (!opt.threads) {
+    std::printf(",\"steps\":%llu,\"wakes\":%llu",
+                static_cast<unsigned long long>(r.exec.steps),
+                static_cast<unsigned long long>(r.exec.wakes));
+  }
+  std::printf("}\n");
+  return 0;
+}
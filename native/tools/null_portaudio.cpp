@@ -0,0 +1,256 @@
+/**
+ * null_portaudio -- a headless PortAudio backend for tools that run the real
+ * AudioEngine without audio hardware (ng_rtcheck).
+ *
+ * Implements the subset of the PortAudio API the engine, HostSession and
+ * LatencyTuner call, against two fake devices:
+ *
+ *   0  "Null Input"   mono capture of synthetic speech over fan noise
+ *                     (signal_gen.h), in paFloat32, paInt16 or paInt24
+ *   1  "Null Output"  mono playback into nowhere
+ *
+ * Each started stream runs its callback on its own thread, paced by the
+ * wall clock at framesPerBuffer / sampleRate, the way a device would. The
+ * stream thread does no allocations between callbacks, so anything the
+ * real-time checker reports inside them belongs to the engine.
+ *
+ * Link this INSTEAD of libportaudio.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "portaudio.h"
+#include "signal_gen.h"
+
+namespace {
+
+using noiseguard::SignalKind;
+using noiseguard::SignalMix;
+using noiseguard::SignalSpec;
+
+/* Device indices. */
+static constexpr PaDeviceIndex kNullInput = 0;
+static constexpr PaDeviceIndex kNullOutput = 1;
+
+/* Latency the fake devices report (s): one 10 ms buffer. */
+static constexpr double kNullLatency = 0.010;
+
+const PaHostApiInfo kHostApi = {
+    1, paInDevelopment, "Null", 2, kNullInput, kNullOutput,
+};
+
+const PaDeviceInfo kDevices[2] = {
+    {2, "Null Input", 0, 1, 0, kNullLatency, kNullLatency, kNullLatency, kNullLatency, 48000.0},
+    {2, "Null Output", 0, 0, 1, kNullLatency, kNullLatency, kNullLatency, kNullLatency, 48000.0},
+};
+
+std::atomic<int> g_initCount{0};
+
+struct NullStream {
+  bool input = false;
+  PaSampleFormat format = paFloat32;
+  unsigned long frames = 0;
+  double sampleRate = 48000.0;
+  PaStreamCallback* callback = nullptr;
+  void* userData = nullptr;
+  PaStreamInfo info = {};
+
+  std::atomic<bool> running{false};
+  std::thread thread;
+
+  /* Sized at open time; the stream thread only reuses them. */
+  std::vector<float> samples;
+  std::vector<uint8_t> raw;
+  SignalMix source;
+};
+
+/** Input: render the next buffer of the source in the stream's sample format. */
+void fillInput(NullStream& s) {
+  s.source.render(s.samples.data(), s.frames);
+  if (s.format == paInt16) {
+    auto* out = reinterpret_cast<int16_t*>(s.raw.data());
+    for (unsigned long i = 0; i < s.frames; i++) {
+      float v = std::min(1.0f, std::max(-1.0f, s.samples[i]));
+      out[i] = static_cast<int16_t>(v * 32767.0f);
+    }
+  } else if (s.format == paInt24) {
+    uint8_t* out = s.raw.data();
+    for (unsigned long i = 0; i < s.frames; i++) {
+      float v = std::min(1.0f, std::max(-1.0f, s.samples[i]));
+      int32_t x = static_cast<int32_t>(v * 8388607.0f);
+      out[3 * i] = static_cast<uint8_t>(x);
+      out[3 * i + 1] = static_cast<uint8_t>(x >> 8);
+      out[3 * i + 2] = static_cast<uint8_t>(x >> 16);
+    }
+  }
+}
+
+void runStream(NullStream* s) {
+  using Clock = std::chrono::steady_clock;
+  const auto period = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(static_cast<double>(s->frames) / s->sampleRate));
+  const void* in = nullptr;
+  void* out = nullptr;
+  if (s->input) {
+    in = (s->format == paFloat32) ? static_cast<const void*>(s->samples.data())
+                                  : static_cast<const void*>(s->raw.data());
+  } else {
+    out = s->samples.data();
+  }
+
+  PaStreamCallbackTimeInfo timeInfo = {};
+  auto next = Clock::now();
+  while (s->running.load(std::memory_order_acquire)) {
+    if (s->input) fillInput(*s);
+    int result = s->callback(in, out, s->frames, &timeInfo, 0, s->userData);
+    if (result != paContinue) break;
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+}
+
+size_t bytesPerSample(PaSampleFormat format) {
+  if (format == paInt16) return 2;
+  if (format == paInt24) return 3;
+  return 4;
+}
+
+}  // namespace
+
+/* ═══ PortAudio API subset ═══ */
+
+extern "C" {
+
+PaError Pa_Initialize(void) {
+  g_initCount.fetch_add(1);
+  return paNoError;
+}
+
+PaError Pa_Terminate(void) {
+  int prev = g_initCount.load();
+  while (prev > 0 && !g_initCount.compare_exchange_weak(prev, prev - 1)) {
+  }
+  return prev > 0 ? paNoError : paNotInitialized;
+}
+
+const char* Pa_GetErrorText(PaError err) {
+  switch (err) {
+    case paNoError: return "Success";
+    case paNotInitialized: return "PortAudio not initialized";
+    case paInvalidChannelCount: return "Invalid number of channels";
+    case paInvalidDevice: return "Invalid device";
+    case paSampleFormatNotSupported: return "Sample format not supported";
+    case paNullCallback: return "No callback routine specified";
+    case paBadStreamPtr: return "Invalid stream pointer";
+    case paStreamIsStopped: return "Stream is stopped";
+    case paStreamIsNotStopped: return "Stream is not stopped";
+    default: return "Invalid error code";
+  }
+}
+
+PaHostApiIndex Pa_GetHostApiCount(void) { return g_initCount.load() > 0 ? 1 : paNotInitialized; }
+
+const PaHostApiInfo* Pa_GetHostApiInfo(PaHostApiIndex index) {
+  return index == 0 ? &kHostApi : nullptr;
+}
+
+PaDeviceIndex Pa_GetDeviceCount(void) { return g_initCount.load() > 0 ? 2 : paNotInitialized; }
+
+const PaDeviceInfo* Pa_GetDeviceInfo(PaDeviceIndex device) {
+  return (device == kNullInput || device == kNullOutput) ? &kDevices[device] : nullptr;
+}
+
+PaDeviceIndex Pa_GetDefaultInputDevice(void) { return kNullInput; }
+PaDeviceIndex Pa_GetDefaultOutputDevice(void) { return kNullOutput; }
+
+PaError Pa_OpenStream(PaStream** stream, const PaStreamParameters* inputParameters,
+                      const PaStreamParameters* outputParameters, double sampleRate,
+                      unsigned long framesPerBuffer, PaStreamFlags /*streamFlags*/,
+                      PaStreamCallback* streamCallback, void* userData) {
+  if (!stream) return paBadStreamPtr;
+  if (g_initCount.load() <= 0) return paNotInitialized;
+  if (!streamCallback) return paNullCallback;
+  /* One direction per stream, mono, like the engine opens them. */
+  if ((inputParameters != nullptr) == (outputParameters != nullptr)) {
+    return paBadIODeviceCombination;
+  }
+  const PaStreamParameters* p = inputParameters ? inputParameters : outputParameters;
+  if (p->device != (inputParameters ? kNullInput : kNullOutput)) return paInvalidDevice;
+  if (p->channelCount != 1) return paInvalidChannelCount;
+  if (p->sampleFormat != paFloat32 &&
+      !(inputParameters && (p->sampleFormat == paInt16 || p->sampleFormat == paInt24))) {
+    return paSampleFormatNotSupported;
+  }
+  if (sampleRate <= 0.0) return paInvalidSampleRate;
+
+  auto* s = new NullStream();
+  s->input = inputParameters != nullptr;
+  s->format = p->sampleFormat;
+  s->frames = framesPerBuffer > 0 ? framesPerBuffer : 480;
+  s->sampleRate = sampleRate;
+  s->callback = streamCallback;
+  s->userData = userData;
+  s->info.structVersion = 1;
+  s->info.inputLatency = s->input ? kNullLatency : 0.0;
+  s->info.outputLatency = s->input ? 0.0 : kNullLatency;
+  s->info.sampleRate = sampleRate;
+  s->samples.assign(s->frames, 0.0f);
+  if (s->input) {
+    s->raw.assign(s->frames * bytesPerSample(s->format), 0);
+    SignalSpec speech;
+    speech.kind = SignalKind::kSpeech;
+    s->source.add(speech);
+    SignalSpec fan;
+    fan.kind = SignalKind::kFan;
+    s->source.add(fan);
+  }
+  *stream = s;
+  return paNoError;
+}
+
+PaError Pa_StartStream(PaStream* stream) {
+  auto* s = static_cast<NullStream*>(stream);
+  if (!s) return paBadStreamPtr;
+  if (s->running.load()) return paStreamIsNotStopped;
+  if (s->thread.joinable()) s->thread.join();  /* Callback ended the last run. */
+  s->running.store(true, std::memory_order_release);
+  s->thread = std::thread(runStream, s);
+  return paNoError;
+}
+
+PaError Pa_StopStream(PaStream* stream) {
+  auto* s = static_cast<NullStream*>(stream);
+  if (!s) return paBadStreamPtr;
+  bool wasRunning = s->running.exchange(false, std::memory_order_acq_rel);
+  if (s->thread.joinable()) s->thread.join();
+  return wasRunning ? paNoError : paStreamIsStopped;
+}
+
+PaError Pa_AbortStream(PaStream* stream) { return Pa_StopStream(stream); }
+
+PaError Pa_CloseStream(PaStream* stream) {
+  auto* s = static_cast<NullStream*>(stream);
+  if (!s) return paBadStreamPtr;
+  Pa_StopStream(s);
+  delete s;
+  return paNoError;
+}
+
+PaError Pa_IsStreamActive(PaStream* stream) {
+  auto* s = static_cast<NullStream*>(stream);
+  if (!s) return paBadStreamPtr;
+  return s->running.load() ? 1 : 0;
+}
+
+const PaStreamInfo* Pa_GetStreamInfo(PaStream* stream) {
+  auto* s = static_cast<NullStream*>(stream);
+  return s ? &s->info : nullptr;
+}
+
+}  // extern "C"
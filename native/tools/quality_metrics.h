@@ -0,0 +1,279 @@
+/**
+ * Objective quality metrics for the benchmark tools (ng_bench).
+ *
+ * All functions take time-aligned, equal-length mono signals at 48 kHz:
+ * clean reference x and a degraded/processed signal y. They are meant for
+ * regression tracking between builds and parameter sets, not as
+ * calibrated perceptual scores:
+ *
+ *   siSnr()         scale-invariant SNR (dB): y projected onto x, so the
+ *                   chain's fixed gain and band-limiting count only as far
+ *                   as they are not a plain gain
+ *   segmentalSnr()  mean per-10 ms SNR (dB, clamped to [-10, 35]) over
+ *                   frames where x is active
+ *   stoiLike()      STOI-style intelligibility estimate [0, 1]: correlation
+ *                   of 1/3-octave band envelopes over ~384 ms segments,
+ *                   after dropping silent frames (Taal et al. 2011, run at
+ *                   48 kHz without the 10 kHz resampling)
+ *   onsetClipping() how much of each speech onset survives: gain of y on x
+ *                   over the first 30 ms after >= 200 ms of silence
+ *
+ * Not real-time safe (allocates); tools only.
+ */
+
+#ifndef NOISEGUARD_TOOLS_QUALITY_METRICS_H
+#define NOISEGUARD_TOOLS_QUALITY_METRICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace noiseguard {
+namespace quality {
+
+/* Activity detection: frames within this range of the loudest frame. */
+static constexpr double kActiveRangeDb = 40.0;
+
+/* Segmental SNR frame (10 ms) and per-frame clamp. */
+static constexpr size_t kSegFrame = 480;
+static constexpr double kSegSnrMin = -10.0;
+static constexpr double kSegSnrMax = 35.0;
+
+/* STOI-like analysis: 1024-sample Hann frames, 50 % overlap, 2048-point FFT. */
+static constexpr size_t kStoiFrame = 1024;
+static constexpr size_t kStoiHop = kStoiFrame / 2;
+static constexpr size_t kStoiFft = 2048;
+static constexpr int kStoiBands = 15;          /* 1/3-octave, from 150 Hz */
+static constexpr double kStoiLowestCenter = 150.0;
+static constexpr size_t kStoiSegment = 36;      /* Frames per segment (~384 ms) */
+static constexpr double kStoiClipDb = -15.0;    /* Lower SDR bound (beta) */
+
+/* Onsets: >= 20 inactive 10 ms frames, then 3 frames (30 ms) examined. */
+static constexpr size_t kOnsetSilentFrames = 20;
+static constexpr size_t kOnsetFrames = 3;
+static constexpr double kOnsetClippedDb = -6.0;
+
+static constexpr double kSampleRate = 48000.0;
+static constexpr double kPi = 3.14159265358979323846;
+static constexpr double kTiny = 1e-20;
+
+inline double energy(const float* x, size_t n) {
+  double e = 0.0;
+  for (size_t i = 0; i < n; i++) e += static_cast<double>(x[i]) * x[i];
+  return e;
+}
+
+inline double dot(const float* x, const float* y, size_t n) {
+  double d = 0.0;
+  for (size_t i = 0; i < n; i++) d += static_cast<double>(x[i]) * y[i];
+  return d;
+}
+
+/** Per-10 ms-frame activity of x (energy within kActiveRangeDb of the max). */
+inline std::vector<bool> activeFrames(const std::vector<float>& x) {
+  size_t frames = x.size() / kSegFrame;
+  std::vector<double> e(frames);
+  double maxE = 0.0;
+  for (size_t f = 0; f < frames; f++) {
+    e[f] = energy(&x[f * kSegFrame], kSegFrame);
+    maxE = std::max(maxE, e[f]);
+  }
+  double threshold = maxE * std::pow(10.0, -kActiveRangeDb / 10.0);
+  std::vector<bool> active(frames);
+  for (size_t f = 0; f < frames; f++) active[f] = maxE > 0.0 && e[f] > threshold;
+  return active;
+}
+
+inline double siSnr(const std::vector<float>& x, const std::vector<float>& y) {
+  size_t n = std::min(x.size(), y.size());
+  double xx = energy(x.data(), n);
+  if (xx <= 0.0) return 0.0;
+  double alpha = dot(x.data(), y.data(), n) / xx;
+  double target = alpha * alpha * xx;
+  double err = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    double d = y[i] - alpha * x[i];
+    err += d * d;
+  }
+  return 10.0 * std::log10((target + kTiny) / (err + kTiny));
+}
+
+inline double segmentalSnr(const std::vector<float>& x, const std::vector<float>& y,
+                           const std::vector<bool>& active) {
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t f = 0; f < active.size(); f++) {
+    if (!active[f]) continue;
+    const float* xf = &x[f * kSegFrame];
+    const float* yf = &y[f * kSegFrame];
+    double err = 0.0;
+    for (size_t i = 0; i < kSegFrame; i++) {
+      double d = static_cast<double>(yf[i]) - xf[i];
+      err += d * d;
+    }
+    double snr = 10.0 * std::log10((energy(xf, kSegFrame) + kTiny) / (err + kTiny));
+    sum += std::min(kSegSnrMax, std::max(kSegSnrMin, snr));
+    count++;
+  }
+  return count ? sum / static_cast<double>(count) : 0.0;
+}
+
+/** In-place iterative radix-2 FFT; a.size() must be a power of two. */
+inline void fft(std::vector<std::complex<double>>& a) {
+  const size_t n = a.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (size_t len = 2; len <= n; len <<= 1) {
+    double ang = -2.0 * kPi / static_cast<double>(len);
+    std::complex<double> wl(std::cos(ang), std::sin(ang));
+    for (size_t i = 0; i < n; i += len) {
+      std::complex<double> w(1.0, 0.0);
+      for (size_t k = 0; k < len / 2; k++) {
+        std::complex<double> u = a[i + k];
+        std::complex<double> v = a[i + k + len / 2] * w;
+        a[i + k] = u + v;
+        a[i + k + len / 2] = u - v;
+        w *= wl;
+      }
+    }
+  }
+}
+
+/** Band envelopes [frame][band] of s over the given analysis frames. */
+inline std::vector<std::vector<double>> bandEnvelopes(const std::vector<float>& s,
+                                                      const std::vector<size_t>& starts) {
+  static const std::vector<double> window = [] {
+    std::vector<double> w(kStoiFrame);
+    for (size_t i = 0; i < kStoiFrame; i++) {
+      w[i] = 0.5 - 0.5 * std::cos(2.0 * kPi * static_cast<double>(i) / kStoiFrame);
+    }
+    return w;
+  }();
+
+  /* Bin ranges of the 1/3-octave bands. */
+  size_t lo[kStoiBands], hi[kStoiBands];
+  const double binHz = kSampleRate / kStoiFft;
+  for (int b = 0; b < kStoiBands; b++) {
+    double center = kStoiLowestCenter * std::pow(2.0, b / 3.0);
+    lo[b] = static_cast<size_t>(std::lround(center * std::pow(2.0, -1.0 / 6.0) / binHz));
+    hi[b] = static_cast<size_t>(std::lround(center * std::pow(2.0, 1.0 / 6.0) / binHz));
+  }
+
+  std::vector<std::vector<double>> env(starts.size(), std::vector<double>(kStoiBands));
+  std::vector<std::complex<double>> buf(kStoiFft);
+  for (size_t f = 0; f < starts.size(); f++) {
+    std::fill(buf.begin(), buf.end(), std::complex<double>());
+    for (size_t i = 0; i < kStoiFrame; i++) buf[i] = s[starts[f] + i] * window[i];
+    fft(buf);
+    for (int b = 0; b < kStoiBands; b++) {
+      double e = 0.0;
+      for (size_t k = lo[b]; k < hi[b]; k++) e += std::norm(buf[k]);
+      env[f][b] = std::sqrt(e);
+    }
+  }
+  return env;
+}
+
+inline double stoiLike(const std::vector<float>& x, const std::vector<float>& y) {
+  size_t n = std::min(x.size(), y.size());
+  if (n < kStoiFrame) return 0.0;
+
+  /* Analysis frames, minus those where the clean signal is silent. */
+  std::vector<size_t> all;
+  std::vector<double> e;
+  double maxE = 0.0;
+  for (size_t s = 0; s + kStoiFrame <= n; s += kStoiHop) {
+    all.push_back(s);
+    e.push_back(energy(&x[s], kStoiFrame));
+    maxE = std::max(maxE, e.back());
+  }
+  double threshold = maxE * std::pow(10.0, -kActiveRangeDb / 10.0);
+  std::vector<size_t> starts;
+  for (size_t i = 0; i < all.size(); i++) {
+    if (e[i] > threshold) starts.push_back(all[i]);
+  }
+  if (starts.size() < kStoiSegment) return 0.0;
+
+  auto X = bandEnvelopes(x, starts);
+  auto Y = bandEnvelopes(y, starts);
+  const double clip = 1.0 + std::pow(10.0, -kStoiClipDb / 20.0);
+
+  double sum = 0.0;
+  size_t count = 0;
+  double xs[kStoiSegment], ys[kStoiSegment];
+  for (size_t end = kStoiSegment; end <= starts.size(); end++) {
+    for (int b = 0; b < kStoiBands; b++) {
+      double xNorm = 0.0, yNorm = 0.0;
+      for (size_t m = 0; m < kStoiSegment; m++) {
+        xs[m] = X[end - kStoiSegment + m][b];
+        ys[m] = Y[end - kStoiSegment + m][b];
+        xNorm += xs[m] * xs[m];
+        yNorm += ys[m] * ys[m];
+      }
+      /* Normalize y's energy to x's, then bound its distortion. */
+      double alpha = std::sqrt(xNorm / (yNorm + kTiny));
+      double xMean = 0.0, yMean = 0.0;
+      for (size_t m = 0; m < kStoiSegment; m++) {
+        ys[m] = std::min(alpha * ys[m], clip * xs[m]);
+        xMean += xs[m];
+        yMean += ys[m];
+      }
+      xMean /= kStoiSegment;
+      yMean /= kStoiSegment;
+      double sxy = 0.0, sxx = 0.0, syy = 0.0;
+      for (size_t m = 0; m < kStoiSegment; m++) {
+        double dx = xs[m] - xMean, dy = ys[m] - yMean;
+        sxy += dx * dy;
+        sxx += dx * dx;
+        syy += dy * dy;
+      }
+      sum += sxy / (std::sqrt(sxx * syy) + kTiny);
+      count++;
+    }
+  }
+  return count ? sum / static_cast<double>(count) : 0.0;
+}
+
+struct OnsetStats {
+  size_t onsets = 0;
+  size_t clipped = 0;          /* Onsets attenuated by more than 6 dB */
+  double meanGainDb = 0.0;     /* Mean onset gain of y relative to x */
+};
+
+inline OnsetStats onsetClipping(const std::vector<float>& x, const std::vector<float>& y,
+                                const std::vector<bool>& active) {
+  OnsetStats s;
+  double sumDb = 0.0;
+  size_t silent = 0;
+  for (size_t f = 0; f + kOnsetFrames <= active.size(); f++) {
+    if (!active[f]) {
+      silent++;
+      continue;
+    }
+    if (silent >= kOnsetSilentFrames) {
+      const float* xf = &x[f * kSegFrame];
+      const float* yf = &y[f * kSegFrame];
+      const size_t len = kOnsetFrames * kSegFrame;
+      /* Least-squares gain of y on x: residual noise does not count. */
+      double g = dot(xf, yf, len) / (energy(xf, len) + kTiny);
+      double db = 20.0 * std::log10(std::max(g, 1e-5));
+      sumDb += db;
+      s.onsets++;
+      if (db < kOnsetClippedDb) s.clipped++;
+    }
+    silent = 0;
+  }
+  if (s.onsets) s.meanGainDb = sumDb / static_cast<double>(s.onsets);
+  return s;
+}
+
+}  // namespace quality
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_TOOLS_QUALITY_METRICS_H
@@ -0,0 +1,26 @@
+/**
+ * rnnoise_layout_check -- build-time guard for src/rnnoise_state.c.
+ *
+ * rnnoise_state.c reads RNNoise's private DenoiseState layout. The build
+ * runs this right after linking it against the fetched library (commit
+ * pinned in native/rnnoise.lock), so moving the pin to a commit with a
+ * different layout fails the build instead of corrupting states at run
+ * time.
+ *
+ * Exit status: 0 = layout as expected, 1 = not.
+ */
+
+#include <stdio.h>
+
+#include "rnnoise_state.h"
+
+int main(void) {
+  if (ng_rnnoise_layout_ok()) {
+    printf("rnnoise_layout_check: ok (%zu arena bytes per state)\n", ng_rnnoise_arena_bytes());
+    return 0;
+  }
+  fprintf(stderr,
+          "rnnoise_layout_check: DenoiseState does not end with its RNNState in this\n"
+          "RNNoise commit; src/rnnoise_state.c must be updated before the pin moves.\n");
+  return 1;
+}
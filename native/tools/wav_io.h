@@ -0,0 +1,123 @@
+/**
+ * Whole-file WAV reading/writing for the developer tools.
+ *
+ * Reads PCM 16/24/32-bit and IEEE float 32-bit files of any channel count,
+ * downmixed to mono normalized floats. Unknown chunks (LIST, fact, ...) are
+ * skipped. Not used by the addon; the real-time writers stream through
+ * wav_header.h instead.
+ */
+
+#ifndef NOISEGUARD_TOOLS_WAV_IO_H
+#define NOISEGUARD_TOOLS_WAV_IO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "wav_header.h"
+
+namespace noiseguard {
+
+struct WavData {
+  uint32_t sampleRate = 0;
+  std::vector<float> samples;  /* Mono, normalized [-1, 1] */
+};
+
+/** Load path into out. Empty string on success, or an error. */
+inline std::string readWav(const std::string& path, WavData& out) {
+  FILE* f = std::fopen(path.c_str(), "rb");
+  if (!f) return "Cannot open " + path;
+
+  auto u16 = [](const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); };
+  auto u32 = [](const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  };
+
+  uint8_t riff[12];
+  if (std::fread(riff, 1, 12, f) != 12 || std::memcmp(riff, "RIFF", 4) != 0 ||
+      std::memcmp(riff + 8, "WAVE", 4) != 0) {
+    std::fclose(f);
+    return "Not a WAV file: " + path;
+  }
+
+  uint16_t format = 0, channels = 0, bits = 0;
+  uint32_t rate = 0;
+  std::vector<uint8_t> data;
+  uint8_t chunk[8];
+  while (std::fread(chunk, 1, 8, f) == 8) {
+    uint32_t size = u32(chunk + 4);
+    if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      std::vector<uint8_t> fmt(size);
+      if (std::fread(fmt.data(), 1, size, f) != size) break;
+      format = u16(&fmt[0]);
+      channels = u16(&fmt[2]);
+      rate = u32(&fmt[4]);
+      bits = u16(&fmt[14]);
+      /* WAVE_FORMAT_EXTENSIBLE: the real tag leads the subformat GUID. */
+      if (format == 0xFFFE && size >= 26) format = u16(&fmt[24]);
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      data.resize(size);
+      data.resize(std::fread(data.data(), 1, size, f));  /* Tolerate truncation */
+      break;
+    } else if (std::fseek(f, static_cast<long>(size), SEEK_CUR) != 0) {
+      break;
+    }
+    if (size & 1) std::fseek(f, 1, SEEK_CUR);  /* Chunks are word-aligned */
+  }
+  std::fclose(f);
+
+  bool pcm = format == kWavFormatPcm && (bits == 16 || bits == 24 || bits == 32);
+  bool flt = format == kWavFormatFloat && bits == 32;
+  if (channels == 0 || (!pcm && !flt)) {
+    return "Unsupported WAV encoding (need PCM 16/24/32 or float 32): " + path;
+  }
+
+  size_t bytes = bits / 8;
+  size_t frames = data.size() / (bytes * channels);
+  out.sampleRate = rate;
+  out.samples.assign(frames, 0.0f);
+  const float downmix = 1.0f / static_cast<float>(channels);
+  const uint8_t* p = data.data();
+  for (size_t i = 0; i < frames; i++) {
+    float sum = 0.0f;
+    for (uint16_t c = 0; c < channels; c++, p += bytes) {
+      if (flt) {
+        float v;
+        std::memcpy(&v, p, sizeof(v));
+        sum += v;
+      } else if (bits == 16) {
+        sum += static_cast<float>(static_cast<int16_t>(u16(p))) / 32768.0f;
+      } else if (bits == 24) {
+        /* Assemble into the top 24 bits so the shift sign-extends. */
+        int32_t v = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) |
+                                         (static_cast<uint32_t>(p[1]) << 16) |
+                                         (static_cast<uint32_t>(p[2]) << 24)) >> 8;
+        sum += static_cast<float>(v) / 8388608.0f;
+      } else {
+        sum += static_cast<float>(static_cast<int32_t>(u32(p)) / 2147483648.0);
+      }
+    }
+    out.samples[i] = sum * downmix;
+  }
+  return "";
+}
+
+/** Write mono normalized floats as a 32-bit float WAV. */
+inline std::string writeWav(const std::string& path, const float* samples,
+                            size_t count, uint32_t sampleRate) {
+  FILE* f = std::fopen(path.c_str(), "wb");
+  if (!f) return "Cannot open " + path;
+  uint8_t header[kWavHeaderBytes];
+  fillWavHeader(header, kWavFormatFloat, 1, sampleRate, 32, uint64_t{count} * sizeof(float));
+  bool ok = std::fwrite(header, 1, sizeof(header), f) == sizeof(header) &&
+            std::fwrite(samples, sizeof(float), count, f) == count;
+  ok = (std::fclose(f) == 0) && ok;
+  return ok ? "" : "Failed writing " + path;
+}
+
+}  // namespace noiseguard
+
+#endif  // NOISEGUARD_TOOLS_WAV_IO_H
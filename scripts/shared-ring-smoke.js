@@ -0,0 +1,115 @@
+/**
+ * NoiseGuard - shared-memory output smoke test
+ *
+ * Attaches a SharedArrayBuffer ring (native/lib/shared_ring_worklet.js) to
+ * a NoiseGuardEngine, runs it on a capture device and drains the ring from
+ * a worker_threads Worker, the way an in-process consumer would.
+ *
+ * Usage:
+ *   node scripts/shared-ring-smoke.js [--input <device id | index>] [--seconds S]
+ *
+ * Needs the addon built for Node (node-gyp rebuild in native/) and a
+ * working capture device (default: the system default input). Prints one
+ * JSON line. Exit status: 0 = whole frames arrived, 1 = none or torn
+ * frames, 2 = the engine could not start.
+ */
+
+'use strict';
+
+const path = require('path');
+const { Worker, isMainThread, parentPort, workerData } = require('worker_threads');
+const { createSharedRing, SharedRingReader } =
+    require('../native/lib/shared_ring_worklet');
+
+const FRAME_SAMPLES = 480;  /* The engine publishes whole RNNoise frames. */
+const WAIT_MS = 5;          /* Native writes cannot wake Atomics.wait(). */
+
+/* ── Worker: drain the ring until told to stop ───────────────────────────── */
+
+function consume({ ring, control }) {
+  const reader = new SharedRingReader(ring);
+  const stop = new Int32Array(control);
+  const block = new Float32Array(FRAME_SAMPLES * 4);
+  let samples = 0;
+  let peak = 0;
+
+  while (Atomics.load(stop, 0) === 0) {
+    reader.waitForData(WAIT_MS);
+    let n;
+    while ((n = reader.read(block)) > 0) {
+      samples += n;
+      for (let i = 0; i < n; i++) peak = Math.max(peak, Math.abs(block[i]));
+    }
+  }
+  parentPort.postMessage({ samples, peak, dropped: reader.dropped() });
+}
+
+/* ── Main thread: engine + worker ────────────────────────────────────────── */
+
+function parseArgs(argv) {
+  const opts = { input: -1, seconds: 3 };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--input' && i + 1 < argv.length) {
+      const v = argv[++i];
+      opts.input = /^-?\d+$/.test(v) ? Number(v) : v;
+    } else if (argv[i] === '--seconds' && i + 1 < argv.length) {
+      opts.seconds = Number(argv[++i]);
+    } else {
+      return null;
+    }
+  }
+  return opts.seconds > 0 ? opts : null;
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  if (!opts) {
+    console.error('usage: node scripts/shared-ring-smoke.js [--input <id | index>] [--seconds S]');
+    return 2;
+  }
+
+  const addon = require(path.join(__dirname, '..', 'build', 'Release', 'noiseguard.node'));
+  const engine = new addon.NoiseGuardEngine();
+  const ring = createSharedRing();
+  const control = new SharedArrayBuffer(4);
+
+  let err = engine.attachSharedOutput(new Int32Array(ring));
+  if (!err) err = engine.start(opts.input, -2);  /* -2: capture only */
+  if (err) {
+    console.error(`shared-ring-smoke: ${err}`);
+    engine.close();
+    return 2;
+  }
+
+  const worker = new Worker(__filename, { workerData: { ring, control } });
+  const result = new Promise((resolve, reject) => {
+    worker.once('message', resolve);
+    worker.once('error', reject);
+  });
+
+  await new Promise((resolve) => setTimeout(resolve, opts.seconds * 1000));
+  Atomics.store(new Int32Array(control), 0, 1);
+  const { samples, peak, dropped } = await result;
+  const frames = engine.getMetrics().framesProcessed;
+  engine.close();
+
+  const ok = samples > 0 && samples % FRAME_SAMPLES === 0;
+  console.log(JSON.stringify({
+    seconds: opts.seconds,
+    framesProcessed: frames,
+    framesRead: samples / FRAME_SAMPLES,
+    samplesDropped: dropped,
+    peak: Number(peak.toFixed(4)),
+    ok,
+  }));
+  return ok ? 0 : 1;
+}
+
+if (isMainThread) {
+  main().then((status) => { process.exitCode = status; }, (e) => {
+    console.error(`shared-ring-smoke: ${e.message}`);
+    process.exitCode = 2;
+  });
+} else {
+  consume(workerData);
+}